@@ -21,6 +21,7 @@ from .ext_libgwatch_binding import *
 from .ext_libgwatch_scheduler import *
 from .ext_libgwatch_profiler import *
 from .ext_libgwatch_instrumentation import *
+from .ext_gwatch_bench import *
 from .ext_gtrace import *
 
 
@@ -74,6 +75,15 @@ class BuildCommand(_build):
             build_tasks += [build_gwatch_profiler]
         if "gtrace" in self.targets:
             build_tasks += [build_and_install_gtrace]
+        if "bench" in self.targets:
+            build_tasks += [
+                build_gwatch_bench_lockfree_table,
+                build_gwatch_bench_rcu_map,
+                build_gwatch_bench_reg_reuse,
+                build_gwatch_bench_sass_format,
+                build_gwatch_bench_trace_decoder,
+                build_gwatch_bench_ts_batch
+            ]
 
         # make build options
         opt: _BuildOptions = _BuildOptions()
@@ -0,0 +1,82 @@
+import glob
+import copy
+from setuptools import setup, Extension, Command, find_packages
+from ._utils import *
+from ._common import *
+from typing import Tuple
+
+
+# ==================== Benchmark Executables ====================
+def _build_gwatch_bench(name: str, source: str) -> Tuple[str,str,bool]:
+    # sources
+    bench_exe_sources = copy.deepcopy(common_sources)
+    bench_exe_sources += [ source ]
+
+    # includes
+    bench_exe_includes = copy.deepcopy(common_includes)
+
+    # ldflags
+    bench_exe_ldflags = copy.deepcopy(common_ldflags)
+
+    # cflags
+    bench_exe_cflags = copy.deepcopy(common_cflags)
+
+    product_path, ok = build_with_meson(
+        name = name,
+        sources=bench_exe_sources,
+        includes=bench_exe_includes,
+        ldflags=bench_exe_ldflags,
+        cflags=bench_exe_cflags,
+        root_dir=root_dir,
+        version=common_version,
+        type="exe"
+    )
+
+    # benchmarks are run from the build directory, and aren't distributed
+    return "bench", product_path, ok
+
+
+def build_gwatch_bench_lockfree_table(opt: _BuildOptions) -> Tuple[str,str,bool]:
+    return _build_gwatch_bench(
+        "gwatch_bench_lockfree_table", f"{root_dir}/src/common/utils/bench/lockfree_table_bench.cpp"
+    )
+
+
+def build_gwatch_bench_rcu_map(opt: _BuildOptions) -> Tuple[str,str,bool]:
+    return _build_gwatch_bench(
+        "gwatch_bench_rcu_map", f"{root_dir}/src/common/utils/bench/rcu_map_bench.cpp"
+    )
+
+
+def build_gwatch_bench_reg_reuse(opt: _BuildOptions) -> Tuple[str,str,bool]:
+    return _build_gwatch_bench(
+        "gwatch_bench_reg_reuse", f"{root_dir}/src/common/utils/bench/reg_reuse_bench.cpp"
+    )
+
+
+def build_gwatch_bench_sass_format(opt: _BuildOptions) -> Tuple[str,str,bool]:
+    return _build_gwatch_bench(
+        "gwatch_bench_sass_format", f"{root_dir}/src/common/utils/bench/sass_format_bench.cpp"
+    )
+
+
+def build_gwatch_bench_trace_decoder(opt: _BuildOptions) -> Tuple[str,str,bool]:
+    return _build_gwatch_bench(
+        "gwatch_bench_trace_decoder", f"{root_dir}/src/common/utils/bench/trace_decoder_bench.cpp"
+    )
+
+
+def build_gwatch_bench_ts_batch(opt: _BuildOptions) -> Tuple[str,str,bool]:
+    return _build_gwatch_bench(
+        "gwatch_bench_ts_batch", f"{root_dir}/src/common/utils/bench/ts_batch_bench.cpp"
+    )
+
+
+__all__ = [
+    "build_gwatch_bench_lockfree_table",
+    "build_gwatch_bench_rcu_map",
+    "build_gwatch_bench_reg_reuse",
+    "build_gwatch_bench_sass_format",
+    "build_gwatch_bench_trace_decoder",
+    "build_gwatch_bench_ts_batch"
+]
@@ -12,6 +12,13 @@ def build_libgwatch_scheduler(opt: _BuildOptions) -> Tuple[str,str,bool]:
     scheduler_sources = copy.deepcopy(common_sources)
     scheduler_sources += glob.glob(f"{root_dir}/src/scheduler/**/*.cpp", recursive=True)
 
+    # events are rebuilt, merged and exported by the scheduler as well (e.g., gwatch spill export)
+    scheduler_sources += [
+        f"{root_dir}/src/capsule/event.cpp",
+        f"{root_dir}/src/capsule/event_exporter.cpp",
+        f"{root_dir}/src/capsule/event_merge.cpp",
+    ]
+
     # includes
     scheduler_includes = copy.deepcopy(common_includes)
     scheduler_includes += [ f'{root_dir}/third_parties/pybind11/include' ]
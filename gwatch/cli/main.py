@@ -1,6 +1,7 @@
 import argparse
 import sys
 from .profile import ProfileCommand
+from .spill import SpillCommand
 
 def main():
     parser = argparse.ArgumentParser(
@@ -12,6 +13,7 @@ def main():
     # register commands
     commands = [
         ProfileCommand(),
+        SpillCommand(),
     ]
     for command in commands:
         command.register(subparsers)
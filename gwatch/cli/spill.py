@@ -0,0 +1,55 @@
+import argparse
+import sys
+from pathlib import Path
+
+
+class SpillCommand:
+    def register(self, subparsers):
+        self.parser = subparsers.add_parser(
+            "spill",
+            help="Process event spill rings of capsules (see GW_EVENT_SPILL_DIR)",
+            usage="gwatch spill export [options] <spill_ring>"
+        )
+        spill_subparsers = self.parser.add_subparsers(dest="spill_subcommand")
+
+        export_parser = spill_subparsers.add_parser(
+            "export",
+            help="Export events within a spill ring to a trace file",
+            usage="gwatch spill export [options] <spill_ring>"
+        )
+        export_parser.add_argument(
+            "spill_ring",
+            help="Path to the spill ring (*.gwspill)"
+        )
+        export_parser.add_argument(
+            "-o", "--output",
+            help="Path to save the trace file, defaults to <spill_ring>.perfetto-trace (perfetto) or <spill_ring>.json (chrome_json)",
+            default=None
+        )
+        export_parser.add_argument(
+            "-f", "--format",
+            help="Format of the trace file",
+            choices=["perfetto", "chrome_json"],
+            default="perfetto"
+        )
+        export_parser.set_defaults(func=self.run_export)
+
+        self.parser.set_defaults(func=self.run)
+
+
+    def run(self, args: argparse.Namespace):
+        self.parser.print_help()
+        sys.exit(1)
+
+
+    def run_export(self, args: argparse.Namespace):
+        import gwatch.libgwatch_scheduler as _C_scheduler
+
+        spill_path = Path(args.spill_ring)
+        if not spill_path.exists():
+            raise RuntimeError(f"Error: Spill ring not found: {spill_path}")
+        default_suffix = ".perfetto-trace" if args.format == "perfetto" else ".json"
+        output_path = args.output if args.output else str(spill_path.with_suffix(default_suffix))
+
+        nb_events = _C_scheduler.export_event_spill(str(spill_path), output_path, args.format)
+        print(f"exported {nb_events} events to {output_path}")
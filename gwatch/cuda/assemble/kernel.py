@@ -2,8 +2,9 @@ import gwatch.libpygwatch as pygwatch
 from .kernel_def_sass import KernelDefSASS
 
 class KernelCUDA:
-    def __init__(self, gw_instance: pygwatch.KernelCUDA):
+    def __init__(self, gw_instance: pygwatch.KernelCUDA, launch_tick: int = 0):
         self._gw_instance = gw_instance
+        self._launch_tick = launch_tick
 
     @property
     def grid_dim_x(self) -> int:
@@ -69,6 +70,11 @@ class KernelCUDA:
     def stream(self, val: int):
         self._gw_instance.stream = val
 
+    @property
+    def launch_tick(self) -> int:
+        # TSC tick when the kernel is launched, 0 if unknown
+        return self._launch_tick
+
     @property
     def definition(self) -> KernelDefSASS:
         # Access 'def' property from C++ binding which is a reserved keyword in Python
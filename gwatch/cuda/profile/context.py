@@ -87,7 +87,15 @@ class ProfileContext:
         """
 
         raw_list = pygwatch.stop_tracing_kernel_launch()
-        return [KernelCUDA(k) for k in raw_list]
+        return [KernelCUDA(k, launch_tick) for k, launch_tick in raw_list]
+
+
+    def get_kernel_launch_queue_stat(self) -> Dict[str, int]:
+        """
+        Get statistics of queues for tracing kernel launch (capacity, nb_enqueued, nb_dropped, high_water).
+        """
+
+        return pygwatch.get_kernel_launch_queue_stat()
 
 
     def get_kernel_def_by_name(self, name: str) -> Optional[KernelDefSASS]:
@@ -78,6 +78,10 @@ class GWScheduler:
         self._gwatch_scheduler.start_gtrace()
 
 
+    def export_event_trace(self, output_path : str, format : Literal["perfetto", "chrome_json"] = "perfetto") -> int:
+        return self._gwatch_scheduler.export_event_trace(output_path, format)
+
+
     @staticmethod
     def parse_cli_args() -> argparse.Namespace:
         parser = argparse.ArgumentParser()
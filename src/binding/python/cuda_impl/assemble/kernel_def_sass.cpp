@@ -11,6 +11,7 @@
 #include "common/binary.hpp"
 #include "common/assemble/instruction.hpp"
 #include "common/utils/exception.hpp"
+#include "common/utils/text_buffer.hpp"
 #include "common/cuda_impl/assemble/kernel_def_sass.hpp"
 
 
@@ -115,4 +116,35 @@ void __gw_pybind_cuda_init_kernel_def_sass_interface(pybind11::module_ &m){
         py::return_value_policy::reference_internal,
         "get list of basic blocks"
     );
+
+    kernel_def.def(
+        "dump_text",
+        [](GWKernelDefExt_CUDA_SASS& self, bool simply) -> std::string {
+            GWKernelDef* kernel_def = nullptr;
+            GWUtilTextBuffer buffer;
+            GW_CHECK_POINTER(kernel_def = GWKernelDefExt_CUDA_SASS::get_base_ptr(&self));
+            kernel_def->dump_text(buffer, simply);
+            return buffer.str();
+        },
+        py::arg("simply") = false,
+        "get disassembly text of this kernel"
+    );
+
+    kernel_def.def(
+        "dump_text_to_file",
+        [](GWKernelDefExt_CUDA_SASS& self, std::string file_path, bool simply, bool append) {
+            gw_retval_t retval = GW_SUCCESS;
+            GWKernelDef* kernel_def = nullptr;
+            GW_CHECK_POINTER(kernel_def = GWKernelDefExt_CUDA_SASS::get_base_ptr(&self));
+            GW_IF_FAILED(
+                kernel_def->dump_text_to_file(file_path, simply, append),
+                retval,
+                {
+                    throw GWException("failed to dump disassembly text: %s", gw_retval_str(retval));
+                }
+            );
+        },
+        py::arg("file_path"), py::arg("simply") = false, py::arg("append") = false,
+        "dump disassembly text of this kernel to file"
+    );
 }
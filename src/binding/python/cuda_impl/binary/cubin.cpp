@@ -108,4 +108,20 @@ void __gw_pybind_cuda_init_cubin_interface(pybind11::module_ &m){
         py::arg("export_directory"),
         "export static analysis of this cubin"
     );
+
+    cubin.def(
+        "diff_kernels",
+        [](GWBinaryImageExt_CUDACubin* self, GWBinaryImageExt_CUDACubin* instrumented_cubin, std::vector<std::string> list_instrumented_kernel) -> nlohmann::json {
+            nlohmann::json report;
+            std::map<std::string, std::vector<std::vector<uint8_t>>> map_expected_bytes;
+            for(auto& kernel_name : list_instrumented_kernel){
+                map_expected_bytes[kernel_name] = {};
+            }
+            GWBinaryImageExt_CUDACubin::diff_kernels(self, instrumented_cubin, map_expected_bytes, report);
+            return report;
+        },
+        py::arg("instrumented_cubin"),
+        py::arg("list_instrumented_kernel"),
+        "diff kernels with an instrumented cubin, kernels not in list_instrumented_kernel should be intact"
+    );
 }
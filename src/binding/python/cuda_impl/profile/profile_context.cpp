@@ -107,20 +107,31 @@ void __gw_pybind_cuda_init_rt_control_interface(pybind11::module_ &m){
         []()
         {
             std::vector<GWKernel*> list_kernel = {};
-            std::vector<GWKernelExt_CUDA*> list_kernel_ext = {};
+            std::vector<uint64_t> list_launch_tick = {};
+            std::vector<std::pair<GWKernelExt_CUDA*, uint64_t>> list_kernel_ext = {};
             GWKernelExt_CUDA *kernel_ext = nullptr;
+            uint64_t i = 0;
             
-            list_kernel = gw_rt_control_stop_tracing_kernel_launch();
+            list_kernel = gw_rt_control_stop_tracing_kernel_launch(list_launch_tick);
 
-            for(auto& kernel : list_kernel){
-                kernel_ext = GWKernelExt_CUDA::get_ext_ptr(kernel);
-                list_kernel_ext.push_back(kernel_ext);
+            // each kernel comes with the TSC tick of its launch
+            for(i=0; i<list_kernel.size(); i++){
+                kernel_ext = GWKernelExt_CUDA::get_ext_ptr(list_kernel[i]);
+                list_kernel_ext.push_back({ kernel_ext, list_launch_tick[i] });
             }
             
             return list_kernel_ext;
         }
     );
 
+    m.def(
+        "get_kernel_launch_queue_stat",
+        []()
+        {
+            return gw_rt_control_get_kernel_launch_queue_stat();
+        }
+    );
+
     m.def(
         "get_kernel_def_by_name",
         [](std::string name) -> GWKernelDefExt_CUDA_SASS* {
@@ -26,6 +26,7 @@ PYBIND11_MODULE(libpygwatch, m) {
     m.def("push_event", &gw_rt_control_push_app_event);
     m.def("push_parent_event", &gw_rt_control_push_app_parent_event);
     m.def("pop_parent_event", &gw_rt_control_pop_app_parent_event);
+    m.def("get_event_queue_stat", &gw_rt_control_get_event_queue_stat);
 
     pybind11::class_<GWEvent>(m, "GWEvent")
         .def(pybind11::init<std::string>())
@@ -33,9 +33,17 @@ void gw_rt_control_start_tracing_kernel_launch();
 
 /*!
  *  \brief  stop capture kernel launch
+ *  \param  list_launch_tick    TSC tick of each captured launch, i-th for the i-th kernel
  *  \return list of captured kernels
  */
-std::vector<GWKernel*> gw_rt_control_stop_tracing_kernel_launch();
+std::vector<GWKernel*> gw_rt_control_stop_tracing_kernel_launch(std::vector<uint64_t>& list_launch_tick);
+
+
+/*!
+ *  \brief  get statistics of queues for tracing kernel launch
+ *  \return statistics: capacity, nb_enqueued, nb_dropped and high_water
+ */
+std::map<std::string, uint64_t> gw_rt_control_get_kernel_launch_queue_stat();
 
 
 /*!
@@ -124,3 +132,11 @@ void gw_rt_control_push_app_parent_event(GWEvent* app_event);
  *  \brief  pop app range parent event
  */
 void gw_rt_control_pop_app_parent_event();
+
+
+/*!
+ *  \brief  get statistics of pending / archived events of event traces
+ *  \return statistics: capacity, nb_enqueued, nb_dropped and high_water, prefixed by
+ *          pending_ and archived_ respectively
+ */
+std::map<std::string, uint64_t> gw_rt_control_get_event_queue_stat();
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
 
 #include "common/common.hpp"
 #include "common/log.hpp"
@@ -23,7 +24,7 @@ void gw_rt_control_start_tracing_kernel_launch(){
 }
 
 
-std::vector<GWKernel*> gw_rt_control_stop_tracing_kernel_launch(){
+std::vector<GWKernel*> gw_rt_control_stop_tracing_kernel_launch(std::vector<uint64_t>& list_launch_tick){
     std::vector<GWKernel*> list_kernel = {};
     gw_retval_t retval = GW_SUCCESS;
     static bool is_hijacklib_loaded = __init_capsule();
@@ -31,7 +32,7 @@ std::vector<GWKernel*> gw_rt_control_stop_tracing_kernel_launch(){
     if(is_hijacklib_loaded){
         GW_CHECK_POINTER(capsule != nullptr);
         GW_IF_FAILED(
-            capsule->stop_tracing_kernel_launch(list_kernel),
+            capsule->stop_tracing_kernel_launch(list_kernel, list_launch_tick),
             retval,
             {
                 throw GWException("failed to stop tracing kernel launch");
@@ -43,6 +44,24 @@ std::vector<GWKernel*> gw_rt_control_stop_tracing_kernel_launch(){
 }
 
 
+std::map<std::string, uint64_t> gw_rt_control_get_kernel_launch_queue_stat(){
+    std::map<std::string, uint64_t> map_stat = {};
+    gw_utils_queue_stat_t stat;
+    static bool is_hijacklib_loaded = __init_capsule();
+
+    if(is_hijacklib_loaded){
+        GW_CHECK_POINTER(capsule != nullptr);
+        stat = capsule->get_kernel_launch_queue_stat();
+        map_stat["capacity"] = stat.capacity;
+        map_stat["nb_enqueued"] = stat.nb_enqueued;
+        map_stat["nb_dropped"] = stat.nb_dropped;
+        map_stat["high_water"] = stat.high_water;
+    }
+
+    return map_stat;
+}
+
+
 gw_retval_t gw_rt_control_get_kernel_def(std::string name, GWKernelDef* &kernel_def){
     gw_retval_t retval = GW_SUCCESS;
     static bool is_hijacklib_loaded = __init_capsule();
@@ -93,3 +93,25 @@ void gw_rt_control_pop_app_parent_event(){
         GWCapsule::event_trace->pop_parent_event(GW_EVENT_TYPE_APP, (uint64_t)(pthread_self()));
     }
 }
+
+
+std::map<std::string, uint64_t> gw_rt_control_get_event_queue_stat(){
+    std::map<std::string, uint64_t> map_stat = {};
+    gw_utils_queue_stat_t pending_stat, archived_stat;
+    static bool is_hijacklib_loaded = __init_capsule();
+
+    if(is_hijacklib_loaded){
+        GW_CHECK_POINTER(capsule != nullptr);
+        capsule->get_event_queue_stat(pending_stat, archived_stat);
+        map_stat["pending_capacity"] = pending_stat.capacity;
+        map_stat["pending_nb_enqueued"] = pending_stat.nb_enqueued;
+        map_stat["pending_nb_dropped"] = pending_stat.nb_dropped;
+        map_stat["pending_high_water"] = pending_stat.high_water;
+        map_stat["archived_capacity"] = archived_stat.capacity;
+        map_stat["archived_nb_enqueued"] = archived_stat.nb_enqueued;
+        map_stat["archived_nb_dropped"] = archived_stat.nb_dropped;
+        map_stat["archived_high_water"] = archived_stat.high_water;
+    }
+
+    return map_stat;
+}
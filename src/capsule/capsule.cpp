@@ -5,6 +5,7 @@
 #include <string>
 #include <cstring>
 #include <filesystem>
+#include <chrono>
 #include <queue>
 #include <atomic>
 
@@ -35,6 +36,7 @@
 #include "common/utils/exception.hpp"
 #include "common/utils/socket.hpp"
 #include "common/utils/queue.hpp"
+#include "common/utils/futex.hpp"
 
 
 #ifdef GW_BACKEND_CUDA
@@ -43,11 +45,44 @@
 #endif
 
 
-thread_local GWUtilsLockFreeQueue<GWKernel*>* GWCapsule::q_kernel_launch = nullptr;
-thread_local std::thread* GWCapsule::_event_report_thread = nullptr;
+thread_local GWUtilsSlabRing<gw_capsule_kernel_launch_record_t>* GWCapsule::q_kernel_launch = nullptr;
 thread_local GWEventTrace *GWCapsule::event_trace = nullptr;
+thread_local GWCapsule::__gw_event_report_slot_guard_t GWCapsule::_event_report_slot_guard;
+
+
+// default capacity of the per-thread ring for tracing kernel launch (262144 x 80 B = 20 MiB
+// of records per thread), slabs of the ring are allocated on demand
+#define GW_CAPSULE_KERNEL_LAUNCH_QUEUE_DEFAULT_LEN          262144
+
+// default number of reporter threads shared by all app threads
+#define GW_CAPSULE_EVENT_REPORT_DEFAULT_NB_THREADS          2
+
+// default number of events within a reported batch
+#define GW_CAPSULE_EVENT_REPORT_DEFAULT_BATCH_SIZE          1024
+
+// default timeout of a pending batch before being reported
+#define GW_CAPSULE_EVENT_REPORT_DEFAULT_BATCH_TIMEOUT_US    1000
+
+// number of idle rounds a reporter yields before sleeping
+#define GW_CAPSULE_EVENT_REPORT_NB_SPIN_ROUNDS              64
+
+// range of a single sleep of an idle reporter, doubled on each idle round
+#define GW_CAPSULE_EVENT_REPORT_MIN_WAIT_US                 16
+#define GW_CAPSULE_EVENT_REPORT_MAX_WAIT_US                 10000
+
+// default size of the spill ring of event batches (MiB)
+#define GW_CAPSULE_EVENT_SPILL_DEFAULT_SIZE_MB              256
+
+// maximum number of spilled batches waiting for acknowledgement of the scheduler
+#define GW_CAPSULE_EVENT_SPILL_MAX_INFLIGHT                 16
+
+// timeout of waiting for acknowledgements of remaining spilled batches while exiting
+#define GW_CAPSULE_EVENT_SPILL_ACK_TIMEOUT_MS               5000
+
+
 thread_local std::vector<GWTraceTask*> GWCapsule::_list_trace_task;
 thread_local std::vector<GWTraceTask*> GWCapsule::_list_trace_task_kernel;
+thread_local GWTraceTaskMatcher GWCapsule::_trace_task_kernel_matcher;
 
 
 GWCapsule::GWCapsule()
@@ -113,6 +148,19 @@ GWCapsule::GWCapsule()
     //     }
     // }
 
+    // setup on-disk tier of instrument cache, shared among runs
+    retval = GWUtilSystem::get_env_variable("GW_INSTRUMENT_CACHE_DIR", env_value);
+    if(retval != GW_SUCCESS){
+        env_value = log_file_dir + std::string("/instrument_cache");
+    }
+    if(env_value.size() > 0){
+        GW_IF_FAILED(
+            this->instrument_cache.set_disk_dir(env_value),
+            retval,
+            GW_WARN_C("failed to setup on-disk instrument cache: dir(%s)", env_value.c_str());
+        );
+    }
+
     // initailize profiler
     #if GW_BACKEND_CUDA
         // retval = GWUtilSystem::get_env_variable("GW_ENABLE_COREDUMP", env_value);
@@ -134,19 +182,115 @@ GWCapsule::GWCapsule()
 
 GWCapsule::~GWCapsule() {
     gw_retval_t retval = GW_SUCCESS;
-    std::lock_guard lock(this->_mutex_map_event_report_thread);
+    gw_util_spill_ring_stat_t spill_stat;
+    gw_utils_queue_stat_t pending_stat, archived_stat;
+    std::chrono::steady_clock::time_point ack_deadline;
+    uint64_t nb_inflight = 0;
+    std::string spill_path = "";
 
-    this->_is_event_report_stop = true;
+    {
+        std::lock_guard lock(this->_mutex_event_report);
+        this->_is_event_report_stop = true;
+    }
 
-    // join all event report threads
-    for(auto& thread_pair : this->_map_event_report_thread){
-        GW_CHECK_POINTER(thread_pair.second);
-        if(thread_pair.second->joinable()){
-            thread_pair.second->join();
+    // join all reporters, sleeping reporters are woken to observe the stop signal,
+    // NOTE(zhuobin): the lock shouldn't be held here, as reporters acquire it to
+    //                refresh the list of registered event traces
+    GWUtilFutex::wake(this->_event_report_signal.seq);
+    for(auto& thread : this->_list_event_report_thread){
+        GW_CHECK_POINTER(thread);
+        if(thread->joinable()){
+            thread->join();
         }
-        delete thread_pair.second;
-        thread_pair.second = nullptr;
+        delete thread;
+        thread = nullptr;
     }
+    this->_list_event_report_thread.clear();
+
+    this->get_event_queue_stat(pending_stat, archived_stat);
+    if(unlikely(pending_stat.nb_dropped > 0 or archived_stat.nb_dropped > 0)){
+        GW_WARN_C(
+            "events were dropped due to queue overflow: "
+            "pending(nb_enqueued: %lu, nb_dropped: %lu, high_water: %lu), "
+            "archived(nb_enqueued: %lu, nb_dropped: %lu, high_water: %lu)",
+            pending_stat.nb_enqueued, pending_stat.nb_dropped, pending_stat.high_water,
+            archived_stat.nb_enqueued, archived_stat.nb_dropped, archived_stat.high_water
+        );
+    }
+    this->_list_event_report_slot.clear();
+
+    // hand remaining spilled batches to the scheduler before the websocket is shutdown, and
+    // wait for their acknowledgements, batches which can't be delivered stay in the spill
+    // ring for offline export
+    if(this->_event_spill_ring != nullptr){
+        ack_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(GW_CAPSULE_EVENT_SPILL_ACK_TIMEOUT_MS);
+        while(std::chrono::steady_clock::now() < ack_deadline){
+            if(this->__replay_event_spill() == GW_SUCCESS){
+                this->sync_send_to_scheduler();
+                continue;
+            }
+            {
+                std::lock_guard lock(this->_mutex_event_spill_inflight);
+                nb_inflight = this->_queue_event_spill_inflight.size();
+            }
+            if(nb_inflight == 0 and this->_event_spill_ring->is_all_read())
+                break;
+            if(this->_ws_intance == nullptr or this->_is_daemon_stop)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        spill_stat = this->_event_spill_ring->get_stat();
+        spill_path = this->_event_spill_ring->get_path();
+        if(spill_stat.nb_overwritten > 0 or spill_stat.nb_corrupted > 0){
+            GW_WARN_C(
+                "event batches lost in spill ring: path(%s), nb_overwritten(%lu), nb_corrupted(%lu)",
+                spill_path.c_str(), spill_stat.nb_overwritten, spill_stat.nb_corrupted
+            );
+        }
+        if(spill_stat.used > 0){
+            GW_WARN_C(
+                "event batches remain in spill ring, export via `gwatch spill export`: path(%s), nb_bytes(%lu)",
+                spill_path.c_str(), spill_stat.used
+            );
+        }
+        {
+            std::lock_guard lock(this->_mutex_event_spill_inflight);
+            this->_queue_event_spill_inflight.clear();
+            delete this->_event_spill_ring;
+            this->_event_spill_ring = nullptr;
+        }
+        if(spill_stat.used == 0)
+            std::filesystem::remove(spill_path);
+    }
+
+    #if GW_BACKEND_CUDA
+        // drain ahead-of-time instrumentation
+        if(this->_pre_instrument_pool != nullptr){
+            delete this->_pre_instrument_pool;
+            this->_pre_instrument_pool = nullptr;
+        }
+
+        // drain background parsing, jobs are freed once no one could wait for them
+        if(this->_parse_pool != nullptr){
+            delete this->_parse_pool;
+            this->_parse_pool = nullptr;
+        }
+        this->_map_cufunction_parse_job.for_each([](const auto& key, gw_capsule_parse_job_t* job){
+            delete job;
+        });
+        for(gw_capsule_parse_job_t* job : this->_list_retired_parse_job)
+            delete job;
+        this->_list_retired_parse_job.clear();
+
+        // launch descriptors within the table are freed by the table
+        for(auto& [function, launch_desc] : this->_map_overflow_launch_desc)
+            delete launch_desc;
+        this->_map_overflow_launch_desc.clear();
+        for(gw_capsule_launch_desc_t* launch_desc : this->_list_retired_launch_desc)
+            delete launch_desc;
+        this->_list_retired_launch_desc.clear();
+    #endif
 
     GW_IF_FAILED(
         this->__shutdown_websocket_daemon(),
@@ -173,6 +317,17 @@ gw_retval_t GWCapsule::register_trace_task(GWTraceTask* trace_task){
 
     if(trace_task->get_type().starts_with("kernel:")){
         this->_list_trace_task_kernel.push_back(trace_task);
+        GW_IF_FAILED(
+            this->__compile_trace_task_kernel_matcher(),
+            retval,
+            {
+                GW_WARN_C("failed to register kernel trace task: type(%s)", trace_task->get_type().c_str());
+                this->_list_trace_task.pop_back();
+                this->_list_trace_task_kernel.pop_back();
+                this->__compile_trace_task_kernel_matcher();
+                goto exit;
+            }
+        );
     } else {
         GW_ERROR_C_DETAIL("shouldn't be here");
     }
@@ -196,6 +351,7 @@ gw_retval_t GWCapsule::unregister_trace_task(GWTraceTask* trace_task){
             std::remove(this->_list_trace_task_kernel.begin(), this->_list_trace_task_kernel.end(), trace_task),
             this->_list_trace_task_kernel.end()
         );
+        this->__compile_trace_task_kernel_matcher();
     } else {
         GW_ERROR_C_DETAIL("shouldn't be here");
     }
@@ -206,17 +362,12 @@ exit:
 
 
 bool GWCapsule::do_need_trace_kernel(std::string kernel_name){
-    bool retval = false;
+    return this->_trace_task_kernel_matcher.match_any(kernel_name);
+}
 
-    for(auto trace_task : this->_list_trace_task_kernel){
-        if(trace_task->do_need_trace(kernel_name)){
-            retval = true;
-            break;
-        }
-    }
 
-exit:
-    return retval;
+gw_retval_t GWCapsule::__compile_trace_task_kernel_matcher(){
+    return this->_trace_task_kernel_matcher.compile(this->_list_trace_task_kernel);
 }
 
 
@@ -227,32 +378,110 @@ gw_retval_t GWCapsule::start_tracing_kernel_launch(){
 }
 
 
-gw_retval_t GWCapsule::stop_tracing_kernel_launch(std::vector<GWKernel*> &list_kernel){
+gw_retval_t GWCapsule::stop_tracing_kernel_launch(std::vector<GWKernel*> &list_kernel, std::vector<uint64_t> &list_launch_tick){
     GWKernel *kernel = nullptr;
-    gw_retval_t retval = GW_SUCCESS;
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    gw_utils_queue_stat_t stat;
+    std::vector<gw_capsule_kernel_launch_record_t> list_record;
+    uint64_t nb_failed = 0;
 
     // stop tracing kernel launch
     this->_flag_trace_kernel_launch.store(false);
 
-    // pop all kernel from queue
+    // drain records from rings of all threads
     list_kernel.clear();
+    list_launch_tick.clear();
+    {
+        std::lock_guard lock(this->_mutex_list_q_trace_kernel_launch);
+        for(auto& q_kernel_launch : this->_list_q_trace_kernel_launch){
+            GW_CHECK_POINTER(q_kernel_launch);
+            q_kernel_launch->drain([&](const gw_capsule_kernel_launch_record_t& record){
+                list_record.push_back(record);
+            });
+        }
+    }
+
+    // materialize kernel instances out of the hot path
+    list_kernel.reserve(list_record.size());
+    list_launch_tick.reserve(list_record.size());
+    for(const gw_capsule_kernel_launch_record_t& record : list_record){
+        #if GW_BACKEND_CUDA
+            tmp_retval = this->CUDA_materialize_kernel_launch(record, kernel);
+        #else
+            tmp_retval = GW_FAILED_NOT_IMPLEMENTAED;
+        #endif
+        if(unlikely(tmp_retval != GW_SUCCESS)){
+            nb_failed += 1;
+            continue;
+        }
+        list_kernel.push_back(kernel);
+        list_launch_tick.push_back(record.launch_tick);
+    }
+    if(unlikely(nb_failed > 0)){
+        GW_WARN_C("failed to materialize traced kernel launches: nb_failed(%lu)", nb_failed);
+    }
+
+    stat = this->get_kernel_launch_queue_stat();
+    if(unlikely(stat.nb_dropped > 0)){
+        GW_WARN_C(
+            "kernel launches were dropped due to queue overflow: nb_enqueued(%lu), nb_dropped(%lu), high_water(%lu)",
+            stat.nb_enqueued, stat.nb_dropped, stat.high_water
+        );
+    }
+
+    return retval;
+}
+
+
+gw_utils_queue_stat_t GWCapsule::get_kernel_launch_queue_stat(){
+    gw_utils_queue_stat_t stat;
+    std::lock_guard lock(this->_mutex_list_q_trace_kernel_launch);
+
     for(auto& q_kernel_launch : this->_list_q_trace_kernel_launch){
         GW_CHECK_POINTER(q_kernel_launch);
-        while(q_kernel_launch->len() > 0){
-            GW_IF_FAILED(
-                q_kernel_launch->dequeue(kernel),
-                retval,
-                {
-                    GW_WARN_C("failed to dequeue kernel launch trace from queue");
-                    goto exit;
-                }
-            );
-            list_kernel.push_back(kernel);
+        stat.merge(q_kernel_launch->get_stat());
+    }
+
+    return stat;
+}
+
+
+void GWCapsule::__create_kernel_launch_queue(){
+    std::string env_value = "";
+    uint64_t capacity = GW_CAPSULE_KERNEL_LAUNCH_QUEUE_DEFAULT_LEN;
+    uint64_t sample_rate = GW_UTILS_MPSC_QUEUE_DEFAULT_SAMPLE_RATE;
+    gw_utils_queue_overflow_policy_t policy = GW_UTILS_QUEUE_OVERFLOW_DROP_NEWEST;
+
+    if(GWUtilSystem::get_env_variable("GW_KERNEL_LAUNCH_QUEUE_LEN", env_value) == GW_SUCCESS){
+        try {
+            capacity = std::max<uint64_t>(1, std::stoul(env_value));
+        } catch (...) {
+            GW_WARN_C("invalid GW_KERNEL_LAUNCH_QUEUE_LEN, use default: value(%s)", env_value.c_str());
+        }
+    }
+    if(GWUtilSystem::get_env_variable("GW_KERNEL_LAUNCH_QUEUE_POLICY", env_value) == GW_SUCCESS){
+        if(gw_utils_queue_string_to_policy(env_value, policy) != GW_SUCCESS)
+            GW_WARN_C("invalid GW_KERNEL_LAUNCH_QUEUE_POLICY, use drop_newest: value(%s)", env_value.c_str());
+    }
+    if(GWUtilSystem::get_env_variable("GW_KERNEL_LAUNCH_QUEUE_SAMPLE_RATE", env_value) == GW_SUCCESS){
+        try {
+            sample_rate = std::max<uint64_t>(1, std::stoul(env_value));
+        } catch (...) {
+            GW_WARN_C("invalid GW_KERNEL_LAUNCH_QUEUE_SAMPLE_RATE, use default: value(%s)", env_value.c_str());
         }
     }
 
- exit:
-    return retval;
+    GW_CHECK_POINTER(
+        GWCapsule::q_kernel_launch = new GWUtilsSlabRing<gw_capsule_kernel_launch_record_t>(capacity, policy, sample_rate)
+    );
+    {
+        std::lock_guard lock(this->_mutex_list_q_trace_kernel_launch);
+        this->_list_q_trace_kernel_launch.push_back(GWCapsule::q_kernel_launch);
+    }
+    GW_DEBUG_C(
+        "create queue for tracing kernel launch: capacity(%lu), policy(%u), sample_rate(%lu)",
+        GWCapsule::q_kernel_launch->get_capacity(), policy, sample_rate
+    );
 }
 
 
@@ -298,141 +527,536 @@ gw_retval_t GWCapsule::stop_trace(uint64_t begin_hash, uint64_t end_hash, std::s
 
 void GWCapsule::ensure_event_trace(){
     uint64_t linux_thread_id = 0;
+    std::shared_ptr<__gw_event_report_slot_t> slot = nullptr;
+    std::string env_value = "";
+    uint64_t capacity = GW_EVENT_TRACE_DEFAULT_QUEUE_LEN;
+    uint64_t sample_rate = GW_UTILS_MPSC_QUEUE_DEFAULT_SAMPLE_RATE;
+    gw_utils_queue_overflow_policy_t policy = GW_UTILS_QUEUE_OVERFLOW_DROP_NEWEST;
+
+    if(likely(GWCapsule::event_trace != nullptr))
+        return;
 
     linux_thread_id = (uint64_t)(pthread_self());
 
-    // make sure event trace exist
-    if(unlikely(GWCapsule::event_trace == nullptr)){
-        GW_CHECK_POINTER(GWCapsule::event_trace = new GWEventTrace(this->_is_event_report_stop));
-        GWCapsule::event_trace->set_name("capsule_event_trace-" + this->global_id);
-        GW_DEBUG_C("create event trace: linux_thread_id(%lu)", linux_thread_id);
+    if(GWUtilSystem::get_env_variable("GW_EVENT_QUEUE_LEN", env_value) == GW_SUCCESS){
+        try {
+            capacity = std::max<uint64_t>(1, std::stoul(env_value));
+        } catch (...) {
+            GW_WARN_C("invalid GW_EVENT_QUEUE_LEN, use default: value(%s)", env_value.c_str());
+        }
+    }
+    if(GWUtilSystem::get_env_variable("GW_EVENT_QUEUE_POLICY", env_value) == GW_SUCCESS){
+        if(gw_utils_queue_string_to_policy(env_value, policy) != GW_SUCCESS)
+            GW_WARN_C("invalid GW_EVENT_QUEUE_POLICY, use drop_newest: value(%s)", env_value.c_str());
+    }
+    if(GWUtilSystem::get_env_variable("GW_EVENT_QUEUE_SAMPLE_RATE", env_value) == GW_SUCCESS){
+        try {
+            sample_rate = std::max<uint64_t>(1, std::stoul(env_value));
+        } catch (...) {
+            GW_WARN_C("invalid GW_EVENT_QUEUE_SAMPLE_RATE, use default: value(%s)", env_value.c_str());
+        }
+    }
+
+    // create event trace, which wakes the reporter pool on completion
+    GW_CHECK_POINTER(
+        GWCapsule::event_trace = new GWEventTrace(this->_is_event_report_stop, capacity, policy, sample_rate)
+    );
+    GWCapsule::event_trace->set_name("capsule_event_trace-" + this->global_id);
+    GWCapsule::event_trace->bind_completion_signal(&this->_event_report_signal);
+    GW_DEBUG_C(
+        "create event trace: linux_thread_id(%lu), capacity(%lu), policy(%u), sample_rate(%lu)",
+        linux_thread_id, capacity, policy, sample_rate
+    );
+
+    // register the event trace to the reporter pool, the slot is retired once current thread exits
+    GW_CHECK_POINTER(slot = std::make_shared<__gw_event_report_slot_t>());
+    slot->event_trace = GWCapsule::event_trace;
+    slot->linux_thread_id = linux_thread_id;
+    GWCapsule::_event_report_slot_guard.slot = slot;
+    {
+        std::lock_guard lock(this->_mutex_event_report);
+        this->__start_event_report_pool();
+        this->_list_event_report_slot.push_back(slot);
+        this->_event_report_slot_version.fetch_add(1, std::memory_order_release);
+        GW_DEBUG_C(
+            "register event trace to reporter pool: linux_thread_id(%lu), nb_event_traces(%lu)",
+            linux_thread_id, this->_list_event_report_slot.size()
+        );
+    }
+}
+
+
+void GWCapsule::__remove_event_report_slot(__gw_event_report_slot_t* slot){
+    gw_utils_queue_stat_t pending_stat, archived_stat;
+
+    GW_CHECK_POINTER(slot);
+    GW_ASSERT(slot->is_retired.load(std::memory_order_acquire));
+
+    GW_CHECK_POINTER(slot->event_trace);
+    slot->event_trace->get_stat(pending_stat, archived_stat);
+
+    std::lock_guard lock(this->_mutex_event_report);
+    for(auto it = this->_list_event_report_slot.begin(); it != this->_list_event_report_slot.end(); it++){
+        if(it->get() != slot)
+            continue;
+        this->_event_report_removed_pending_stat.merge(pending_stat);
+        this->_event_report_removed_archived_stat.merge(archived_stat);
+        this->_list_event_report_slot.erase(it);
+        this->_event_report_slot_version.fetch_add(1, std::memory_order_release);
+        GW_DEBUG_C(
+            "remove event trace of exited thread from reporter pool: linux_thread_id(%lu), nb_event_traces(%lu)",
+            slot->linux_thread_id, this->_list_event_report_slot.size()
+        );
+        break;
+    }
+}
+
+
+void GWCapsule::get_event_queue_stat(gw_utils_queue_stat_t& pending_stat, gw_utils_queue_stat_t& archived_stat){
+    gw_utils_queue_stat_t slot_pending_stat, slot_archived_stat;
+    std::lock_guard lock(this->_mutex_event_report);
+
+    pending_stat = this->_event_report_removed_pending_stat;
+    archived_stat = this->_event_report_removed_archived_stat;
+    for(auto& slot : this->_list_event_report_slot){
+        GW_CHECK_POINTER(slot);
+        GW_CHECK_POINTER(slot->event_trace);
+        slot->event_trace->get_stat(slot_pending_stat, slot_archived_stat);
+        pending_stat.merge(slot_pending_stat);
+        archived_stat.merge(slot_archived_stat);
+    }
+}
+
+
+void GWCapsule::__start_event_report_pool(){
+    std::string env_value = "";
+    uint64_t i = 0;
+    std::thread *thread = nullptr;
+
+    if(likely(!this->_list_event_report_thread.empty()))
+        return;
+
+    this->_event_report_nb_threads = GW_CAPSULE_EVENT_REPORT_DEFAULT_NB_THREADS;
+    this->_event_report_batch_size = GW_CAPSULE_EVENT_REPORT_DEFAULT_BATCH_SIZE;
+    this->_event_report_batch_timeout_us = GW_CAPSULE_EVENT_REPORT_DEFAULT_BATCH_TIMEOUT_US;
+
+    if(GWUtilSystem::get_env_variable("GW_EVENT_REPORT_NB_THREADS", env_value) == GW_SUCCESS){
+        try {
+            this->_event_report_nb_threads = std::max<uint64_t>(1, std::stoul(env_value));
+        } catch (...) {
+            GW_WARN_C("invalid GW_EVENT_REPORT_NB_THREADS, use default: value(%s)", env_value.c_str());
+        }
+    }
+    if(GWUtilSystem::get_env_variable("GW_EVENT_REPORT_NUMA_NODE", env_value) == GW_SUCCESS){
+        try {
+            this->_event_report_numa_node = std::stoi(env_value);
+        } catch (...) {
+            GW_WARN_C("invalid GW_EVENT_REPORT_NUMA_NODE, reporters won't be pinned: value(%s)", env_value.c_str());
+        }
+    }
+    if(GWUtilSystem::get_env_variable("GW_EVENT_REPORT_BATCH_SIZE", env_value) == GW_SUCCESS){
+        try {
+            this->_event_report_batch_size = std::max<uint64_t>(1, std::stoul(env_value));
+        } catch (...) {
+            GW_WARN_C("invalid GW_EVENT_REPORT_BATCH_SIZE, use default: value(%s)", env_value.c_str());
+        }
+    }
+    if(GWUtilSystem::get_env_variable("GW_EVENT_REPORT_BATCH_TIMEOUT_US", env_value) == GW_SUCCESS){
+        try {
+            this->_event_report_batch_timeout_us = std::stoul(env_value);
+        } catch (...) {
+            GW_WARN_C("invalid GW_EVENT_REPORT_BATCH_TIMEOUT_US, use default: value(%s)", env_value.c_str());
+        }
+    }
+    if(GWUtilSystem::get_env_variable("GW_EVENT_REPORT_ENCODING", env_value) == GW_SUCCESS){
+        if(env_value == "compact"){
+            this->_event_report_encoding = GW_TS_BATCH_ENCODING_COMPACT;
+        } else if(env_value == "compact_lz4"){
+            this->_event_report_encoding = GW_TS_BATCH_ENCODING_COMPACT_LZ4;
+        } else {
+            GW_WARN_C("invalid GW_EVENT_REPORT_ENCODING, use compact_lz4: value(%s)", env_value.c_str());
+        }
+    }
+    this->_event_report_batch_timeout_tick = (uint64_t)(this->_tsc_timer.us_to_tick(this->_event_report_batch_timeout_us));
+    this->__open_event_spill();
+
+    for(i=0; i<this->_event_report_nb_threads; i++){
+        GW_CHECK_POINTER(thread = new std::thread(GWCapsule::__event_report_func, this, i));
+        this->_list_event_report_thread.push_back(thread);
+    }
+
+    GW_DEBUG_C(
+        "start event reporter pool: nb_threads(%lu), numa_node(%d), batch_size(%lu), batch_timeout_us(%lu), encoding(%u)",
+        this->_event_report_nb_threads, this->_event_report_numa_node,
+        this->_event_report_batch_size, this->_event_report_batch_timeout_us, this->_event_report_encoding
+    );
+}
+
+
+void GWCapsule::__open_event_spill(){
+    gw_retval_t retval = GW_SUCCESS;
+    std::string env_value = "", spill_dir = "";
+    uint64_t spill_size_mb = GW_CAPSULE_EVENT_SPILL_DEFAULT_SIZE_MB;
+    std::error_code ec;
+
+    if(GWUtilSystem::get_env_variable("GW_EVENT_SPILL_DIR", spill_dir) != GW_SUCCESS or spill_dir.empty())
+        return;
+    if(GWUtilSystem::get_env_variable("GW_EVENT_SPILL_SIZE_MB", env_value) == GW_SUCCESS){
+        try {
+            spill_size_mb = std::max<uint64_t>(1, std::stoul(env_value));
+        } catch (...) {
+            GW_WARN_C("invalid GW_EVENT_SPILL_SIZE_MB, use default: value(%s)", env_value.c_str());
+        }
     }
 
-    // make sure event trace report thread exist
-    if(unlikely(GWCapsule::_event_report_thread == nullptr)){
-        GW_CHECK_POINTER(GWCapsule::_event_report_thread = new std::thread(
-            GWCapsule::__event_report_func, this, GWCapsule::event_trace, linux_thread_id
-        ));
-        this->_mutex_map_event_report_thread.lock();
-        this->_map_event_report_thread[linux_thread_id] = GWCapsule::_event_report_thread;
-        this->_mutex_map_event_report_thread.unlock();
-        GW_DEBUG_C("create event trace report thread: linux_thread_id(%lu)", linux_thread_id);
+    if(unlikely(!std::filesystem::exists(spill_dir) and !std::filesystem::create_directories(spill_dir, ec))){
+        GW_WARN_C(
+            "failed to create spill directory, event spilling is disabled: dir(%s), err(%s)",
+            spill_dir.c_str(), ec.message().c_str()
+        );
+        return;
     }
+
+    GW_CHECK_POINTER(this->_event_spill_ring = new GWUtilSpillRing());
+    GW_IF_FAILED(
+        this->_event_spill_ring->open(spill_dir + "/" + this->global_id + ".gwspill", spill_size_mb << 20),
+        retval,
+        {
+            GW_WARN_C("failed to open spill ring, event spilling is disabled: dir(%s)", spill_dir.c_str());
+            delete this->_event_spill_ring;
+            this->_event_spill_ring = nullptr;
+            return;
+        }
+    );
+
+    GW_DEBUG_C(
+        "spill event batches to disk: path(%s), size_mb(%lu)",
+        this->_event_spill_ring->get_path().c_str(), spill_size_mb
+    );
 }
 
 
-void GWCapsule::__event_report_func(GWCapsule* _this, GWEventTrace *event_trace, uint64_t linux_thread_id){
+void GWCapsule::__event_report_func(GWCapsule* _this, uint64_t worker_id){
     gw_retval_t retval = GW_SUCCESS;
-    GWEvent *event = nullptr;
-    GWInternalMessage_Capsule *capsule_message = nullptr;
-    GWInternalMessagePayload_Common_DB_TS_Write *payload = nullptr;
-    std::queue<GWEvent*> queue_non_ready_events;
-    #if GW_BACKEND_CUDA
-        CUresult cudv_retval = CUDA_SUCCESS;
-    #endif
-    
+    std::vector<std::shared_ptr<__gw_event_report_slot_t>> list_slot;
+    uint64_t i = 0, pass = 0, nb_slot = 0, nb_threads = 0, slot_version = 0;
+    uint64_t nb_idle_rounds = 0, wait_us = 0;
+    uint32_t completion_seq = 0;
+    bool is_stopping = false, has_work = false, has_contention = false, has_pending_batch = false;
+    bool is_all_empty = false;
+
     GW_CHECK_POINTER(_this);
-    GW_CHECK_POINTER(event_trace);
+    nb_threads = _this->_event_report_nb_threads;
+    GW_ASSERT(worker_id < nb_threads);
+
+    // pin the reporter to the given numa node, so that it doesn't compete with app threads
+    if(_this->_event_report_numa_node >= 0){
+        if(numa_available() == -1 or numa_run_on_node(_this->_event_report_numa_node) != 0){
+            GW_WARN(
+                "failed to pin event reporter to numa node: worker_id(%lu), numa_node(%d)",
+                worker_id, _this->_event_report_numa_node
+            );
+        }
+    }
 
-    GW_DEBUG("start to report event stream to scheduler: linux_thread_id(%lu)", linux_thread_id);
+    GW_DEBUG("start to report event stream to scheduler: worker_id(%lu)", worker_id);
 
-    while(
-        likely(!_this->_is_event_report_stop)
-        or !queue_non_ready_events.empty()
-        or !event_trace->is_event_trace_empty()
-    ){
-        event = nullptr;
-
-        // first we try dequeue from the cache queue
-        if(!queue_non_ready_events.empty()){
-            event = queue_non_ready_events.front();
-            GW_CHECK_POINTER(event);
-            queue_non_ready_events.pop();
-
-            // if the event isn't ready, we push back to the queue
-            if(event->is_archived() == false){
-                queue_non_ready_events.push(event);
-                event = nullptr;
+    while(true){
+        is_stopping = _this->_is_event_report_stop;
+
+        // the sequence is observed before draining, so that archives after draining
+        // always wake the wait below
+        completion_seq = _this->_event_report_signal.seq.load(std::memory_order_acquire);
+
+        // refresh the snapshot of registered event traces, the snapshot keeps removed slots
+        // alive until it's refreshed, so that they're never released while being drained
+        if(unlikely(slot_version != _this->_event_report_slot_version.load(std::memory_order_acquire))){
+            std::lock_guard lock(_this->_mutex_event_report);
+            list_slot = _this->_list_event_report_slot;
+            slot_version = _this->_event_report_slot_version.load(std::memory_order_acquire);
+            nb_slot = list_slot.size();
+        }
+
+        // drain event traces of own shard first, and only steal from other shards once
+        // own shard is idle; a trace is claimed by one reporter at a time, so that
+        // stealing never reorders events of an app thread
+        has_work = false;
+        has_contention = false;
+        has_pending_batch = false;
+        for(pass=0; pass<2; pass++){
+            if(pass == 1 and has_work)
+                break;
+            for(i=0; i<nb_slot; i++){
+                if((i % nb_threads == worker_id) != (pass == 0))
+                    continue;
+                retval = _this->__drain_event_report_slot(list_slot[i].get(), is_stopping, has_pending_batch);
+                if(retval == GW_SUCCESS)
+                    has_work = true;
+                else if(retval == GW_FAILED_ALREADY_EXIST)
+                    has_contention = true;
             }
         }
 
-        // if the cache is empty or nothing in cache is ready, we try dequeue from the event trace
-        if(event == nullptr){
-            if(event_trace->pop_event(event) == GW_SUCCESS){
-                GW_CHECK_POINTER(event);
+        // replay spilled batches once the traces are drained
+        if(!has_work and _this->_event_spill_ring != nullptr and _this->__replay_event_spill() == GW_SUCCESS)
+            has_work = true;
 
-                // if the event isn't ready, we push back to the queue
-                if(event->is_archived() == false){
-                    queue_non_ready_events.push(event);
-                    event = nullptr;
+        if(has_work){
+            nb_idle_rounds = 0;
+            continue;
+        }
+
+        // exit once all event traces are drained after stopping
+        if(unlikely(is_stopping) and !has_contention and !has_pending_batch){
+            is_all_empty = true;
+            for(i=0; i<nb_slot; i++){
+                if(!list_slot[i]->event_trace->is_event_trace_empty()){
+                    is_all_empty = false;
+                    break;
                 }
             }
+            if(is_all_empty)
+                break;
+        }
+
+        // adaptive backoff: yield for a few rounds, then sleep until an event is archived,
+        // the sleep is bounded so that stop flag and pending batches are still checked;
+        // a trace claimed by another reporter might have been archived after it's drained,
+        // so the reporter keeps yielding under contention instead of sleeping
+        nb_idle_rounds += 1;
+        if(nb_idle_rounds <= GW_CAPSULE_EVENT_REPORT_NB_SPIN_ROUNDS or has_contention){
+            std::this_thread::yield();
+        } else {
+            wait_us = std::min<uint64_t>(
+                GW_CAPSULE_EVENT_REPORT_MAX_WAIT_US,
+                GW_CAPSULE_EVENT_REPORT_MIN_WAIT_US << std::min<uint64_t>(nb_idle_rounds - GW_CAPSULE_EVENT_REPORT_NB_SPIN_ROUNDS, 16)
+            );
+            if(has_pending_batch)
+                wait_us = std::min(wait_us, _this->_event_report_batch_timeout_us);
+            _this->_event_report_signal.nb_waiters.fetch_add(1, std::memory_order_seq_cst);
+            GWUtilFutex::wait(_this->_event_report_signal.seq, completion_seq, std::max<uint64_t>(wait_us, 1));
+            _this->_event_report_signal.nb_waiters.fetch_sub(1, std::memory_order_seq_cst);
         }
+    }
+
+    GW_DEBUG("stop to report event stream to scheduler: worker_id(%lu)", worker_id);
+}
+
+
+gw_retval_t GWCapsule::__drain_event_report_slot(
+    __gw_event_report_slot_t* slot, bool is_stopping, bool& has_pending_batch
+){
+    gw_retval_t retval = GW_FAILED_NOT_READY;
+    GWInternalMessage_Capsule *capsule_message = nullptr;
+    GWInternalMessagePayload_Common_DB_TS_BatchWrite *payload = nullptr;
+    std::vector<GWEvent*> list_events;
+    std::string uri = "";
+    uint64_t current_tick = 0;
+    #if GW_BACKEND_CUDA
+        CUresult cudv_retval = CUDA_SUCCESS;
+    #endif
+
+    GW_CHECK_POINTER(slot);
+    GW_CHECK_POINTER(slot->event_trace);
 
+    if(slot->is_claimed.exchange(true, std::memory_order_acquire)){
+        retval = GW_FAILED_ALREADY_EXIST;
+        goto exit;
+    }
+
+    if(slot->event_trace->pop_archived_events(list_events) != GW_SUCCESS){
         /*!
-         *  \note(zhuobin): if the report thread is about to close,
+         *  \note(zhuobin): if the reporter pool is about to close,
          *                  and there still unfinished GPU event,
          *                  we need to check whether there's sticky
          *                  error on current context; if it's, we
          *                  need to manully end these events    
          */
         #if GW_BACKEND_CUDA
-            if(
-                unlikely(_this->_is_event_report_stop)
-                and event == nullptr
-                and event->type_id == GW_EVENT_TYPE_GPU
-                and !queue_non_ready_events.empty()
-            ){
+            if(unlikely(is_stopping) and slot->event_trace->get_nb_pending_events() > 0){
                 cudv_retval = cuCtxSynchronize();
                 if(unlikely(cudv_retval != CUDA_SUCCESS)){
-                    event = queue_non_ready_events.front();
-                    GW_CHECK_POINTER(event);
-                    queue_non_ready_events.pop();
-                    event->record_tick("end");
-                    event->set_metadata("return code", cudv_retval);
-                    event->archive();
+                    slot->event_trace->archive_pending_events(
+                        GW_EVENT_TYPE_GPU,
+                        [&](GWEvent* _event){
+                            _event->record_tick(GW_EVENT_KEY_TICK_END);
+                            _event->set_metadata("return code", cudv_retval);
+                        }
+                    );
+                    slot->event_trace->pop_archived_events(list_events);
                 }
             }
         #endif
+    }
 
-        if(event != nullptr){
-            GW_ASSERT(event->is_archived());
+    for(GWEvent* event : list_events){
+        GW_CHECK_POINTER(event);
+        GW_ASSERT(event->is_archived());
+
+        uri = std::format(
+            "/capsule/{}/{}event",
+            this->global_id,
+            GWEvent::typeid_to_string(event->type_id)
+        );
 
+        if(slot->map_batch.count(uri) == 0){
             GW_CHECK_POINTER(capsule_message = new GWInternalMessage_Capsule());
-            payload = capsule_message->get_payload_ptr<GWInternalMessagePayload_Common_DB_TS_Write>(GW_MESSAGE_TYPEID_COMMON_TS_WRITE_DB);
+            capsule_message->type_id = GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB;
+            payload = capsule_message->get_payload_ptr<GWInternalMessagePayload_Common_DB_TS_BatchWrite>(GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB);
             GW_CHECK_POINTER(payload);
+            payload->uri = uri;
+            payload->encoding = this->_event_report_encoding;
+            slot->map_batch[uri] = { capsule_message, GWUtilTscTimer::get_tsc() };
+        } else {
+            capsule_message = slot->map_batch[uri].first;
+            payload = capsule_message->get_payload_ptr<GWInternalMessagePayload_Common_DB_TS_BatchWrite>(GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB);
+            GW_CHECK_POINTER(payload);
+        }
+        if(unlikely(event->to_compact_json(payload->begin_sample(event->id, GWUtilTscTimer::get_tsc())) != GW_SUCCESS)){
+            GW_WARN_C("failed to encode metadata of event, reported partially: event_id(%lu)", event->id);
+        }
+        payload->end_sample();
 
-            // make payload
-            capsule_message->type_id = GW_MESSAGE_TYPEID_COMMON_TS_WRITE_DB;
-            payload->uri = std::format(
-                "/capsule/{}/{}event",
-                _this->global_id,
-                GWEvent::typeid_to_string(event->type_id)
-            );
-            payload->index = event->id;
-            payload->timestamp = GWUtilTscTimer::get_tsc();
-            payload->payload = event->to_json();
-
-            // send to scheduler
-            retval = _this->send_to_scheduler(capsule_message);
-            if(retval == GW_SUCCESS){
-                GW_DEBUG("reported event: linux_thread_id(%lu), event_id(%lu)", linux_thread_id, event->id);
+        if(payload->get_nb_samples() >= this->_event_report_batch_size)
+            this->__flush_event_report_batch(slot, uri);
+
+        // should be save to delete the event here, as
+        // all parent / relative connection should be form
+        // before the event is archived
+        // delete event;
+    }
+    if(!list_events.empty())
+        retval = GW_SUCCESS;
+
+    // flush batches which have been pending longer than the timeout, or all batches once stopping
+    if(!slot->map_batch.empty()){
+        current_tick = GWUtilTscTimer::get_tsc();
+        for(auto it = slot->map_batch.begin(); it != slot->map_batch.end(); ){
+            uri = (it++)->first;
+            if(is_stopping or current_tick - slot->map_batch[uri].second >= this->_event_report_batch_timeout_tick){
+                this->__flush_event_report_batch(slot, uri);
+                retval = GW_SUCCESS;
             }
+        }
+    }
+    if(!slot->map_batch.empty())
+        has_pending_batch = true;
+
+    // the app thread has exited and all of its events are reported, so the slot is removed
+    if(
+        unlikely(slot->is_retired.load(std::memory_order_acquire))
+        and slot->map_batch.empty()
+        and slot->event_trace->is_event_trace_empty()
+    ){
+        this->__remove_event_report_slot(slot);
+    }
 
-        _exit:
-            // should be save to delete the event here, as
-            // all parent / relative connection should be form
-            // before the event is archived
-            // delete event;
+    slot->is_claimed.store(false, std::memory_order_release);
 
-            if(capsule_message != nullptr){
-                delete capsule_message;
-                capsule_message = nullptr;
-            }
+exit:
+    return retval;
+}
+
+
+void GWCapsule::__flush_event_report_batch(__gw_event_report_slot_t* slot, const std::string& uri){
+    gw_retval_t retval = GW_SUCCESS;
+    GWInternalMessage_Capsule *capsule_message = nullptr;
+    GWInternalMessagePayload_Common_DB_TS_BatchWrite *payload = nullptr;
+    std::string frame = "";
+    uint64_t nb_samples = 0;
+
+    GW_CHECK_POINTER(slot);
+    if(slot->map_batch.count(uri) == 0)
+        return;
+
+    GW_CHECK_POINTER(capsule_message = slot->map_batch[uri].first);
+    payload = capsule_message->get_payload_ptr<GWInternalMessagePayload_Common_DB_TS_BatchWrite>(GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB);
+    GW_CHECK_POINTER(payload);
+    payload->serialize_frame(frame);
+    nb_samples = payload->get_nb_samples();
+
+    // NOTE(zhuobin): with spilling enabled, the batch is persisted first and then replayed,
+    //                so the reporter never blocks on (or loses batches to) the scheduler;
+    //                a batch larger than the ring falls back to be sent directly
+    if(this->_event_spill_ring != nullptr and this->_event_spill_ring->append(frame) == GW_SUCCESS){
+        GW_DEBUG(
+            "spilled event batch: linux_thread_id(%lu), uri(%s), nb_events(%lu)",
+            slot->linux_thread_id, uri.c_str(), nb_samples
+        );
+        this->__replay_event_spill();
+    } else {
+        retval = this->__send_event_frame(std::move(frame), /* spill_end_offset */ 0);
+        if(retval == GW_SUCCESS){
+            GW_DEBUG(
+                "reported event batch: linux_thread_id(%lu), uri(%s), nb_events(%lu)",
+                slot->linux_thread_id, uri.c_str(), nb_samples
+            );
         }
     }
 
-    GW_DEBUG("stop to report event stream to scheduler: linux_thread_id(%lu)", linux_thread_id);
+    delete capsule_message;
+    slot->map_batch.erase(uri);
+}
+
+
+gw_retval_t GWCapsule::__replay_event_spill(){
+    gw_retval_t retval = GW_FAILED_NOT_READY;
+    std::string frame = "";
+    uint64_t nb_inflight = 0, end_offset = 0, sent_offset = 0;
+
+    GW_CHECK_POINTER(this->_event_spill_ring);
+
+    std::unique_lock lock(this->_mutex_event_spill_replay, std::try_to_lock);
+    if(!lock.owns_lock())
+        goto exit;
+
+    if(this->_ws_intance == nullptr or this->_is_daemon_stop)
+        goto exit;
+
+    // bound the number of unacknowledged batches, so that memory stays flat while
+    // the scheduler falls behind, the backlog waits in the ring instead
+    while(true){
+        {
+            std::lock_guard inflight_lock(this->_mutex_event_spill_inflight);
+            nb_inflight = this->_queue_event_spill_inflight.size();
+            sent_offset = this->_event_spill_sent_offset;
+        }
+        if(nb_inflight >= GW_CAPSULE_EVENT_SPILL_MAX_INFLIGHT)
+            break;
+        if(this->_event_spill_ring->read_next(frame, end_offset) != GW_SUCCESS)
+            break;
+        if(unlikely(this->__send_event_frame(std::move(frame), end_offset) != GW_SUCCESS)){
+            GW_WARN_C("failed to replay spilled event batch, will retry");
+            this->_event_spill_ring->rewind(sent_offset);
+            break;
+        }
+        retval = GW_SUCCESS;
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWCapsule::__send_event_frame(std::string&& frame, uint64_t spill_end_offset){
+    gw_retval_t retval = GW_SUCCESS;
+
+    // NOTE(zhuobin): the frame is queued and tracked under the same lock, so that the
+    //                order of tracked frames matches the order of acknowledgements
+    std::lock_guard lock(this->_mutex_event_spill_inflight);
+
+    retval = this->send_frame_to_scheduler(std::move(frame));
+    if(retval != GW_SUCCESS)
+        goto exit;
+
+    if(this->_event_spill_ring != nullptr){
+        this->_queue_event_spill_inflight.push_back(spill_end_offset);
+        if(spill_end_offset > 0)
+            this->_event_spill_sent_offset = spill_end_offset;
+    }
+
+exit:
+    return retval;
 }
 
 
@@ -463,6 +1087,33 @@ exit:
 }
 
 
+gw_retval_t GWCapsule::send_frame_to_scheduler(std::string&& frame){
+    gw_retval_t retval = GW_SUCCESS;
+    static bool has_warn_websocket_not_ready = false;
+
+    if(this->_ws_intance == nullptr){
+        if(unlikely(!has_warn_websocket_not_ready)){
+            GW_WARN_C("websocket not ready, turn off sending frame to scheduler");
+            has_warn_websocket_not_ready = true;
+        }
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    GW_IF_FAILED(
+        this->_ws_intance->send(std::move(frame), /* is_binary */ true),
+        retval,
+        {
+            GW_WARN_C("failed to send frame to scheduler: %s", gw_retval_str(retval));
+            goto exit;
+        }
+    );
+
+exit:
+    return retval;
+}
+
+
 gw_retval_t GWCapsule::sync_send_to_scheduler(){
     gw_retval_t retval = GW_SUCCESS;
     
@@ -682,6 +1333,9 @@ int GWCapsule::__websocket_callback(
             case GW_MESSAGE_TYPEID_CAPSULE_REGISTER:
                 capsule->__process_capsule_resp_REGISTER(&message);
                 break;
+            case GW_MESSAGE_TYPEID_CAPSULE_BATCH_ACK:
+                capsule->__process_capsule_resp_BATCH_ACK(&message);
+                break;
             default:
                 GW_WARN("received unknown scheduler message type: message_type(%d)", message.type_id);
             }
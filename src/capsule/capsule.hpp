@@ -7,24 +7,36 @@
 #include <set>
 #include <map>
 #include <queue>
+#include <deque>
 #include <atomic>
 #include <format>
+#include <future>
 #include <string>
+#include <memory>
 
 #include <libwebsockets.h>
 
 #include "common/common.hpp"
 #include "common/log.hpp"
 #include "common/binary.hpp"
+#include "common/instrument_cache.hpp"
 #include "common/assemble/kernel.hpp"
 #include "common/assemble/kernel_def.hpp"
+#include "common/assemble/kernel_dedup.hpp"
 #include "common/utils/timer.hpp"
 #include "common/utils/socket.hpp"
 #include "common/utils/queue.hpp"
+#include "common/utils/mpsc_queue.hpp"
+#include "common/utils/slab_ring.hpp"
+#include "common/utils/lockfree_table.hpp"
+#include "common/utils/rcu_map.hpp"
+#include "common/utils/spill_ring.hpp"
+#include "common/utils/thread_pool.hpp"
 #include "common/cuda_impl/binary/utils.hpp"
 #include "capsule/event.hpp"
 #include "capsule/metric.hpp"
 #include "capsule/trace.hpp"
+#include "capsule/trace_matcher.hpp"
 #include "profiler/context.hpp"
 #include "scheduler/serve/capsule_message.hpp"
 
@@ -37,6 +49,96 @@
 #endif
 
 
+/*!
+ *  \brief  descriptor of a launched kernel function, which is created on the first launch
+ *          and cached, so that launch hooks don't query the capsule on every launch
+ */
+typedef struct gw_capsule_launch_desc {
+    // name of the function
+    std::string name = "";
+
+    // the function (CUfunction)
+    void *function = nullptr;
+
+    // the context which launches the function (CUcontext), nullptr if it's unknown
+    void *context = nullptr;
+
+    // kernel definition of the function, nullptr if the function is still being parsed
+    // in background while the descriptor is created, which is filled once the parsing finishes
+    std::atomic<GWKernelDef*> kernel_def = nullptr;
+
+    // memoized decision of whether to trace the function: (version of trace tasks << 1) | need_trace
+    std::atomic<uint64_t> trace_decision = 0;
+
+    // generation of modules when the descriptor was created, the descriptor is stale once
+    // any module is unloaded afterwards, as the CUfunction could be reused
+    uint64_t module_generation = 0;
+} gw_capsule_launch_desc_t;
+
+
+/*!
+ *  \brief  background parsing job of a kernel function, the future is ready once the kernel
+ *          definition of the function is published, or the parsing fails
+ */
+typedef struct gw_capsule_parse_job {
+    std::promise<gw_retval_t> promise;
+    std::shared_future<gw_retval_t> future;
+
+    // whether the module of the function has been unloaded, in which case the job publishes
+    // nothing, guarded by _mutex_module_management of the capsule
+    bool is_cancelled = false;
+} gw_capsule_parse_job_t;
+
+
+/*!
+ *  \brief  compact record of a kernel launch for tracing kernel launch, which is stored by
+ *          value on the hot path and materialized into GWKernel once tracing is stopped
+ */
+typedef struct gw_capsule_kernel_launch_record {
+    // launch descriptor of the function, which lives as long as the capsule
+    const gw_capsule_launch_desc_t *launch_desc;
+
+    // launch shape
+    uint32_t grid_dim_x;
+    uint32_t grid_dim_y;
+    uint32_t grid_dim_z;
+    uint32_t block_dim_x;
+    uint32_t block_dim_y;
+    uint32_t block_dim_z;
+
+    // usage of shared memory
+    uint32_t shared_mem_bytes;
+
+    // number of launch attributes, placed among 32-bit fields to avoid padding
+    uint32_t num_attrs;
+
+    // the stream to launch the kernel
+    uint64_t stream;
+
+    // TSC tick of the launch
+    uint64_t launch_tick;
+
+    // parameters and launch attributes (CUlaunchAttribute*) of the launch, owned by the
+    // caller of the launch
+    void **params;
+    void **extra;
+    void *attrs;
+} gw_capsule_kernel_launch_record_t;
+static_assert(sizeof(gw_capsule_kernel_launch_record_t) == 80, "size of kernel launch record is changed, update GW_CAPSULE_KERNEL_LAUNCH_QUEUE_DEFAULT_LEN");
+
+
+/*!
+ *  \brief  hash of keys of module registries, which are scoped by context,
+ *          i.e., (context, handle / name)
+ */
+typedef struct gw_capsule_context_key_hash {
+    template<typename C, typename T>
+    inline uint64_t operator()(const std::pair<C, T>& key) const {
+        return std::hash<C>()(key.first) ^ (std::hash<T>()(key.second) * 0x9e3779b97f4a7c15ull);
+    }
+} gw_capsule_context_key_hash_t;
+
+
 /*!
  *  \brief  capsule for executing profiling according to a specific plan
  */
@@ -182,10 +284,53 @@ class GWCapsule {
     bool do_need_trace_kernel(std::string kernel_name);
 
 
+    /*!
+     *  \brief  check whether the capsule need to trace the function of the launch descriptor,
+     *          the decision is memoized within the descriptor until trace tasks of
+     *          current thread change
+     *  \param  launch_desc  launch descriptor of the function
+     *  \return true if has, false otherwise
+     */
+    inline bool do_need_trace_kernel(gw_capsule_launch_desc_t* launch_desc){
+        uint64_t version = this->_trace_task_kernel_matcher.get_version(), decision = 0;
+        bool need_trace = false;
+
+        // no trace task on current thread
+        if(likely(version == 0))
+            return false;
+
+        decision = launch_desc->trace_decision.load(std::memory_order_relaxed);
+        if(likely((decision >> 1) == version))
+            return decision & 1;
+
+        need_trace = this->do_need_trace_kernel(launch_desc->name);
+        launch_desc->trace_decision.store((version << 1) | need_trace, std::memory_order_relaxed);
+        return need_trace;
+    }
+
+
+    // cache of instrumented binaries, shared among trace tasks
+    GWInstrumentCache instrument_cache;
+
+
  private:
+    /*!
+     *  \brief  recompile filters of kernel trace tasks of current thread into the matcher,
+     *          which renews its version and hence invalidates trace decisions memoized in
+     *          launch descriptors
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t __compile_trace_task_kernel_matcher();
+
     // list of trace task (per thread)
     static thread_local std::vector<GWTraceTask*>   _list_trace_task;
     static thread_local std::vector<GWTraceTask*>   _list_trace_task_kernel;
+
+    // compiled filters of kernel trace tasks of current thread, the i-th bit of match
+    // masks is the i-th task of _list_trace_task_kernel (see GWTraceTaskMatcher::is_matched
+    // for tasks beyond the mask); its version is 0 if there's no kernel trace task, and
+    // versions are unique among threads
+    static thread_local GWTraceTaskMatcher _trace_task_kernel_matcher;
     /* ======================== Trace Management ======================== */
 
 
@@ -208,37 +353,59 @@ class GWCapsule {
 
 
     /*!
-     *  \brief  stop tracing kernel launch
+     *  \brief  stop tracing kernel launch, recorded launches of all threads are materialized
+     *          into kernel instances, in the order of launch within each thread
+     *  \note   launch ticks are returned aside rather than within GWKernel, whose layout is
+     *          shared with the prebuilt kernel extension
+     *  \param  list_kernel         kernel instances of traced launches, owned by the caller
+     *  \param  list_launch_tick    TSC tick of each traced launch, i-th for the i-th kernel
      *  \return GW_SUCCESS if success, GW_FAILED otherwise
      */
-    gw_retval_t stop_tracing_kernel_launch(std::vector<GWKernel*> &list_kernel);
+    gw_retval_t stop_tracing_kernel_launch(std::vector<GWKernel*> &list_kernel, std::vector<uint64_t> &list_launch_tick);
  
 
     /*!
-     *  \brief  add an event trace for tracing kernel launch
-     *  \param  kernel  kernel to be traced
+     *  \brief  record a kernel launch for tracing kernel launch
+     *  \param  record  record of the launch
      */
-    inline void append_kernel_launch(GWKernel* kernel){
-        if(unlikely(GWCapsule::q_kernel_launch == nullptr)){
-            GWCapsule::q_kernel_launch = new GWUtilsLockFreeQueue<GWKernel*>();
-            GW_CHECK_POINTER(GWCapsule::q_kernel_launch);
-            {
-                std::lock_guard lock(this->_mutex_list_q_trace_kernel_launch);
-                this->_list_q_trace_kernel_launch.push_back(GWCapsule::q_kernel_launch);
-            }
-        }
-        GWCapsule::q_kernel_launch->push(kernel);
+    inline void append_kernel_launch(const gw_capsule_kernel_launch_record_t& record){
+        if(unlikely(GWCapsule::q_kernel_launch == nullptr))
+            this->__create_kernel_launch_queue();
+        GWCapsule::q_kernel_launch->push(record);
     }
 
 
+    /*!
+     *  \brief  obtain statistics of queues for tracing kernel launch, accumulated over all threads
+     *  \return accumulated statistics
+     */
+    gw_utils_queue_stat_t get_kernel_launch_queue_stat();
+
+
+    /*!
+     *  \brief  obtain statistics of pending / archived events of event traces, accumulated
+     *          over all threads (including exited ones)
+     *  \param  pending_stat    accumulated statistics of pending events
+     *  \param  archived_stat   accumulated statistics of archived events
+     */
+    void get_event_queue_stat(gw_utils_queue_stat_t& pending_stat, gw_utils_queue_stat_t& archived_stat);
+
+
  private:
+    /*!
+     *  \brief  create the queue for tracing kernel launch of current thread, configured by
+     *          GW_KERNEL_LAUNCH_QUEUE_LEN, GW_KERNEL_LAUNCH_QUEUE_POLICY and
+     *          GW_KERNEL_LAUNCH_QUEUE_SAMPLE_RATE
+     */
+    void __create_kernel_launch_queue();
+
     // flag for tracing kernel launch
     alignas(64) std::atomic<bool> _flag_trace_kernel_launch{false};
 
-    // event trace queue for tracing kernel launch
+    // per-thread rings of launch records for tracing kernel launch
     std::mutex _mutex_list_q_trace_kernel_launch;
-    static thread_local GWUtilsLockFreeQueue<GWKernel*>* q_kernel_launch;
-    std::vector<GWUtilsLockFreeQueue<GWKernel*>*> _list_q_trace_kernel_launch;
+    static thread_local GWUtilsSlabRing<gw_capsule_kernel_launch_record_t>* q_kernel_launch;
+    std::vector<GWUtilsSlabRing<gw_capsule_kernel_launch_record_t>*> _list_q_trace_kernel_launch;
     /* ======================== Trace Managemen: kernel ======================== */
 
 
@@ -314,7 +481,7 @@ class GWCapsule {
 
 
     /*!
-     *  \brief  ensure the event trace and the thread for report to scheduler is created
+     *  \brief  ensure the event trace is created and registered to the event reporter pool
      */
     void ensure_event_trace();
 
@@ -324,21 +491,155 @@ class GWCapsule {
 
  private:
     /*!
-     *  \brief  thread function to report to scheduler
-     *  \param  _this           the capsule instance
-     *  \param  event_trace     the event trace to report
-     *  \param  linux_thread_id the linux thread id of the report thread
+     *  \brief  event trace registered to the event reporter pool, along with its pending batches
+     */
+    typedef struct __gw_event_report_slot {
+        GWEventTrace *event_trace = nullptr;
+        uint64_t linux_thread_id = 0;
+
+        // whether a reporter is draining the trace, a trace is drained by at most one
+        // reporter at a time, so that events of an app thread are reported in order
+        std::atomic<bool> is_claimed = false;
+
+        // pending batch of each series: <uri, <message, tick of the first event>>
+        std::map<std::string, std::pair<GWInternalMessage_Capsule*, uint64_t>> map_batch;
+
+        // set once the app thread exits, the slot is removed from the pool after it's drained
+        std::atomic<bool> is_retired = false;
+
+        ~__gw_event_report_slot(){
+            // the trace of an exited app thread is no longer referenced once the slot is released
+            if(this->is_retired.load(std::memory_order_acquire) and this->event_trace != nullptr)
+                delete this->event_trace;
+        }
+    } __gw_event_report_slot_t;
+
+
+    /*!
+     *  \brief  retire the slot of an app thread when the thread exits
      */
-    static void __event_report_func(
-        GWCapsule* _this, GWEventTrace *event_trace, uint64_t linux_thread_id
+    typedef struct __gw_event_report_slot_guard {
+        std::shared_ptr<__gw_event_report_slot_t> slot = nullptr;
+
+        ~__gw_event_report_slot_guard(){
+            if(this->slot != nullptr)
+                this->slot->is_retired.store(true, std::memory_order_release);
+        }
+    } __gw_event_report_slot_guard_t;
+
+    // guard of the slot registered by current thread
+    static thread_local __gw_event_report_slot_guard_t _event_report_slot_guard;
+
+
+    /*!
+     *  \brief  start the event reporter pool (if not started)
+     *  \note   should be called with _mutex_event_report held
+     */
+    void __start_event_report_pool();
+
+
+    /*!
+     *  \brief  thread function of reporters, which drains event traces of its own shard,
+     *          and steals event traces of other shards once idle
+     *  \param  _this       the capsule instance
+     *  \param  worker_id   index of the reporter within the pool
+     */
+    static void __event_report_func(GWCapsule* _this, uint64_t worker_id);
+
+
+    /*!
+     *  \brief  claim an event trace, report its archived events and flush its timed-out batches
+     *  \param  slot        the slot of the event trace
+     *  \param  is_stopping whether the reporter pool is stopping, which flushes all batches
+     *  \param  has_pending_batch  set if the trace still has pending batches after draining
+     *  \return GW_SUCCESS if any event is reported or any batch is flushed,
+     *          GW_FAILED_NOT_READY if nothing to be done,
+     *          GW_FAILED_ALREADY_EXIST if the trace is claimed by another reporter
+     */
+    gw_retval_t __drain_event_report_slot(
+        __gw_event_report_slot_t* slot, bool is_stopping, bool& has_pending_batch
     );
 
-    // thread to report trace event to scheduler
-    static thread_local std::thread* _event_report_thread;
 
-    // map of event report thread: <thread_id, thread_handle>
-    std::mutex _mutex_map_event_report_thread;
-    std::map<uint64_t, std::thread*> _map_event_report_thread;
+    /*!
+     *  \brief  send a pending batch of the event trace to the scheduler and release it
+     *  \param  slot    the slot of the event trace
+     *  \param  uri     uri of the batch
+     */
+    void __flush_event_report_batch(__gw_event_report_slot_t* slot, const std::string& uri);
+
+
+    /*!
+     *  \brief  remove a retired slot from the reporter pool
+     *  \note   should be called with the slot claimed, after it's fully drained; reporters
+     *          keep referencing the slot until they refresh their snapshot of the pool
+     *  \param  slot    the slot to be removed
+     */
+    void __remove_event_report_slot(__gw_event_report_slot_t* slot);
+
+
+    /*!
+     *  \brief  open the spill ring of event batches if GW_EVENT_SPILL_DIR is set, batches are
+     *          appended to the ring before being sent, so they survive disconnection of the
+     *          scheduler and crash of the app
+     *  \note   should be called with _mutex_event_report held
+     */
+    void __open_event_spill();
+
+
+    /*!
+     *  \brief  replay spilled event batches to the scheduler, batches handed to the websocket
+     *          are committed once the scheduler acknowledges them (see
+     *          __process_capsule_resp_BATCH_ACK), so they are delivered at least once
+     *  \note   at most one thread replays at a time, others return immediately
+     *  \return GW_SUCCESS if any batch is handed to the websocket,
+     *          GW_FAILED_NOT_READY if nothing to replay or the scheduler isn't reachable
+     */
+    gw_retval_t __replay_event_spill();
+
+
+    /*!
+     *  \brief  send a batch frame to the scheduler, and track it until it's acknowledged
+     *          if spilling is enabled, so that acknowledgements are matched in order
+     *  \param  frame               the batch frame
+     *  \param  spill_end_offset    end offset of the frame within the spill ring (committed
+     *                              once acknowledged), 0 if the frame isn't spilled
+     *  \return GW_SUCCESS if the frame is handed to the websocket, otherwise GW_FAILED_NOT_READY
+     */
+    gw_retval_t __send_event_frame(std::string&& frame, uint64_t spill_end_offset);
+
+    // reporter pool, along with registered event traces
+    std::mutex _mutex_event_report;
+    std::vector<std::thread*> _list_event_report_thread;
+    std::vector<std::shared_ptr<__gw_event_report_slot_t>> _list_event_report_slot;
+
+    // version of the list of slots, bumped whenever a slot is registered or removed
+    std::atomic<uint64_t> _event_report_slot_version = 0;
+
+    // statistics of event traces of removed slots, protected by _mutex_event_report
+    gw_utils_queue_stat_t _event_report_removed_pending_stat;
+    gw_utils_queue_stat_t _event_report_removed_archived_stat;
+
+    // completion signal shared by all registered event traces
+    gw_event_completion_signal_t _event_report_signal;
+
+    // configurations of the reporter pool
+    uint64_t _event_report_nb_threads = 0;
+    int _event_report_numa_node = -1;
+    uint64_t _event_report_batch_size = 0;
+    uint64_t _event_report_batch_timeout_us = 0;
+    uint64_t _event_report_batch_timeout_tick = 0;
+    gw_ts_batch_encoding_t _event_report_encoding = GW_TS_BATCH_ENCODING_COMPACT_LZ4;
+
+    // spill ring of event batches, nullptr if spilling is disabled
+    GWUtilSpillRing *_event_spill_ring = nullptr;
+    std::mutex _mutex_event_spill_replay;
+
+    // end offsets (within the spill ring) of batch frames waiting for acknowledgement, in
+    // the order of sending, along with the end offset of the last replayed frame
+    std::mutex _mutex_event_spill_inflight;
+    std::deque<uint64_t> _queue_event_spill_inflight;
+    uint64_t _event_spill_sent_offset = 0;
 
     // map of metric trace
     std::map<uint64_t, GWAppMetricTrace*> _map_begin_hash_to_app_trace;
@@ -359,6 +660,15 @@ class GWCapsule {
     gw_retval_t send_to_scheduler(GWInternalMessage_Capsule *message);
 
 
+    /*!
+     *  \brief  send a binary frame (e.g., batch of timeseries samples) to the scheduler
+     *  \param  frame   the binary frame
+     *  \return GW_SUCCESS if success,
+     *          GW_FAILED_NOT_READY for no websocket connection is built
+     */
+    gw_retval_t send_frame_to_scheduler(std::string&& frame);
+
+
     /*!
      *  \brief  sync send message to the scheduler
      *  \return GW_SUCCESS if success, GW_FAILED otherwise
@@ -374,6 +684,14 @@ class GWCapsule {
     void __process_capsule_resp_REGISTER(GWInternalMessage_Capsule *message);
 
 
+    /*!
+     *  \brief  process the capsule message: BATCH_ACK, which consumes the acknowledged
+     *          batch from the spill ring
+     *  \param  message     the received message
+     */
+    void __process_capsule_resp_BATCH_ACK(GWInternalMessage_Capsule *message);
+
+
     /*!
      *  \brief  start the websocket daemon
      *  \return GW_SUCCESS if success, GW_FAILED otherwise
@@ -424,7 +742,7 @@ class GWCapsule {
     // capsule heartbeat thread handle
     std::thread *_heartbeat_thread = nullptr;
 
-    // signal for stopping the event report thread
+    // signal for stopping the event reporter pool
     volatile bool _is_event_report_stop = false;
 
     // signal for stopping the daemon thread
@@ -507,6 +825,15 @@ class GWCapsule {
     );
 
 
+    /*!
+     *  \brief  materialize a kernel instance from the record of a traced kernel launch
+     *  \param  record  record of the launch
+     *  \param  kernel  the materialized kernel instance, owned by the caller
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t CUDA_materialize_kernel_launch(const gw_capsule_kernel_launch_record_t& record, GWKernel*& kernel);
+
+
     /* ============ CUDA - Module Management ============ */
  public:
     /*!
@@ -569,6 +896,26 @@ class GWCapsule {
     gw_retval_t CUDA_record_mapping_cufunction_cumodule(CUfunction function, CUmodule module);
 
 
+    /*!
+     *  \brief  forget the unloaded CUmodule, along with its CUfunctions and their kernel
+     *          definitions, and invalidate cached launch descriptors, so that handles reused
+     *          by modules loaded afterwards aren't resolved to stale records
+     *  \note   this function is thread safe, and should be called once the module is unloaded
+     *  \param  module  CUDA module handle
+     *  \return GW_SUCCESS  for successful invalidation
+     */
+    gw_retval_t CUDA_unload_cumodule(CUmodule module);
+
+
+    /*!
+     *  \brief  forget the unloaded CUlibrary along with all of its CUmodules (see CUDA_unload_cumodule)
+     *  \note   this function is thread safe, and should be called once the library is unloaded
+     *  \param  library CUDA library handle
+     *  \return GW_SUCCESS  for successful invalidation
+     */
+    gw_retval_t CUDA_unload_culibrary(CUlibrary library);
+
+
     /*!
      *  \brief  parse CUfunction
      *  \note   this function should be called during get function from module operation
@@ -580,6 +927,59 @@ class GWCapsule {
     gw_retval_t CUDA_parse_cufunction(CUfunction function, CUmodule module, bool do_parse_entire_binary=true);
 
 
+    /*!
+     *  \brief  submit parsing of CUfunction to background workers, so that the application
+     *          thread isn't blocked on decompressing and parsing the binary
+     *  \note   this function is thread safe, the function is parsed once even if it's
+     *          submitted multiple times; it's parsed synchronously if background parsing
+     *          is disabled (i.e., GW_PARSE_NB_WORKERS=0)
+     *  \param  function                the CUfunction to be parsed
+     *  \param  module                  the CUmodule that contain this function
+     *  \param  do_parse_entire_binary  mark whether to parse the entire binary
+     *  \return GW_SUCCESS if the parsing is submitted (or succeeded if it's synchronous)
+     */
+    gw_retval_t CUDA_parse_cufunction_async(CUfunction function, CUmodule module, bool do_parse_entire_binary=false);
+
+
+    /*!
+     *  \brief  get the kernel definition by CUfunction, wait for its background parsing if
+     *          it's still being parsed
+     *  \note   this function is thread safe, and lock-free if the function has been parsed
+     *  \param  function    the CUfunction
+     *  \param  kernel_def  the kernel definition
+     *  \return GW_SUCCESS if success,
+     *          GW_FAILED_NOT_EXIST if the function is neither parsed nor being parsed,
+     *          otherwise the error of the background parsing
+     */
+    gw_retval_t CUDA_wait_kerneldef_by_cufunction(CUfunction function, GWKernelDef*& kernel_def);
+
+
+    /*!
+     *  \brief  get the kernel definition by CUfunction within the given context, wait for its
+     *          background parsing if it's still being parsed
+     *  \note   this function is thread safe, and could be called from threads without the
+     *          context being current (e.g., materializing launch records)
+     *  \param  cu_context  the context which loads the function
+     *  \param  function    the CUfunction
+     *  \param  kernel_def  the kernel definition
+     *  \return GW_SUCCESS if success,
+     *          GW_FAILED_INVALID_INPUT if the context is unknown,
+     *          GW_FAILED_NOT_EXIST if the function is neither parsed nor being parsed,
+     *          otherwise the error of the background parsing
+     */
+    gw_retval_t CUDA_wait_kerneldef_by_cufunction(CUcontext cu_context, CUfunction function, GWKernelDef*& kernel_def);
+
+
+    /*!
+     *  \brief  calculate the fingerprint of the kernel definition, with offsets patched by
+     *          relocations of its text section normalized, so that the fingerprint of a
+     *          kernel is the same no matter which path calculates it first
+     *  \param  kerneldef   the kernel definition, must be parsed from a cubin
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t CUDA_calculate_kerneldef_fingerprint(GWKernelDef *kerneldef);
+
+
     /*!
      *  \brief  record the function
      *  \note   this function is thread safe 
@@ -591,7 +991,7 @@ class GWCapsule {
 
     /*!
      *  \brief  get the kernel definition by CUfunction
-     *  \note   this function is thread safe 
+     *  \note   this function is thread safe and lock-free
      *  \param  function    the CUfunction to be recorded
      *  \param  kernel_def  the kernel definition to be recorded
      *  \return GW_SUCCESS  for successful recording
@@ -599,8 +999,34 @@ class GWCapsule {
     gw_retval_t CUDA_get_kerneldef_by_cufunction(CUfunction function, GWKernelDef*& kernel_def);
 
 
+    /*!
+     *  \brief  get the launch descriptor of the CUfunction, which is created on the first
+     *          launch of the function and cached in a lock-free table
+     *  \note   this function is thread safe, and lock-free once the descriptor is cached;
+     *          it never waits for background parsing, so the kernel definition within the
+     *          descriptor could be nullptr, and should be obtained via
+     *          CUDA_wait_kerneldef_by_cufunction once it's actually needed
+     *          cached descriptors are rebuilt on their next launch once any module is
+     *          unloaded, as the CUfunction could be reused by modules loaded afterwards
+     *  \param  function        the CUfunction to be launched
+     *  \param  launch_desc     the launch descriptor
+     *  \return GW_SUCCESS if success
+     */
+    inline gw_retval_t CUDA_get_launch_desc(CUfunction function, gw_capsule_launch_desc_t*& launch_desc){
+        launch_desc = this->_table_launch_desc.find(reinterpret_cast<uint64_t>(function));
+        if(likely(
+            launch_desc != nullptr
+            and launch_desc->module_generation == this->_cumodule_generation.load(std::memory_order_acquire)
+        )){
+            return GW_SUCCESS;
+        }
+        return this->__CUDA_create_launch_desc(function, launch_desc);
+    }
+
+
     /*!
      *  \brief  get the kernel definition by name
+     *  \note   this function is thread safe and lock-free
      *  \param  name            name of the kernel
      *  \param  kernel_def      pointer to the kernel definition
      *  \return GW_SUCCESS if success, otherwise GW_FAILURE
@@ -617,9 +1043,54 @@ class GWCapsule {
 
 
  private:
-    // mutex for manage modules
+    /*!
+     *  \brief  slow path of CUDA_get_launch_desc, which creates and caches the launch descriptor
+     *  \param  function        the CUfunction to be launched
+     *  \param  launch_desc     the launch descriptor
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t __CUDA_create_launch_desc(CUfunction function, gw_capsule_launch_desc_t*& launch_desc);
+
+
+    /*!
+     *  \brief  fill the kernel definition into the cached launch descriptor of the function,
+     *          once the function is parsed after the descriptor was created
+     *  \param  cu_context  the context which loads the function
+     *  \param  function    the parsed CUfunction
+     *  \param  kernel_def  the kernel definition
+     */
+    void __CUDA_publish_kerneldef_to_launch_desc(CUcontext cu_context, CUfunction function, GWKernelDef *kernel_def);
+
+    // launch descriptors of CUfunctions: <cufunction, launch descriptor>
+    GWUtilLockFreeTable<gw_capsule_launch_desc_t> _table_launch_desc;
+
+    // launch descriptors which don't fit in the table: <cufunction, launch descriptor>
+    std::mutex _mutex_overflow_launch_desc;
+    std::map<CUfunction, gw_capsule_launch_desc_t*> _map_overflow_launch_desc;
+
+    // stale launch descriptors replaced within the overflow map, which are kept until
+    // destruction as launch records could still refer to them
+    std::vector<gw_capsule_launch_desc_t*> _list_retired_launch_desc;
+
+    // generation of modules, which is bumped once any module is unloaded
+    std::atomic<uint64_t> _cumodule_generation = 0;
+
+    /*!
+     *  \brief  forget the unloaded CUmodules of the context (see CUDA_unload_cumodule)
+     *  \note   should be called with _mutex_module_management held
+     *  \param  cu_context  the context which loads the modules
+     *  \param  set_modules the unloaded modules
+     */
+    void __CUDA_forget_cumodules(CUcontext cu_context, const std::set<CUmodule>& set_modules);
+
+    // mutex for manage modules, which serializes loading modules and updating registries,
+    // while registries of functions are read without it, and binaries are parsed without it
     std::mutex _mutex_module_management;
 
+    // mutexes which serialize parsing of each top-level binary image (fatbin or cubin) of
+    // modules, inserted with _mutex_module_management held: <image, mutex>
+    std::map<GWBinaryImage*, std::mutex> _map_binary_parse_mutex;
+
     // map of CUlibary to its contained binary data
     std::map<CUlibrary, std::vector<uint8_t>> _map_culibrary_data;
 
@@ -629,11 +1100,11 @@ class GWCapsule {
     // map from CUmodule to its parent CUlibary: <cucontext, <module, culibrary>>
     std::map<CUcontext, std::map<CUmodule, CUlibrary>> _map_cumodule_culibrary;
 
-    // map from CUfunction to its parent CUmodule: <cucontext, <function, module>>
-    std::map<CUcontext, std::map<CUfunction, CUmodule>> _map_cufunction_cumodule;
+    // registry from CUfunction to its parent CUmodule: <(cucontext, function), module>
+    GWUtilRcuMap<std::pair<CUcontext, CUfunction>, CUmodule, gw_capsule_context_key_hash_t> _map_cufunction_cumodule;
 
-    // map of CUfunction with its corresponding kernel definition: <cucontext, <cufunction, kerneldef>>
-    std::map<CUcontext, std::map<CUfunction, GWKernelDef*>> _map_cufunction_kerneldef;
+    // registry of CUfunction with its corresponding kernel definition: <(cucontext, cufunction), kerneldef>
+    GWUtilRcuMap<std::pair<CUcontext, CUfunction>, GWKernelDef*, gw_capsule_context_key_hash_t> _map_cufunction_kerneldef;
 
     // map of CUmodule with its contained fatbin: <cucontext, <module, fatbin>>
     std::map<CUcontext, std::map<CUmodule, GWBinaryImage*>> _map_cumodule_fatbin;
@@ -644,15 +1115,101 @@ class GWCapsule {
     // map of CUmodule with its contained ptx: <cucontext, <module, ptx>>
     std::map<CUcontext, std::multimap<CUmodule, GWBinaryImage*>> _map_cumodule_ptx;
 
-    // map of kernel name with its corresponding kernel definition: <cucontext, <kernel_name, kernel_def>>
-    std::map<CUcontext, std::map<std::string, GWKernelDef*>> _map_name_kerneldef;
+    // registry of kernel name with its corresponding kernel definition: <(cucontext, kernel_name), kernel_def>
+    GWUtilRcuMap<std::pair<CUcontext, std::string>, GWKernelDef*, gw_capsule_context_key_hash_t> _map_name_kerneldef;
 
     // libraries registered by user
     std::map<CUfunction, gw_cuda_function_attribute_t*> _map_trace_function;
 
+    /*!
+     *  \brief  parse CUfunction (see CUDA_parse_cufunction), the binary is parsed without
+     *          _mutex_module_management, which is only held to look up and update registries
+     *  \param  function                the CUfunction to be parsed
+     *  \param  module                  the CUmodule that contain this function
+     *  \param  do_parse_entire_binary  mark whether to parse the entire binary
+     *  \param  job                     the background job which parses the function, nothing
+     *                                  is published if the job is cancelled; nullptr if the
+     *                                  function is parsed synchronously
+     *  \return GW_SUCCESS  for successful parsing
+     */
+    gw_retval_t __CUDA_parse_cufunction(
+        CUfunction function, CUmodule module, bool do_parse_entire_binary, gw_capsule_parse_job_t *job
+    );
+
+
+    /*!
+     *  \brief  background job of parsing CUfunction
+     *  \param  cu_context              context which loads the module
+     *  \param  function                the CUfunction to be parsed
+     *  \param  module                  the CUmodule that contain this function
+     *  \param  do_parse_entire_binary  mark whether to parse the entire binary
+     *  \param  job                     the job, whose future is fulfilled once finished
+     */
+    void __CUDA_parse_cufunction_job(
+        CUcontext cu_context,
+        CUfunction function,
+        CUmodule module,
+        bool do_parse_entire_binary,
+        gw_capsule_parse_job_t *job
+    );
+
+    // worker pool for background parsing, lazily created
+    std::mutex _mutex_parse_pool;
+    GWUtilThreadPool *_parse_pool = nullptr;
+    bool _is_async_parse_disabled = false;
+
+    // registry of background parsing jobs of CUfunctions: <(cucontext, cufunction), job>
+    GWUtilRcuMap<std::pair<CUcontext, CUfunction>, gw_capsule_parse_job_t*, gw_capsule_context_key_hash_t> _map_cufunction_parse_job;
+
+    // jobs of functions within unloaded modules, which are freed on destruction as they could
+    // still be waited for
+    std::vector<gw_capsule_parse_job_t*> _list_retired_parse_job;
+
     // binary utilities
     GWBinaryUtility_CUDA _binary_utility_cuda;
 
+    // registry for sharing analysis results among kernels with identical instruction stream
+    GWKernelDefDedup _kernel_def_dedup;
+
+
+    /* ============ CUDA - Ahead-of-time Instrumentation ============ */
+ public:
+    /*!
+     *  \brief  speculatively instrument kernels within a newly loaded binary on worker
+     *          threads, for kernels which would be traced by registered trace tasks, so
+     *          that the instrumented binary is ready within the instrument cache before
+     *          their first launch
+     *  \note   the registered trace tasks of current thread are snapshotted, as trace
+     *          tasks are registered per thread
+     *  \param  binary_data     raw bytes of the loaded fatbin / cubin
+     *  \return GW_SUCCESS if the job is submitted or there's nothing to pre-instrument
+     */
+    gw_retval_t CUDA_pre_instrument_binary(const std::vector<uint8_t>& binary_data);
+
+
+ private:
+    /*!
+     *  \brief  job of ahead-of-time instrumentation, executed by worker threads
+     *  \param  cu_device           CUDA device which loads the binary
+     *  \param  cu_context          retained primary context of the device, released by the job
+     *  \param  arch_version        arch version of the device
+     *  \param  binary_data         raw bytes of the loaded fatbin / cubin
+     *  \param  list_trace_task     trace tasks to pre-instrument, owned by the job
+     */
+    void __CUDA_pre_instrument_job(
+        CUdevice cu_device,
+        CUcontext cu_context,
+        std::string arch_version,
+        std::shared_ptr<const std::vector<uint8_t>> binary_data,
+        std::vector<GWTraceTask*> list_trace_task
+    );
+
+    // worker pool for ahead-of-time instrumentation, lazily created,
+    // the pool and the disable flag are protected by _mutex_pre_instrument_pool
+    std::mutex _mutex_pre_instrument_pool;
+    GWUtilThreadPool *_pre_instrument_pool = nullptr;
+    bool _is_pre_instrument_disabled = false;
+
 
     /* ============ CUDA - CUPTI Profiling ============ */
  public:
@@ -43,20 +43,21 @@ gw_retval_t GWCapsule::CUDA_trace_single_kernel(
     CUlaunchAttribute* attrs,
     uint32_t num_attrs
 ){
-    gw_retval_t retval = GW_SUCCESS;
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
     static thread_local uint64_t trace_id = 0;
     std::string trace_global_id = "";
     CUcontext cu_context = (CUcontext)0;
     CUmodule cu_module = (CUmodule)0;
     GWKernel *kernel = nullptr;
     GWKernelExt_CUDA *kernel_ext_cuda = nullptr;
-    GWKernelDef *kernel_def_sass = nullptr;
+    GWKernelDef *kernel_def_sass = nullptr, *representative_kernel_def = nullptr;
     GWEvent *trace_event = nullptr;
     uint64_t cpu_thread_id = 0;
     std::map<std::string, GWInstrumentCxt*> map_existing_instrument_ctx;
     std::map<std::string, GWInstrumentCxt*> map_current_instrument_ctx;
     std::map<std::string, GWInstrumentCxt*> map_new_instrument_ctx;
     std::vector<std::string> list_current_instrument_cxt_global_id;
+    uint64_t trace_task_mask = 0, trace_task_index = 0;
 
     auto __report_trace_to_scheduler = [&](
         std::string _trace_global_id, std::string _trace_type, nlohmann::json&& _trace_task_serialize, \
@@ -133,17 +134,15 @@ gw_retval_t GWCapsule::CUDA_trace_single_kernel(
     GW_ASSERT(cu_context != (CUcontext)0);
 
     // find the CUmodule that contain this CUfunction
-    this->_mutex_module_management.lock();
-    if(unlikely(this->_map_cufunction_cumodule[cu_context].count(function) == 0)){
+    if(unlikely(!this->_map_cufunction_cumodule.find({ cu_context, function }, cu_module))){
         GW_WARN_C("failed to trace function, no mapped cumodule found: func(%p)", function);
         retval = GW_FAILED_NOT_EXIST;
         goto exit;
     }
-    cu_module = this->_map_cufunction_cumodule[cu_context][function];
 
-    // parse the cubin of the CUmodule (if needed)
-    if(unlikely(this->_map_cumodule_cubin[cu_context].count(cu_module) == 0)){
-        this->_mutex_module_management.unlock();
+    // obtain kernel definition, which might be parsed in background, otherwise parse the
+    // binary of the CUmodule if it's not parsed yet
+    if(unlikely(this->CUDA_wait_kerneldef_by_cufunction(function, kernel_def_sass) != GW_SUCCESS)){
         GW_IF_FAILED(
             this->CUDA_parse_cufunction(function, cu_module, /* do_parse_entire_binary */ false),
             retval,
@@ -152,20 +151,13 @@ gw_retval_t GWCapsule::CUDA_trace_single_kernel(
                 goto exit;
             }
         );
-        this->_mutex_module_management.lock();
-        GW_ASSERT(this->_map_cumodule_cubin[cu_context].count(cu_module) > 0);
-    }
-    this->_mutex_module_management.unlock();
-
-    // obtain kernel definition
-    this->_mutex_module_management.lock();
-    if(unlikely(this->_map_cufunction_kerneldef[cu_context].count(function) == 0)){
-        GW_WARN_C("failed to trace function, no kernel definition found: func(%p)", function);
-        retval = GW_FAILED_NOT_EXIST;
-        goto exit;
+        if(unlikely(!this->_map_cufunction_kerneldef.find({ cu_context, function }, kernel_def_sass))){
+            GW_WARN_C("failed to trace function, no kernel definition found: func(%p)", function);
+            retval = GW_FAILED_NOT_EXIST;
+            goto exit;
+        }
     }
-    GW_CHECK_POINTER(kernel_def_sass = this->_map_cufunction_kerneldef[cu_context][function]);
-    this->_mutex_module_management.unlock();
+    GW_CHECK_POINTER(kernel_def_sass);
 
     // instantiate kernel
     GW_CHECK_POINTER(kernel_ext_cuda = GWKernelExt_CUDA::create(kernel_def_sass));
@@ -183,23 +175,75 @@ gw_retval_t GWCapsule::CUDA_trace_single_kernel(
     kernel_ext_cuda->params().attrs = attrs;
     kernel_ext_cuda->params().num_attrs = num_attrs;
 
-    // parse register liveness of the kernel definition
-    GW_IF_FAILED(
-        kernel_def_sass->parse_register_liveness(),
-        retval,
-        {
-            GW_WARN_C(
-                "failed to start tracing due to failed to parse register livesss: error(%s)",
-                gw_retval_str(retval)
+    // try to adopt analysis results from identical kernel which has been analysed
+    if(!kernel_def_sass->is_register_liveness_parsed()){
+        if(!kernel_def_sass->has_fingerprint()){
+            GW_IF_FAILED(
+                this->CUDA_calculate_kerneldef_fingerprint(kernel_def_sass),
+                tmp_retval,
+                GW_WARN_C("failed to calculate kernel fingerprint, skip dedup: error(%s)", gw_retval_str(tmp_retval));
             );
-            goto exit;
         }
-    );
+        if(kernel_def_sass->has_fingerprint()){
+            GW_IF_FAILED(
+                this->_kernel_def_dedup.lookup_or_register(kernel_def_sass, representative_kernel_def),
+                tmp_retval,
+                representative_kernel_def = nullptr;
+            );
+            if(representative_kernel_def != nullptr){
+                GW_IF_FAILED(
+                    kernel_def_sass->adopt_analysis(representative_kernel_def),
+                    tmp_retval,
+                    GW_DEBUG_C(
+                        "failed to adopt analysis from identical kernel, parse from scratch: kernel(%s), error(%s)",
+                        function_name.c_str(), gw_retval_str(tmp_retval)
+                    );
+                );
+                if(tmp_retval == GW_SUCCESS)
+                    this->_kernel_def_dedup.record_dedup();
+            }
+            GW_DEBUG_C(
+                "kernel dedup: kernel(%s), fingerprint(%lx), adopted(%s), dedup_ratio(%.2f)",
+                function_name.c_str(),
+                kernel_def_sass->get_fingerprint(),
+                kernel_def_sass->is_register_liveness_parsed() ? "yes" : "no",
+                this->_kernel_def_dedup.get_dedup_ratio()
+            );
+        }
+    }
+
+    // parse register liveness of the kernel definition
+    if(!kernel_def_sass->is_register_liveness_parsed()){
+        GW_IF_FAILED(
+            kernel_def_sass->parse_register_liveness(),
+            retval,
+            {
+                GW_WARN_C(
+                    "failed to start tracing due to failed to parse register livesss: error(%s)",
+                    gw_retval_str(retval)
+                );
+                goto exit;
+            }
+        );
+    }
+
+    // build dense pc index for resolving pcs of trace / sampling results
+    if(!kernel_def_sass->is_pc_index_built()){
+        GW_IF_FAILED(
+            kernel_def_sass->build_pc_index(),
+            tmp_retval,
+            GW_WARN_C("failed to build pc index, fall back to tree lookup: error(%s)", gw_retval_str(tmp_retval));
+        );
+    }
+
+    // execute all trace, the i-th bit of the mask is the i-th kernel trace task, and tasks
+    // beyond the mask are matched per task
+    trace_task_mask = this->_trace_task_kernel_matcher.match(function_name);
+    for(trace_task_index=0; trace_task_index<this->_list_trace_task_kernel.size(); trace_task_index++){
+        GWTraceTask *trace_task = this->_list_trace_task_kernel[trace_task_index];
 
-    // execute all trace
-    for(auto& trace_task : this->_list_trace_task_kernel){
         // check whether need to trace this kernel
-        if(!trace_task->do_need_trace(function_name)){
+        if(!this->_trace_task_kernel_matcher.is_matched(function_name, trace_task_mask, trace_task_index)){
             continue;
         }
 
@@ -223,7 +267,7 @@ gw_retval_t GWCapsule::CUDA_trace_single_kernel(
         this->ensure_event_trace();
         GWCapsule::event_trace->push_event(trace_event);
         GWCapsule::event_trace->push_parent_event(trace_event);
-        trace_event->record_tick("begin");
+        trace_event->record_tick(GW_EVENT_KEY_TICK_BEGIN);
 
         // execute trace task
         map_current_instrument_ctx.clear();
@@ -245,7 +289,7 @@ gw_retval_t GWCapsule::CUDA_trace_single_kernel(
         );
 
         // archive trace event
-        trace_event->record_tick("end");
+        trace_event->record_tick(GW_EVENT_KEY_TICK_END);
         GWCapsule::event_trace->pop_parent_event(trace_event);
         trace_event->archive();
 
@@ -306,6 +350,52 @@ exit:
 }
 
 
+gw_retval_t GWCapsule::CUDA_materialize_kernel_launch(const gw_capsule_kernel_launch_record_t& record, GWKernel*& kernel){
+    gw_retval_t retval = GW_SUCCESS;
+    GWKernelExt_CUDA *kernel_ext_cuda = nullptr;
+    GWKernelDef *kernel_def = nullptr;
+
+    GW_CHECK_POINTER(record.launch_desc);
+
+    // the function might be parsed in background while it's launched, whose kernel definition
+    // is waited for within the context which launched it, as the current thread could be
+    // bound to another context or none
+    kernel_def = record.launch_desc->kernel_def.load(std::memory_order_acquire);
+    if(unlikely(kernel_def == nullptr)){
+        retval = this->CUDA_wait_kerneldef_by_cufunction(
+            static_cast<CUcontext>(record.launch_desc->context),
+            static_cast<CUfunction>(record.launch_desc->function),
+            kernel_def
+        );
+        if(unlikely(retval != GW_SUCCESS)){
+            GW_DEBUG_C(
+                "failed to obtain kernel definition of traced launch: CUcontext(%p), CUfunction(%p), error(%s)",
+                record.launch_desc->context, record.launch_desc->function, gw_retval_str(retval)
+            );
+            goto exit;
+        }
+    }
+
+    GW_CHECK_POINTER(kernel_ext_cuda = GWKernelExt_CUDA::create(kernel_def));
+    GW_CHECK_POINTER(kernel = kernel_ext_cuda->get_base_ptr());
+    kernel->grid_dim_x = record.grid_dim_x;
+    kernel->grid_dim_y = record.grid_dim_y;
+    kernel->grid_dim_z = record.grid_dim_z;
+    kernel->block_dim_x = record.block_dim_x;
+    kernel->block_dim_y = record.block_dim_y;
+    kernel->block_dim_z = record.block_dim_z;
+    kernel->shared_mem_bytes = record.shared_mem_bytes;
+    kernel->stream = record.stream;
+    kernel_ext_cuda->params().params = record.params;
+    kernel_ext_cuda->params().extra = record.extra;
+    kernel_ext_cuda->params().attrs = static_cast<CUlaunchAttribute*>(record.attrs);
+    kernel_ext_cuda->params().num_attrs = record.num_attrs;
+
+exit:
+    return retval;
+}
+
+
 gw_retval_t GWCapsule::CUDA_checkpoint(
     gw_capsule_cuda_state_t &state, bool do_push
 ){
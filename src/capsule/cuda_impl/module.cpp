@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include <mutex>
+#include <set>
 #include <filesystem>
 
 #include <cuda.h>
@@ -14,6 +15,8 @@
 #include "common/assemble/kernel_def.hpp"
 #include "common/utils/string.hpp"
 #include "common/utils/cuda.hpp"
+#include "common/utils/system.hpp"
+#include "common/utils/thread_pool.hpp"
 #include "common/cuda_impl/real_apis.hpp"
 #include "common/cuda_impl/binary/cubin.hpp"
 #include "common/cuda_impl/binary/fatbin.hpp"
@@ -24,6 +27,10 @@
 #include "scheduler/serve/capsule_message.hpp"
 
 
+// default number of worker threads for background parsing
+#define GW_CAPSULE_PARSE_DEFAULT_NB_WORKERS    1
+
+
 gw_retval_t GWCapsule::CUDA_cache_culibrary(CUlibrary library, std::string file_path_str){
     gw_retval_t retval = GW_SUCCESS;
     std::filesystem::path file_path;
@@ -64,14 +71,14 @@ exit:
 
 
 gw_retval_t GWCapsule::CUDA_cache_culibrary(CUlibrary library, const void *data) {
-    gw_retval_t retval = GW_SUCCESS;
-    std::lock_guard lock_guard(this->_mutex_module_management);
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    std::vector<uint8_t> binary_data;
 
     GW_ASSERT(library != (CUlibrary)0);
-    this->_map_culibrary_data.insert({ library, {} });
 
+    // NOTE(zhuobin): extracting only reads the loaded image, so it's done outside the lock
     GW_IF_FAILED(
-        GWBinaryImageExt_CUDAFatbin::extract_from_byte_sequence(data, this->_map_culibrary_data[library]),
+        GWBinaryImageExt_CUDAFatbin::extract_from_byte_sequence(data, binary_data),
         retval,
         {
             GW_WARN_C(
@@ -81,7 +88,19 @@ gw_retval_t GWCapsule::CUDA_cache_culibrary(CUlibrary library, const void *data)
             goto exit;
         }
     );
-    GW_DEBUG_C("cached CUDA library: CUlibrary(%p), size(%lu)", library, this->_map_culibrary_data[library].size());
+    GW_DEBUG_C("cached CUDA library: CUlibrary(%p), size(%lu)", library, binary_data.size());
+
+    // speculatively instrument kernels to be traced within the library
+    GW_IF_FAILED(
+        this->CUDA_pre_instrument_binary(binary_data),
+        tmp_retval,
+        GW_WARN_C("failed to submit ahead-of-time instrumentation: CUlibrary(%p), error(%s)", library, gw_retval_str(tmp_retval));
+    );
+
+    {
+        std::lock_guard lock_guard(this->_mutex_module_management);
+        this->_map_culibrary_data[library] = std::move(binary_data);
+    }
 
 exit:
     return retval;
@@ -128,9 +147,9 @@ exit:
 
 
 gw_retval_t GWCapsule::CUDA_cache_cumodule(CUmodule module, const void *data){
-    gw_retval_t retval = GW_SUCCESS;
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
     CUcontext cu_context = (CUcontext)0;
-    std::lock_guard lock_guard(this->_mutex_module_management);
+    std::vector<uint8_t> binary_data;
 
     GW_IF_FAILED(
         GWUtilCUDA::get_current_cucontext(cu_context),
@@ -141,21 +160,21 @@ gw_retval_t GWCapsule::CUDA_cache_cumodule(CUmodule module, const void *data){
     GW_ASSERT(module != (CUmodule)0);
 
     // we need to avoid the CUmodule be duplicated record due to a call to cuLibraryGetModule
-    if(this->_map_cumodule_culibrary[cu_context].count(module) > 0){
-        GW_WARN_C(
-            "CUmodule has already been recorded during cuLibraryGetModule, skip recording it again: "
-            "CUcontext(%p), CUmodule(%p)",
-            cu_context, module
-        );
-        goto exit; 
+    {
+        std::lock_guard lock_guard(this->_mutex_module_management);
+        if(this->_map_cumodule_culibrary[cu_context].count(module) > 0){
+            GW_WARN_C(
+                "CUmodule has already been recorded during cuLibraryGetModule, skip recording it again: "
+                "CUcontext(%p), CUmodule(%p)",
+                cu_context, module
+            );
+            goto exit;
+        }
     }
-    this->_map_cumodule_data[cu_context].insert({ module, {} });
 
+    // NOTE(zhuobin): extracting only reads the loaded image, so it's done outside the lock
     GW_IF_FAILED(
-        GWBinaryImageExt_CUDAFatbin::extract_from_byte_sequence(
-            data,
-            this->_map_cumodule_data[cu_context][module]
-        ),
+        GWBinaryImageExt_CUDAFatbin::extract_from_byte_sequence(data, binary_data),
         retval,
         {
             GW_WARN_C(
@@ -167,9 +186,21 @@ gw_retval_t GWCapsule::CUDA_cache_cumodule(CUmodule module, const void *data){
     );
     GW_DEBUG_C(
         "cached CUDA module: CUcontext(%p), CUmodule(%p), size(%lu)",
-        cu_context, module, this->_map_cumodule_data[cu_context][module].size()
+        cu_context, module, binary_data.size()
     );
 
+    // speculatively instrument kernels to be traced within the module
+    GW_IF_FAILED(
+        this->CUDA_pre_instrument_binary(binary_data),
+        tmp_retval,
+        GW_WARN_C("failed to submit ahead-of-time instrumentation: CUmodule(%p), error(%s)", module, gw_retval_str(tmp_retval));
+    );
+
+    {
+        std::lock_guard lock_guard(this->_mutex_module_management);
+        this->_map_cumodule_data[cu_context][module] = std::move(binary_data);
+    }
+
 exit:
     return retval;
 }
@@ -224,18 +255,14 @@ gw_retval_t GWCapsule::CUDA_record_mapping_cufunction_cumodule(CUfunction functi
     GW_ASSERT(function != (CUfunction)0);
     GW_ASSERT(module != (CUmodule)0);
 
-    {
-        std::lock_guard lock_guard(this->_mutex_module_management);
-        if(this->_map_cufunction_cumodule[cu_context].count(function) > 0){
-            // shouldn't happend
-            GW_WARN_C(
-                "CUfunction-CUmodule mapping has already been recorded: "
-                "CUcontext(%p), CUfunction(%p), CUmodule(%p)",
-                cu_context, function, module
-            );
-            goto exit; 
-        }
-        this->_map_cufunction_cumodule[cu_context].insert({ function, module });
+    if(this->_map_cufunction_cumodule.insert({ cu_context, function }, module) == GW_FAILED_ALREADY_EXIST){
+        // shouldn't happend
+        GW_WARN_C(
+            "CUfunction-CUmodule mapping has already been recorded: "
+            "CUcontext(%p), CUfunction(%p), CUmodule(%p)",
+            cu_context, function, module
+        );
+        goto exit; 
     }
 
     GW_DEBUG_C(
@@ -249,8 +276,127 @@ exit:
 }
 
 
+gw_retval_t GWCapsule::CUDA_unload_cumodule(CUmodule module){
+    gw_retval_t retval = GW_SUCCESS;
+    CUcontext cu_context = (CUcontext)0;
+    std::lock_guard lock_guard(this->_mutex_module_management);
+
+    GW_IF_FAILED(
+        GWUtilCUDA::get_current_cucontext(cu_context),
+        retval,
+        goto exit;
+    );
+    GW_ASSERT(cu_context != (CUcontext)0);
+    GW_ASSERT(module != (CUmodule)0);
+
+    this->__CUDA_forget_cumodules(cu_context, { module });
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWCapsule::CUDA_unload_culibrary(CUlibrary library){
+    gw_retval_t retval = GW_SUCCESS;
+    std::set<CUmodule> set_modules;
+    std::lock_guard lock_guard(this->_mutex_module_management);
+
+    GW_ASSERT(library != (CUlibrary)0);
+
+    // libraries are context-independent, so their modules within all contexts are unloaded
+    for(auto& [cu_context, map_module_library] : this->_map_cumodule_culibrary){
+        set_modules.clear();
+        for(auto& [module, parent_library] : map_module_library){
+            if(parent_library == library)
+                set_modules.insert(module);
+        }
+        if(!set_modules.empty())
+            this->__CUDA_forget_cumodules(cu_context, set_modules);
+    }
+    this->_map_culibrary_data.erase(library);
+
+    return retval;
+}
+
+
+void GWCapsule::__CUDA_forget_cumodules(CUcontext cu_context, const std::set<CUmodule>& set_modules){
+    std::set<std::pair<CUcontext, CUfunction>> set_functions;
+    std::set<GWKernelDef*> set_kerneldefs;
+    std::vector<gw_capsule_parse_job_t*> list_jobs;
+    uint64_t nb_functions = 0;
+
+    for(CUmodule module : set_modules){
+        this->_map_cumodule_data[cu_context].erase(module);
+        this->_map_cumodule_culibrary[cu_context].erase(module);
+        this->_map_cumodule_fatbin[cu_context].erase(module);
+        this->_map_cumodule_cubin[cu_context].erase(module);
+        this->_map_cumodule_ptx[cu_context].erase(module);
+    }
+
+    nb_functions = this->_map_cufunction_cumodule.erase_if(
+        [&](const std::pair<CUcontext, CUfunction>& key, CUmodule module){
+            if(key.first != cu_context or set_modules.count(module) == 0)
+                return false;
+            set_functions.insert(key);
+            return true;
+        }
+    );
+
+    // NOTE(zhuobin): kernel definitions are kept alive, as they could still be referred by
+    //                launch records and the dedup registry, only their registries are cleaned
+    this->_map_cufunction_kerneldef.erase_if(
+        [&](const std::pair<CUcontext, CUfunction>& key, GWKernelDef* kerneldef){
+            if(set_functions.count(key) == 0)
+                return false;
+            set_kerneldefs.insert(kerneldef);
+            return true;
+        }
+    );
+    this->_map_name_kerneldef.erase_if(
+        [&](const std::pair<CUcontext, std::string>& key, GWKernelDef* kerneldef){
+            return key.first == cu_context and set_kerneldefs.count(kerneldef) > 0;
+        }
+    );
+
+    // jobs are cancelled and retired instead of freed, as they could still be running or
+    // waited for, running jobs find themselves cancelled once they reacquire the lock
+    {
+        std::lock_guard lock_guard(this->_mutex_parse_pool);
+        this->_map_cufunction_parse_job.for_each(
+            [&](const std::pair<CUcontext, CUfunction>& key, gw_capsule_parse_job_t* job){
+                if(set_functions.count(key) > 0)
+                    list_jobs.push_back(job);
+            }
+        );
+        this->_map_cufunction_parse_job.erase_if(
+            [&](const std::pair<CUcontext, CUfunction>& key, gw_capsule_parse_job_t* job){
+                return set_functions.count(key) > 0;
+            }
+        );
+        for(gw_capsule_parse_job_t* job : list_jobs)
+            job->is_cancelled = true;
+        this->_list_retired_parse_job.insert(this->_list_retired_parse_job.end(), list_jobs.begin(), list_jobs.end());
+    }
+
+    // cached launch descriptors are refreshed on their next launch
+    this->_cumodule_generation.fetch_add(1, std::memory_order_acq_rel);
+
+    GW_DEBUG_C(
+        "forgot unloaded CUmodules: CUcontext(%p), nb_modules(%lu), nb_functions(%lu)",
+        cu_context, set_modules.size(), nb_functions
+    );
+}
+
+
 gw_retval_t GWCapsule::CUDA_parse_cufunction(
     CUfunction function, CUmodule module, bool do_parse_entire_binary
+){
+    return this->__CUDA_parse_cufunction(function, module, do_parse_entire_binary, nullptr);
+}
+
+
+gw_retval_t GWCapsule::__CUDA_parse_cufunction(
+    CUfunction function, CUmodule module, bool do_parse_entire_binary, gw_capsule_parse_job_t *job
 ){
     gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
     uint64_t i = 0, nb_ptx = 0, nb_cubin = 0;
@@ -270,12 +416,21 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
     GWBinaryImage *binary_fatbin = nullptr;
     GWBinaryImage *binary_cubin = nullptr;
     GWBinaryImage *binary_ptx = nullptr;
+    std::vector<GWBinaryImage*> list_new_ptx, list_new_cubin;
     GWBinaryImageExt_CUDAFatbin *binary_ext_fatbin = nullptr;
     GWBinaryImageExt_CUDACubin *binary_ext_cubin = nullptr;
     GWBinaryImageExt_CUDAPTX *binary_ext_ptx = nullptr;
     typename std::multimap<CUmodule, GWBinaryImage*>::iterator map_iter;
-    bool found_kerneldef = false, is_fatbin_first_seen = false;
-    std::lock_guard lock_guard(this->_mutex_module_management);
+    bool found_kerneldef = false, is_fatbin_first_seen = false, is_kerneldef_extracted = false, is_kerneldef_published = false;
+    std::mutex *mutex_binary = nullptr;
+    std::unique_lock<std::mutex> lock_module(this->_mutex_module_management);
+    std::unique_lock<std::mutex> lock_binary;
+
+    // the module of the job could have been unloaded before the job starts
+    if(unlikely(job != nullptr and job->is_cancelled)){
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
 
     // obtain current context
     GW_IF_FAILED(
@@ -317,7 +472,7 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
 
     // check whether the function has already been parsed
     // i.e. call cuModuleGetFunction on the same function before
-    if(this->_map_cufunction_kerneldef[cu_context].count(function) > 0){
+    if(this->_map_cufunction_kerneldef.find({ cu_context, function }, kerneldef)){
         goto exit;
     }
 
@@ -411,7 +566,72 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
 
             is_fatbin_first_seen = true;
         }
+    } else if (binary_type == GWBinaryUtility_CUDA::GW_CUDA_BINARY_CUBIN){
+        if(this->_map_cumodule_cubin[cu_context].count(module) > 0){
+            GW_ASSERT(this->_map_cumodule_cubin[cu_context].count(module) == 1);
+            map_iter = this->_map_cumodule_cubin[cu_context].find(module);
+            GW_CHECK_POINTER(binary_cubin = map_iter->second);
+            GW_CHECK_POINTER(binary_ext_cubin = GWBinaryImageExt_CUDACubin::get_ext_ptr(binary_cubin))
+            GW_IF_FAILED(
+                binary_ext_cubin->get_arch_version_from_byte_sequence(cubin_arch_version),
+                retval,
+                {
+                    GW_WARN("failed to extract cubin arch version: error(%s)", gw_retval_str(tmp_retval));
+                    goto exit;
+                }
+            );
+        } else {
+            GW_CHECK_POINTER(binary_ext_cubin = GWBinaryImageExt_CUDACubin::create());
+            GW_CHECK_POINTER(binary_cubin = binary_ext_cubin->get_base_ptr());
+
+            GW_IF_FAILED(
+                binary_cubin->fill(
+                    /* bytes */ binary_data->data(),
+                    /* byte_size */ binary_data->size()
+                ),
+                retval,
+                {
+                    GW_WARN_C(
+                        "failed to fill cubin: "
+                        "error(%s), "
+                        "CUcontext(%p), CUmodule(%p)",
+                        gw_retval_str(retval), cu_context, module
+                    );
+                    goto exit;
+                }
+            );
+            this->_map_cumodule_cubin[cu_context].insert({ module, binary_cubin });
+
+            // obtain cubin version
+            GW_IF_FAILED(
+                binary_ext_cubin->get_arch_version_from_byte_sequence(cubin_arch_version),
+                retval,
+                {
+                    GW_WARN("failed to extract cubin arch version: error(%s)", gw_retval_str(tmp_retval));
+                    goto exit;
+                }
+            );
+            GW_DEBUG_C(
+                "recorded CUBIN from CUmodule: CUcontext(%p), CUmodule(%p), CUBIN(%p), arch_version(%s)",
+                cu_context, module, binary_cubin, cubin_arch_version.c_str()
+            );
+        }
+    } else {
+        GW_ERROR_C_DETAIL("unknown binary type, this is a bug: binary type(%u)", binary_type);
+    }
+
+    // NOTE(zhuobin): parsing (and JIT compiling) the binary could take seconds, so it's done
+    //                without _mutex_module_management to not block loading modules and
+    //                launches on other threads, while parsing of the same binary image is
+    //                serialized by its own mutex; binary images are never freed, so they stay
+    //                valid even if the module is unloaded meanwhile
+    mutex_binary = &this->_map_binary_parse_mutex[
+        binary_type == GWBinaryUtility_CUDA::GW_CUDA_BINARY_FATBIN ? binary_fatbin : binary_cubin
+    ];
+    lock_module.unlock();
+    lock_binary = std::unique_lock<std::mutex>(*mutex_binary);
 
+    if(binary_type == GWBinaryUtility_CUDA::GW_CUDA_BINARY_FATBIN){
         // parse the fatbin (this would trigger JIT compile all PTXs)
         GW_IF_FAILED(
             binary_fatbin->parse(),
@@ -432,14 +652,9 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
         for(i=0; i<binary_ext_fatbin->params().list_ptx.size(); i++){
             GW_CHECK_POINTER(binary_ptx = binary_ext_fatbin->params().list_ptx[i]);
 
-            if(is_fatbin_first_seen == true){
-                // build the map: <module, ptx>
-                this->_map_cumodule_ptx[cu_context].insert({ module, binary_ptx });
-                GW_DEBUG_C(
-                    "recorded PTX from CUmodule: CUcontext(%p), CUmodule(%p), PTX(%p)",
-                    cu_context, module, binary_ptx
-                );
-            }
+            // the map <module, ptx> is built once the lock of registries is reacquired
+            if(is_fatbin_first_seen == true)
+                list_new_ptx.push_back(binary_ptx);
 
             // parse the ptx
             if(do_parse_entire_binary == true){
@@ -474,14 +689,9 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
                 }
             );
 
-            // build the map: <module, cubin>
-            if(is_fatbin_first_seen == true){
-                this->_map_cumodule_cubin[cu_context].insert({ module, binary_cubin });
-                GW_DEBUG_C(
-                    "recorded CUBIN from CUmodule: CUcontext(%p), CUmodule(%p), CUBIN(%p), arch_version(%s)",
-                    cu_context, module, binary_cubin, cubin_arch_version.c_str()
-                );
-            }
+            // the map <module, cubin> is built once the lock of registries is reacquired
+            if(is_fatbin_first_seen == true)
+                list_new_cubin.push_back(binary_cubin);
 
             if(do_parse_entire_binary == true){
                 // parse the cubin
@@ -517,9 +727,6 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
 
                         GW_CHECK_POINTER(kerneldef);
 
-                        // record to map
-                        this->_map_cufunction_kerneldef[cu_context].insert({ function, kerneldef });
-                        this->_map_name_kerneldef[cu_context].insert({ mangled_name, kerneldef });
                         found_kerneldef = true;
                         GW_DEBUG_C(
                             "recorded CUfunction from CUmodule: CUcontext(%p), CUmodule(%p), CUfunction(%p), arch_version(%s)",
@@ -553,10 +760,8 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
                         if(tmp_retval == GW_SUCCESS){
                             GW_CHECK_POINTER(kerneldef);
 
-                            // record to map
-                            this->_map_cufunction_kerneldef[cu_context].insert({ function, kerneldef });
-                            this->_map_name_kerneldef[cu_context].insert({ mangled_name, kerneldef });
                             found_kerneldef = true;
+                            is_kerneldef_extracted = true;
                             GW_DEBUG_C(
                                 "recorded CUfunction from CUmodule: CUcontext(%p), CUmodule(%p), CUfunction(%p), arch_version(%s)",
                                 cu_context, module, function, cubin_arch_version.c_str()
@@ -581,56 +786,6 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
             } // if do_parse_entire_binary == false
         } // forall CUBINs
     } else if (binary_type == GWBinaryUtility_CUDA::GW_CUDA_BINARY_CUBIN){
-        if(this->_map_cumodule_cubin[cu_context].count(module) > 0){
-            GW_ASSERT(this->_map_cumodule_cubin[cu_context].count(module) == 1);
-            map_iter = this->_map_cumodule_cubin[cu_context].find(module);
-            GW_CHECK_POINTER(binary_cubin = map_iter->second);
-            GW_CHECK_POINTER(binary_ext_cubin = GWBinaryImageExt_CUDACubin::get_ext_ptr(binary_cubin))
-            GW_IF_FAILED(
-                binary_ext_cubin->get_arch_version_from_byte_sequence(cubin_arch_version),
-                retval,
-                {
-                    GW_WARN("failed to extract cubin arch version: error(%s)", gw_retval_str(tmp_retval));
-                    goto exit;
-                }
-            );
-        } else {
-            GW_CHECK_POINTER(binary_ext_cubin = GWBinaryImageExt_CUDACubin::create());
-            GW_CHECK_POINTER(binary_cubin = binary_ext_cubin->get_base_ptr());
-
-            GW_IF_FAILED(
-                binary_cubin->fill(
-                    /* bytes */ binary_data->data(),
-                    /* byte_size */ binary_data->size()
-                ),
-                retval,
-                {
-                    GW_WARN_C(
-                        "failed to fill cubin: "
-                        "error(%s), "
-                        "CUcontext(%p), CUmodule(%p)",
-                        gw_retval_str(retval), cu_context, module
-                    );
-                    goto exit;
-                }
-            );
-            this->_map_cumodule_cubin[cu_context].insert({ module, binary_cubin });
-
-            // obtain cubin version
-            GW_IF_FAILED(
-                binary_ext_cubin->get_arch_version_from_byte_sequence(cubin_arch_version),
-                retval,
-                {
-                    GW_WARN("failed to extract cubin arch version: error(%s)", gw_retval_str(tmp_retval));
-                    goto exit;
-                }
-            );
-            GW_DEBUG_C(
-                "recorded CUBIN from CUmodule: CUcontext(%p), CUmodule(%p), CUBIN(%p), arch_version(%s)",
-                cu_context, module, binary_cubin, cubin_arch_version.c_str()
-            );
-        }
-
         if(do_parse_entire_binary == true){
             GW_IF_FAILED(
                 binary_cubin->parse(),
@@ -652,9 +807,6 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
             )){
                 tmp_retval = binary_ext_cubin->get_kerneldef_by_name(mangled_name, kerneldef);
                 if(tmp_retval == GW_SUCCESS){
-                    // record to map
-                    this->_map_cufunction_kerneldef[cu_context].insert({ function, kerneldef });
-                    this->_map_name_kerneldef[cu_context].insert({ mangled_name, kerneldef });
                     found_kerneldef = true;
                     GW_DEBUG_C(
                         "recorded CUfunction from CUmodule: CUcontext(%p), CUmodule(%p), CUfunction(%p), arch_version(%s)",
@@ -685,9 +837,6 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
             )){
                 tmp_retval = binary_ext_cubin->get_kerneldef_by_name(mangled_name, kerneldef);
                 if(tmp_retval == GW_SUCCESS){
-                    // record to map
-                    this->_map_cufunction_kerneldef[cu_context].insert({ function, kerneldef });
-                    this->_map_name_kerneldef[cu_context].insert({ mangled_name, kerneldef });
                     found_kerneldef = true;
                     GW_DEBUG_C(
                         "recorded CUfunction from CUmodule: CUcontext(%p), CUmodule(%p), CUfunction(%p), arch_version(%s)",
@@ -711,8 +860,6 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
                 } // gw_cubin_get_kerneldef_by_name
             } // is_arch_equal
         } // do_parse_entire_binary
-    } else {
-        GW_ERROR_C_DETAIL("unknown binary type, this is a bug: binary type(%u)", binary_type);
     }
 
     // return error if kerneldef isn't found
@@ -746,6 +893,52 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
         GW_ASSERT(kerneldef->is_cfg_parsed());
     }
 
+    // calculate the fingerprint before publishing, with relocated instructions normalized,
+    // so that kernels identical apart from relocations could share their analysis results
+    if(!kerneldef->has_fingerprint()){
+        GW_IF_FAILED(
+            this->CUDA_calculate_kerneldef_fingerprint(kerneldef),
+            tmp_retval,
+            GW_WARN_C("failed to calculate kernel fingerprint, skip dedup: function(%s)", mangled_name.c_str());
+        );
+    }
+
+    // reacquire the lock of registries to publish, the two locks are never held together, so
+    // that waiting for a long parsing never blocks the registries
+    lock_binary.unlock();
+    lock_module.lock();
+
+    // NOTE(zhuobin): the module could be unloaded while it's parsed, in which case nothing is
+    //                published, as the CUfunction could be reused by modules loaded afterwards
+    if(unlikely(job != nullptr and job->is_cancelled)){
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    for(GWBinaryImage *new_ptx : list_new_ptx){
+        this->_map_cumodule_ptx[cu_context].insert({ module, new_ptx });
+        GW_DEBUG_C(
+            "recorded PTX from CUmodule: CUcontext(%p), CUmodule(%p), PTX(%p)",
+            cu_context, module, new_ptx
+        );
+    }
+    for(GWBinaryImage *new_cubin : list_new_cubin){
+        this->_map_cumodule_cubin[cu_context].insert({ module, new_cubin });
+        GW_DEBUG_C(
+            "recorded CUBIN from CUmodule: CUcontext(%p), CUmodule(%p), CUBIN(%p)",
+            cu_context, module, new_cubin
+        );
+    }
+
+    // publish the kernel definition once it's set up, as it's looked up without lock on launch;
+    // the function could be parsed concurrently by another caller, whose result is kept
+    if(unlikely(this->_map_cufunction_kerneldef.insert({ cu_context, function }, kerneldef) == GW_FAILED_ALREADY_EXIST))
+        goto exit;
+    is_kerneldef_published = true;
+    this->_map_name_kerneldef.insert({ cu_context, mangled_name }, kerneldef);
+    this->__CUDA_publish_kerneldef_to_launch_desc(cu_context, function, kerneldef);
+    lock_module.unlock();
+
     // get arch_version and mangled_name of kerneldef_sass
     kerneldef_ext_sass = GWKernelDefExt_CUDA_SASS::get_ext_ptr(kerneldef);
     GW_CHECK_POINTER(kerneldef_ext_sass);
@@ -771,6 +964,205 @@ gw_retval_t GWCapsule::CUDA_parse_cufunction(
     }
 
  exit:
+    // NOTE(zhuobin): a kerneldef extracted from the byte sequence is owned by us until it's
+    //                published, e.g., it's dropped if another caller has published first or the
+    //                module is unloaded, while the one from get_kerneldef_by_name is owned by the image
+    if(unlikely(is_kerneldef_extracted and !is_kerneldef_published and kerneldef != nullptr))
+        delete kerneldef;
+    return retval;
+}
+
+
+gw_retval_t GWCapsule::CUDA_parse_cufunction_async(
+    CUfunction function, CUmodule module, bool do_parse_entire_binary
+){
+    gw_retval_t retval = GW_SUCCESS;
+    CUcontext cu_context = (CUcontext)0;
+    GWKernelDef *kerneldef = nullptr;
+    gw_capsule_parse_job_t *job = nullptr;
+    std::string env_value = "";
+    uint64_t nb_workers = GW_CAPSULE_PARSE_DEFAULT_NB_WORKERS;
+    bool do_parse_sync = false;
+
+    GW_IF_FAILED(
+        GWUtilCUDA::get_current_cucontext(cu_context),
+        retval,
+        goto exit;
+    );
+    GW_ASSERT(cu_context != (CUcontext)0);
+
+    // the function has already been parsed
+    if(this->_map_cufunction_kerneldef.find({ cu_context, function }, kerneldef))
+        goto exit;
+
+    {
+        std::lock_guard lock_guard(this->_mutex_parse_pool);
+
+        if(unlikely(this->_parse_pool == nullptr and !this->_is_async_parse_disabled)){
+            if(GWUtilSystem::get_env_variable("GW_PARSE_NB_WORKERS", env_value) == GW_SUCCESS){
+                try {
+                    nb_workers = std::stoul(env_value);
+                } catch (...) {
+                    GW_WARN_C("invalid GW_PARSE_NB_WORKERS, use default: value(%s)", env_value.c_str());
+                }
+            }
+            if(nb_workers == 0){
+                GW_DEBUG_C("background parsing is disabled");
+                this->_is_async_parse_disabled = true;
+            } else {
+                GW_CHECK_POINTER(this->_parse_pool = new GWUtilThreadPool(nb_workers));
+                GW_DEBUG_C("created worker pool for background parsing: nb_workers(%lu)", nb_workers);
+            }
+        }
+
+        if(this->_is_async_parse_disabled){
+            do_parse_sync = true;
+        } else if(!this->_map_cufunction_parse_job.find({ cu_context, function }, job)){
+            // NOTE(zhuobin): jobs are published under the lock before being submitted, so
+            //                that a function is submitted at most once, and waiters always
+            //                find the job of a submitted function
+            GW_CHECK_POINTER(job = new gw_capsule_parse_job_t());
+            job->future = job->promise.get_future().share();
+            this->_map_cufunction_parse_job.insert({ cu_context, function }, job);
+            if(unlikely(this->_parse_pool->submit(
+                [this, cu_context, function, module, do_parse_entire_binary, job](){
+                    this->__CUDA_parse_cufunction_job(cu_context, function, module, do_parse_entire_binary, job);
+                }
+            ) != GW_SUCCESS)){
+                do_parse_sync = true;
+            } else {
+                job = nullptr;
+            }
+        } else {
+            job = nullptr;
+        }
+    }
+
+    // the job (if any) couldn't be submitted, which is fulfilled here
+    if(do_parse_sync){
+        retval = this->__CUDA_parse_cufunction(function, module, do_parse_entire_binary, job);
+        if(job != nullptr)
+            job->promise.set_value(retval);
+    }
+
+exit:
+    return retval;
+}
+
+
+void GWCapsule::__CUDA_parse_cufunction_job(
+    CUcontext cu_context,
+    CUfunction function,
+    CUmodule module,
+    bool do_parse_entire_binary,
+    gw_capsule_parse_job_t *job
+){
+    gw_retval_t retval = GW_SUCCESS;
+    CUresult cudv_retval = CUDA_SUCCESS;
+
+    GW_CHECK_POINTER(job);
+
+    // the worker thread should bind to the context which loads the module, as parsing
+    // fatbin could trigger JIT compilation of PTX
+    // NOTE(zhuobin): only primary contexts could be retained, so the job doesn't hold the
+    //                context, instead it's cancelled once its module is unloaded, and the
+    //                worker is unbound from the context once the job finishes
+    GW_IF_CUDA_DRIVER_FAILED(
+        cuCtxSetCurrent(cu_context),
+        cudv_retval,
+        {
+            GW_WARN_C("failed to parse CUfunction in background, failed to set context: CUcontext(%p)", cu_context);
+            retval = GW_FAILED_SDK;
+            goto exit;
+        }
+    );
+
+    retval = this->__CUDA_parse_cufunction(function, module, do_parse_entire_binary, job);
+    cuCtxSetCurrent((CUcontext)0);
+
+exit:
+    job->promise.set_value(retval);
+}
+
+
+gw_retval_t GWCapsule::CUDA_calculate_kerneldef_fingerprint(GWKernelDef *kerneldef){
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    GWKernelDefExt_CUDA_SASS *kerneldef_ext_sass = nullptr;
+    std::set<uint64_t> set_relocated_offset;
+
+    GW_CHECK_POINTER(kerneldef);
+    GW_CHECK_POINTER(kerneldef_ext_sass = GWKernelDefExt_CUDA_SASS::get_ext_ptr(kerneldef));
+
+    if(kerneldef_ext_sass->params().binary_cuda_cubin != nullptr){
+        tmp_retval = kerneldef_ext_sass->params().binary_cuda_cubin->get_elf_relocated_offsets(
+            std::string(".text.") + kerneldef->mangled_prototype, set_relocated_offset
+        );
+        if(unlikely(tmp_retval != GW_SUCCESS and tmp_retval != GW_FAILED_NOT_EXIST)){
+            GW_DEBUG_C(
+                "failed to obtain relocations, fingerprint without them: function(%s), error(%s)",
+                kerneldef->mangled_prototype.c_str(), gw_retval_str(tmp_retval)
+            );
+            set_relocated_offset.clear();
+        }
+    }
+
+    retval = kerneldef->calculate_fingerprint(set_relocated_offset);
+
+    return retval;
+}
+
+
+gw_retval_t GWCapsule::CUDA_wait_kerneldef_by_cufunction(CUfunction function, GWKernelDef*& kernel_def){
+    gw_retval_t retval = GW_SUCCESS;
+    CUcontext cu_context = (CUcontext)0;
+
+    kernel_def = nullptr;
+
+    // obtain current context
+    GW_IF_FAILED(
+        GWUtilCUDA::get_current_cucontext(cu_context),
+        retval,
+        goto exit;
+    );
+    GW_ASSERT(cu_context != (CUcontext)0);
+
+    retval = this->CUDA_wait_kerneldef_by_cufunction(cu_context, function, kernel_def);
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWCapsule::CUDA_wait_kerneldef_by_cufunction(CUcontext cu_context, CUfunction function, GWKernelDef*& kernel_def){
+    gw_retval_t retval = GW_SUCCESS;
+    gw_capsule_parse_job_t *job = nullptr;
+
+    kernel_def = nullptr;
+
+    if(unlikely(cu_context == (CUcontext)0)){
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    if(likely(this->_map_cufunction_kerneldef.find({ cu_context, function }, kernel_def)))
+        goto exit;
+
+    if(!this->_map_cufunction_parse_job.find({ cu_context, function }, job)){
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+    GW_CHECK_POINTER(job);
+
+    // block until the background parsing finishes
+    if(unlikely((retval = job->future.get()) != GW_SUCCESS))
+        goto exit;
+
+    if(unlikely(!this->_map_cufunction_kerneldef.find({ cu_context, function }, kernel_def))){
+        kernel_def = nullptr;
+        retval = GW_FAILED_NOT_EXIST;
+    }
+
+exit:
     return retval;
 }
 
@@ -795,7 +1187,7 @@ gw_retval_t GWCapsule::CUDA_report_function(CUfunction function){
     int local_mem_size = 0;
     int num_reg = 0;
 
-    std::lock_guard<std::mutex>(this->_mutex_module_management);
+    std::lock_guard lock_guard(this->_mutex_module_management);
 
     if(unlikely(this->_map_trace_function.count(function) > 0)){
         GW_CHECK_POINTER(trace_function = this->_map_trace_function[function]);
@@ -911,13 +1303,118 @@ gw_retval_t GWCapsule::CUDA_get_kerneldef_by_cufunction(CUfunction function, GWK
     );
     GW_ASSERT(cu_context != (CUcontext)0);
 
+    if(!this->_map_cufunction_kerneldef.find({ cu_context, function }, kernel_def)){
+        kernel_def = nullptr;
+        retval = GW_FAILED_NOT_EXIST;
+    }
+
+ exit:
+    return retval;
+}
+
+
+gw_retval_t GWCapsule::__CUDA_create_launch_desc(CUfunction function, gw_capsule_launch_desc_t*& launch_desc){
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    CUresult cudv_retval = CUDA_SUCCESS;
+    const char *function_name = nullptr;
+    CUcontext cu_context = (CUcontext)0;
+    GWKernelDef *kernel_def = nullptr, *expected_kernel_def = nullptr;
+    gw_capsule_launch_desc_t *new_launch_desc = nullptr, *stale_launch_desc = nullptr;
+    typename std::map<CUfunction, gw_capsule_launch_desc_t*>::iterator overflow_it;
+    uint64_t module_generation = 0;
+
+    launch_desc = nullptr;
+
+    // NOTE(zhuobin): the generation is sampled before the descriptor is built, so that a
+    //                descriptor built while a module is being unloaded is never taken as fresh
+    module_generation = this->_cumodule_generation.load(std::memory_order_acquire);
+
+    // the descriptor could have been refreshed by other threads
+    stale_launch_desc = this->_table_launch_desc.find(reinterpret_cast<uint64_t>(function));
+    if(stale_launch_desc != nullptr and stale_launch_desc->module_generation == module_generation){
+        launch_desc = stale_launch_desc;
+        goto exit;
+    }
+
+    // the descriptor could be cached in the overflow map once the table is full
     {
-        std::lock_guard<std::mutex>(this->_mutex_module_management);
-        if(this->_map_cufunction_kerneldef[cu_context].count(function) > 0){
-            kernel_def = this->_map_cufunction_kerneldef[cu_context][function];
-        } else {
-            kernel_def = nullptr;
-            retval = GW_FAILED_NOT_EXIST;
+        std::lock_guard<std::mutex> lock(this->_mutex_overflow_launch_desc);
+        overflow_it = this->_map_overflow_launch_desc.find(function);
+        if(overflow_it != this->_map_overflow_launch_desc.end() and overflow_it->second->module_generation == module_generation){
+            launch_desc = overflow_it->second;
+            goto exit;
+        }
+    }
+
+    GW_CHECK_POINTER(new_launch_desc = new gw_capsule_launch_desc_t());
+    new_launch_desc->function = function;
+    new_launch_desc->module_generation = module_generation;
+
+    // the context is recorded, as launch records are materialized on other threads
+    if(unlikely(GWUtilCUDA::get_current_cucontext(cu_context) != GW_SUCCESS)){
+        cu_context = (CUcontext)0;
+        GW_WARN_C("failed to obtain context of launched function: func(%p)", function);
+    }
+    new_launch_desc->context = cu_context;
+
+    // the function could still be parsed in background, in which case the launch goes on
+    // without the kernel definition, which is filled once the parsing finishes
+    if(cu_context != (CUcontext)0 and this->_map_cufunction_kerneldef.find({ cu_context, function }, kernel_def))
+        new_launch_desc->kernel_def.store(kernel_def, std::memory_order_release);
+
+    GW_IF_CUDA_DRIVER_FAILED(
+        cuFuncGetName(&function_name, function),
+        cudv_retval,
+        {
+            function_name = nullptr;
+            GW_WARN_C("failed to obtain function name: func(%p)", function);
+        }
+    );
+    if(likely(function_name != nullptr))
+        new_launch_desc->name = function_name;
+
+    // the descriptor could be created by other threads concurrently, in which case the one
+    // published first is kept; stale descriptors are replaced but kept alive, as launch
+    // records could still refer to them
+    if(stale_launch_desc == nullptr){
+        tmp_retval = this->_table_launch_desc.insert(reinterpret_cast<uint64_t>(function), new_launch_desc, launch_desc);
+    } else {
+        tmp_retval = this->_table_launch_desc.replace(
+            reinterpret_cast<uint64_t>(function), stale_launch_desc, new_launch_desc, launch_desc
+        );
+    }
+    if(likely(tmp_retval == GW_SUCCESS)){
+        launch_desc = new_launch_desc;
+    } else if(tmp_retval == GW_FAILED_ALREADY_EXIST){
+        delete new_launch_desc;
+    } else {
+        std::lock_guard<std::mutex> lock(this->_mutex_overflow_launch_desc);
+        if(unlikely(this->_map_overflow_launch_desc.empty())){
+            GW_WARN_C(
+                "launch descriptor table is full, fall back to the locked map: capacity(%lu)",
+                this->_table_launch_desc.capacity()
+            );
+        }
+        auto [it, is_inserted] = this->_map_overflow_launch_desc.emplace(function, new_launch_desc);
+        if(!is_inserted){
+            if(it->second->module_generation == module_generation){
+                delete new_launch_desc;
+            } else {
+                this->_list_retired_launch_desc.push_back(it->second);
+                it->second = new_launch_desc;
+            }
+        }
+        launch_desc = it->second;
+    }
+
+    // NOTE(zhuobin): the parsing could finish after the lookup above but before the descriptor
+    //                is published, in which case the parser misses the descriptor, so it's
+    //                looked up again after publishing (see __CUDA_publish_kerneldef_to_launch_desc)
+    if(launch_desc->context == cu_context and launch_desc->kernel_def.load(std::memory_order_acquire) == nullptr){
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(cu_context != (CUcontext)0 and this->_map_cufunction_kerneldef.find({ cu_context, function }, kernel_def)){
+            expected_kernel_def = nullptr;
+            launch_desc->kernel_def.compare_exchange_strong(expected_kernel_def, kernel_def, std::memory_order_acq_rel);
         }
     }
 
@@ -926,6 +1423,37 @@ gw_retval_t GWCapsule::CUDA_get_kerneldef_by_cufunction(CUfunction function, GWK
 }
 
 
+void GWCapsule::__CUDA_publish_kerneldef_to_launch_desc(CUcontext cu_context, CUfunction function, GWKernelDef *kernel_def){
+    gw_capsule_launch_desc_t *launch_desc = nullptr;
+    GWKernelDef *expected_kernel_def = nullptr;
+    typename std::map<CUfunction, gw_capsule_launch_desc_t*>::iterator overflow_it;
+
+    GW_CHECK_POINTER(kernel_def);
+
+    // pairs with the fence in __CUDA_create_launch_desc, so that either the parser finds the
+    // descriptor here, or the creator finds the published kernel definition
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    launch_desc = this->_table_launch_desc.find(reinterpret_cast<uint64_t>(function));
+    if(launch_desc == nullptr){
+        std::lock_guard<std::mutex> lock(this->_mutex_overflow_launch_desc);
+        overflow_it = this->_map_overflow_launch_desc.find(function);
+        if(overflow_it != this->_map_overflow_launch_desc.end())
+            launch_desc = overflow_it->second;
+    }
+
+    // descriptors of the function launched within other contexts, or of unloaded modules
+    // (whose launch records refer to the old kernel) are left untouched
+    if(
+        launch_desc != nullptr
+        and launch_desc->context == cu_context
+        and launch_desc->module_generation == this->_cumodule_generation.load(std::memory_order_acquire)
+    ){
+        launch_desc->kernel_def.compare_exchange_strong(expected_kernel_def, kernel_def, std::memory_order_acq_rel);
+    }
+}
+
+
 gw_retval_t GWCapsule::CUDA_get_kerneldef_by_name(std::string name, GWKernelDef*& kernel_def){
     gw_retval_t retval = GW_SUCCESS;
     CUcontext cu_context = (CUcontext)0;
@@ -937,14 +1465,9 @@ gw_retval_t GWCapsule::CUDA_get_kerneldef_by_name(std::string name, GWKernelDef*
         goto exit;
     );
 
-    {
-        std::lock_guard<std::mutex>(this->_mutex_module_management);
-        if(this->_map_name_kerneldef[cu_context].count(name) > 0){
-            kernel_def = this->_map_name_kerneldef[cu_context][name];
-        } else {
-            kernel_def = nullptr;
-            retval = GW_FAILED_NOT_EXIST;
-        }
+    if(!this->_map_name_kerneldef.find({ cu_context, name }, kernel_def)){
+        kernel_def = nullptr;
+        retval = GW_FAILED_NOT_EXIST;
     }
 
  exit:
@@ -963,13 +1486,13 @@ gw_retval_t GWCapsule::CUDA_get_map_kerneldef(std::map<std::string, GWKernelDef*
         goto exit;
     );
     
-    {
-        std::lock_guard lock_guard(this->_mutex_module_management);
-        map_name_kerneldef.clear();
-        for(auto& [name, kernel_def] : this->_map_name_kerneldef[cu_context]){
-            map_name_kerneldef.insert({ name, kernel_def });
+    map_name_kerneldef.clear();
+    this->_map_name_kerneldef.for_each(
+        [&](const std::pair<CUcontext, std::string>& key, GWKernelDef* kernel_def){
+            if(key.first == cu_context)
+                map_name_kerneldef.insert({ key.second, kernel_def });
         }
-    }
+    );
 
  exit:
     return retval;
@@ -0,0 +1,283 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <memory>
+
+#include <cuda.h>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/binary.hpp"
+#include "common/assemble/kernel.hpp"
+#include "common/assemble/kernel_def.hpp"
+#include "common/utils/cuda.hpp"
+#include "common/utils/system.hpp"
+#include "common/utils/thread_pool.hpp"
+#include "common/cuda_impl/binary/cubin.hpp"
+#include "common/cuda_impl/binary/fatbin.hpp"
+#include "common/cuda_impl/binary/utils.hpp"
+#include "common/cuda_impl/assemble/kernel_cuda.hpp"
+#include "common/cuda_impl/assemble/kernel_def_sass.hpp"
+#include "capsule/capsule.hpp"
+#include "capsule/trace.hpp"
+#include "capsule/trace_matcher.hpp"
+#include "capsule/cuda_impl/trace.hpp"
+
+
+// default number of worker threads for ahead-of-time instrumentation
+#define GW_CAPSULE_PRE_INSTRUMENT_DEFAULT_NB_WORKERS   2
+
+
+gw_retval_t GWCapsule::CUDA_pre_instrument_binary(const std::vector<uint8_t>& binary_data){
+    gw_retval_t retval = GW_SUCCESS;
+    CUresult cudv_retval = CUDA_SUCCESS;
+    CUdevice cu_device = (CUdevice)0;
+    CUcontext cu_primary_context = (CUcontext)0;
+    unsigned int primary_context_flags = 0;
+    int is_primary_context_active = 0;
+    bool is_primary_context_retained = false;
+    std::string arch_version = "", env_value = "";
+    uint64_t nb_workers = GW_CAPSULE_PRE_INSTRUMENT_DEFAULT_NB_WORKERS;
+    GWTraceTask *trace_task_snapshot = nullptr;
+    std::vector<GWTraceTask*> list_trace_task;
+    std::shared_ptr<const std::vector<uint8_t>> shared_binary_data;
+
+    {
+        std::lock_guard lock_guard(this->_mutex_pre_instrument_pool);
+        if(this->_is_pre_instrument_disabled)
+            goto exit;
+    }
+
+    // snapshot trace tasks which support ahead-of-time instrumentation, so that the job
+    // doesn't depend on the lifecycle of trace tasks registered on current thread
+    for(auto& trace_task : this->_list_trace_task_kernel){
+        GW_CHECK_POINTER(trace_task);
+        if(trace_task->get_instrument_cxt_types().size() == 0)
+            continue;
+        GW_CHECK_POINTER(trace_task_snapshot = GWTraceTaskFactory::instance().create(trace_task->get_type()));
+        for(auto& [key, value] : trace_task->get_map_metadata())
+            trace_task_snapshot->set_metadata(key, value);
+        list_trace_task.push_back(trace_task_snapshot);
+    }
+    if(list_trace_task.size() == 0)
+        goto exit;
+
+    GW_IF_FAILED(GWUtilCUDA::get_current_device(cu_device), retval, goto exit;);
+    GW_IF_FAILED(GWUtilCUDA::get_arch_of_current_context(arch_version), retval, goto exit;);
+
+    // NOTE(zhuobin): the loading context could be destroyed before the job runs, and only
+    //                primary context could be retained, so the job runs on the retained
+    //                primary context of the same device, the instrumented binary doesn't
+    //                depend on the context; we don't activate the primary context for
+    //                applications which only use their own contexts
+    GW_IF_CUDA_DRIVER_FAILED(
+        cuDevicePrimaryCtxGetState(cu_device, &primary_context_flags, &is_primary_context_active),
+        cudv_retval,
+        {
+            retval = GW_FAILED_SDK;
+            goto exit;
+        }
+    );
+    if(!is_primary_context_active){
+        GW_DEBUG_C("skip ahead-of-time instrumentation, primary context is inactive: CUdevice(%d)", cu_device);
+        goto exit;
+    }
+    GW_IF_CUDA_DRIVER_FAILED(
+        cuDevicePrimaryCtxRetain(&cu_primary_context, cu_device),
+        cudv_retval,
+        {
+            retval = GW_FAILED_SDK;
+            goto exit;
+        }
+    );
+    is_primary_context_retained = true;
+
+    {
+        std::lock_guard lock_guard(this->_mutex_pre_instrument_pool);
+        if(unlikely(this->_pre_instrument_pool == nullptr)){
+            if(GWUtilSystem::get_env_variable("GW_PRE_INSTRUMENT_NB_WORKERS", env_value) == GW_SUCCESS){
+                try {
+                    nb_workers = std::stoul(env_value);
+                } catch (...) {
+                    GW_WARN_C("invalid GW_PRE_INSTRUMENT_NB_WORKERS, use default: value(%s)", env_value.c_str());
+                }
+            }
+            if(nb_workers == 0){
+                GW_DEBUG_C("ahead-of-time instrumentation is disabled");
+                this->_is_pre_instrument_disabled = true;
+                goto exit;
+            }
+            GW_CHECK_POINTER(this->_pre_instrument_pool = new GWUtilThreadPool(nb_workers));
+            GW_DEBUG_C("created worker pool for ahead-of-time instrumentation: nb_workers(%lu)", nb_workers);
+        }
+
+        // the binary is copied once here, and shared with the job
+        shared_binary_data = std::make_shared<const std::vector<uint8_t>>(binary_data);
+        GW_IF_FAILED(
+            this->_pre_instrument_pool->submit(
+                [this, cu_device, cu_primary_context, arch_version, shared_binary_data, list_trace_task](){
+                    this->__CUDA_pre_instrument_job(
+                        cu_device, cu_primary_context, arch_version, shared_binary_data, list_trace_task
+                    );
+                }
+            ),
+            retval,
+            goto exit;
+        );
+        list_trace_task.clear();
+        is_primary_context_retained = false;
+    }
+
+exit:
+    // trace tasks and the retained primary context are owned by the job once submitted
+    for(auto& trace_task : list_trace_task)
+        delete trace_task;
+    if(is_primary_context_retained)
+        cuDevicePrimaryCtxRelease(cu_device);
+    return retval;
+}
+
+
+void GWCapsule::__CUDA_pre_instrument_job(
+    CUdevice cu_device,
+    CUcontext cu_context,
+    std::string arch_version,
+    std::shared_ptr<const std::vector<uint8_t>> binary_data,
+    std::vector<GWTraceTask*> list_trace_task
+){
+    gw_retval_t retval = GW_SUCCESS;
+    CUresult cudv_retval = CUDA_SUCCESS;
+    GWBinaryUtility_CUDA::gw_cuda_binary_t binary_type = GWBinaryUtility_CUDA::GW_CUDA_BINARY_UNKNOWN;
+    GWBinaryImageExt_CUDAFatbin *binary_ext_fatbin = nullptr;
+    GWBinaryImageExt_CUDACubin *binary_ext_cubin = nullptr;
+    GWKernelExt_CUDA *kernel_ext_cuda = nullptr;
+    GWTraceTask_CUDA *trace_task_cuda = nullptr;
+    GWBinaryImageExt_CUDACubin *cubin_ext = nullptr;
+    std::vector<GWBinaryImage*> list_cubin;
+    std::string cubin_arch_version = "";
+    uint64_t nb_pre_instrumented = 0, nb_committed = 0, trace_task_mask = 0, i = 0;
+    std::vector<GWKernelExt_CUDA*> list_kernel_ext;
+    std::vector<std::vector<GWInstrumentCxt*>> list_task_cxt;
+    std::vector<std::vector<gw_instrument_cache_key_t>> list_task_key;
+    std::vector<GWInstrumentCxt*> list_batch_cxt;
+    GWTraceTaskMatcher trace_task_matcher;
+
+    // the worker thread should bind to a context on the device which loads the binary,
+    // as parsing fatbin could trigger JIT compilation of PTX
+    GW_IF_CUDA_DRIVER_FAILED(
+        cuCtxSetCurrent(cu_context),
+        cudv_retval,
+        {
+            GW_WARN_C("failed to pre-instrument binary, failed to set context: CUcontext(%p)", cu_context);
+            goto exit;
+        }
+    );
+
+    GW_IF_FAILED(
+        GWBinaryUtility_CUDA::get_binary_type(binary_data->data(), binary_data->size(), binary_type),
+        retval,
+        goto exit;
+    );
+
+    if(binary_type == GWBinaryUtility_CUDA::GW_CUDA_BINARY_FATBIN){
+        GW_CHECK_POINTER(binary_ext_fatbin = GWBinaryImageExt_CUDAFatbin::create());
+        GW_IF_FAILED(binary_ext_fatbin->get_base_ptr()->fill(binary_data->data(), binary_data->size()), retval, goto exit;);
+        GW_IF_FAILED(binary_ext_fatbin->get_base_ptr()->parse(), retval, goto exit;);
+        list_cubin = binary_ext_fatbin->params().list_cubin;
+    } else if(binary_type == GWBinaryUtility_CUDA::GW_CUDA_BINARY_CUBIN){
+        GW_CHECK_POINTER(binary_ext_cubin = GWBinaryImageExt_CUDACubin::create());
+        GW_IF_FAILED(binary_ext_cubin->get_base_ptr()->fill(binary_data->data(), binary_data->size()), retval, goto exit;);
+        list_cubin.push_back(binary_ext_cubin->get_base_ptr());
+    } else {
+        // PTX-only binary is JIT compiled by the driver, skip
+        goto exit;
+    }
+
+    GW_IF_FAILED(
+        trace_task_matcher.compile(list_trace_task),
+        retval,
+        {
+            GW_WARN_C("failed to pre-instrument binary, failed to compile filters of trace tasks");
+            goto exit;
+        }
+    );
+
+    for(GWBinaryImage* cubin : list_cubin){
+        GW_CHECK_POINTER(cubin);
+        GW_CHECK_POINTER(cubin_ext = GWBinaryImageExt_CUDACubin::get_ext_ptr(cubin));
+
+        if(cubin_ext->get_arch_version_from_byte_sequence(cubin_arch_version) != GW_SUCCESS)
+            continue;
+        if(!GWBinaryUtility_CUDA::is_arch_equal(cubin_arch_version, arch_version, /* ignore_variant_suffix */ true))
+            continue;
+        if(cubin->parse() != GW_SUCCESS){
+            GW_WARN_C("failed to pre-instrument cubin, failed to parse: arch_version(%s)", cubin_arch_version.c_str());
+            continue;
+        }
+
+        // collect instrument contexts of all matched kernels, so that the cubin is
+        // instrumented in a single batch
+        list_task_cxt.assign(list_trace_task.size(), {});
+        list_task_key.assign(list_trace_task.size(), {});
+        for(auto& [kernel_name, kernel_def] : cubin_ext->get_map_kernel_def()){
+            GW_CHECK_POINTER(kernel_def);
+            trace_task_mask = trace_task_matcher.match(kernel_name);
+            kernel_ext_cuda = nullptr;
+            for(i=0; i<list_trace_task.size(); i++){
+                if(!trace_task_matcher.is_matched(kernel_name, trace_task_mask, i))
+                    continue;
+                trace_task_cuda = dynamic_cast<GWTraceTask_CUDA*>(list_trace_task[i]);
+                if(trace_task_cuda == nullptr)
+                    continue;
+                if(kernel_ext_cuda == nullptr){
+                    GW_CHECK_POINTER(kernel_ext_cuda = GWKernelExt_CUDA::create(kernel_def));
+                    list_kernel_ext.push_back(kernel_ext_cuda);
+                }
+                trace_task_cuda->prepare_pre_instrument(
+                    this, kernel_ext_cuda->get_base_ptr(), list_task_cxt[i], list_task_key[i]
+                );
+            }
+        }
+
+        list_batch_cxt.clear();
+        for(auto& list_cxt : list_task_cxt)
+            list_batch_cxt.insert(list_batch_cxt.end(), list_cxt.begin(), list_cxt.end());
+        if(list_batch_cxt.size() > 0){
+            // NOTE(zhuobin): contexts failed to instrument are skipped by commit
+            if(cubin_ext->dynamic_instrument_batch(list_batch_cxt) != GW_SUCCESS){
+                GW_DEBUG_C(
+                    "failed to pre-instrument some kernels of cubin: arch_version(%s), nb_instrument_cxt(%lu)",
+                    cubin_arch_version.c_str(), list_batch_cxt.size()
+                );
+            }
+        }
+
+        for(i=0; i<list_trace_task.size(); i++){
+            if(list_task_cxt[i].size() == 0)
+                continue;
+            trace_task_cuda = dynamic_cast<GWTraceTask_CUDA*>(list_trace_task[i]);
+            GW_CHECK_POINTER(trace_task_cuda);
+            trace_task_cuda->commit_pre_instrument(this, list_task_cxt[i], list_task_key[i], nb_committed);
+            nb_pre_instrumented += nb_committed;
+        }
+
+        for(auto& kernel_ext : list_kernel_ext)
+            delete kernel_ext;
+        list_kernel_ext.clear();
+    }
+
+    GW_DEBUG_C(
+        "finished ahead-of-time instrumentation: nb_cubin(%lu), nb_pre_instrumented(%lu)",
+        list_cubin.size(), nb_pre_instrumented
+    );
+
+exit:
+    if(binary_ext_fatbin != nullptr)
+        delete binary_ext_fatbin;
+    if(binary_ext_cubin != nullptr)
+        delete binary_ext_cubin;
+    for(auto& trace_task : list_trace_task)
+        delete trace_task;
+    cuDevicePrimaryCtxRelease(cu_device);
+}
@@ -3,6 +3,9 @@
 #include <iostream>
 #include <vector>
 #include <csignal>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 #include <pthread.h>
 
@@ -12,9 +15,11 @@
 #include "common/log.hpp"
 #include "common/utils/cuda.hpp"
 #include "common/utils/string.hpp"
+#include "common/utils/hash.hpp"
 #include "common/cuda_impl/binary/cubin.hpp"
 #include "common/cuda_impl/assemble/kernel_cuda.hpp"
 #include "common/cuda_impl/assemble/kernel_def_sass.hpp"
+#include "common/cuda_impl/occupancy.hpp"
 #include "capsule/capsule.hpp"
 #include "capsule/event.hpp"
 #include "capsule/hijack/cuda_impl/runtime.hpp"
@@ -32,6 +37,299 @@ GWTraceTask_CUDA::~GWTraceTask_CUDA()
 {}
 
 
+gw_retval_t GWTraceTask_CUDA::__get_instrument_cache_key(
+    GWKernelDef* kernel_def, const std::string& cxt_type, gw_instrument_cache_key_t& key
+) const {
+    gw_retval_t retval = GW_SUCCESS;
+    GWKernelDefExt_CUDA_SASS *kernel_def_ext_cuda_sass = nullptr;
+
+    GW_CHECK_POINTER(kernel_def);
+    GW_CHECK_POINTER(kernel_def_ext_cuda_sass = GWKernelDefExt_CUDA_SASS::get_ext_ptr(kernel_def));
+
+    if(unlikely(!kernel_def->has_fingerprint())){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    key.kernel_binary_hash = kernel_def->get_binary_hash();
+    key.kernel_name = kernel_def->mangled_prototype;
+    key.trace_task_type = this->_type;
+    key.list_instrument_cxt_type = { cxt_type };
+    key.metadata_hash = GWUtilHash::fnv1a(nlohmann::json(this->_map_metadata).dump());
+    key.arch_version = kernel_def_ext_cuda_sass->params().arch_version;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTask_CUDA::__export_instrument_cache_entry(
+    GWInstrumentCxt* instrument_cxt, gw_instrument_cache_entry_t& entry
+) const {
+    gw_retval_t retval = GW_SUCCESS;
+    CUresult cudv_retval = CUDA_SUCCESS;
+    std::vector<uint8_t> rest_bytes;
+    uint64_t init_size = 0;
+
+    GW_CHECK_POINTER(instrument_cxt);
+
+    GW_IF_FAILED(instrument_cxt->export_instrumentation(entry), retval, goto exit;);
+
+    entry.extra_dmem_init_bytes.clear();
+    if(entry.size_extra_dmem == 0)
+        goto exit;
+
+    // snapshot the initial content (e.g., header of trace buffer) before the first launch
+    init_size = std::min<uint64_t>(entry.size_extra_dmem, GW_INSTRUMENT_CACHE_MAX_DMEM_INIT_SIZE);
+    entry.extra_dmem_init_bytes.resize(init_size);
+    GW_IF_CUDA_DRIVER_FAILED(
+        cuMemcpyDtoH(entry.extra_dmem_init_bytes.data(), (CUdeviceptr)(instrument_cxt->extra_dmem), init_size),
+        cudv_retval,
+        {
+            retval = GW_FAILED_SDK;
+            goto exit;
+        }
+    );
+
+    // NOTE(zhuobin): content beyond the snapshot is restored as zero, so we refuse
+    //                to cache instrumentations which initialize it otherwise
+    if(entry.size_extra_dmem > init_size){
+        rest_bytes.resize(entry.size_extra_dmem - init_size);
+        GW_IF_CUDA_DRIVER_FAILED(
+            cuMemcpyDtoH(rest_bytes.data(), (CUdeviceptr)(instrument_cxt->extra_dmem) + init_size, rest_bytes.size()),
+            cudv_retval,
+            {
+                retval = GW_FAILED_SDK;
+                goto exit;
+            }
+        );
+        if(std::any_of(rest_bytes.begin(), rest_bytes.end(), [](uint8_t byte){ return byte != 0; })){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+    }
+
+    // trim trailing zeros, which are restored by memset
+    while(entry.extra_dmem_init_bytes.size() > 0 and entry.extra_dmem_init_bytes.back() == 0)
+        entry.extra_dmem_init_bytes.pop_back();
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTask_CUDA::__adopt_instrument_cache_entry(
+    GWInstrumentCxt* instrument_cxt, const gw_instrument_cache_entry_t& entry, bool& is_extra_dmem_allocated
+) const {
+    gw_retval_t retval = GW_SUCCESS;
+    CUresult cudv_retval = CUDA_SUCCESS;
+    CUdeviceptr dptr = (CUdeviceptr)0;
+
+    GW_CHECK_POINTER(instrument_cxt);
+    is_extra_dmem_allocated = false;
+
+    if(entry.size_extra_dmem > 0){
+        if(unlikely(entry.extra_dmem_init_bytes.size() > entry.size_extra_dmem)){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        GW_IF_CUDA_DRIVER_FAILED(cuMemAlloc(&dptr, entry.size_extra_dmem), cudv_retval, { retval = GW_FAILED_SDK; goto exit; });
+        GW_IF_CUDA_DRIVER_FAILED(cuMemsetD8(dptr, 0, entry.size_extra_dmem), cudv_retval, { retval = GW_FAILED_SDK; goto exit; });
+        if(entry.extra_dmem_init_bytes.size() > 0){
+            GW_IF_CUDA_DRIVER_FAILED(
+                cuMemcpyHtoD(dptr, entry.extra_dmem_init_bytes.data(), entry.extra_dmem_init_bytes.size()),
+                cudv_retval,
+                { retval = GW_FAILED_SDK; goto exit; }
+            );
+        }
+        instrument_cxt->extra_dmem = reinterpret_cast<void*>(dptr);
+        instrument_cxt->size_extra_dmem = entry.size_extra_dmem;
+    }
+
+    retval = instrument_cxt->adopt_cached_instrumentation(entry);
+
+exit:
+    if(retval != GW_SUCCESS and dptr != (CUdeviceptr)0){
+        cuMemFree(dptr);
+        instrument_cxt->extra_dmem = nullptr;
+        instrument_cxt->size_extra_dmem = 0;
+    } else if(dptr != (CUdeviceptr)0){
+        is_extra_dmem_allocated = true;
+    }
+    return retval;
+}
+
+
+gw_retval_t GWTraceTask_CUDA::__verify_instrumented_binary(GWInstrumentCxt* instrument_cxt, nlohmann::json& report) const {
+    gw_retval_t retval = GW_SUCCESS;
+    GWKernelDefExt_CUDA_SASS *kernel_def_ext_cuda_sass = nullptr;
+    GWBinaryImageExt_CUDACubin *binary_ext_cuda_cubin = nullptr;
+    nlohmann::json metadata_value;
+
+    GW_CHECK_POINTER(instrument_cxt);
+    report = nullptr;
+
+    if(!this->has_metadata("verify_instrumented_binary"))
+        goto exit;
+    this->get_metadata("verify_instrumented_binary", metadata_value);
+    if(!metadata_value.is_boolean() or metadata_value.get<bool>() == false)
+        goto exit;
+
+    GW_CHECK_POINTER(instrument_cxt->get_kernel());
+    GW_CHECK_POINTER(kernel_def_ext_cuda_sass = GWKernelDefExt_CUDA_SASS::get_ext_ptr(instrument_cxt->get_kernel()->get_def()));
+    GW_CHECK_POINTER(kernel_def_ext_cuda_sass->params().binary_cuda_cubin);
+    GW_CHECK_POINTER(binary_ext_cuda_cubin = GWBinaryImageExt_CUDACubin::get_ext_ptr(kernel_def_ext_cuda_sass->params().binary_cuda_cubin));
+
+    report = nlohmann::json::object();
+    retval = binary_ext_cuda_cubin->verify_instrumented_binary(
+        instrument_cxt->instrumented_binary_bytes, { instrument_cxt }, report
+    );
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTask_CUDA::pre_instrument(GWCapsule* capsule, GWKernel* kernel) const {
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    GWKernelDefExt_CUDA_SASS *kernel_def_ext_cuda_sass = nullptr;
+    GWBinaryImageExt_CUDACubin *binary_ext_cuda_cubin = nullptr;
+    std::vector<GWInstrumentCxt*> list_instrument_cxt;
+    std::vector<gw_instrument_cache_key_t> list_cache_key;
+    uint64_t nb_committed = 0;
+
+    GW_CHECK_POINTER(kernel);
+    GW_CHECK_POINTER(kernel->get_def());
+    GW_CHECK_POINTER(kernel_def_ext_cuda_sass = GWKernelDefExt_CUDA_SASS::get_ext_ptr(kernel->get_def()));
+    GW_CHECK_POINTER(kernel_def_ext_cuda_sass->params().binary_cuda_cubin);
+    GW_CHECK_POINTER(binary_ext_cuda_cubin = GWBinaryImageExt_CUDACubin::get_ext_ptr(kernel_def_ext_cuda_sass->params().binary_cuda_cubin));
+
+    GW_IF_FAILED(
+        this->prepare_pre_instrument(capsule, kernel, list_instrument_cxt, list_cache_key),
+        retval,
+        goto exit;
+    );
+    if(list_instrument_cxt.size() > 0){
+        // NOTE(zhuobin): contexts failed to instrument are skipped by commit, as they have
+        //                no instrumented binary
+        tmp_retval = binary_ext_cuda_cubin->dynamic_instrument_batch(list_instrument_cxt);
+        if(tmp_retval != GW_SUCCESS){
+            GW_DEBUG_C(
+                "failed to instrument some contexts ahead of time: kernel(%s), error(%s)",
+                kernel->get_def()->mangled_prototype.c_str(), gw_retval_str(tmp_retval)
+            );
+        }
+    }
+
+exit:
+    this->commit_pre_instrument(capsule, list_instrument_cxt, list_cache_key, nb_committed);
+    return retval;
+}
+
+
+gw_retval_t GWTraceTask_CUDA::prepare_pre_instrument(
+    GWCapsule* capsule, GWKernel* kernel,
+    std::vector<GWInstrumentCxt*>& list_instrument_cxt,
+    std::vector<gw_instrument_cache_key_t>& list_cache_key
+) const {
+    gw_retval_t retval = GW_SUCCESS;
+    GWKernelDef *kernel_def = nullptr;
+    GWInstrumentCxt *instrument_cxt = nullptr;
+    std::vector<std::string> list_cxt_type;
+    gw_instrument_cache_key_t instrument_cache_key;
+    gw_instrument_cache_entry_t instrument_cache_entry;
+
+    GW_CHECK_POINTER(capsule);
+    GW_CHECK_POINTER(kernel);
+    GW_CHECK_POINTER(kernel_def = kernel->get_def());
+
+    list_cxt_type = this->get_instrument_cxt_types();
+    if(list_cxt_type.size() == 0){
+        retval = GW_FAILED_NOT_IMPLEMENTAED;
+        goto exit;
+    }
+
+    if(!kernel_def->has_fingerprint()){
+        GW_IF_FAILED(capsule->CUDA_calculate_kerneldef_fingerprint(kernel_def), retval, goto exit;);
+    }
+
+    for(auto& cxt_type : list_cxt_type){
+        GW_IF_FAILED(
+            this->__get_instrument_cache_key(kernel_def, cxt_type, instrument_cache_key),
+            retval,
+            goto exit;
+        );
+
+        // NOTE(zhuobin): lookup would account a miss for ahead-of-time instrumentation,
+        //                which is expected as the kernel hasn't been launched yet
+        if(capsule->instrument_cache.lookup(instrument_cache_key, instrument_cache_entry) == GW_SUCCESS){
+            continue;
+        }
+
+        GW_CHECK_POINTER(instrument_cxt = GWInstrumentCxtFactory::instance().create(cxt_type, this, kernel));
+        list_instrument_cxt.push_back(instrument_cxt);
+        list_cache_key.push_back(instrument_cache_key);
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTask_CUDA::commit_pre_instrument(
+    GWCapsule* capsule,
+    std::vector<GWInstrumentCxt*>& list_instrument_cxt,
+    const std::vector<gw_instrument_cache_key_t>& list_cache_key,
+    uint64_t& nb_committed
+) const {
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t i = 0;
+    gw_instrument_cache_entry_t instrument_cache_entry;
+    nlohmann::json verification_report;
+
+    GW_CHECK_POINTER(capsule);
+    GW_ASSERT(list_instrument_cxt.size() == list_cache_key.size());
+
+    nb_committed = 0;
+    for(i=0; i<list_instrument_cxt.size(); i++){
+        GW_CHECK_POINTER(list_instrument_cxt[i]);
+
+        // contexts failed to instrument have no instrumented binary
+        if(list_instrument_cxt[i]->instrumented_binary_bytes.size() == 0){
+            list_instrument_cxt[i]->release_instrumentation();
+            continue;
+        }
+
+        // NOTE(zhuobin): the report is cached along with the binary, as cache hits can't
+        //                verify the binary without the instrumented instruction stream
+        if(this->__verify_instrumented_binary(list_instrument_cxt[i], verification_report) != GW_SUCCESS){
+            GW_WARN_C(
+                "failed to verify instrumented binary ahead of time, skip caching: kernel(%s), instrumentation(%s)",
+                list_cache_key[i].kernel_name.c_str(), list_instrument_cxt[i]->get_type().c_str()
+            );
+            list_instrument_cxt[i]->release_instrumentation();
+            continue;
+        }
+
+        if(this->__export_instrument_cache_entry(list_instrument_cxt[i], instrument_cache_entry) == GW_SUCCESS){
+            instrument_cache_entry.verification_report = verification_report;
+            if(capsule->instrument_cache.insert(list_cache_key[i], instrument_cache_entry) == GW_SUCCESS){
+                nb_committed += 1;
+                GW_DEBUG_C(
+                    "instrumented kernel ahead of time: kernel(%s), instrumentation(%s)",
+                    list_cache_key[i].kernel_name.c_str(), list_instrument_cxt[i]->get_type().c_str()
+                );
+            }
+        }
+        list_instrument_cxt[i]->release_instrumentation();
+    }
+    list_instrument_cxt.clear();
+
+exit:
+    return retval;
+}
+
+
 gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWInstrumentCxt* instrument_cxt) const {
     using cu_module_load_data_func_t = CUresult(CUmodule*, const void*);
     using cu_module_get_function_func_t = CUresult(CUfunction*, CUmodule, const char*);
@@ -66,6 +364,14 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
     };
     std::map<uint64_t, std::map<uint32_t, uint64_t>> map_pc_sampling_result = {};
     std::vector<std::map<uint64_t, std::map<uint32_t, uint64_t>>> list_map_pc_sampling_result;
+    double estimated_slowdown = 1.0f;
+    nlohmann::json metadata_value;
+    std::string overhead_policy = "refuse";
+    bool do_downgrade = false;
+    gw_instrument_cache_key_t instrument_cache_key;
+    gw_instrument_cache_entry_t instrument_cache_entry;
+    bool is_instrument_cacheable = false, is_extra_dmem_allocated = false, is_instrument_cache_hit = false;
+    nlohmann::json verification_report;
 
 
     /*!
@@ -179,6 +485,117 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
     };
 
 
+    /*!
+     *  \brief  lambda for statically estimating the slowdown of the instrumented kernel,
+     *          based on occupancy change and instruction count inflation
+     *  \param  _estimated_slowdown    output estimated slowdown ratio
+     *  \return GW_SUCCESS if success
+     */
+    auto __estimate_instrument_overhead = [&](double& _estimated_slowdown) -> gw_retval_t {
+        gw_retval_t _retval = GW_SUCCESS;
+        CUresult _cudv_retval = CUDA_SUCCESS;
+        int _func_attr_nb_regs = 0, _func_attr_static_smem_size = 0;
+        uint32_t _nb_threads_per_block = 0;
+        gw_cuda_sm_resource_t _sm_resource;
+        gw_cuda_occupancy_t _occupancy_origin, _occupancy_instrumented;
+        std::map<uint64_t, double> _map_bb_inflation;
+        double _overall_inflation = 1.0f;
+
+        _estimated_slowdown = 1.0f;
+
+        GW_IF_CUDA_DRIVER_FAILED(
+            cuFuncGetAttribute(&_func_attr_nb_regs, CU_FUNC_ATTRIBUTE_NUM_REGS, kernel_def_ext_cuda_sass->params().cu_function),
+            _cudv_retval,
+            {
+                GW_WARN_C(
+                    "failed to get function attribute CU_FUNC_ATTRIBUTE_NUM_REGS: error(%s)",
+                    GWUtilCUDA::get_driver_error_string(_cudv_retval).c_str()
+                );
+                _retval = GW_FAILED_SDK;
+                goto _exit;
+            }
+        );
+        GW_IF_CUDA_DRIVER_FAILED(
+            cuFuncGetAttribute(&_func_attr_static_smem_size, CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, kernel_def_ext_cuda_sass->params().cu_function),
+            _cudv_retval,
+            {
+                GW_WARN_C(
+                    "failed to get function attribute CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES: error(%s)",
+                    GWUtilCUDA::get_driver_error_string(_cudv_retval).c_str()
+                );
+                _retval = GW_FAILED_SDK;
+                goto _exit;
+            }
+        );
+
+        GW_IF_FAILED(
+            GWOccupancyCUDA::get_sm_resource(kernel_def_ext_cuda_sass->params().arch_version, _sm_resource),
+            _retval,
+            goto _exit;
+        );
+
+        _nb_threads_per_block = kernel->block_dim_x * kernel->block_dim_y * kernel->block_dim_z;
+        GW_IF_FAILED(
+            GWOccupancyCUDA::calculate(
+                /* sm_resource */ _sm_resource,
+                /* nb_threads_per_block */ _nb_threads_per_block,
+                /* nb_regs_per_thread */ _func_attr_nb_regs,
+                /* smem_per_block */ _func_attr_static_smem_size + kernel->shared_mem_bytes,
+                /* occupancy */ _occupancy_origin
+            ),
+            _retval,
+            goto _exit;
+        );
+
+        // NOTE(zhuobin): the instrumented kernel could be unlaunchable (e.g., exceed register limit),
+        //                in which case the occupancy is zero and the slowdown is infinite
+        _retval = GWOccupancyCUDA::calculate(
+            /* sm_resource */ _sm_resource,
+            /* nb_threads_per_block */ _nb_threads_per_block,
+            /* nb_regs_per_thread */ _func_attr_nb_regs + instrument_cxt->nb_added_general_register,
+            /* smem_per_block */ _func_attr_static_smem_size + kernel->shared_mem_bytes + instrument_cxt->added_shared_memory_size,
+            /* occupancy */ _occupancy_instrumented
+        );
+        if(unlikely(_retval != GW_SUCCESS and _retval != GW_FAILED_HARDWARE)){
+            goto _exit;
+        }
+        _retval = GW_SUCCESS;
+
+        // instruction inflation is optional, as it requires CFG to be parsed
+        instrument_cxt->estimate_instruction_inflation(
+            is_instrument_cache_hit ? instrument_cache_entry.nb_out_instructions : instrument_cxt->list_out_instructions.size(),
+            _map_bb_inflation, _overall_inflation
+        );
+
+        if(_occupancy_instrumented.nb_active_warps_per_sm == 0){
+            _estimated_slowdown = std::numeric_limits<double>::infinity();
+        } else {
+            _estimated_slowdown = _overall_inflation
+                * std::max(1.0, _occupancy_origin.occupancy / _occupancy_instrumented.occupancy);
+        }
+
+        instrument_cxt->set_trace_result("instrument_overhead", "occupancy_origin", _occupancy_origin);
+        instrument_cxt->set_trace_result("instrument_overhead", "occupancy_instrumented", _occupancy_instrumented);
+        instrument_cxt->set_trace_result("instrument_overhead", "bb_instruction_inflation", _map_bb_inflation);
+        instrument_cxt->set_trace_result("instrument_overhead", "instruction_inflation", _overall_inflation);
+        instrument_cxt->set_trace_result(
+            "instrument_overhead", "estimated_slowdown",
+            std::isinf(_estimated_slowdown) ? nlohmann::json(nullptr) : nlohmann::json(_estimated_slowdown)
+        );
+
+        GW_DEBUG_C(
+            "estimated instrumentation overhead: kernel(%s), "
+            "occupancy(%.2lf -> %.2lf, limiter: %s), instruction_inflation(%.2lf), estimated_slowdown(%.2lf)",
+            kernel_def->mangled_prototype.c_str(),
+            _occupancy_origin.occupancy, _occupancy_instrumented.occupancy,
+            _occupancy_instrumented.limiter.c_str(), _overall_inflation, _estimated_slowdown
+        );
+
+    _exit:
+        return _retval;
+    };
+
+
     /*!
      *  \brief  lambda for executing instrumentation context once to colloect profiling results
      *  \todo   add support for range profiling
@@ -232,7 +649,7 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
         GWCapsule::event_trace->push_event(_pc_sampling_event);
         GWCapsule::event_trace->push_parent_event(_pc_sampling_event);
 
-        _pc_sampling_event->record_tick("begin");
+        _pc_sampling_event->record_tick(GW_EVENT_KEY_TICK_BEGIN);
 
         // obtain the current device id
         GW_IF_FAILED(
@@ -450,7 +867,7 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
         capsule->profile_context_cuda->unlock_device(_device_id);
 
     _real_exit:
-        _pc_sampling_event->record_tick("end");
+        _pc_sampling_event->record_tick(GW_EVENT_KEY_TICK_END);
         GWCapsule::event_trace->pop_parent_event(_pc_sampling_event);
         _pc_sampling_event->archive();
         return _retval;
@@ -497,7 +914,7 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
         GWCapsule::event_trace->push_event(_trace_event);
         GWCapsule::event_trace->push_parent_event(_trace_event);
 
-        _trace_event->record_tick("begin");
+        _trace_event->record_tick(GW_EVENT_KEY_TICK_BEGIN);
 
         cu_launch_config.gridDimX = kernel->grid_dim_x;
         cu_launch_config.gridDimY = kernel->grid_dim_y;
@@ -610,7 +1027,7 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
         // );
 
     _exit:
-        _trace_event->record_tick("end");
+        _trace_event->record_tick(GW_EVENT_KEY_TICK_END);
         GWCapsule::event_trace->pop_parent_event(_trace_event);
         _trace_event->archive();
         return _retval;
@@ -640,7 +1057,7 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
     capsule->ensure_event_trace();
     GWCapsule::event_trace->push_event(trace_event);
     GWCapsule::event_trace->push_parent_event(trace_event);
-    trace_event->record_tick("begin");
+    trace_event->record_tick(GW_EVENT_KEY_TICK_BEGIN);
 
     GW_CHECK_POINTER(instrument_event = new GWEvent("Instrument"));
     instrument_event->type_id = GW_EVENT_TYPE_GWATCH;
@@ -664,24 +1081,138 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
     // );
 
     // step 2: dynamic instrumentation
-    instrument_event->record_tick("begin");
+    instrument_event->record_tick(GW_EVENT_KEY_TICK_BEGIN);
+
+    // step 2.0: lookup instrumented binary from cache
+    if(!kernel_def->has_fingerprint()){
+        GW_IF_FAILED(
+            capsule->CUDA_calculate_kerneldef_fingerprint(kernel_def),
+            tmp_retval,
+            GW_WARN_C(
+                "failed to calculate kernel fingerprint, skip instrument cache: kernel(%s), error(%s)",
+                kernel_def->mangled_prototype.c_str(), gw_retval_str(tmp_retval)
+            );
+        );
+    }
+    if(this->__get_instrument_cache_key(kernel_def, instrument_cxt->get_type(), instrument_cache_key) == GW_SUCCESS){
+        is_instrument_cacheable = true;
+        if(capsule->instrument_cache.lookup(instrument_cache_key, instrument_cache_entry) == GW_SUCCESS){
+            if(this->__adopt_instrument_cache_entry(instrument_cxt, instrument_cache_entry, is_extra_dmem_allocated) == GW_SUCCESS){
+                is_instrument_cache_hit = true;
+            } else {
+                capsule->instrument_cache.record_reject();
+            }
+        }
+    }
+
+    if(!is_instrument_cache_hit){
+        GW_IF_FAILED(
+            binary_ext_cuda_cubin->dynamic_instrument(instrument_cxt),
+            retval,
+            {
+                GW_WARN_C(
+                    "failed to instrument kernel for tracing: kernel(%s), err(%s)",
+                    kernel_def->mangled_prototype.c_str(), gw_retval_str(retval)
+                );
+                goto exit;
+            }
+        );
+    }
+    instrument_event->record_tick(GW_EVENT_KEY_TICK_END);
+    instrument_event->set_metadata("Instrument Cache", is_instrument_cache_hit ? "hit" : "miss");
+    instrument_event->archive();
+
+    // export statistics of instrument cache
+    instrument_cxt->set_trace_result("instrument_cache", "hit", is_instrument_cache_hit);
+    instrument_cxt->set_trace_result("instrument_cache", "statistics", capsule->instrument_cache.get_statistics());
+    GW_DEBUG_C(
+        "instrument cache: kernel(%s), hit(%s), nb_hits(%lu), nb_misses(%lu)",
+        kernel_def->mangled_prototype.c_str(),
+        is_instrument_cache_hit ? "yes" : "no",
+        capsule->instrument_cache.get_nb_hits(),
+        capsule->instrument_cache.get_nb_misses()
+    );
+
+    // record number of general register which reuse dead register instead of being added
+    if(!is_instrument_cache_hit and instrument_cxt->get_reg_alloc_cxt() != nullptr){
+        GW_DEBUG_C(
+            "register allocation of instrumented kernel: kernel(%s), nb_added(%u), nb_avoided(%lu)",
+            kernel_def->mangled_prototype.c_str(),
+            instrument_cxt->nb_added_general_register,
+            instrument_cxt->get_reg_alloc_cxt()->get_nb_avoided_extra_reg("general")
+        );
+    }
+
+    // step 2.1: check whether the instrumented kernel would have performance issue,
+    //           e.g., add too much register / smem, or inflate the instruction stream
     GW_IF_FAILED(
-        binary_ext_cuda_cubin->dynamic_instrument(instrument_cxt),
-        retval,
+        __estimate_instrument_overhead(estimated_slowdown),
+        tmp_retval,
         {
             GW_WARN_C(
-                "failed to instrument kernel for tracing: kernel(%s), err(%s)",
-                kernel_def->mangled_prototype.c_str(), gw_retval_str(retval)
+                "failed to estimate instrumentation overhead, skip checking: kernel(%s), error(%s)",
+                kernel_def->mangled_prototype.c_str(), gw_retval_str(tmp_retval)
             );
-            goto exit;
         }
     );
-    instrument_event->record_tick("end");
-    instrument_event->archive();
+    if(tmp_retval == GW_SUCCESS and this->has_metadata("max_instrument_overhead")){
+        this->get_metadata("max_instrument_overhead", metadata_value);
+        if(metadata_value.is_number() and estimated_slowdown > metadata_value.get<double>()){
+            if(this->has_metadata("instrument_overhead_policy")){
+                this->get_metadata("instrument_overhead_policy", metadata_value);
+                if(metadata_value.is_string())
+                    overhead_policy = metadata_value.get<std::string>();
+            }
+            GW_WARN_C(
+                "instrumented kernel exceeds overhead threshold: kernel(%s), estimated_slowdown(%.2lf), policy(%s)",
+                kernel_def->mangled_prototype.c_str(), estimated_slowdown, overhead_policy.c_str()
+            );
+            trace_event->set_metadata("warning", "Instrumented kernel exceeds overhead threshold");
+            if(overhead_policy == "refuse"){
+                retval = GW_FAILED;
+                goto exit;
+            } else if(overhead_policy == "downgrade"){
+                // NOTE(zhuobin): downgrade skips the optional profiling runs (e.g., PC sampling),
+                //                which launch the instrumented kernel repeatedly
+                do_downgrade = true;
+            }
+        }
+    }
+
+    // step 2.2: (optional) verify the instrumented binary by re-parsing it, cached binaries
+    //           were verified before caching, whose report is reused
+    if(is_instrument_cache_hit){
+        verification_report = instrument_cache_entry.verification_report;
+    } else {
+        tmp_retval = this->__verify_instrumented_binary(instrument_cxt, verification_report);
+        if(unlikely(tmp_retval != GW_SUCCESS)){
+            GW_WARN_C(
+                "failed to verify instrumented binary: kernel(%s), error(%s)",
+                kernel_def->mangled_prototype.c_str(), gw_retval_str(tmp_retval)
+            );
+            instrument_cxt->set_trace_result("instrument_verification", "report", verification_report);
+            trace_event->set_metadata("error", "Failed to verify instrumented binary");
+            retval = tmp_retval;
+            goto exit;
+        }
+    }
+    if(!verification_report.is_null())
+        instrument_cxt->set_trace_result("instrument_verification", "report", verification_report);
 
-    // TODO(zhuobin):
-    // we shall check whether the instrumented kernel would have performance issue
-    // e.g., add too much register / smem
+    // step 2.3: insert the instrumented binary to cache for later traces / runs
+    if(is_instrument_cacheable and !is_instrument_cache_hit){
+        if(this->__export_instrument_cache_entry(instrument_cxt, instrument_cache_entry) == GW_SUCCESS){
+            instrument_cache_entry.verification_report = verification_report;
+            GW_IF_FAILED(
+                capsule->instrument_cache.insert(instrument_cache_key, instrument_cache_entry),
+                tmp_retval,
+                GW_WARN_C(
+                    "failed to insert instrumented binary to cache: kernel(%s), error(%s)",
+                    kernel_def->mangled_prototype.c_str(), gw_retval_str(tmp_retval)
+                );
+            );
+        }
+    }
 
     // step 3: load the instrumented binary
     GW_IF_CUDA_DRIVER_FAILED(
@@ -736,6 +1267,7 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
     if(
         this->_map_metadata.find("enable_pc_sampling") != this->_map_metadata.end()
         and capsule->profile_context_cuda != nullptr
+        and do_downgrade == false
     ){
         GW_CHECK_POINTER(capsule->profile_context_cuda);
 
@@ -813,9 +1345,15 @@ gw_retval_t GWTraceTask_CUDA::__execute_instrument_cxt(GWCapsule* capsule, GWIns
     // TODO(zhuobin): unload the module to save CUDA memory
 
 exit:
+    // release extra device memory allocated for adopting cached instrumentation
+    if(is_extra_dmem_allocated){
+        cuMemFree((CUdeviceptr)(instrument_cxt->extra_dmem));
+        instrument_cxt->extra_dmem = nullptr;
+        instrument_cxt->size_extra_dmem = 0;
+    }
     if(trace_event != nullptr){
         GWCapsule::event_trace->pop_parent_event(trace_event);
-        trace_event->record_tick("end");
+        trace_event->record_tick(GW_EVENT_KEY_TICK_END);
         trace_event->archive();
     }
     return retval;
@@ -26,7 +26,109 @@ class GWTraceTask_CUDA : public GWTraceTask {
     ~GWTraceTask_CUDA();
 
 
+    /*!
+     *  \brief  instrument the kernel ahead of its first launch, and store the instrumented
+     *          binary to the instrument cache of the capsule, so that later tracing of the
+     *          kernel skips the instrumentation
+     *  \note   this function is called from the worker threads of the capsule, the kernel
+     *          isn't launched and has no launch configuration
+     *  \param  capsule     capsule which owns the instrument cache
+     *  \param  kernel      kernel to be instrumented
+     *  \return GW_SUCCESS if success, GW_FAILED_NOT_IMPLEMENTAED if the trace task doesn't
+     *          support ahead-of-time instrumentation
+     */
+    gw_retval_t pre_instrument(GWCapsule* capsule, GWKernel* kernel) const;
+
+
+    /*!
+     *  \brief  create instrument contexts of the kernel for ahead-of-time instrumentation,
+     *          contexts whose instrumented binary has been cached are skipped
+     *  \note   the created contexts should be instrumented (in batch with contexts of other
+     *          kernels within the same cubin) and then passed to commit_pre_instrument
+     *  \param  capsule             capsule which owns the instrument cache
+     *  \param  kernel              kernel to be instrumented
+     *  \param  list_instrument_cxt created instrument contexts
+     *  \param  list_cache_key      key of each created instrument context within the cache
+     *  \return GW_SUCCESS if success, GW_FAILED_NOT_IMPLEMENTAED if the trace task doesn't
+     *          support ahead-of-time instrumentation
+     */
+    gw_retval_t prepare_pre_instrument(
+        GWCapsule* capsule, GWKernel* kernel,
+        std::vector<GWInstrumentCxt*>& list_instrument_cxt,
+        std::vector<gw_instrument_cache_key_t>& list_cache_key
+    ) const;
+
+
+    /*!
+     *  \brief  store instrumented binaries of contexts from prepare_pre_instrument to the
+     *          instrument cache, and release buffers of the contexts
+     *  \note   the contexts are created by the prebuilt library and aren't deleted, as
+     *          GWInstrumentCxt has no virtual destructor
+     *  \param  capsule             capsule which owns the instrument cache
+     *  \param  list_instrument_cxt instrument contexts, which would be cleared
+     *  \param  list_cache_key      key of each instrument context within the cache
+     *  \param  nb_committed        number of instrumented binaries stored to the cache
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t commit_pre_instrument(
+        GWCapsule* capsule,
+        std::vector<GWInstrumentCxt*>& list_instrument_cxt,
+        const std::vector<gw_instrument_cache_key_t>& list_cache_key,
+        uint64_t& nb_committed
+    ) const;
+
+
  protected:
+    /*!
+     *  \brief  form the key of the instrumented binary within the instrument cache
+     *  \param  kernel_def      kernel definition to be instrumented
+     *  \param  cxt_type        type of the instrument context
+     *  \param  key             the formed key
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t __get_instrument_cache_key(
+        GWKernelDef* kernel_def, const std::string& cxt_type, gw_instrument_cache_key_t& key
+    ) const;
+
+
+    /*!
+     *  \brief  export the instrumentation to a cache entry, along with the initial content
+     *          of the extra device memory behind the added parameters
+     *  \note   should be called before the instrumented kernel is launched
+     *  \param  instrument_cxt  the instrument context to be exported
+     *  \param  entry           the exported cache entry
+     *  \return GW_SUCCESS if success, GW_FAILED_NOT_IMPLEMENTAED if the extra device memory
+     *          isn't zero beyond GW_INSTRUMENT_CACHE_MAX_DMEM_INIT_SIZE
+     */
+    gw_retval_t __export_instrument_cache_entry(
+        GWInstrumentCxt* instrument_cxt, gw_instrument_cache_entry_t& entry
+    ) const;
+
+
+    /*!
+     *  \brief  adopt a cache entry to the instrument context, the extra device memory is
+     *          allocated and initialized if the cached instrumentation points into it
+     *  \param  instrument_cxt          the instrument context to adopt the entry
+     *  \param  entry                   the cache entry
+     *  \param  is_extra_dmem_allocated  whether extra_dmem is allocated here, which should be
+     *                                  freed by the caller after collecting trace result
+     *  \return GW_SUCCESS if adopted
+     */
+    gw_retval_t __adopt_instrument_cache_entry(
+        GWInstrumentCxt* instrument_cxt, const gw_instrument_cache_entry_t& entry, bool& is_extra_dmem_allocated
+    ) const;
+
+
+    /*!
+     *  \brief  verify the instrumented binary of the instrument context by re-parsing it,
+     *          if the trace task requests so by the metadata "verify_instrumented_binary"
+     *  \param  instrument_cxt  the instrument context which has been instrumented
+     *  \param  report          report of the verification, null if not requested
+     *  \return GW_SUCCESS if verified or not requested
+     */
+    gw_retval_t __verify_instrumented_binary(GWInstrumentCxt* instrument_cxt, nlohmann::json& report) const;
+
+
     /*!
      *  \brief  execute one instrument context
      *  \param  capsule             capsule to execute the trace
@@ -38,6 +38,15 @@ class GWTraceTask_CUDA_Kernel_BlockSchedule final : public GWTraceTask_CUDA {
     ~GWTraceTask_CUDA_Kernel_BlockSchedule();
 
 
+    /*!
+     *  \brief  obtain types of instrument contexts applied by this trace task
+     *  \return types of instrument contexts
+     */
+    std::vector<std::string> get_instrument_cxt_types() const override {
+        return { "sass::count_control_flow" };
+    }
+
+
     /*!
      *  \brief  execute the trace application
      *  \param  capsule                         capsule to execute the trace
@@ -85,9 +94,7 @@ gw_retval_t GWTraceTask_CUDA_Kernel_BlockSchedule::execute(
     std::map<std::string, GWInstrumentCxt*>& map_current_instrument_ctx
 ) const {
     gw_retval_t retval = GW_SUCCESS;
-    std::vector<std::string> list_instrument_ctx_name = { 
-        "sass::count_control_flow"
-    };
+    std::vector<std::string> list_instrument_ctx_name = this->get_instrument_cxt_types();
     return this->__execute(
         capsule, kernel, global_id, list_instrument_ctx_name, map_existing_instrument_ctx, map_current_instrument_ctx
     );
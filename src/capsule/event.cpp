@@ -4,45 +4,330 @@
 #include <map>
 #include <algorithm>
 #include <thread>
+#include <shared_mutex>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <ctime>
 
 #include <pthread.h>
 
 #include "common/common.hpp"
 #include "common/log.hpp"
 #include "capsule/event.hpp"
-#include "common/utils/lockfree_queue.hpp"
+#include "capsule/event_exporter.hpp"
+#include "common/utils/futex.hpp"
+
+
+GWEventKeyRegistry::GWEventKeyRegistry(){
+    // builtin keys, in the order of gw_event_key_builtin_t
+    this->intern("unknown");
+    this->intern("begin");
+    this->intern("end");
+}
+
+
+gw_event_key_t GWEventKeyRegistry::intern(const std::string& str){
+    gw_event_key_t key = GW_EVENT_KEY_UNKNOWN;
+    typename std::unordered_map<std::string, gw_event_key_t>::iterator it;
+
+    // fast path: the string has been interned
+    {
+        std::shared_lock<std::shared_mutex> lock(this->_mutex);
+        it = this->_map_str_key.find(str);
+        if(likely(it != this->_map_str_key.end()))
+            return it->second;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(this->_mutex);
+        it = this->_map_str_key.find(str);
+        if(it != this->_map_str_key.end())
+            return it->second;
+        key = static_cast<gw_event_key_t>(this->_list_str.size());
+        this->_list_str.push_back(str);
+        this->_map_str_key.insert({ str, key });
+    }
+
+    return key;
+}
+
+
+const std::string& GWEventKeyRegistry::get_str(gw_event_key_t key){
+    std::shared_lock<std::shared_mutex> lock(this->_mutex);
+    if(unlikely(key >= this->_list_str.size()))
+        return this->_list_str[GW_EVENT_KEY_UNKNOWN];
+    return this->_list_str[key];
+}
+
+
+std::string gw_event_global_id::str() const {
+    if(!this->is_valid)
+        return "";
+    return GWEventKeyRegistry::instance().get_str(this->trace_name_id)
+            + "-" + GWEvent::typeid_to_string(this->type_id)
+            + "-" + std::to_string(this->thread_id)
+            + "-" + std::to_string(this->id);
+}
+
+
+gw_retval_t gw_event_global_id::parse(const std::string& global_id_str){
+    gw_retval_t retval = GW_SUCCESS;
+    std::string::size_type pos_id = 0, pos_thread_id = 0, pos_type = 0;
+
+    this->is_valid = false;
+    if(global_id_str.size() == 0)
+        goto exit;
+
+    // trace name could contain '-', so we parse from the right
+    pos_id = global_id_str.rfind('-');
+    if(pos_id == std::string::npos or pos_id == 0)
+        goto exit_failed;
+    pos_thread_id = global_id_str.rfind('-', pos_id - 1);
+    if(pos_thread_id == std::string::npos or pos_thread_id == 0)
+        goto exit_failed;
+    pos_type = global_id_str.rfind('-', pos_thread_id - 1);
+    if(pos_type == std::string::npos)
+        goto exit_failed;
+
+    try {
+        this->id = std::stoull(global_id_str.substr(pos_id + 1));
+        this->thread_id = std::stoull(global_id_str.substr(pos_thread_id + 1, pos_id - pos_thread_id - 1));
+    } catch (...) {
+        goto exit_failed;
+    }
+    this->type_id = GWEvent::string_to_typeid(global_id_str.substr(pos_type + 1, pos_thread_id - pos_type - 1));
+    this->trace_name_id = GWEventKeyRegistry::instance().intern(global_id_str.substr(0, pos_type));
+    this->is_valid = true;
+    goto exit;
+
+exit_failed:
+    GW_WARN_C("failed to parse global id of event: %s", global_id_str.c_str());
+    retval = GW_FAILED_INVALID_INPUT;
+
+exit:
+    return retval;
+}
+
+
+void GWEvent::archive(){
+    GWEventTrace *event_trace = nullptr;
+
+    // NOTE(zhuobin): pairs with push_event, which publishes the trace before checking
+    //                the archive flag, so that either side observes the other
+    this->_is_archived.store(true, std::memory_order_seq_cst);
+    event_trace = this->_event_trace.load(std::memory_order_seq_cst);
+    if(event_trace != nullptr)
+        event_trace->__notify_archived(this);
+}
+
+
+std::map<std::string,uint64_t> GWEvent::get_map_ticks() const {
+    std::map<std::string,uint64_t> map_ticks;
+    GWEventKeyRegistry& registry = GWEventKeyRegistry::instance();
+    uint8_t i = 0;
+
+    for(i=0; i<this->_nb_inline_ticks; i++)
+        map_ticks.insert({ registry.get_str(this->_inline_ticks[i].key), this->_inline_ticks[i].tick });
+    for(auto& overflow_tick : this->_list_overflow_ticks)
+        map_ticks.insert({ registry.get_str(overflow_tick.key), overflow_tick.tick });
+
+    return map_ticks;
+}
+
+
+void GWEvent::set_metadata(gw_event_key_t key, const nlohmann::json& value){
+    gw_event_metadata_t metadata;
+
+    metadata.key = key;
+    if(value.is_number_unsigned()){
+        metadata.type = gw_event_metadata_t::GW_EVENT_METADATA_UINT;
+        metadata.value.u64 = value.get<uint64_t>();
+    } else if(value.is_number_integer()){
+        metadata.type = gw_event_metadata_t::GW_EVENT_METADATA_INT;
+        metadata.value.i64 = value.get<int64_t>();
+    } else if(value.is_number_float()){
+        metadata.type = gw_event_metadata_t::GW_EVENT_METADATA_DOUBLE;
+        metadata.value.f64 = value.get<double>();
+    } else if(value.is_boolean()){
+        metadata.type = gw_event_metadata_t::GW_EVENT_METADATA_BOOL;
+        metadata.value.b = value.get<bool>();
+    } else {
+        metadata.type = gw_event_metadata_t::GW_EVENT_METADATA_JSON;
+        metadata.value.json_idx = this->_list_metadata_json.size();
+        this->_list_metadata_json.push_back(value);
+    }
+
+    this->__append_metadata(metadata);
+}
+
+
+std::vector<std::pair<std::string, nlohmann::json>> GWEvent::get_map_metadata() const {
+    std::vector<std::pair<std::string, nlohmann::json>> list_metadata;
+    GWEventKeyRegistry& registry = GWEventKeyRegistry::instance();
+    uint8_t i = 0;
+
+    for(i=0; i<this->_nb_inline_metadata; i++){
+        list_metadata.push_back({
+            registry.get_str(this->_inline_metadata[i].key), this->__metadata_to_json(this->_inline_metadata[i])
+        });
+    }
+    for(auto& overflow_metadata : this->_list_overflow_metadata){
+        list_metadata.push_back({
+            registry.get_str(overflow_metadata.key), this->__metadata_to_json(overflow_metadata)
+        });
+    }
+
+    return list_metadata;
+}
+
+
+nlohmann::json GWEvent::__metadata_to_json(const gw_event_metadata_t& metadata) const {
+    switch(metadata.type){
+        case gw_event_metadata_t::GW_EVENT_METADATA_INT:
+            return metadata.value.i64;
+        case gw_event_metadata_t::GW_EVENT_METADATA_UINT:
+            return metadata.value.u64;
+        case gw_event_metadata_t::GW_EVENT_METADATA_DOUBLE:
+            return metadata.value.f64;
+        case gw_event_metadata_t::GW_EVENT_METADATA_BOOL:
+            return metadata.value.b;
+        case gw_event_metadata_t::GW_EVENT_METADATA_JSON:
+            GW_ASSERT(metadata.value.json_idx < this->_list_metadata_json.size());
+            return this->_list_metadata_json[metadata.value.json_idx];
+        default:
+            return nullptr;
+    }
+}
 
 
 nlohmann::json GWEvent::to_json() const {
     nlohmann::json object;
+    std::vector<std::string> list_related_event_global_idx;
+
+    for(auto& related_event_global_id : this->_list_related_event_global_idx)
+        list_related_event_global_idx.push_back(related_event_global_id.str());
 
-    object["name"] = this->name;
+    object["name"] = this->get_name();
     object["id"] = this->id;
-    object["global_id"] = this->global_id;
-    object["list_related_event_global_idx"] = this->_list_related_event_global_idx;
+    object["global_id"] = this->global_id.str();
+    object["list_related_event_global_idx"] = list_related_event_global_idx;
     object["has_parent"] = this->_has_parent;
     object["parent_id"] = this->_parent_id;
     object["type"] = this->type_id;
     object["thread_id"] = this->thread_id;
-    object["ticks"] = this->_map_ticks;
-    object["metadata"] = this->_list_metadata;
+    object["ticks"] = this->get_map_ticks();
+    object["metadata"] = this->get_map_metadata();
 
     return object;
 }
 
 
+gw_retval_t GWEvent::to_compact_json(GWUtilCompactJson::Writer& writer) const {
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    GWEventKeyRegistry& registry = GWEventKeyRegistry::instance();
+    uint8_t i = 0;
+
+    auto __write_metadata = [&](const gw_event_metadata_t& metadata) -> gw_retval_t {
+        gw_retval_t _retval = GW_SUCCESS;
+
+        writer.begin_array(2);
+        writer.write_string(registry.get_str(metadata.key));
+        switch(metadata.type){
+            case gw_event_metadata_t::GW_EVENT_METADATA_INT:
+                writer.write_int(metadata.value.i64);
+                break;
+            case gw_event_metadata_t::GW_EVENT_METADATA_UINT:
+                writer.write_uint(metadata.value.u64);
+                break;
+            case gw_event_metadata_t::GW_EVENT_METADATA_DOUBLE:
+                writer.write_float(metadata.value.f64);
+                break;
+            case gw_event_metadata_t::GW_EVENT_METADATA_BOOL:
+                writer.write_bool(metadata.value.b);
+                break;
+            case gw_event_metadata_t::GW_EVENT_METADATA_JSON:
+                GW_ASSERT(metadata.value.json_idx < this->_list_metadata_json.size());
+                _retval = writer.write_json(this->_list_metadata_json[metadata.value.json_idx]);
+                break;
+            default:
+                writer.write_null();
+        }
+        writer.end();
+
+        return _retval;
+    };
+
+    // NOTE(zhuobin): fields are in the same layout as to_json(), the order of fields within
+    //                an object doesn't matter as the decoder rebuilds json objects
+    writer.begin_object(10);
+
+    writer.key("name");
+    writer.write_string(this->get_name());
+    writer.key("id");
+    writer.write_uint(this->id);
+    writer.key("global_id");
+    writer.write_string(this->global_id.str());
+
+    writer.key("list_related_event_global_idx");
+    writer.begin_array(this->_list_related_event_global_idx.size());
+    for(auto& related_event_global_id : this->_list_related_event_global_idx)
+        writer.write_string(related_event_global_id.str());
+    writer.end();
+
+    writer.key("has_parent");
+    writer.write_bool(this->_has_parent);
+    writer.key("parent_id");
+    writer.write_uint(this->_parent_id);
+    writer.key("type");
+    writer.write_uint(this->type_id);
+    writer.key("thread_id");
+    writer.write_uint(this->thread_id);
+
+    // ticks are unique per key, as later records of a recorded tick are ignored
+    writer.key("ticks");
+    writer.begin_object(this->_nb_inline_ticks + this->_list_overflow_ticks.size());
+    for(i=0; i<this->_nb_inline_ticks; i++){
+        writer.key(registry.get_str(this->_inline_ticks[i].key));
+        writer.write_uint(this->_inline_ticks[i].tick);
+    }
+    for(auto& overflow_tick : this->_list_overflow_ticks){
+        writer.key(registry.get_str(overflow_tick.key));
+        writer.write_uint(overflow_tick.tick);
+    }
+    writer.end();
+
+    writer.key("metadata");
+    writer.begin_array(this->_nb_inline_metadata + this->_list_overflow_metadata.size());
+    for(i=0; i<this->_nb_inline_metadata; i++){
+        if(unlikely((tmp_retval = __write_metadata(this->_inline_metadata[i])) != GW_SUCCESS))
+            retval = tmp_retval;
+    }
+    for(auto& overflow_metadata : this->_list_overflow_metadata){
+        if(unlikely((tmp_retval = __write_metadata(overflow_metadata)) != GW_SUCCESS))
+            retval = tmp_retval;
+    }
+    writer.end();
+
+    writer.end();
+
+    return retval;
+}
+
+
 gw_retval_t GWEvent::from_json(const nlohmann::json& json){
     gw_retval_t retval = GW_SUCCESS;
+    gw_event_global_id_t related_event_global_id;
 
     try {
         if(json.contains("name"))
-            this->name = json["name"];
+            this->name_id = GWEventKeyRegistry::instance().intern(json["name"].get<std::string>());
         
         if(json.contains("id"))
             this->id = json["id"];
 
         if(json.contains("global_id"))
-            this->global_id = json["global_id"];
+            this->global_id.parse(json["global_id"].get<std::string>());
 
         if(json.contains("thread_id"))
             this->thread_id = json["thread_id"];
@@ -51,8 +336,12 @@ gw_retval_t GWEvent::from_json(const nlohmann::json& json){
             this->type_id = json["type"];
         }
 
-        if(json.contains("list_related_event_global_idx"))
-            this->_list_related_event_global_idx = json["list_related_event_global_idx"];
+        if(json.contains("list_related_event_global_idx")){
+            for(auto &it : json["list_related_event_global_idx"]){
+                if(related_event_global_id.parse(it.get<std::string>()) == GW_SUCCESS)
+                    this->_list_related_event_global_idx.push_back(related_event_global_id);
+            }
+        }
 
         if(json.contains("has_parent"))
             this->_has_parent = json["has_parent"];
@@ -62,12 +351,14 @@ gw_retval_t GWEvent::from_json(const nlohmann::json& json){
 
         if(json.contains("ticks")){
             for(auto &it : json["ticks"].items()){
-                this->_map_ticks.insert({it.key(), it.value()});
+                this->record_tick(it.key(), it.value().get<uint64_t>());
             }
         }
 
         if(json.contains("metadata")){
-            this->_list_metadata = json["metadata"];
+            for(auto &it : json["metadata"]){
+                this->set_metadata(it.at(0).get<std::string>(), it.at(1));
+            }
         }
     } catch (const std::exception& e) {
         GW_WARN_C("failed to deserialize the event: %s", e.what());
@@ -88,8 +379,45 @@ GWEventTraceView::~GWEventTraceView(){
 }
 
 
+gw_retval_t gw_event_trace_clock_t::parse_start_time(const std::string& start_time, uint64_t& start_ns){
+    gw_retval_t retval = GW_SUCCESS;
+    std::tm local_tm = {};
+    std::istringstream iss(start_time);
+    std::string micros_str = "";
+    uint64_t micros = 0;
+    time_t seconds = 0;
+
+    iss >> std::get_time(&local_tm, "%Y-%m-%d %H:%M:%S");
+    if(unlikely(iss.fail())){
+        GW_WARN("failed to parse start time: start_time(%s)", start_time.c_str());
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    // fractional part of the second, which is in us
+    if(iss.peek() == '.'){
+        iss.get();
+        iss >> micros_str;
+        micros_str.resize(6, '0');
+        micros = std::strtoull(micros_str.c_str(), nullptr, 10);
+    }
+
+    local_tm.tm_isdst = -1;
+    seconds = std::mktime(&local_tm);
+    if(unlikely(seconds == static_cast<time_t>(-1))){
+        GW_WARN("failed to convert start time: start_time(%s)", start_time.c_str());
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+    start_ns = static_cast<uint64_t>(seconds) * 1000000000ul + micros * 1000ul;
+
+exit:
+    return retval;
+}
+
+
 void GWEventTraceView::load(std::map<uint64_t, std::vector<const GWEvent*>> map_event_trace){
-    this->_map_event_trace = map_event_trace;
+    this->_map_event_trace = std::move(map_event_trace);
     this->__sort_event_trace();
 }
 
@@ -123,50 +451,110 @@ gw_retval_t GWEventTraceView::from_json(const nlohmann::json& json){
 }
 
 
-GWEventTraceView operator+(const GWEventTraceView& lhs, const GWEventTraceView& rhs) {
-    GWEventTraceView result;
+gw_retval_t GWEventTraceView::export_trace(const std::string& path, uint8_t format, double tsc_freq) const {
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    GWEventTraceExporter exporter;
+    uint64_t nb_skipped_events = 0;
 
-    // merge left
-    for (const auto& [key, value] : lhs._map_event_trace) {
-        result._map_event_trace[key] = value;
+    GW_IF_FAILED(
+        exporter.open(path, static_cast<gw_event_trace_export_format_t>(format), tsc_freq),
+        retval,
+        goto exit;
+    );
+
+    for(auto &it : this->_map_event_trace){
+        for(auto &event : it.second){
+            if(unlikely(event == nullptr))
+                continue;
+            if(this->_clock.tsc_freq > 0)
+                tmp_retval = exporter.write_event(event, this->_clock);
+            else
+                tmp_retval = exporter.write_event(event);
+            if(unlikely(tmp_retval != GW_SUCCESS))
+                nb_skipped_events += 1;
+        }
+    }
+    if(unlikely(nb_skipped_events > 0)){
+        GW_WARN_C("skipped events without begin tick while exporting: nb_skipped_events(%lu)", nb_skipped_events);
     }
 
-    // merge right
-    for (const auto& [key, value] : rhs._map_event_trace) {
-        if (result._map_event_trace.find(key) != result._map_event_trace.end()) {
-            result._map_event_trace[key].insert(result._map_event_trace[key].end(), value.begin(), value.end());
+    retval = exporter.close();
+
+exit:
+    return retval;
+}
+
+
+GWEventTraceView operator+(const GWEventTraceView& lhs, const GWEventTraceView& rhs) {
+    GWEventTraceView result;
+    typename std::map<uint64_t, std::vector<const GWEvent*>>::const_iterator lhs_it, rhs_it;
+    typename std::map<uint64_t, std::vector<const GWEvent*>>::iterator result_it;
+
+    result._clock = lhs._clock;
+    result_it = result._map_event_trace.end();
+
+    // both views are sorted per thread, so threads are merged as sorted runs
+    lhs_it = lhs._map_event_trace.begin();
+    rhs_it = rhs._map_event_trace.begin();
+    while(lhs_it != lhs._map_event_trace.end() or rhs_it != rhs._map_event_trace.end()){
+        if(rhs_it == rhs._map_event_trace.end() or (lhs_it != lhs._map_event_trace.end() and lhs_it->first < rhs_it->first)){
+            result_it = result._map_event_trace.emplace_hint(result._map_event_trace.end(), lhs_it->first, lhs_it->second);
+            lhs_it++;
+        } else if(lhs_it == lhs._map_event_trace.end() or rhs_it->first < lhs_it->first){
+            result_it = result._map_event_trace.emplace_hint(result._map_event_trace.end(), rhs_it->first, rhs_it->second);
+            rhs_it++;
         } else {
-            result._map_event_trace[key] = value;
+            result_it = result._map_event_trace.emplace_hint(result._map_event_trace.end(), lhs_it->first, std::vector<const GWEvent*>());
+            result_it->second.reserve(lhs_it->second.size() + rhs_it->second.size());
+            std::merge(
+                lhs_it->second.begin(), lhs_it->second.end(),
+                rhs_it->second.begin(), rhs_it->second.end(),
+                std::back_inserter(result_it->second),
+                GWEventTraceView::__compare_event_tick
+            );
+            lhs_it++;
+            rhs_it++;
         }
     }
 
-    // sort the result
-    result.__sort_event_trace();
-
     return result;
 }
 
 
 void GWEventTraceView::__sort_event_trace(){
-    auto __sort_event = [](const GWEvent* a, const GWEvent* b) -> bool {
-        std::map<std::string,uint64_t> map_ticks_a, map_ticks_b;
-        if(a == nullptr || b == nullptr) return false;
-        return  a->get_map_ticks()["begin"] < b->get_map_ticks()["begin"];
-    };
     for(auto &it : this->_map_event_trace){
-        std::sort(it.second.begin(), it.second.end(), __sort_event);
+        // events are mostly recorded in order, so sorting is usually unnecessary
+        if(std::is_sorted(it.second.begin(), it.second.end(), GWEventTraceView::__compare_event_tick))
+            continue;
+        std::stable_sort(it.second.begin(), it.second.end(), GWEventTraceView::__compare_event_tick);
     }
 }
 
 
-GWEventTrace::GWEventTrace(volatile bool do_exit) : _do_exit(do_exit) {
-    this->_event_queue = new GWUtilsLockFreeQueue<GWEvent*>(
-        [](GWEvent *event) -> gw_retval_t {
-            if(event != nullptr) delete event;
-            return GW_SUCCESS;
-        }
-    );
-    GW_CHECK_POINTER(this->_event_queue);
+bool GWEventTraceView::__compare_event_tick(const GWEvent* a, const GWEvent* b){
+    uint64_t tick_a = 0, tick_b = 0;
+    if(a == nullptr || b == nullptr) return false;
+    a->get_tick(GW_EVENT_KEY_TICK_BEGIN, tick_a);
+    b->get_tick(GW_EVENT_KEY_TICK_BEGIN, tick_b);
+    return tick_a < tick_b;
+}
+
+
+GWEventTrace::GWEventTrace(
+    volatile bool do_exit, uint64_t capacity, gw_utils_queue_overflow_policy_t policy, uint64_t sample_rate
+)   :   _do_exit(do_exit),
+        _pending_policy(policy),
+        _pending_sample_rate(std::max<uint64_t>(sample_rate, 1)),
+        _q_archived_events(
+            capacity, policy, sample_rate,
+            [this](GWEvent* event){
+                // dropped (or remaining) archived events are no longer tracked by the trace
+                this->_nb_tracked_events.fetch_sub(1, std::memory_order_acq_rel);
+                return GW_SUCCESS;
+            }
+        )
+{
+    this->_pending_stat.capacity = std::max<uint64_t>(capacity, 1);
 }
 
 
@@ -176,26 +564,42 @@ GWEventTrace::~GWEventTrace()
 
 gw_retval_t GWEventTrace::push_event(GWEvent* event){
     gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
-    GWUtilsLockFreeQueue<GWEvent*> *new_queue;
     GWEvent *parent_event = nullptr;
+    bool is_archived = false;
 
     GW_CHECK_POINTER(event);
 
-    // make sure the queue exist
-    GW_CHECK_POINTER(this->_event_queue);
-
     // set id and global id of the event
     event->id = this->_current_event_id;
     this->_current_event_id += 1;
 
-    // event global index: <trace_name>-<type_name>-<thread_id>--<id>
-    event->global_id =  this->_name 
-                        + "-" + GWEvent::typeid_to_string(event->type_id)
-                        + "-" + std::to_string(event->thread_id)
-                        + "-" + std::to_string(event->id);
-
-    // push to event trace
-    this->_event_queue->push(event);
+    // event global index: <trace_name>-<type_name>-<thread_id>-<id>, formatted when serializing
+    event->global_id.trace_name_id = this->_name_id;
+    event->global_id.type_id = event->type_id;
+    event->global_id.thread_id = event->thread_id;
+    event->global_id.id = event->id;
+    event->global_id.is_valid = true;
+
+    // track the event until it's archived, an event archived before being pushed
+    // is ready for reporting immediately
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex_completion);
+        event->_event_trace.store(this, std::memory_order_seq_cst);
+        if(event->_is_archived.load(std::memory_order_seq_cst)){
+            is_archived = true;
+        } else if(this->__admit_pending_event()){
+            this->_map_pending_events.insert({ event->id, event });
+            this->_nb_tracked_events.fetch_add(1, std::memory_order_acq_rel);
+        } else {
+            // dropped by the overflow policy, a later archive of the event is ignored
+            event->_event_trace.store(nullptr, std::memory_order_seq_cst);
+        }
+    }
+    if(is_archived){
+        this->_nb_tracked_events.fetch_add(1, std::memory_order_acq_rel);
+        if(this->_q_archived_events.push(event) == GW_SUCCESS)
+            this->__signal_completion();
+    }
 
     // try set parent event (if exist)
     tmp_retval = this->get_latest_parent_event(parent_event, event->type_id, event->thread_id);
@@ -208,8 +612,121 @@ gw_retval_t GWEventTrace::push_event(GWEvent* event){
 }
 
 
-gw_retval_t GWEventTrace::pop_event(GWEvent*& event){
-    return this->_event_queue->dequeue(event);
+gw_retval_t GWEventTrace::pop_archived_events(std::vector<GWEvent*>& list_events){
+    gw_retval_t retval = GW_SUCCESS;
+    GWEvent *event = nullptr;
+    uint64_t nb_popped = 0;
+
+    while(this->_q_archived_events.dequeue(event) == GW_SUCCESS){
+        list_events.push_back(event);
+        nb_popped += 1;
+    }
+
+    if(nb_popped == 0){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+    this->_nb_tracked_events.fetch_sub(nb_popped, std::memory_order_acq_rel);
+
+exit:
+    return retval;
+}
+
+
+uint64_t GWEventTrace::archive_pending_events(gw_event_typeid_t type_id, std::function<void(GWEvent*)> callback){
+    std::vector<GWEvent*> list_events;
+
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex_completion);
+        for(auto& it : this->_map_pending_events){
+            if(it.second->type_id == type_id)
+                list_events.push_back(it.second);
+        }
+    }
+
+    for(GWEvent* event : list_events){
+        callback(event);
+        event->archive();
+    }
+
+    return list_events.size();
+}
+
+
+void GWEventTrace::__notify_archived(GWEvent* event){
+    bool is_pending = false;
+    std::map<uint64_t, GWEvent*>::iterator it;
+
+    // NOTE(zhuobin): the trace of an exited thread is released by the reporter once no
+    //                event is tracked, so hold it until the event is handed to the reporter;
+    //                the archived queue is pushed outside the lock, as it could block on
+    //                GW_UTILS_QUEUE_OVERFLOW_BLOCK until the reporter drains
+    this->_nb_tracked_events.fetch_add(1, std::memory_order_acq_rel);
+
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex_completion);
+        it = this->_map_pending_events.find(event->id);
+        if(it != this->_map_pending_events.end() and it->second == event){
+            this->_map_pending_events.erase(it);
+            is_pending = true;
+        }
+    }
+
+    if(is_pending and this->_q_archived_events.push(event) == GW_SUCCESS)
+        this->__signal_completion();
+
+    // must be the last access to the trace
+    this->_nb_tracked_events.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+
+bool GWEventTrace::__admit_pending_event(){
+    bool is_admitted = true;
+    uint64_t nb_pending = this->_map_pending_events.size();
+    GWEvent *evicted = nullptr;
+
+    // sampling kicks in once pending events are under pressure
+    if(this->_pending_policy == GW_UTILS_QUEUE_OVERFLOW_SAMPLE and nb_pending >= (this->_pending_stat.capacity >> 1)){
+        if(this->_pending_sample_counter++ % this->_pending_sample_rate != 0){
+            is_admitted = false;
+            goto exit;
+        }
+    }
+
+    if(nb_pending >= this->_pending_stat.capacity){
+        if(this->_pending_policy == GW_UTILS_QUEUE_OVERFLOW_DROP_OLDEST){
+            // the evicted event is detached from the trace, so its archive is ignored
+            evicted = this->_map_pending_events.begin()->second;
+            evicted->_event_trace.store(nullptr, std::memory_order_seq_cst);
+            this->_map_pending_events.erase(this->_map_pending_events.begin());
+            this->_nb_tracked_events.fetch_sub(1, std::memory_order_acq_rel);
+            this->_pending_stat.nb_dropped += 1;
+            nb_pending -= 1;
+        } else {
+            // NOTE(zhuobin): GW_UTILS_QUEUE_OVERFLOW_BLOCK drops as well, as pending events are
+            //                mostly archived by the very thread which pushes them, waiting here
+            //                would never return
+            is_admitted = false;
+            goto exit;
+        }
+    }
+
+    this->_pending_stat.nb_enqueued += 1;
+    this->_pending_stat.high_water = std::max(this->_pending_stat.high_water, nb_pending + 1);
+
+exit:
+    if(!is_admitted)
+        this->_pending_stat.nb_dropped += 1;
+    return is_admitted;
+}
+
+
+void GWEventTrace::__signal_completion(){
+    // NOTE(zhuobin): waking a single waiter is enough even if the signal is shared
+    //                by several reporters, as any of them could drain any trace
+    this->_completion_signal->seq.fetch_add(1, std::memory_order_seq_cst);
+    if(this->_completion_signal->nb_waiters.load(std::memory_order_seq_cst) > 0)
+        GWUtilFutex::wake(this->_completion_signal->seq, 1);
 }
 
 
@@ -291,5 +808,5 @@ exit:
 
 
 bool GWEventTrace::is_event_trace_empty(){
-    return this->_event_queue->len() == 0;
+    return this->_nb_tracked_events.load(std::memory_order_acquire) == 0;
 }
@@ -7,6 +7,12 @@
 #include <stack>
 #include <map>
 #include <any>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <unordered_set>
+#include <atomic>
+#include <functional>
 
 #include "nlohmann/json.hpp"
 
@@ -14,6 +20,8 @@
 #include "common/log.hpp"
 #include "common/utils/timer.hpp"
 #include "common/utils/lockfree_queue.hpp"
+#include "common/utils/mpsc_queue.hpp"
+#include "common/utils/compact_json.hpp"
 
 
 enum gw_event_typeid_t : uint32_t {
@@ -45,20 +53,149 @@ constexpr bool gw_event_is_gwatch(gw_event_typeid_t id) {
 }
 
 
+// forward declaration
+class GWEventTrace;
+
+
+// interned id of strings within events (e.g., event name, tick name, metadata key)
+using gw_event_key_t = uint32_t;
+
+
+/*!
+ *  \brief  builtin interned keys, which are registered before any other key
+ */
+enum gw_event_key_builtin_t : gw_event_key_t {
+    GW_EVENT_KEY_UNKNOWN = 0,
+    GW_EVENT_KEY_TICK_BEGIN,
+    GW_EVENT_KEY_TICK_END,
+};
+
+
+/*!
+ *  \brief  process-wide registry interning strings used by events, so that events
+ *          only carry fixed-size ids on the hot path
+ */
+class GWEventKeyRegistry {
+ public:
+    /*!
+     *  \brief  obtain the singleton registry
+     *  \return the registry
+     */
+    static GWEventKeyRegistry& instance(){
+        static GWEventKeyRegistry registry;
+        return registry;
+    }
+
+
+    /*!
+     *  \brief  intern a string
+     *  \param  str the string to be interned
+     *  \return interned id of the string
+     */
+    gw_event_key_t intern(const std::string& str);
+
+
+    /*!
+     *  \brief  obtain the string of an interned id
+     *  \param  key interned id
+     *  \return the string, "unknown" for unregistered id
+     */
+    const std::string& get_str(gw_event_key_t key);
+
+
+ private:
+    GWEventKeyRegistry();
+
+    std::shared_mutex _mutex;
+
+    // <string, key>
+    std::unordered_map<std::string, gw_event_key_t> _map_str_key;
+
+    // strings indexed by key, deque keeps references stable while growing
+    std::deque<std::string> _list_str;
+};
+
+
+/*!
+ *  \brief  compact global id of an event (across the world), whose string form
+ *          is <trace_name>-<type_name>-<thread_id>-<id>
+ */
+typedef struct gw_event_global_id {
+    gw_event_key_t trace_name_id = GW_EVENT_KEY_UNKNOWN;
+    gw_event_typeid_t type_id = GW_EVENT_TYPE_UNKNOWN;
+    uint64_t thread_id = 0;
+    uint64_t id = 0;
+    bool is_valid = false;
+
+    /*!
+     *  \brief  obtain the string form of the global id
+     *  \return string form, empty if the global id isn't assigned
+     */
+    std::string str() const;
+
+    /*!
+     *  \brief  parse the string form of the global id
+     *  \param  global_id_str   string form of the global id
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed string
+     */
+    gw_retval_t parse(const std::string& global_id_str);
+} gw_event_global_id_t;
+
+
+/*!
+ *  \brief  tick of an event
+ */
+typedef struct gw_event_tick {
+    gw_event_key_t key;
+    uint64_t tick;
+} gw_event_tick_t;
+
+
+/*!
+ *  \brief  metadata of an event, scalar values are stored inline,
+ *          other values are stored as json aside
+ */
+typedef struct gw_event_metadata {
+    enum gw_event_metadata_type_t : uint8_t {
+        GW_EVENT_METADATA_INT = 0,
+        GW_EVENT_METADATA_UINT,
+        GW_EVENT_METADATA_DOUBLE,
+        GW_EVENT_METADATA_BOOL,
+        GW_EVENT_METADATA_JSON
+    };
+
+    gw_event_key_t key;
+    gw_event_metadata_type_t type;
+    union {
+        int64_t i64;
+        uint64_t u64;
+        double f64;
+        bool b;
+        // index within the list of json values
+        uint64_t json_idx;
+    } value;
+} gw_event_metadata_t;
+
+
+// number of ticks / metadata stored inline within the event before spilling to heap
+#define GW_EVENT_NB_INLINE_TICKS        4
+#define GW_EVENT_NB_INLINE_METADATA     4
+
+
 /*!
  *  \brief  represent an event occurs during execution
  */
 class GWEvent {
     /* ======================== common ======================== */
  public:
-    // name of the event
-    std::string name = "unknown";
+    // interned name of the event
+    gw_event_key_t name_id = GW_EVENT_KEY_UNKNOWN;
 
     // id of the event
     uint64_t id = 0;
 
     // global id of the event (across the world)
-    std::string global_id = "";
+    gw_event_global_id_t global_id;
 
     // thread id of the event
     uint64_t thread_id = 0;
@@ -69,8 +206,16 @@ class GWEvent {
 
     /*!
      *  \brief  constructor
+     *  \param  name_   name of the event
+     */
+    GWEvent(const std::string& name_="unknown") : name_id(GWEventKeyRegistry::instance().intern(name_)){};
+
+
+    /*!
+     *  \brief  constructor
+     *  \param  name_id_    interned name of the event
      */
-    GWEvent(std::string name_="unknown") : name(name_){};
+    GWEvent(gw_event_key_t name_id_) : name_id(name_id_){};
 
 
     /*!
@@ -80,9 +225,18 @@ class GWEvent {
 
 
     /*!
-     *  \brief  mark the event as archived
+     *  \brief  obtain the name of the event
+     *  \return name of the event
      */
-    inline void archive() { this->_is_archived = true; }
+    inline const std::string& get_name() const {
+        return GWEventKeyRegistry::instance().get_str(this->name_id);
+    }
+
+
+    /*!
+     *  \brief  mark the event as archived, and notify the event trace it's pushed to
+     */
+    void archive();
 
 
     /*!
@@ -130,29 +284,77 @@ class GWEvent {
     }
 
 
+    /*!
+     *  \brief  convert string to event type id
+     *  \param  str string representation of the event type id
+     *  \return event type id
+     */
+    static gw_event_typeid_t string_to_typeid(const std::string& str){
+        if(str == "cpu") return GW_EVENT_TYPE_CPU;
+        if(str == "gpu") return GW_EVENT_TYPE_GPU;
+        if(str == "app") return GW_EVENT_TYPE_APP;
+        if(str == "gwatch") return GW_EVENT_TYPE_GWATCH;
+        return GW_EVENT_TYPE_UNKNOWN;
+    }
+
+
  protected:
     friend class GWCapsule;
+    friend class GWEventTrace;
+    friend class GWEventTraceExporter;
 
     // related events
-    std::vector<std::string> _list_related_event_global_idx;
+    std::vector<gw_event_global_id_t> _list_related_event_global_idx;
 
     // id of the parent event (within the same event trace)
     bool _has_parent = false;
     uint64_t _parent_id = 0;
 
     // mark whether the event is archived
-    volatile bool _is_archived = false;
+    std::atomic<bool> _is_archived = false;
+
+    // event trace which the event is pushed to
+    std::atomic<GWEventTrace*> _event_trace = nullptr;
     /* ======================== common ======================== */
 
 
     /* ======================== tick management ======================== */
  public:
+    /*!
+     *  \brief  record the tick of the event
+     *  \note   the first record of a tick wins, later records of the same tick are ignored
+     *  \param  tick_key        interned name of the tick
+     *  \param  customized_tick customized tick
+     */
+    inline void record_tick(gw_event_key_t tick_key, uint64_t customized_tick){
+        uint64_t tmp_tick = 0;
+
+        if(unlikely(this->get_tick(tick_key, tmp_tick)))
+            return;
+        if(likely(this->_nb_inline_ticks < GW_EVENT_NB_INLINE_TICKS)){
+            this->_inline_ticks[this->_nb_inline_ticks] = { tick_key, customized_tick };
+            this->_nb_inline_ticks += 1;
+        } else {
+            this->_list_overflow_ticks.push_back({ tick_key, customized_tick });
+        }
+    }
+
+
+    /*!
+     *  \brief  record the tick of the event
+     *  \param  tick_key    interned name of the tick
+     */
+    inline void record_tick(gw_event_key_t tick_key){
+        this->record_tick(tick_key, GWUtilTscTimer::get_tsc());
+    }
+
+
     /*!
      *  \brief  record the tick of the event
      *  \param  tick_name name of the tick
      */
-    inline void record_tick(std::string tick_name){
-        this->_map_ticks.insert({tick_name, GWUtilTscTimer::get_tsc()});
+    inline void record_tick(const std::string& tick_name){
+        this->record_tick(GWEventKeyRegistry::instance().intern(tick_name), GWUtilTscTimer::get_tsc());
     }
 
 
@@ -161,48 +363,109 @@ class GWEvent {
      *  \param  tick_name       name of the tick
      *  \param  customized_tick customized tick
      */
-    inline void record_tick(std::string tick_name, uint64_t customized_tick){
-        this->_map_ticks.insert({tick_name, customized_tick});
+    inline void record_tick(const std::string& tick_name, uint64_t customized_tick){
+        this->record_tick(GWEventKeyRegistry::instance().intern(tick_name), customized_tick);
+    }
+
+
+    /*!
+     *  \brief  obtain a tick of the event
+     *  \param  tick_key    interned name of the tick
+     *  \param  tick        the obtained tick
+     *  \return whether the tick is recorded
+     */
+    inline bool get_tick(gw_event_key_t tick_key, uint64_t& tick) const {
+        uint8_t i = 0;
+        for(i=0; i<this->_nb_inline_ticks; i++){
+            if(this->_inline_ticks[i].key == tick_key){
+                tick = this->_inline_ticks[i].tick;
+                return true;
+            }
+        }
+        for(auto& overflow_tick : this->_list_overflow_ticks){
+            if(overflow_tick.key == tick_key){
+                tick = overflow_tick.tick;
+                return true;
+            }
+        }
+        return false;
     }
 
 
     /*!
      *  \brief  get the map of ticks of the event
+     *  \note   this is a boundary conversion, hot path should use get_tick
      *  \return map of ticks of the event
      */
-    inline std::map<std::string,uint64_t> get_map_ticks() const { return this->_map_ticks; }
+    std::map<std::string,uint64_t> get_map_ticks() const;
 
 
  protected:
-    // map of ticks of the event
-    std::map<std::string, uint64_t> _map_ticks;
+    // ticks of the event
+    gw_event_tick_t _inline_ticks[GW_EVENT_NB_INLINE_TICKS];
+    uint8_t _nb_inline_ticks = 0;
+    std::vector<gw_event_tick_t> _list_overflow_ticks;
     /* ======================== tick management ======================== */
 
 
     /* ======================== metadata management ======================== */
  public:
+    /*!
+     *  \brief  record the metadata of the event
+     *  \note   scalar values are stored inline without heap allocation
+     *  \param  key   interned key of the metadata
+     *  \param  value value of the metadata
+     */
+    void set_metadata(gw_event_key_t key, const nlohmann::json& value);
+
+
     /*!
      *  \brief  record the metadata of the event
      *  \param  key   key of the metadata
      *  \param  value value of the metadata
      */
-    inline void set_metadata(std::string key, nlohmann::json value){
-        this->_list_metadata.push_back({key, value});
+    inline void set_metadata(const std::string& key, const nlohmann::json& value){
+        this->set_metadata(GWEventKeyRegistry::instance().intern(key), value);
     }
 
 
     /*!
      *  \brief  get the map of metadata of the event
+     *  \note   this is a boundary conversion
      *  \return map of metadata of the event
      */
-    inline std::vector<std::pair<std::string, nlohmann::json>> get_map_metadata() const { 
-        return this->_list_metadata;
-    }
+    std::vector<std::pair<std::string, nlohmann::json>> get_map_metadata() const;
 
 
  protected:
-    // list of metadata of the event
-    std::vector<std::pair<std::string, nlohmann::json>> _list_metadata;
+    /*!
+     *  \brief  append a metadata to inline slots, or to heap once inline slots are full
+     *  \param  metadata    the metadata to be appended
+     */
+    inline void __append_metadata(const gw_event_metadata_t& metadata){
+        if(likely(this->_nb_inline_metadata < GW_EVENT_NB_INLINE_METADATA)){
+            this->_inline_metadata[this->_nb_inline_metadata] = metadata;
+            this->_nb_inline_metadata += 1;
+        } else {
+            this->_list_overflow_metadata.push_back(metadata);
+        }
+    }
+
+
+    /*!
+     *  \brief  convert a metadata to json
+     *  \param  metadata    the metadata to be converted
+     *  \return json value of the metadata
+     */
+    nlohmann::json __metadata_to_json(const gw_event_metadata_t& metadata) const;
+
+    // metadata of the event, in the order of recording
+    gw_event_metadata_t _inline_metadata[GW_EVENT_NB_INLINE_METADATA];
+    uint8_t _nb_inline_metadata = 0;
+    std::vector<gw_event_metadata_t> _list_overflow_metadata;
+
+    // non-scalar values of metadata
+    std::vector<nlohmann::json> _list_metadata_json;
     /* ======================== metadata management ======================== */
 
 
@@ -215,6 +478,15 @@ class GWEvent {
     nlohmann::json to_json() const;
 
 
+    /*!
+     *  \brief  serialize the event into a compact json stream, which decodes to the same
+     *          json value as to_json() without building it on the reporting path
+     *  \param  writer  the compact json stream
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if the metadata contains binary
+     */
+    gw_retval_t to_compact_json(GWUtilCompactJson::Writer& writer) const;
+
+
     /*!
      *  \brief  deserialize the event
      *  \param  json  serialized string
@@ -225,8 +497,51 @@ class GWEvent {
 };
 
 
+/*!
+ *  \brief  clock domain of the ticks within events, which aligns ticks from different
+ *          capsules onto a common timeline (ns since epoch)
+ *  \note   tsc_freq comes from mgnt_cpu of the node, start_tsc / start_time come from
+ *          mgnt_capsule, which were sampled at the same moment when the capsule started
+ */
+typedef struct gw_event_trace_clock {
+    // frequency of ticks (Hz), 0 if ticks are already timestamps (ns)
+    double tsc_freq = 0;
+
+    // tick at which the capsule started
+    uint64_t start_tsc = 0;
+
+    // wall-clock timestamp (ns since epoch) at start_tsc
+    uint64_t start_ns = 0;
+
+    /*!
+     *  \brief  convert a tick within events to timestamp (ns since epoch)
+     *  \param  tick    the tick
+     *  \return the timestamp
+     */
+    inline uint64_t tick_to_ns(uint64_t tick) const {
+        double offset_ns = 0;
+        if(this->tsc_freq <= 0)
+            return tick;
+        // NOTE(zhuobin): ticks could be sampled slightly before start_tsc, so the offset is signed
+        offset_ns = static_cast<double>(static_cast<int64_t>(tick - this->start_tsc)) * 1e9 / this->tsc_freq;
+        return static_cast<uint64_t>(static_cast<int64_t>(this->start_ns) + static_cast<int64_t>(offset_ns));
+    }
+
+    /*!
+     *  \brief  parse the start time of the capsule (e.g., "2025-01-01 12:00:00.000001" in local
+     *          time, as recorded by GWUtilTscTimer::get_time_and_tsc) to ns since epoch
+     *  \param  start_time  the start time
+     *  \param  start_ns    the parsed timestamp
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed start time
+     */
+    static gw_retval_t parse_start_time(const std::string& start_time, uint64_t& start_ns);
+} gw_event_trace_clock_t;
+
+
 /*!
  *  \brief  view of a specific collections of events
+ *  \note   events of each thread are kept sorted by their begin tick, so that each thread
+ *          is a sorted run which could be merged without re-sorting
  */
 class GWEventTraceView {
  public:
@@ -244,11 +559,18 @@ class GWEventTraceView {
 
     /*!
      *  \brief  load the event trace view
-     *  \param  map_event_trace  map of event trace
+     *  \param  map_event_trace  map of event trace, moved into the view
      */
     void load(std::map<uint64_t, std::vector<const GWEvent*>> map_event_trace);
 
 
+    /*!
+     *  \brief  set the clock domain of ticks within the events
+     *  \param  clock   the clock domain
+     */
+    inline void set_clock(const gw_event_trace_clock_t& clock){ this->_clock = clock; }
+
+
     /*!
      *  \brief  serialize the event trace view
      *  \return serialized string
@@ -265,7 +587,22 @@ class GWEventTraceView {
 
 
     /*!
-     *  \brief  merge two event trace views
+     *  \brief  export the event trace view to a trace file, events are streamed to the
+     *          file one at a time instead of being materialized as json
+     *  \param  path        path to the trace file
+     *  \param  format      format of the trace file (see gw_event_trace_export_format_t)
+     *  \param  tsc_freq    frequency of ticks within events (Hz), 0 for the TSC frequency
+     *                      measured on current node, ignored if the clock domain is set
+     *  \return GW_SUCCESS if success, otherwise the error of the exporter
+     */
+    gw_retval_t export_trace(const std::string& path, uint8_t format, double tsc_freq = 0) const;
+
+
+    /*!
+     *  \brief  merge two event trace views, threads existing in both views are merged
+     *          as sorted runs in linear time
+     *  \note   the merged view takes the clock domain of lhs, use GWEventTraceMerger to
+     *          merge views from different clock domains
      *  \param  lhs  left hand side operand
      *  \param  rhs  right hand side operand
      *  \return merged event trace view
@@ -273,19 +610,49 @@ class GWEventTraceView {
     friend GWEventTraceView operator+(const GWEventTraceView& lhs, const GWEventTraceView& rhs);
 
 
+    // getters
+    inline const gw_event_trace_clock_t& get_clock() const { return this->_clock; }
+    inline const std::map<uint64_t, std::vector<const GWEvent*>>& get_map_event_trace() const {
+        return this->_map_event_trace;
+    }
+
+
  protected:
     // view of the event trace
     std::map<uint64_t, std::vector<const GWEvent*>> _map_event_trace;
 
+    // clock domain of ticks within the events
+    gw_event_trace_clock_t _clock;
+
 
  private:
     /*!
-     *  \brief  sort the event trace
+     *  \brief  sort the event trace, threads which are already sorted are skipped
      */
     void __sort_event_trace();
+
+
+    /*!
+     *  \brief  compare events by their begin tick, events without begin tick go first
+     */
+    static bool __compare_event_tick(const GWEvent* a, const GWEvent* b);
 };
 
 
+// default capacity of pending events and of archived events within an event trace
+#define GW_EVENT_TRACE_DEFAULT_QUEUE_LEN    65536
+
+
+/*!
+ *  \brief  futex word signalled whenever an event is archived, could be shared by
+ *          multiple event traces so that a reporter sleeps on all of them at once
+ */
+typedef struct gw_event_completion_signal {
+    std::atomic<uint32_t> seq = 0;
+    std::atomic<uint32_t> nb_waiters = 0;
+} gw_event_completion_signal_t;
+
+
 /*!
  *  \brief  a trace of events, managing event hierarchy and sequence
  */
@@ -293,9 +660,17 @@ class GWEventTrace {
  public:
     /*!
      *  \brief  constructor
-     *  \param  do_exit  whether to exit the event trace when upstream deconstructor be called
+     *  \param  do_exit      whether to exit the event trace when upstream deconstructor be called
+     *  \param  capacity     capacity of pending events and of archived events respectively
+     *  \param  policy       policy once pending / archived events are overflowed
+     *  \param  sample_rate  N of the 1-in-N sampling, only used by GW_UTILS_QUEUE_OVERFLOW_SAMPLE
      */
-    GWEventTrace(volatile bool do_exit);
+    GWEventTrace(
+        volatile bool do_exit,
+        uint64_t capacity = GW_EVENT_TRACE_DEFAULT_QUEUE_LEN,
+        gw_utils_queue_overflow_policy_t policy = GW_UTILS_QUEUE_OVERFLOW_DROP_NEWEST,
+        uint64_t sample_rate = GW_UTILS_MPSC_QUEUE_DEFAULT_SAMPLE_RATE
+    );
 
 
     /*!
@@ -310,6 +685,18 @@ class GWEventTrace {
      */
     inline void set_name(std::string name){
         this->_name = name;
+        this->_name_id = GWEventKeyRegistry::instance().intern(name);
+    }
+
+
+    /*!
+     *  \brief  signal the given completion signal instead of the one owned by the trace
+     *  \note   should be called before any event is pushed into the trace
+     *  \param  completion_signal  the shared completion signal
+     */
+    inline void bind_completion_signal(gw_event_completion_signal_t* completion_signal){
+        GW_CHECK_POINTER(completion_signal);
+        this->_completion_signal = completion_signal;
     }
 
 
@@ -323,12 +710,45 @@ class GWEventTrace {
     
 
     /*!
-     *  \brief  pop an event from the trace
-     *  \param  event      the event be poped
-     *  \param  thread_id  thread id from which the event be poped
-     *  \return GW_SUCCESS if success, otherwise GW_FAILED
+     *  \brief  pop archived events from the trace, in the order of completion
+     *  \param  list_events    the popped events, appended to the list
+     *  \return GW_SUCCESS if any event is popped, GW_FAILED_NOT_READY if none is archived
      */
-    gw_retval_t pop_event(GWEvent*& event);
+    gw_retval_t pop_archived_events(std::vector<GWEvent*>& list_events);
+
+
+    /*!
+     *  \brief  archive all pending events of the given type, used for ending events
+     *          which would never complete (e.g., GPU events after a sticky error)
+     *  \param  type_id     type of the events
+     *  \param  callback    callback applied to each event before it's archived
+     *  \return number of archived events
+     */
+    uint64_t archive_pending_events(gw_event_typeid_t type_id, std::function<void(GWEvent*)> callback);
+
+
+    /*!
+     *  \brief  obtain the number of pushed events which haven't been archived
+     *  \return number of pending events
+     */
+    inline uint64_t get_nb_pending_events(){
+        std::lock_guard<std::mutex> lock(this->_mutex_completion);
+        return this->_map_pending_events.size();
+    }
+
+
+    /*!
+     *  \brief  obtain statistics of pending events and of archived events
+     *  \param  pending_stat    statistics of pending events
+     *  \param  archived_stat   statistics of archived events
+     */
+    inline void get_stat(gw_utils_queue_stat_t& pending_stat, gw_utils_queue_stat_t& archived_stat){
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex_completion);
+            pending_stat = this->_pending_stat;
+        }
+        archived_stat = this->_q_archived_events.get_stat();
+    }
 
 
     /*!
@@ -369,14 +789,53 @@ class GWEventTrace {
 
 
  private:
+    friend class GWEvent;
+
+    /*!
+     *  \brief  move a pending event to the queue of archived events, and wake the reporter
+     *  \param  event   the archived event
+     */
+    void __notify_archived(GWEvent* event);
+
+
+    /*!
+     *  \brief  apply the overflow policy before tracking a new pending event,
+     *          should be called with _mutex_completion held
+     *  \return true if the event could be tracked, false if it's dropped
+     */
+    bool __admit_pending_event();
+
+
+    /*!
+     *  \brief  bump the completion sequence and wake a sleeping reporter (if any)
+     */
+    void __signal_completion();
+
     // name of the event trace
     std::string _name = "";
+    gw_event_key_t _name_id = GW_EVENT_KEY_UNKNOWN;
 
     // whether to exit the event trace when upstream deconstructor be called
     volatile bool _do_exit = false;
 
-    // event trace queue
-    GWUtilsLockFreeQueue<GWEvent*>* _event_queue = nullptr;
+    // pushed events which haven't been archived, keyed by event id so that the oldest one could be evicted
+    std::mutex _mutex_completion;
+    std::map<uint64_t, GWEvent*> _map_pending_events;
+    gw_utils_queue_overflow_policy_t _pending_policy;
+    uint64_t _pending_sample_rate = 1;
+    uint64_t _pending_sample_counter = 0;
+    gw_utils_queue_stat_t _pending_stat;
+
+    // number of events which are pending, being archived or archived but not popped yet,
+    // the trace is empty (hence could be released) only if it reaches zero
+    std::atomic<uint64_t> _nb_tracked_events = 0;
+
+    // archived events in the order of completion
+    GWUtilsMPSCQueue<GWEvent*> _q_archived_events;
+
+    // futex word for waking the reporter on completion, either owned or shared
+    gw_event_completion_signal_t _own_completion_signal;
+    gw_event_completion_signal_t *_completion_signal = &_own_completion_signal;
 
     // per-type per-thread parent event stack
     std::map<gw_event_typeid_t, std::map<uint64_t, std::stack<GWEvent*>>> _map_parent_events = {};
@@ -0,0 +1,570 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <fstream>
+#include <cstring>
+#include <format>
+
+#include "nlohmann/json.hpp"
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/bytes.hpp"
+#include "common/utils/timer.hpp"
+#include "capsule/event.hpp"
+#include "capsule/event_exporter.hpp"
+
+
+/* ==================== Perfetto Proto Fields ==================== */
+// Trace
+#define GW_PB_TRACE_PACKET                          1
+
+// TracePacket
+#define GW_PB_PACKET_TIMESTAMP                      8
+#define GW_PB_PACKET_TRUSTED_SEQUENCE_ID            10
+#define GW_PB_PACKET_TRACK_EVENT                    11
+#define GW_PB_PACKET_SEQUENCE_FLAGS                 13
+#define GW_PB_PACKET_TRACK_DESCRIPTOR               60
+#define GW_PB_SEQ_INCREMENTAL_STATE_CLEARED         1
+
+// TrackDescriptor / ProcessDescriptor / ThreadDescriptor
+#define GW_PB_TRACK_UUID                            1
+#define GW_PB_TRACK_NAME                            2
+#define GW_PB_TRACK_PROCESS                         3
+#define GW_PB_TRACK_THREAD                          4
+#define GW_PB_TRACK_PARENT_UUID                     5
+#define GW_PB_PROCESS_PID                           1
+#define GW_PB_PROCESS_NAME                          6
+#define GW_PB_THREAD_PID                            1
+#define GW_PB_THREAD_TID                            2
+#define GW_PB_THREAD_NAME                           5
+
+// TrackEvent
+#define GW_PB_EVENT_DEBUG_ANNOTATIONS               4
+#define GW_PB_EVENT_TYPE                            9
+#define GW_PB_EVENT_TRACK_UUID                      11
+#define GW_PB_EVENT_CATEGORIES                      22
+#define GW_PB_EVENT_NAME                            23
+#define GW_PB_EVENT_FLOW_IDS                        47
+#define GW_PB_EVENT_TERMINATING_FLOW_IDS            48
+#define GW_PB_EVENT_TYPE_SLICE_BEGIN                1
+#define GW_PB_EVENT_TYPE_SLICE_END                  2
+#define GW_PB_EVENT_TYPE_INSTANT                    3
+
+// DebugAnnotation
+#define GW_PB_ANNOTATION_BOOL                       2
+#define GW_PB_ANNOTATION_UINT                       3
+#define GW_PB_ANNOTATION_INT                        4
+#define GW_PB_ANNOTATION_DOUBLE                     5
+#define GW_PB_ANNOTATION_STRING                     6
+#define GW_PB_ANNOTATION_JSON                       9
+#define GW_PB_ANNOTATION_NAME                       10
+
+// protobuf wire types
+#define GW_PB_WIRE_VARINT                           0
+#define GW_PB_WIRE_FIXED64                          1
+#define GW_PB_WIRE_BYTES                            2
+/* ==================== Perfetto Proto Fields ==================== */
+
+
+// sequence id of all packets written by the exporter
+#define GW_EVENT_EXPORTER_SEQUENCE_ID               1
+
+// base of synthetic thread ids for non-cpu tracks (chrome json only)
+#define GW_EVENT_EXPORTER_SYNTHETIC_TID_BASE        0x40000000
+
+// multiplier deriving the uuid of the async track of a slice from its event id (perfetto only)
+#define GW_EVENT_EXPORTER_SLICE_TRACK_MIX           0x9e3779b97f4a7c15ul
+
+
+GWEventTraceExporter::GWEventTraceExporter(){}
+
+
+GWEventTraceExporter::~GWEventTraceExporter(){
+    if(this->_file.is_open())
+        this->close();
+}
+
+
+gw_retval_t GWEventTraceExporter::open(const std::string& path, gw_event_trace_export_format_t format, double tsc_freq){
+    gw_retval_t retval = GW_SUCCESS;
+
+    if(unlikely(this->_file.is_open())){
+        GW_WARN_C("trace file already opened");
+        retval = GW_FAILED_ALREADY_EXIST;
+        goto exit;
+    }
+
+    this->_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(unlikely(!this->_file.is_open())){
+        GW_WARN_C("failed to open trace file: path(%s)", path.c_str());
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    if(tsc_freq <= 0)
+        tsc_freq = GWUtilClock::instance().get_freq();
+    this->_ns_per_tick = 1e9 / tsc_freq;
+    this->_format = format;
+    this->_nb_exported_events = 0;
+    this->_has_chrome_object = false;
+    this->_map_process.clear();
+    this->_map_track.clear();
+
+    if(format == GW_EVENT_TRACE_EXPORT_CHROME_JSON){
+        this->_file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    } else {
+        // clear incremental state of the sequence before any track event
+        this->_pb_packet.clear();
+        __pb_write_varint(this->_pb_packet, GW_PB_PACKET_TRUSTED_SEQUENCE_ID, GW_EVENT_EXPORTER_SEQUENCE_ID);
+        __pb_write_varint(this->_pb_packet, GW_PB_PACKET_SEQUENCE_FLAGS, GW_PB_SEQ_INCREMENTAL_STATE_CLEARED);
+        this->__perfetto_flush_packet();
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWEventTraceExporter::write_event(const GWEvent* event){
+    return this->__write_event(event, nullptr);
+}
+
+
+gw_retval_t GWEventTraceExporter::write_event(const GWEvent* event, const gw_event_trace_clock_t& clock){
+    return this->__write_event(event, &clock);
+}
+
+
+gw_retval_t GWEventTraceExporter::__write_event(const GWEvent* event, const gw_event_trace_clock_t* clock){
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t begin_tick = 0, end_tick = 0, begin_ns = 0, end_ns = 0;
+    bool has_end_tick = false;
+    std::vector<uint64_t> list_flow_ids, list_terminating_flow_ids;
+
+    GW_CHECK_POINTER(event);
+
+    if(unlikely(!this->_file.is_open())){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    if(unlikely(!event->get_tick(GW_EVENT_KEY_TICK_BEGIN, begin_tick))){
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+    has_end_tick = event->get_tick(GW_EVENT_KEY_TICK_END, end_tick) and end_tick >= begin_tick;
+
+    if(clock != nullptr){
+        begin_ns = clock->tick_to_ns(begin_tick);
+        end_ns = has_end_tick ? clock->tick_to_ns(end_tick) : begin_ns;
+    } else {
+        begin_ns = this->__tick_to_ns(begin_tick);
+        end_ns = has_end_tick ? this->__tick_to_ns(end_tick) : begin_ns;
+    }
+
+    {
+        const __gw_track_t& track = this->__get_track(event);
+        this->__get_flows(event, list_flow_ids, list_terminating_flow_ids);
+
+        if(this->_format == GW_EVENT_TRACE_EXPORT_CHROME_JSON){
+            this->__chrome_write_event(
+                event, track, begin_ns, end_ns, has_end_tick, list_flow_ids, list_terminating_flow_ids
+            );
+        } else {
+            this->__perfetto_write_event(
+                event, track, begin_ns, end_ns, has_end_tick, list_flow_ids, list_terminating_flow_ids
+            );
+        }
+    }
+    this->_nb_exported_events += 1;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWEventTraceExporter::close(){
+    gw_retval_t retval = GW_SUCCESS;
+
+    if(!this->_file.is_open())
+        goto exit;
+
+    if(this->_format == GW_EVENT_TRACE_EXPORT_CHROME_JSON)
+        this->_file << "\n]}\n";
+
+    this->_file.flush();
+    if(unlikely(!this->_file.good())){
+        GW_WARN_C("failed to flush trace file");
+        retval = GW_FAILED;
+    }
+    this->_file.close();
+
+    GW_DEBUG_C(
+        "exported event trace: nb_events(%lu), nb_tracks(%lu)",
+        this->_nb_exported_events, this->_map_track.size()
+    );
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWEventTraceExporter::string_to_format(const std::string& name, gw_event_trace_export_format_t& format){
+    gw_retval_t retval = GW_SUCCESS;
+
+    if(name == "perfetto"){
+        format = GW_EVENT_TRACE_EXPORT_PERFETTO;
+    } else if(name == "chrome_json"){
+        format = GW_EVENT_TRACE_EXPORT_CHROME_JSON;
+    } else {
+        retval = GW_FAILED_INVALID_INPUT;
+    }
+
+    return retval;
+}
+
+
+const GWEventTraceExporter::__gw_track_t& GWEventTraceExporter::__get_track(const GWEvent* event){
+    gw_event_key_t trace_name_id = event->global_id.trace_name_id;
+    std::tuple<gw_event_key_t, uint64_t, gw_event_typeid_t> track_key = { trace_name_id, event->thread_id, event->type_id };
+    typename std::map<std::tuple<gw_event_key_t, uint64_t, gw_event_typeid_t>, __gw_track_t>::iterator it;
+    __gw_track_t track;
+    uint32_t pid = 0;
+    uint64_t process_uuid = 0;
+    std::string trace_name = "", track_name = "";
+
+    it = this->_map_track.find(track_key);
+    if(likely(it != this->_map_track.end()))
+        return it->second;
+
+    // declare the process of the event trace on first use
+    trace_name = GWEventKeyRegistry::instance().get_str(trace_name_id);
+    process_uuid = __hash_global_id({ trace_name_id, GW_EVENT_TYPE_UNKNOWN, 0, 0, true });
+    if(this->_map_process.count(trace_name_id) == 0){
+        pid = static_cast<uint32_t>(this->_map_process.size() + 1);
+        this->_map_process[trace_name_id] = pid;
+        if(this->_format == GW_EVENT_TRACE_EXPORT_CHROME_JSON){
+            this->__chrome_write_object({
+                {"ph", "M"}, {"name", "process_name"}, {"pid", pid}, {"tid", 0}, {"args", {{"name", trace_name}}}
+            });
+        } else {
+            this->__perfetto_write_process_descriptor(process_uuid, pid, trace_name);
+        }
+    }
+    pid = this->_map_process[trace_name_id];
+
+    // cpu events are placed on the thread track, other event types are
+    // placed on a dedicated track of the thread
+    track.pid = pid;
+    track.uuid = __hash_global_id({ trace_name_id, event->type_id, event->thread_id, 0, true });
+    if(gw_event_is_cpu(event->type_id)){
+        track.tid = static_cast<uint32_t>(event->thread_id);
+        track_name = "thread " + std::to_string(event->thread_id);
+    } else {
+        track.tid = static_cast<uint32_t>(GW_EVENT_EXPORTER_SYNTHETIC_TID_BASE + this->_map_track.size());
+        track_name = GWEvent::typeid_to_string(event->type_id) + " (thread " + std::to_string(event->thread_id) + ")";
+    }
+    track.name = track_name;
+
+    if(this->_format == GW_EVENT_TRACE_EXPORT_CHROME_JSON){
+        this->__chrome_write_object({
+            {"ph", "M"}, {"name", "thread_name"}, {"pid", track.pid}, {"tid", track.tid}, {"args", {{"name", track_name}}}
+        });
+    } else if(gw_event_is_cpu(event->type_id)){
+        this->__perfetto_write_thread_descriptor(track.uuid, process_uuid, track.pid, track.tid, track_name);
+    } else {
+        this->__perfetto_write_track_descriptor(track.uuid, process_uuid, track_name);
+    }
+
+    return this->_map_track.insert({ track_key, track }).first->second;
+}
+
+
+void GWEventTraceExporter::__get_flows(
+    const GWEvent* event, std::vector<uint64_t>& list_flow_ids, std::vector<uint64_t>& list_terminating_flow_ids
+){
+    const gw_event_global_id_t& self_id = event->global_id;
+    uint64_t self_hash = __hash_global_id(self_id), related_hash = 0;
+
+    // both sides of a relation carry each other, the side with smaller hash starts the flow,
+    // and the flow id is symmetric so that both sides agree on it without any lookup
+    for(const gw_event_global_id_t& related_id : event->_list_related_event_global_idx){
+        if(unlikely(!related_id.is_valid))
+            continue;
+        related_hash = __hash_global_id(related_id);
+        if(unlikely(related_hash == self_hash))
+            continue;
+        if(self_hash < related_hash)
+            list_flow_ids.push_back(self_hash ^ (related_hash * 0x9e3779b97f4a7c15ul));
+        else
+            list_terminating_flow_ids.push_back(related_hash ^ (self_hash * 0x9e3779b97f4a7c15ul));
+    }
+}
+
+
+void GWEventTraceExporter::__perfetto_write_process_descriptor(uint64_t uuid, uint32_t pid, const std::string& name){
+    this->_pb_nested_message.clear();
+    __pb_write_varint(this->_pb_nested_message, GW_PB_PROCESS_PID, pid);
+    __pb_write_string(this->_pb_nested_message, GW_PB_PROCESS_NAME, name);
+
+    this->_pb_message.clear();
+    __pb_write_varint(this->_pb_message, GW_PB_TRACK_UUID, uuid);
+    __pb_write_message(this->_pb_message, GW_PB_TRACK_PROCESS, this->_pb_nested_message);
+
+    this->_pb_packet.clear();
+    __pb_write_varint(this->_pb_packet, GW_PB_PACKET_TRUSTED_SEQUENCE_ID, GW_EVENT_EXPORTER_SEQUENCE_ID);
+    __pb_write_message(this->_pb_packet, GW_PB_PACKET_TRACK_DESCRIPTOR, this->_pb_message);
+    this->__perfetto_flush_packet();
+}
+
+
+void GWEventTraceExporter::__perfetto_write_thread_descriptor(
+    uint64_t uuid, uint64_t parent_uuid, uint32_t pid, uint32_t tid, const std::string& name
+){
+    this->_pb_nested_message.clear();
+    __pb_write_varint(this->_pb_nested_message, GW_PB_THREAD_PID, pid);
+    __pb_write_varint(this->_pb_nested_message, GW_PB_THREAD_TID, tid);
+    __pb_write_string(this->_pb_nested_message, GW_PB_THREAD_NAME, name);
+
+    this->_pb_message.clear();
+    __pb_write_varint(this->_pb_message, GW_PB_TRACK_UUID, uuid);
+    __pb_write_varint(this->_pb_message, GW_PB_TRACK_PARENT_UUID, parent_uuid);
+    __pb_write_message(this->_pb_message, GW_PB_TRACK_THREAD, this->_pb_nested_message);
+
+    this->_pb_packet.clear();
+    __pb_write_varint(this->_pb_packet, GW_PB_PACKET_TRUSTED_SEQUENCE_ID, GW_EVENT_EXPORTER_SEQUENCE_ID);
+    __pb_write_message(this->_pb_packet, GW_PB_PACKET_TRACK_DESCRIPTOR, this->_pb_message);
+    this->__perfetto_flush_packet();
+}
+
+
+void GWEventTraceExporter::__perfetto_write_track_descriptor(uint64_t uuid, uint64_t parent_uuid, const std::string& name){
+    this->_pb_message.clear();
+    __pb_write_varint(this->_pb_message, GW_PB_TRACK_UUID, uuid);
+    __pb_write_string(this->_pb_message, GW_PB_TRACK_NAME, name);
+    __pb_write_varint(this->_pb_message, GW_PB_TRACK_PARENT_UUID, parent_uuid);
+
+    this->_pb_packet.clear();
+    __pb_write_varint(this->_pb_packet, GW_PB_PACKET_TRUSTED_SEQUENCE_ID, GW_EVENT_EXPORTER_SEQUENCE_ID);
+    __pb_write_message(this->_pb_packet, GW_PB_PACKET_TRACK_DESCRIPTOR, this->_pb_message);
+    this->__perfetto_flush_packet();
+}
+
+
+void GWEventTraceExporter::__perfetto_write_event(
+    const GWEvent* event, const __gw_track_t& track, uint64_t begin_ns, uint64_t end_ns, bool has_end_tick,
+    const std::vector<uint64_t>& list_flow_ids, const std::vector<uint64_t>& list_terminating_flow_ids
+){
+    GWEventKeyRegistry& registry = GWEventKeyRegistry::instance();
+    uint64_t slice_track_uuid = track.uuid;
+    uint8_t i = 0;
+
+    // NOTE(zhuobin): events of a track could overlap (e.g., asynchronous GPU events) and are
+    //                written in the order of completion, so begin / end of different events on
+    //                a shared track don't nest; each slice goes on its own async track instead,
+    //                named after the track of the event so that viewers group them together
+    if(has_end_tick){
+        slice_track_uuid = track.uuid ^ ((event->id + 1) * GW_EVENT_EXPORTER_SLICE_TRACK_MIX);
+        this->__perfetto_write_track_descriptor(slice_track_uuid, track.uuid, track.name);
+    }
+
+    // begin of the slice, along with its arguments and flows
+    this->_pb_message.clear();
+    __pb_write_varint(
+        this->_pb_message, GW_PB_EVENT_TYPE, has_end_tick ? GW_PB_EVENT_TYPE_SLICE_BEGIN : GW_PB_EVENT_TYPE_INSTANT
+    );
+    __pb_write_varint(this->_pb_message, GW_PB_EVENT_TRACK_UUID, slice_track_uuid);
+    __pb_write_string(this->_pb_message, GW_PB_EVENT_CATEGORIES, GWEvent::typeid_to_string(event->type_id));
+    __pb_write_string(this->_pb_message, GW_PB_EVENT_NAME, event->get_name());
+
+    this->__perfetto_append_annotation(this->_pb_message, "global_id", event->global_id.str());
+    if(event->_has_parent)
+        this->__perfetto_append_annotation(this->_pb_message, "parent_id", event->_parent_id);
+    for(i=0; i<event->_nb_inline_ticks; i++){
+        if(event->_inline_ticks[i].key == GW_EVENT_KEY_TICK_BEGIN or event->_inline_ticks[i].key == GW_EVENT_KEY_TICK_END)
+            continue;
+        this->__perfetto_append_annotation(
+            this->_pb_message, "tick." + registry.get_str(event->_inline_ticks[i].key), event->_inline_ticks[i].tick
+        );
+    }
+    for(const gw_event_tick_t& overflow_tick : event->_list_overflow_ticks){
+        this->__perfetto_append_annotation(
+            this->_pb_message, "tick." + registry.get_str(overflow_tick.key), overflow_tick.tick
+        );
+    }
+    for(const auto& [key, value] : event->get_map_metadata())
+        this->__perfetto_append_annotation(this->_pb_message, key, value);
+
+    for(uint64_t flow_id : list_flow_ids)
+        __pb_write_fixed64(this->_pb_message, GW_PB_EVENT_FLOW_IDS, flow_id);
+    for(uint64_t flow_id : list_terminating_flow_ids)
+        __pb_write_fixed64(this->_pb_message, GW_PB_EVENT_TERMINATING_FLOW_IDS, flow_id);
+
+    this->_pb_packet.clear();
+    __pb_write_varint(this->_pb_packet, GW_PB_PACKET_TIMESTAMP, begin_ns);
+    __pb_write_varint(this->_pb_packet, GW_PB_PACKET_TRUSTED_SEQUENCE_ID, GW_EVENT_EXPORTER_SEQUENCE_ID);
+    __pb_write_message(this->_pb_packet, GW_PB_PACKET_TRACK_EVENT, this->_pb_message);
+    this->__perfetto_flush_packet();
+
+    if(!has_end_tick)
+        return;
+
+    // end of the slice
+    this->_pb_message.clear();
+    __pb_write_varint(this->_pb_message, GW_PB_EVENT_TYPE, GW_PB_EVENT_TYPE_SLICE_END);
+    __pb_write_varint(this->_pb_message, GW_PB_EVENT_TRACK_UUID, slice_track_uuid);
+
+    this->_pb_packet.clear();
+    __pb_write_varint(this->_pb_packet, GW_PB_PACKET_TIMESTAMP, end_ns);
+    __pb_write_varint(this->_pb_packet, GW_PB_PACKET_TRUSTED_SEQUENCE_ID, GW_EVENT_EXPORTER_SEQUENCE_ID);
+    __pb_write_message(this->_pb_packet, GW_PB_PACKET_TRACK_EVENT, this->_pb_message);
+    this->__perfetto_flush_packet();
+}
+
+
+void GWEventTraceExporter::__perfetto_append_annotation(
+    std::vector<uint8_t>& buffer, const std::string& name, const nlohmann::json& value
+){
+    this->_pb_nested_message.clear();
+    __pb_write_string(this->_pb_nested_message, GW_PB_ANNOTATION_NAME, name);
+
+    if(value.is_boolean()){
+        __pb_write_varint(this->_pb_nested_message, GW_PB_ANNOTATION_BOOL, value.get<bool>());
+    } else if(value.is_number_unsigned()){
+        __pb_write_varint(this->_pb_nested_message, GW_PB_ANNOTATION_UINT, value.get<uint64_t>());
+    } else if(value.is_number_integer()){
+        __pb_write_varint(this->_pb_nested_message, GW_PB_ANNOTATION_INT, static_cast<uint64_t>(value.get<int64_t>()));
+    } else if(value.is_number_float()){
+        __pb_write_double(this->_pb_nested_message, GW_PB_ANNOTATION_DOUBLE, value.get<double>());
+    } else if(value.is_string()){
+        __pb_write_string(this->_pb_nested_message, GW_PB_ANNOTATION_STRING, value.get_ref<const std::string&>());
+    } else {
+        __pb_write_string(this->_pb_nested_message, GW_PB_ANNOTATION_JSON, value.dump());
+    }
+
+    __pb_write_message(buffer, GW_PB_EVENT_DEBUG_ANNOTATIONS, this->_pb_nested_message);
+}
+
+
+void GWEventTraceExporter::__perfetto_flush_packet(){
+    // the packet is a length-delimited field of the top-level trace message
+    this->_pb_prefix.clear();
+    GWUtilBytes::write_uleb128(this->_pb_prefix, (GW_PB_TRACE_PACKET << 3) | GW_PB_WIRE_BYTES);
+    GWUtilBytes::write_uleb128(this->_pb_prefix, this->_pb_packet.size());
+    this->_file.write(reinterpret_cast<const char*>(this->_pb_prefix.data()), this->_pb_prefix.size());
+    this->_file.write(reinterpret_cast<const char*>(this->_pb_packet.data()), this->_pb_packet.size());
+}
+
+
+void GWEventTraceExporter::__chrome_write_object(const nlohmann::json& object){
+    this->_file << (this->_has_chrome_object ? ",\n" : "\n") << object.dump();
+    this->_has_chrome_object = true;
+}
+
+
+void GWEventTraceExporter::__chrome_write_event(
+    const GWEvent* event, const __gw_track_t& track, uint64_t begin_ns, uint64_t end_ns, bool has_end_tick,
+    const std::vector<uint64_t>& list_flow_ids, const std::vector<uint64_t>& list_terminating_flow_ids
+){
+    GWEventKeyRegistry& registry = GWEventKeyRegistry::instance();
+    nlohmann::json object, args;
+    double begin_us = static_cast<double>(begin_ns) / 1000.0;
+    uint8_t i = 0;
+
+    args["global_id"] = event->global_id.str();
+    if(event->_has_parent)
+        args["parent_id"] = event->_parent_id;
+    for(i=0; i<event->_nb_inline_ticks; i++){
+        if(event->_inline_ticks[i].key == GW_EVENT_KEY_TICK_BEGIN or event->_inline_ticks[i].key == GW_EVENT_KEY_TICK_END)
+            continue;
+        args["tick." + registry.get_str(event->_inline_ticks[i].key)] = event->_inline_ticks[i].tick;
+    }
+    for(const gw_event_tick_t& overflow_tick : event->_list_overflow_ticks)
+        args["tick." + registry.get_str(overflow_tick.key)] = overflow_tick.tick;
+    for(const auto& [key, value] : event->get_map_metadata())
+        args[key] = value;
+
+    object["name"] = event->get_name();
+    object["cat"] = GWEvent::typeid_to_string(event->type_id);
+    object["pid"] = track.pid;
+    object["tid"] = track.tid;
+    object["ts"] = begin_us;
+    if(has_end_tick){
+        object["ph"] = "X";
+        object["dur"] = static_cast<double>(end_ns - begin_ns) / 1000.0;
+    } else {
+        object["ph"] = "i";
+        object["s"] = "t";
+    }
+    object["args"] = std::move(args);
+    this->__chrome_write_object(object);
+
+    // flows are bound to the slice enclosing the begin of the event, ids are written as
+    // hex strings as trace viewers parse numbers as double
+    for(uint64_t flow_id : list_flow_ids){
+        this->__chrome_write_object({
+            {"ph", "s"}, {"name", "related"}, {"cat", "flow"}, {"id", std::format("{:#x}", flow_id)},
+            {"pid", track.pid}, {"tid", track.tid}, {"ts", begin_us}
+        });
+    }
+    for(uint64_t flow_id : list_terminating_flow_ids){
+        this->__chrome_write_object({
+            {"ph", "f"}, {"bp", "e"}, {"name", "related"}, {"cat", "flow"}, {"id", std::format("{:#x}", flow_id)},
+            {"pid", track.pid}, {"tid", track.tid}, {"ts", begin_us}
+        });
+    }
+}
+
+
+void GWEventTraceExporter::__pb_write_varint(std::vector<uint8_t>& buffer, uint64_t field, uint64_t value){
+    GWUtilBytes::write_uleb128(buffer, (field << 3) | GW_PB_WIRE_VARINT);
+    GWUtilBytes::write_uleb128(buffer, value);
+}
+
+
+void GWEventTraceExporter::__pb_write_fixed64(std::vector<uint8_t>& buffer, uint64_t field, uint64_t value){
+    uint8_t i = 0;
+
+    GWUtilBytes::write_uleb128(buffer, (field << 3) | GW_PB_WIRE_FIXED64);
+    for(i=0; i<8; i++)
+        buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+
+void GWEventTraceExporter::__pb_write_double(std::vector<uint8_t>& buffer, uint64_t field, double value){
+    uint64_t bits = 0;
+
+    std::memcpy(&bits, &value, sizeof(double));
+    __pb_write_fixed64(buffer, field, bits);
+}
+
+
+void GWEventTraceExporter::__pb_write_bytes(std::vector<uint8_t>& buffer, uint64_t field, const void* data, uint64_t size){
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+
+    GWUtilBytes::write_uleb128(buffer, (field << 3) | GW_PB_WIRE_BYTES);
+    GWUtilBytes::write_uleb128(buffer, size);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+
+uint64_t GWEventTraceExporter::__hash_global_id(const gw_event_global_id_t& global_id){
+    uint64_t hash = 0xcbf29ce484222325ul;
+
+    // splitmix64 over each field
+    auto __mix = [](uint64_t value) -> uint64_t {
+        value += 0x9e3779b97f4a7c15ul;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ul;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebul;
+        return value ^ (value >> 31);
+    };
+    hash = __mix(hash ^ global_id.trace_name_id);
+    hash = __mix(hash ^ global_id.type_id);
+    hash = __mix(hash ^ global_id.thread_id);
+    hash = __mix(hash ^ global_id.id);
+
+    return hash;
+}
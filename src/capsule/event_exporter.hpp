@@ -0,0 +1,239 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <fstream>
+
+#include "nlohmann/json.hpp"
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "capsule/event.hpp"
+
+
+/*!
+ *  \brief  format of the exported trace file
+ */
+enum gw_event_trace_export_format_t : uint8_t {
+    // perfetto protobuf trace (https://perfetto.dev/docs/reference/trace-packet-proto)
+    GW_EVENT_TRACE_EXPORT_PERFETTO = 0,
+
+    // chrome json trace (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU)
+    GW_EVENT_TRACE_EXPORT_CHROME_JSON
+};
+
+
+/*!
+ *  \brief  streaming exporter of events to a trace file, events are written one at a
+ *          time, so the memory footprint only depends on the number of tracks
+ *  \note   each event trace becomes a process, and each (thread, event type) becomes a
+ *          track within the process; an event becomes a slice between its begin / end
+ *          ticks (or an instant without end tick); related events are connected by flows;
+ *          in perfetto traces, each slice is placed on its own async track under the
+ *          track of the event, as events of a track could overlap
+ */
+class GWEventTraceExporter {
+ public:
+    /*!
+     *  \brief  constructor
+     */
+    GWEventTraceExporter();
+
+
+    /*!
+     *  \brief  deconstructor, which closes the trace file if it's still opened
+     */
+    ~GWEventTraceExporter();
+
+
+    /*!
+     *  \brief  open the trace file to export
+     *  \param  path        path to the trace file
+     *  \param  format      format of the trace file
+     *  \param  tsc_freq    frequency of ticks within events (Hz), 0 for the TSC frequency
+     *                      measured on current node
+     *  \return GW_SUCCESS if success,
+     *          GW_FAILED_ALREADY_EXIST if a trace file is opened,
+     *          GW_FAILED_NOT_EXIST if failed to open the trace file
+     */
+    gw_retval_t open(const std::string& path, gw_event_trace_export_format_t format, double tsc_freq = 0);
+
+
+    /*!
+     *  \brief  write an event to the trace file
+     *  \param  event   the event to be written
+     *  \return GW_SUCCESS if success,
+     *          GW_FAILED_NOT_READY if the trace file isn't opened,
+     *          GW_FAILED_INVALID_INPUT if the event doesn't have begin tick
+     */
+    gw_retval_t write_event(const GWEvent* event);
+
+
+    /*!
+     *  \brief  write an event to the trace file, with ticks converted by the given clock
+     *          domain instead of the frequency given while opening
+     *  \param  event   the event to be written
+     *  \param  clock   clock domain of ticks within the event
+     *  \return GW_SUCCESS if success,
+     *          GW_FAILED_NOT_READY if the trace file isn't opened,
+     *          GW_FAILED_INVALID_INPUT if the event doesn't have begin tick
+     */
+    gw_retval_t write_event(const GWEvent* event, const gw_event_trace_clock_t& clock);
+
+
+    /*!
+     *  \brief  finish and close the trace file
+     *  \return GW_SUCCESS if success, GW_FAILED if failed to flush the trace file
+     */
+    gw_retval_t close();
+
+
+    /*!
+     *  \brief  parse export format from its name
+     *  \param  name    name of the format: perfetto / chrome_json
+     *  \param  format  the parsed format
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for unknown name
+     */
+    static gw_retval_t string_to_format(const std::string& name, gw_event_trace_export_format_t& format);
+
+
+    // getters
+    inline uint64_t get_nb_exported_events() const { return this->_nb_exported_events; }
+
+ private:
+    /*!
+     *  \brief  track of events from the same (event trace, thread, event type)
+     */
+    typedef struct __gw_track {
+        uint64_t uuid = 0;
+        uint32_t pid = 0;
+        uint32_t tid = 0;
+        std::string name = "";
+    } __gw_track_t;
+
+
+    /*!
+     *  \brief  write an event to the trace file with its timestamps
+     *  \param  event           the event to be written
+     *  \param  clock           clock domain of ticks, nullptr for the frequency given while opening
+     *  \return GW_SUCCESS if success,
+     *          GW_FAILED_NOT_READY if the trace file isn't opened,
+     *          GW_FAILED_INVALID_INPUT if the event doesn't have begin tick
+     */
+    gw_retval_t __write_event(const GWEvent* event, const gw_event_trace_clock_t* clock);
+
+
+    /*!
+     *  \brief  obtain the track of the event, the track is declared on first use
+     *  \param  event   the event
+     *  \return the track
+     */
+    const __gw_track_t& __get_track(const GWEvent* event);
+
+
+    /*!
+     *  \brief  obtain the flows between the event and its related events
+     *  \param  event               the event
+     *  \param  list_flow_ids       ids of flows started by the event
+     *  \param  list_terminating_flow_ids   ids of flows terminated by the event
+     */
+    void __get_flows(
+        const GWEvent* event, std::vector<uint64_t>& list_flow_ids, std::vector<uint64_t>& list_terminating_flow_ids
+    );
+
+
+    /*!
+     *  \brief  perfetto: write process / thread / track descriptors
+     */
+    void __perfetto_write_process_descriptor(uint64_t uuid, uint32_t pid, const std::string& name);
+    void __perfetto_write_thread_descriptor(uint64_t uuid, uint64_t parent_uuid, uint32_t pid, uint32_t tid, const std::string& name);
+    void __perfetto_write_track_descriptor(uint64_t uuid, uint64_t parent_uuid, const std::string& name);
+
+
+    /*!
+     *  \brief  perfetto: write the slice of an event
+     */
+    void __perfetto_write_event(
+        const GWEvent* event, const __gw_track_t& track, uint64_t begin_ns, uint64_t end_ns, bool has_end_tick,
+        const std::vector<uint64_t>& list_flow_ids, const std::vector<uint64_t>& list_terminating_flow_ids
+    );
+
+
+    /*!
+     *  \brief  perfetto: append a debug annotation to the track event being built
+     */
+    void __perfetto_append_annotation(std::vector<uint8_t>& buffer, const std::string& name, const nlohmann::json& value);
+
+
+    /*!
+     *  \brief  perfetto: flush the packet being built to the trace file
+     */
+    void __perfetto_flush_packet();
+
+
+    /*!
+     *  \brief  chrome json: write an json object as an element of traceEvents
+     */
+    void __chrome_write_object(const nlohmann::json& object);
+
+
+    /*!
+     *  \brief  chrome json: write the slice of an event
+     */
+    void __chrome_write_event(
+        const GWEvent* event, const __gw_track_t& track, uint64_t begin_ns, uint64_t end_ns, bool has_end_tick,
+        const std::vector<uint64_t>& list_flow_ids, const std::vector<uint64_t>& list_terminating_flow_ids
+    );
+
+
+    /*!
+     *  \brief  protobuf wire format helpers
+     */
+    static void __pb_write_varint(std::vector<uint8_t>& buffer, uint64_t field, uint64_t value);
+    static void __pb_write_fixed64(std::vector<uint8_t>& buffer, uint64_t field, uint64_t value);
+    static void __pb_write_double(std::vector<uint8_t>& buffer, uint64_t field, double value);
+    static void __pb_write_bytes(std::vector<uint8_t>& buffer, uint64_t field, const void* data, uint64_t size);
+    static inline void __pb_write_string(std::vector<uint8_t>& buffer, uint64_t field, const std::string& str){
+        __pb_write_bytes(buffer, field, str.data(), str.size());
+    }
+    static inline void __pb_write_message(std::vector<uint8_t>& buffer, uint64_t field, const std::vector<uint8_t>& message){
+        __pb_write_bytes(buffer, field, message.data(), message.size());
+    }
+
+
+    /*!
+     *  \brief  hash of a global event id, which is stable within the process
+     */
+    static uint64_t __hash_global_id(const gw_event_global_id_t& global_id);
+
+
+    /*!
+     *  \brief  convert tick to timestamp (ns)
+     */
+    inline uint64_t __tick_to_ns(uint64_t tick) const {
+        return static_cast<uint64_t>(static_cast<double>(tick) * this->_ns_per_tick);
+    }
+
+    std::ofstream _file;
+    gw_event_trace_export_format_t _format = GW_EVENT_TRACE_EXPORT_PERFETTO;
+    double _ns_per_tick = 1.0;
+    uint64_t _nb_exported_events = 0;
+
+    // <trace name id, pid>
+    std::map<gw_event_key_t, uint32_t> _map_process;
+
+    // <<trace name id, thread id, event type>, track>
+    std::map<std::tuple<gw_event_key_t, uint64_t, gw_event_typeid_t>, __gw_track_t> _map_track;
+
+    // perfetto: reused buffers of the packet being built
+    std::vector<uint8_t> _pb_packet;
+    std::vector<uint8_t> _pb_message;
+    std::vector<uint8_t> _pb_nested_message;
+    std::vector<uint8_t> _pb_prefix;
+
+    // chrome json: whether any element is written to traceEvents
+    bool _has_chrome_object = false;
+};
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstdlib>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "capsule/event.hpp"
+#include "capsule/event_merge.hpp"
+#include "capsule/event_exporter.hpp"
+
+
+// order of the min-heap: earlier timestamp first, ties are broken by the order of runs
+#define GW_EVENT_MERGE_CURSOR_AFTER(a, b)   \
+    ((a).timestamp_ns > (b).timestamp_ns or ((a).timestamp_ns == (b).timestamp_ns and (a).run_index > (b).run_index))
+
+
+GWEventTraceMerger::GWEventTraceMerger(){}
+
+
+GWEventTraceMerger::~GWEventTraceMerger(){}
+
+
+void GWEventTraceMerger::add_view(const GWEventTraceView* view){
+    GW_CHECK_POINTER(view);
+    this->add_view(view, view->get_clock());
+}
+
+
+void GWEventTraceMerger::add_view(const GWEventTraceView* view, const gw_event_trace_clock_t& clock){
+    const gw_event_trace_clock_t *stored_clock = nullptr;
+
+    GW_CHECK_POINTER(view);
+
+    this->_list_clocks.push_back(clock);
+    stored_clock = &this->_list_clocks.back();
+
+    for(auto &it : view->get_map_event_trace()){
+        if(it.second.empty())
+            continue;
+        this->_list_runs.push_back({ .list_events = &it.second, .clock = stored_clock });
+    }
+}
+
+
+GWEventTraceMerger::const_iterator GWEventTraceMerger::begin() const {
+    const_iterator it;
+    uint64_t i = 0;
+
+    it._list_runs = &this->_list_runs;
+    it._heap.reserve(this->_list_runs.size());
+    for(i=0; i<this->_list_runs.size(); i++)
+        it.__push_run(i, 0);
+    it.__update_current();
+
+    return it;
+}
+
+
+gw_retval_t GWEventTraceMerger::export_trace(const std::string& path, uint8_t format) const {
+    gw_retval_t retval = GW_SUCCESS;
+    GWEventTraceExporter exporter;
+    uint64_t nb_skipped_events = 0;
+
+    // NOTE(zhuobin): every event is written with the clock domain of its view, so the
+    //                frequency of the exporter is unused and given to avoid measuring it
+    GW_IF_FAILED(
+        exporter.open(path, static_cast<gw_event_trace_export_format_t>(format), 1e9),
+        retval,
+        goto exit;
+    );
+
+    for(const gw_event_trace_merged_event_t& merged_event : *this){
+        if(unlikely(exporter.write_event(merged_event.event, *merged_event.clock) != GW_SUCCESS))
+            nb_skipped_events += 1;
+    }
+    if(unlikely(nb_skipped_events > 0)){
+        GW_WARN_C("skipped events without begin tick while exporting: nb_skipped_events(%lu)", nb_skipped_events);
+    }
+
+    retval = exporter.close();
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWEventTraceMerger::build_clock(
+    const std::string& tsc_freq, const std::string& start_tsc, const std::string& start_time,
+    gw_event_trace_clock_t& clock
+){
+    gw_retval_t retval = GW_SUCCESS;
+    char *end = nullptr;
+    double freq = 0, tsc = 0;
+
+    // NOTE(zhuobin): both columns are DOUBLE in the database, so they could be returned
+    //                in either fixed or scientific notation
+    freq = std::strtod(tsc_freq.c_str(), &end);
+    if(unlikely(tsc_freq.empty() or *end != '\0' or !(freq > 0))){
+        GW_WARN("malformed tsc_freq of capsule: tsc_freq(%s)", tsc_freq.c_str());
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    tsc = std::strtod(start_tsc.c_str(), &end);
+    if(unlikely(start_tsc.empty() or *end != '\0' or !(tsc >= 0))){
+        GW_WARN("malformed start_tsc of capsule: start_tsc(%s)", start_tsc.c_str());
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    GW_IF_FAILED(
+        gw_event_trace_clock_t::parse_start_time(start_time, clock.start_ns),
+        retval,
+        goto exit;
+    );
+    clock.tsc_freq = freq;
+    clock.start_tsc = static_cast<uint64_t>(tsc);
+
+exit:
+    return retval;
+}
+
+
+GWEventTraceMerger::const_iterator& GWEventTraceMerger::const_iterator::operator++(){
+    __gw_cursor_t cursor;
+
+    if(unlikely(this->_heap.empty()))
+        return *this;
+
+    std::pop_heap(this->_heap.begin(), this->_heap.end(), [](const __gw_cursor_t& a, const __gw_cursor_t& b){
+        return GW_EVENT_MERGE_CURSOR_AFTER(a, b);
+    });
+    cursor = this->_heap.back();
+    this->_heap.pop_back();
+
+    this->__push_run(cursor.run_index, cursor.position + 1);
+    this->__update_current();
+
+    return *this;
+}
+
+
+void GWEventTraceMerger::const_iterator::__push_run(uint64_t run_index, uint64_t position){
+    const __gw_run_t& run = (*this->_list_runs)[run_index];
+    uint64_t tick = 0;
+
+    while(position < run.list_events->size() and (*run.list_events)[position] == nullptr)
+        position += 1;
+    if(position >= run.list_events->size())
+        return;
+
+    this->_heap.push_back({
+        .timestamp_ns = (*run.list_events)[position]->get_tick(GW_EVENT_KEY_TICK_BEGIN, tick)
+                        ? run.clock->tick_to_ns(tick) : 0,
+        .run_index = run_index,
+        .position = position
+    });
+    std::push_heap(this->_heap.begin(), this->_heap.end(), [](const __gw_cursor_t& a, const __gw_cursor_t& b){
+        return GW_EVENT_MERGE_CURSOR_AFTER(a, b);
+    });
+}
+
+
+void GWEventTraceMerger::const_iterator::__update_current(){
+    if(this->_heap.empty()){
+        this->_current = gw_event_trace_merged_event_t();
+        return;
+    }
+
+    const __gw_cursor_t& top = this->_heap.front();
+    const __gw_run_t& run = (*this->_list_runs)[top.run_index];
+    this->_current.event = (*run.list_events)[top.position];
+    this->_current.timestamp_ns = top.timestamp_ns;
+    this->_current.clock = run.clock;
+}
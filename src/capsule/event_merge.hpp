@@ -0,0 +1,185 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <iterator>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "capsule/event.hpp"
+
+
+/*!
+ *  \brief  an event yielded by the merger, with its begin tick aligned onto the common timeline
+ */
+typedef struct gw_event_trace_merged_event {
+    // the event
+    const GWEvent* event = nullptr;
+
+    // aligned timestamp of the begin of the event (ns since epoch), 0 if the event
+    // doesn't have begin tick
+    uint64_t timestamp_ns = 0;
+
+    // clock domain of ticks within the event
+    const gw_event_trace_clock_t* clock = nullptr;
+} gw_event_trace_merged_event_t;
+
+
+/*!
+ *  \brief  k-way merger of event trace views, e.g., views reported by capsules of
+ *          different ranks, which yields a unified view lazily through iterators
+ *  \note   each thread of each view is a run sorted by begin tick, runs are merged
+ *          with a min-heap of their heads keyed by the aligned timestamp, so iterating
+ *          over N events of k runs costs O(N log k) without copying / re-sorting events;
+ *          views are referenced instead of copied, so they must outlive the merger
+ */
+class GWEventTraceMerger {
+ private:
+    /*!
+     *  \brief  a sorted run of events sharing the same clock domain
+     */
+    typedef struct __gw_run {
+        const std::vector<const GWEvent*>* list_events = nullptr;
+        const gw_event_trace_clock_t* clock = nullptr;
+    } __gw_run_t;
+
+
+    /*!
+     *  \brief  head of a run within the heap
+     */
+    typedef struct __gw_cursor {
+        uint64_t timestamp_ns = 0;
+        uint64_t run_index = 0;
+        uint64_t position = 0;
+    } __gw_cursor_t;
+
+ public:
+    /*!
+     *  \brief  forward iterator over the merged events, in the order of aligned timestamp,
+     *          ties are broken by the order of views / threads being added
+     */
+    class const_iterator {
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = gw_event_trace_merged_event_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const gw_event_trace_merged_event_t*;
+        using reference = const gw_event_trace_merged_event_t&;
+
+        const_iterator() = default;
+
+        inline reference operator*() const { return this->_current; }
+        inline pointer operator->() const { return &this->_current; }
+
+        const_iterator& operator++();
+        inline const_iterator operator++(int){
+            const_iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        friend inline bool operator==(const const_iterator& lhs, const const_iterator& rhs){
+            if(lhs._heap.empty() or rhs._heap.empty())
+                return lhs._heap.empty() and rhs._heap.empty();
+            return lhs._heap.front().run_index == rhs._heap.front().run_index
+                and lhs._heap.front().position == rhs._heap.front().position;
+        }
+        friend inline bool operator!=(const const_iterator& lhs, const const_iterator& rhs){
+            return !(lhs == rhs);
+        }
+
+     private:
+        friend class GWEventTraceMerger;
+
+        /*!
+         *  \brief  push the head of the run starting from the given position into the heap,
+         *          null events are skipped
+         *  \param  run_index   index of the run
+         *  \param  position    position within the run
+         */
+        void __push_run(uint64_t run_index, uint64_t position);
+
+        /*!
+         *  \brief  update the current event from the top of the heap
+         */
+        void __update_current();
+
+        const std::vector<__gw_run_t>* _list_runs = nullptr;
+
+        // min-heap of the heads of runs
+        std::vector<__gw_cursor_t> _heap;
+
+        gw_event_trace_merged_event_t _current;
+    };
+
+
+    /*!
+     *  \brief  constructor
+     */
+    GWEventTraceMerger();
+
+
+    /*!
+     *  \brief  deconstructor
+     */
+    ~GWEventTraceMerger();
+
+
+    /*!
+     *  \brief  add a view to be merged, with the clock domain of the view
+     *  \param  view    the view, which must outlive the merger
+     */
+    void add_view(const GWEventTraceView* view);
+
+
+    /*!
+     *  \brief  add a view to be merged, with the given clock domain
+     *  \param  view    the view, which must outlive the merger
+     *  \param  clock   clock domain of ticks within the view, copied into the merger
+     */
+    void add_view(const GWEventTraceView* view, const gw_event_trace_clock_t& clock);
+
+
+    /*!
+     *  \brief  export the merged events to a trace file, events are streamed in the
+     *          order of aligned timestamp
+     *  \param  path    path to the trace file
+     *  \param  format  format of the trace file (see gw_event_trace_export_format_t)
+     *  \return GW_SUCCESS if success, otherwise the error of the exporter
+     */
+    gw_retval_t export_trace(const std::string& path, uint8_t format) const;
+
+
+    /*!
+     *  \brief  build the clock domain of a capsule from its records within the database of
+     *          the scheduler, i.e., mgnt_cpu.tsc_freq, mgnt_capsule.start_tsc and
+     *          mgnt_capsule.start_time
+     *  \param  tsc_freq    tsc_freq of the node of the capsule, as stored in the database
+     *  \param  start_tsc   start_tsc of the capsule, as stored in the database
+     *  \param  start_time  start_time of the capsule, as stored in the database
+     *  \param  clock       the built clock domain
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed records
+     */
+    static gw_retval_t build_clock(
+        const std::string& tsc_freq, const std::string& start_tsc, const std::string& start_time,
+        gw_event_trace_clock_t& clock
+    );
+
+
+    // iterators
+    const_iterator begin() const;
+    inline const_iterator end() const { return const_iterator(); }
+
+
+    // getters
+    inline uint64_t get_nb_runs() const { return this->_list_runs.size(); }
+
+ private:
+    // sorted runs to be merged
+    std::vector<__gw_run_t> _list_runs;
+
+    // clock domains of added views, deque for stable addresses
+    std::deque<gw_event_trace_clock_t> _list_clocks;
+};
@@ -15,8 +15,6 @@
 
 extern "C" {
 
-static thread_local std::map<CUfunction, std::string> _map_function_name;
-static thread_local std::map<CUfunction, GWKernelDef*> _map_function_kerneldef;
 extern thread_local bool global_cuLaunchKernel_at_first_level;
 
 CUresult cuLaunchCooperativeKernel (
@@ -35,9 +33,7 @@ CUresult cuLaunchCooperativeKernel (
     CUresult cudv_retval = CUDA_SUCCESS;
     const char* func_name = nullptr;
     bool cuLaunchKernel_at_first_level = false;
-    GWKernel *kernel = nullptr;
-    GWKernelDef *kernel_def = nullptr;
-    GWKernelExt_CUDA *kernel_ext = nullptr;
+    gw_capsule_launch_desc_t *launch_desc = nullptr;
 
     GW_CHECK_POINTER(capsule);
     GW_CHECK_POINTER((void*)(f));
@@ -51,58 +47,43 @@ CUresult cuLaunchCooperativeKernel (
         global_cuLaunchKernel_at_first_level = false;
     }
 
-    // obtain function name
-    if(unlikely(cuLaunchKernel_at_first_level && _map_function_name.count(f) == 0)){
-        GW_IF_CUDA_DRIVER_FAILED(
-            cuFuncGetName(&func_name, f),
-            cudv_retval,
-            {
-                func_name = nullptr;
-                GW_WARN("failed to obtain function name: func(%p)", f);
-            }
-        );
-        _map_function_name[f] = func_name;
-    } else {
-        func_name = _map_function_name[f].c_str();
-    }
-
-    // obtain kernel def
-    if(unlikely(_map_function_kerneldef.count(f) == 0)){
-        GW_IF_FAILED(
-            capsule->CUDA_get_kerneldef_by_cufunction(f, kernel_def),
-            gw_retval,
-            {
-                GW_WARN(
-                    "failed to obtain kernel def from capsule: func(%p), err(%s)",
-                    f,
-                    gw_retval_str(gw_retval)
-                );
-                goto execute_real_apis;
-            }
-        );
-        _map_function_kerneldef[f] = kernel_def;
-    } else {
-        kernel_def = _map_function_kerneldef[f];
-    }
+    // obtain launch descriptor of the function
+    GW_IF_FAILED(
+        capsule->CUDA_get_launch_desc(f, launch_desc),
+        gw_retval,
+        {
+            GW_WARN(
+                "failed to obtain kernel def from capsule: func(%p), err(%s)",
+                f,
+                gw_retval_str(gw_retval)
+            );
+            goto execute_real_apis;
+        }
+    );
+    func_name = launch_desc->name.c_str();
 
     // trace kernel launch
     if(cuLaunchKernel_at_first_level && capsule->is_tracing_kernel_launch()){
-        GW_CHECK_POINTER(kernel_ext = GWKernelExt_CUDA::create(kernel_def));
-        GW_CHECK_POINTER(kernel = kernel_ext->get_base_ptr());
-        kernel->block_dim_x = blockDimX;
-        kernel->block_dim_y = blockDimY;
-        kernel->block_dim_z = blockDimZ;
-        kernel->grid_dim_x = gridDimX;
-        kernel->grid_dim_y = gridDimY;
-        kernel->grid_dim_z = gridDimZ;
-        kernel->shared_mem_bytes = sharedMemBytes;
-        kernel->stream = (uint64_t)hStream;
-        kernel_ext->params().params = kernelParams;
-        capsule->append_kernel_launch(kernel);
+        capsule->append_kernel_launch({
+            .launch_desc = launch_desc,
+            .grid_dim_x = gridDimX,
+            .grid_dim_y = gridDimY,
+            .grid_dim_z = gridDimZ,
+            .block_dim_x = blockDimX,
+            .block_dim_y = blockDimY,
+            .block_dim_z = blockDimZ,
+            .shared_mem_bytes = sharedMemBytes,
+            .num_attrs = 0,
+            .stream = (uint64_t)hStream,
+            .launch_tick = GWUtilTscTimer::get_tsc(),
+            .params = kernelParams,
+            .extra = nullptr,
+            .attrs = nullptr
+        });
     }
 
     // trace the function
-    if(unlikely(cuLaunchKernel_at_first_level && capsule->do_need_trace_kernel(func_name))){
+    if(unlikely(cuLaunchKernel_at_first_level && capsule->do_need_trace_kernel(launch_desc))){
         GW_IF_FAILED(
             capsule->CUDA_trace_single_kernel(
                 f, func_name, gridDimX, gridDimY, gridDimZ, blockDimX, blockDimY, blockDimZ,
@@ -15,8 +15,6 @@
 
 extern "C" {
 
-static thread_local std::map<CUfunction, std::string> _map_function_name;
-static thread_local std::map<CUfunction, GWKernelDef*> _map_function_kerneldef;
 extern thread_local bool global_cuLaunchKernel_at_first_level;
 
 CUresult cuLaunchKernelEx_ptsz (
@@ -29,9 +27,7 @@ CUresult cuLaunchKernelEx_ptsz (
     CUresult cudv_retval = CUDA_SUCCESS;
     const char* func_name = nullptr;
     bool cuLaunchKernel_at_first_level = false;
-    GWKernel *kernel = nullptr;
-    GWKernelDef *kernel_def = nullptr;
-    GWKernelExt_CUDA *kernel_ext = nullptr;
+    gw_capsule_launch_desc_t *launch_desc = nullptr;
 
     GW_CHECK_POINTER(capsule);
     GW_CHECK_POINTER((void*)(f));
@@ -45,61 +41,43 @@ CUresult cuLaunchKernelEx_ptsz (
         global_cuLaunchKernel_at_first_level = false;
     }
 
-    // obtain kernel def
-    if(unlikely(_map_function_kerneldef.count(f) == 0)){
-        GW_IF_FAILED(
-            capsule->CUDA_get_kerneldef_by_cufunction(f, kernel_def),
-            gw_retval,
-            {
-                GW_WARN(
-                    "failed to obtain kernel def from capsule: func(%p), err(%s)",
-                    f,
-                    gw_retval_str(gw_retval)
-                );
-                goto execute_real_apis;
-            }
-        );
-        _map_function_kerneldef[f] = kernel_def;
-    } else {
-        kernel_def = _map_function_kerneldef[f];
-    }
-
-    // obtain function name
-    if(unlikely(cuLaunchKernel_at_first_level && _map_function_name.count(f) == 0)){
-        GW_IF_CUDA_DRIVER_FAILED(
-            cuFuncGetName(&func_name, f),
-            cudv_retval,
-            {
-                func_name = nullptr;
-                GW_WARN("failed to obtain function name: func(%p)", f);
-            }
-        );
-        _map_function_name[f] = func_name;
-    } else {
-        func_name = _map_function_name[f].c_str();
-    }
+    // obtain launch descriptor of the function
+    GW_IF_FAILED(
+        capsule->CUDA_get_launch_desc(f, launch_desc),
+        gw_retval,
+        {
+            GW_WARN(
+                "failed to obtain kernel def from capsule: func(%p), err(%s)",
+                f,
+                gw_retval_str(gw_retval)
+            );
+            goto execute_real_apis;
+        }
+    );
+    func_name = launch_desc->name.c_str();
 
     // trace kernel launch
     if(cuLaunchKernel_at_first_level && capsule->is_tracing_kernel_launch()){
-        GW_CHECK_POINTER(kernel_ext = GWKernelExt_CUDA::create(kernel_def));
-        GW_CHECK_POINTER(kernel = kernel_ext->get_base_ptr());
-        kernel->block_dim_x = config->blockDimX;
-        kernel->block_dim_y = config->blockDimY;
-        kernel->block_dim_z = config->blockDimZ;
-        kernel->grid_dim_x = config->gridDimX;
-        kernel->grid_dim_y = config->gridDimY;
-        kernel->grid_dim_z = config->gridDimZ;
-        kernel->shared_mem_bytes = config->sharedMemBytes;
-        kernel->stream = (uint64_t)config->hStream;
-        kernel_ext->params().params = kernelParams;
-        kernel_ext->params().attrs = config->attrs;
-        kernel_ext->params().num_attrs = config->numAttrs;
-        kernel_ext->params().extra = extra;
-        capsule->append_kernel_launch(kernel);
+        capsule->append_kernel_launch({
+            .launch_desc = launch_desc,
+            .grid_dim_x = config->gridDimX,
+            .grid_dim_y = config->gridDimY,
+            .grid_dim_z = config->gridDimZ,
+            .block_dim_x = config->blockDimX,
+            .block_dim_y = config->blockDimY,
+            .block_dim_z = config->blockDimZ,
+            .shared_mem_bytes = config->sharedMemBytes,
+            .num_attrs = config->numAttrs,
+            .stream = (uint64_t)config->hStream,
+            .launch_tick = GWUtilTscTimer::get_tsc(),
+            .params = kernelParams,
+            .extra = extra,
+            .attrs = config->attrs
+        });
     }
 
     // trace the function
-    if(unlikely(cuLaunchKernel_at_first_level && capsule->do_need_trace_kernel(func_name))){
+    if(unlikely(cuLaunchKernel_at_first_level && capsule->do_need_trace_kernel(launch_desc))){
         GW_IF_FAILED(
             capsule->CUDA_trace_single_kernel(
                 f, func_name,
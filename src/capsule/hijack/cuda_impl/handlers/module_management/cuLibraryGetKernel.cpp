@@ -69,7 +69,7 @@ CUresult cuLibraryGetKernel(
         );
 
         GW_IF_FAILED(
-            capsule->CUDA_parse_cufunction(linked_function, linked_module, /* do_parse_entire_binary */ false),
+            capsule->CUDA_parse_cufunction_async(linked_function, linked_module, /* do_parse_entire_binary */ false),
             gw_retval,
             {
                 GW_WARN_DETAIL("failed to parse cufunction: %s", gw_retval_str(gw_retval));
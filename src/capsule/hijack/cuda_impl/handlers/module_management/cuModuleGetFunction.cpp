@@ -43,7 +43,7 @@ CUresult cuModuleGetFunction(
         );
 
         GW_IF_FAILED(
-            capsule->CUDA_parse_cufunction(*hfunc, hmod, /* do_parse_entire_binary */ false),
+            capsule->CUDA_parse_cufunction_async(*hfunc, hmod, /* do_parse_entire_binary */ false),
             gw_retval,
             {
                 GW_WARN_DETAIL("failed to parse cufunction: %s", gw_retval_str(gw_retval));
@@ -0,0 +1,48 @@
+#include <iostream>
+
+#include <dlfcn.h>
+#include <string.h>
+#include <cuda.h>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "capsule/capsule.hpp"
+#include "capsule/hijack/cuda_impl/runtime.hpp"
+#include "common/cuda_impl/real_apis.hpp"
+
+
+CUresult cuModuleUnload(
+    CUmodule hmod
+){
+    gw_retval_t gw_retval = GW_SUCCESS;
+    CUresult cudv_retval = CUDA_SUCCESS;
+
+    GW_CHECK_POINTER(capsule);
+
+    // obtain the real cuda apis
+    __init_real_cuda_apis();
+
+    /* ================ call actual function ================ */
+    cudv_retval = real_cuModuleUnload(hmod);
+    GW_DEBUG("called cuModuleUnload");
+    /* ================ call actual function ================ */
+
+    /* ================ forget the module ================ */
+    if(likely(cudv_retval == CUDA_SUCCESS)){
+        GW_IF_FAILED(
+            capsule->CUDA_unload_cumodule(hmod),
+            gw_retval,
+            {
+                GW_WARN_DETAIL("failed to forget unloaded CUDA module");
+            }
+        );
+    }
+    /* ================ forget the module ================ */
+
+    // if operation isn't success, we sync all previous messages to scheduler to be finished
+    if(cudv_retval != CUDA_SUCCESS){
+        capsule->sync_send_to_scheduler();
+    }
+
+    return cudv_retval;
+}
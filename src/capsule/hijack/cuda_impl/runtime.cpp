@@ -13,6 +13,7 @@
 #include "common/log.hpp"
 #include "common/utils/cuda.hpp"
 #include "common/utils/system.hpp"
+#include "common/utils/timer.hpp"
 #include "capsule/hijack/cuda_impl/runtime.hpp"
 #include "capsule/capsule.hpp"
 
@@ -64,6 +65,9 @@ void gwatch_capsule_init() {
     signal(SIGINT, signal_handler);
     signal(SIGQUIT, signal_handler);
 
+    // calibrate the clock service before any hook reads ticks
+    GWUtilClock::init();
+
     // initialize CUDA driver APIs
     cuInit(0);
 
@@ -150,12 +154,16 @@ void* __hook_cuda_driver_api(const char* symbol){
         return (void*)(cuModuleLoadFatBinary);
     if(strcmp(symbol, "cuModuleGetFunction") == 0)
         return (void*)(cuModuleGetFunction);
+    if(strcmp(symbol, "cuModuleUnload") == 0)
+        return (void*)(cuModuleUnload);
     if(strcmp(symbol, "cuLibraryLoadData") == 0)
         return (void*)(cuLibraryLoadData);
     if(strcmp(symbol, "cuLibraryGetModule") == 0)
         return (void*)(cuLibraryGetModule);
     if(strcmp(symbol, "cuLibraryGetKernel") == 0)
         return (void*)(cuLibraryGetKernel);
+    if(strcmp(symbol, "cuLibraryUnload") == 0)
+        return (void*)(cuLibraryUnload);
 
     /* ======== hijack kernel launching ======== */
     if(strcmp(symbol, "cuLaunchKernel") == 0)
@@ -132,8 +132,9 @@ gw_retval_t GWCapsule::__detect_cpu_topology(gw_capsule_cpu_info_t &cpu_info){
     // obtain global id
     cpu_info.global_id = "cpu-" + cpu_info.ip_addr;
 
-    // obtain TSC frequency
+    // obtain TSC frequency and source of ticks, the frequency is 1 GHz if ticks come from CLOCK_MONOTONIC_RAW
     cpu_info.tsc_freq = this->_tsc_timer.get_tsc_freq();
+    cpu_info.clock_source = GWUtilClock::instance().get_source_name();
 
     // obtain CPU name and number of cores
     cpu_info.num_cpu_cores = 0;
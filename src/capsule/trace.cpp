@@ -8,6 +8,7 @@
 #include "common/instrument.hpp"
 #include "common/assemble/kernel_def.hpp"
 #include "capsule/trace.hpp"
+#include "capsule/trace_matcher.hpp"
 
 
 GWTraceTask::GWTraceTask()
@@ -20,25 +21,18 @@ GWTraceTask::~GWTraceTask()
 
 bool GWTraceTask::do_need_trace(nlohmann::json query) const {
     bool retval = false;
-    std::smatch m;
-    std::regex pattern;
-    std::string kernel_name = "";
-    std::string pattern_str = "";
+    GWTraceTaskMatcher matcher;
 
-    // check whether filtering rule exists
-    if(unlikely(this->_map_metadata.find("match_pattern") == this->_map_metadata.end())){
+    if(unlikely(!query.is_string())){
+        GW_WARN_C("failed to check whether need trace, query isn't a string: query(%s)", query.dump().c_str());
         goto exit;
     }
 
-    pattern_str = this->_map_metadata.at("match_pattern");
-    pattern = std::regex(pattern_str);
-
-    kernel_name = query.get<std::string>();
-    if (std::regex_search(kernel_name, m, pattern)){
-        retval = true;
-    } else {
-        retval = false;
-    }
+    // NOTE(zhuobin): the filters are compiled per call, launch hooks match all trace tasks
+    //                at once via the matcher of the capsule instead
+    if(unlikely(matcher.compile({ const_cast<GWTraceTask*>(this) }) != GW_SUCCESS))
+        goto exit;
+    retval = matcher.match(query.get<std::string>()) != 0;
 
 exit:
     return retval;
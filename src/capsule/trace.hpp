@@ -34,7 +34,7 @@ class GWTraceTask {
     /*!
      *  \brief  destructor
      */
-    ~GWTraceTask();
+    virtual ~GWTraceTask();
 
 
     /*!
@@ -45,8 +45,19 @@ class GWTraceTask {
 
 
     /*!
-     *  \brief  identify whether specific input need current trace task
-     *  \param  query  query
+     *  \brief  obtain types of instrument contexts applied by this trace task,
+     *          which enables instrumenting kernels ahead of their first launch
+     *  \return types of instrument contexts, empty if the trace task doesn't
+     *          support ahead-of-time instrumentation
+     */
+    virtual std::vector<std::string> get_instrument_cxt_types() const { return {}; }
+
+
+    /*!
+     *  \brief  identify whether specific input need current trace task, the kernel name is
+     *          matched against filters within metadata (match_exact / match_substring /
+     *          match_pattern, see GWTraceTaskMatcher)
+     *  \param  query  query, i.e., the kernel name
      *  \return whether specific input need current trace task
      */
     virtual bool do_need_trace(nlohmann::json query) const;
@@ -127,6 +138,15 @@ class GWTraceTask {
     }
 
 
+    /*!
+     *  \brief  obtain all metadata of the trace definition
+     *  \return all metadata of the trace definition
+     */
+    inline const std::map<std::string, nlohmann::json>& get_map_metadata() const {
+        return this->_map_metadata;
+    }
+
+
  protected:
     /*!
      *  \brief  execute the trace application (internally called)
@@ -0,0 +1,941 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <bitset>
+#include <regex>
+#include <deque>
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "capsule/trace.hpp"
+#include "capsule/trace_matcher.hpp"
+
+
+std::atomic<uint64_t> GWTraceTaskMatcher::_version_counter = 0;
+
+
+GWTraceTaskMatcher::GWTraceTaskMatcher(){}
+
+
+GWTraceTaskMatcher::~GWTraceTaskMatcher(){
+    for(GWTraceTaskMatcher* overflow_matcher : this->_list_overflow_matchers)
+        delete overflow_matcher;
+}
+
+
+gw_retval_t GWTraceTaskMatcher::compile(const std::vector<GWTraceTask*>& list_trace_tasks){
+    gw_retval_t retval = GW_SUCCESS;
+    uint32_t i = 0;
+    uint64_t nb_masked_tasks = 0;
+    GWTraceTaskMatcher *overflow_matcher = nullptr;
+    typename std::map<std::string, nlohmann::json>::const_iterator filter_it;
+
+    this->_version = 0;
+    this->_nb_tasks = 0;
+    this->_map_exact.clear();
+    this->_ac_transitions.clear();
+    this->_ac_fails.clear();
+    this->_ac_outputs.clear();
+    this->_list_nfa_states.clear();
+    this->_list_nfa_byte_sets.clear();
+    this->_list_nfa_starts.clear();
+    this->_nfa_start_closure.clear();
+    this->_nfa_visited.clear();
+    this->_map_dfa_states.clear();
+    this->_list_dfa_nfa_sets.clear();
+    this->_dfa_transitions.clear();
+    this->_dfa_accepts.clear();
+    this->_dfa_mask = 0;
+    this->_list_fallback_regex.clear();
+    for(GWTraceTaskMatcher* old_overflow_matcher : this->_list_overflow_matchers)
+        delete old_overflow_matcher;
+    this->_list_overflow_matchers.clear();
+
+    // tasks beyond the match mask are matched per task
+    nb_masked_tasks = std::min<uint64_t>(list_trace_tasks.size(), GW_TRACE_MATCHER_MAX_NB_TASKS);
+    for(i=nb_masked_tasks; i<list_trace_tasks.size(); i++){
+        GW_CHECK_POINTER(overflow_matcher = new GWTraceTaskMatcher());
+        GW_IF_FAILED(
+            overflow_matcher->compile({ list_trace_tasks[i] }),
+            retval,
+            {
+                delete overflow_matcher;
+                goto exit;
+            }
+        );
+        this->_list_overflow_matchers.push_back(overflow_matcher);
+    }
+    if(unlikely(this->_list_overflow_matchers.size() > 0)){
+        GW_DEBUG_C(
+            "trace tasks beyond the match mask are matched per task: nb_trace_tasks(%lu), max(%d)",
+            list_trace_tasks.size(), GW_TRACE_MATCHER_MAX_NB_TASKS
+        );
+    }
+
+    for(i=0; i<nb_masked_tasks; i++){
+        GW_CHECK_POINTER(list_trace_tasks[i]);
+        for(const char* key : { "match_exact", "match_substring", "match_pattern" }){
+            filter_it = list_trace_tasks[i]->get_map_metadata().find(key);
+            if(filter_it == list_trace_tasks[i]->get_map_metadata().end())
+                continue;
+            if(filter_it->second.is_string()){
+                this->__add_filter(key, filter_it->second.get<std::string>(), i);
+            } else if(filter_it->second.is_array()){
+                for(const nlohmann::json& filter : filter_it->second){
+                    if(likely(filter.is_string()))
+                        this->__add_filter(key, filter.get<std::string>(), i);
+                    else
+                        GW_WARN_C("skipped non-string filter of trace task: key(%s), filter(%s)", key, filter.dump().c_str());
+                }
+            } else {
+                GW_WARN_C("skipped non-string filter of trace task: key(%s), filter(%s)", key, filter_it->second.dump().c_str());
+            }
+        }
+    }
+
+    if(this->_ac_transitions.size() > 0)
+        this->__build_aho_corasick();
+
+    if(this->_list_nfa_starts.size() > 0){
+        this->_nfa_visited.assign(this->_list_nfa_states.size(), 0);
+        this->_nfa_visit_generation += 1;
+        for(int32_t start : this->_list_nfa_starts)
+            this->__add_nfa_closure(start, this->_nfa_start_closure);
+        std::sort(this->_nfa_start_closure.begin(), this->_nfa_start_closure.end());
+        this->__reset_dfa();
+    }
+
+    this->_nb_tasks = list_trace_tasks.size();
+    if(this->_nb_tasks > 0)
+        this->_version = this->_version_counter.fetch_add(1) + 1;
+
+exit:
+    return retval;
+}
+
+
+uint64_t GWTraceTaskMatcher::match(const std::string& name){
+    uint64_t mask = 0;
+    int32_t node = 0, dfa_state = 0, last_dfa_state = 0;
+    uint64_t i = 0;
+    typename std::unordered_map<std::string, uint64_t>::iterator exact_it;
+
+    if(!this->_map_exact.empty()){
+        exact_it = this->_map_exact.find(name);
+        if(exact_it != this->_map_exact.end())
+            mask |= exact_it->second;
+    }
+
+    if(this->_ac_transitions.size() > 0){
+        mask |= this->_ac_outputs[0];
+        for(const char c : name){
+            node = this->_ac_transitions[node][static_cast<uint8_t>(c)];
+            mask |= this->_ac_outputs[node];
+        }
+    }
+
+    if(this->_dfa_mask != 0){
+        dfa_state = this->__step_dfa(0, __GW_DFA_SYMBOL_BEGIN);
+        mask |= this->_dfa_accepts[0] | this->_dfa_accepts[dfa_state];
+        for(const char c : name){
+            // all patterns have been matched
+            if((mask & this->_dfa_mask) == this->_dfa_mask)
+                break;
+            dfa_state = this->__step_dfa(dfa_state, static_cast<uint8_t>(c));
+            mask |= this->_dfa_accepts[dfa_state];
+        }
+        if((mask & this->_dfa_mask) != this->_dfa_mask){
+            dfa_state = this->__step_dfa(dfa_state, __GW_DFA_SYMBOL_END);
+            mask |= this->_dfa_accepts[dfa_state];
+
+            // both begin and end hold on an empty name, which is asserted alternately until
+            // no new NFA state is reached, as sets only grow under zero-width symbols
+            for(i=0; name.empty() and i<this->_list_nfa_states.size(); i++){
+                last_dfa_state = dfa_state;
+                dfa_state = this->__step_dfa(dfa_state, __GW_DFA_SYMBOL_BEGIN);
+                dfa_state = this->__step_dfa(dfa_state, __GW_DFA_SYMBOL_END);
+                mask |= this->_dfa_accepts[dfa_state];
+                if(dfa_state == last_dfa_state)
+                    break;
+            }
+        }
+    }
+
+    for(auto& [pattern, task_mask] : this->_list_fallback_regex){
+        if((mask & task_mask) != 0)
+            continue;
+        if(std::regex_search(name, pattern))
+            mask |= task_mask;
+    }
+
+    return mask;
+}
+
+
+bool GWTraceTaskMatcher::match_any(const std::string& name){
+    if(this->match(name) != 0)
+        return true;
+    for(GWTraceTaskMatcher* overflow_matcher : this->_list_overflow_matchers){
+        if(overflow_matcher->match(name) != 0)
+            return true;
+    }
+    return false;
+}
+
+
+void GWTraceTaskMatcher::__add_filter(const std::string& key, const std::string& filter, uint32_t task_index){
+    uint64_t task_mask = 1ul << task_index;
+    int32_t node = 0, next_node = 0;
+    __gw_regex_node_t regex_root;
+    __gw_nfa_fragment_t fragment;
+    int32_t match_state = 0;
+    std::string literal = "";
+    bool is_begin_anchored = false, is_end_anchored = false;
+
+    if(key == "match_exact"){
+        this->_map_exact[filter] |= task_mask;
+    } else if(key == "match_substring"){
+        // insert into the trie, transitions are completed once all substrings are inserted
+        if(this->_ac_transitions.size() == 0){
+            this->_ac_transitions.emplace_back().fill(-1);
+            this->_ac_outputs.push_back(0);
+        }
+        for(const char c : filter){
+            next_node = this->_ac_transitions[node][static_cast<uint8_t>(c)];
+            if(next_node < 0){
+                next_node = this->_ac_transitions.size();
+                this->_ac_transitions[node][static_cast<uint8_t>(c)] = next_node;
+                this->_ac_transitions.emplace_back().fill(-1);
+                this->_ac_outputs.push_back(0);
+            }
+            node = next_node;
+        }
+        this->_ac_outputs[node] |= task_mask;
+    } else {
+        __GWRegexParser parser(filter);
+        if(parser.parse(regex_root) == GW_SUCCESS){
+            // literal patterns are cheaper to be matched as exact names / substrings
+            if(__get_regex_literal(regex_root, literal, is_begin_anchored, is_end_anchored)){
+                if(is_begin_anchored and is_end_anchored){
+                    this->__add_filter("match_exact", literal, task_index);
+                    return;
+                } else if(!is_begin_anchored and !is_end_anchored){
+                    this->__add_filter("match_substring", literal, task_index);
+                    return;
+                }
+            }
+            fragment = this->__compile_nfa(regex_root);
+            match_state = this->__add_nfa_state(__GW_NFA_STATE_MATCH);
+            this->_list_nfa_states[match_state].task_index = task_index;
+            this->__patch_nfa_fragment(fragment, match_state);
+            this->_list_nfa_starts.push_back(fragment.start);
+            this->_dfa_mask |= task_mask;
+        } else {
+            try {
+                this->_list_fallback_regex.emplace_back(std::regex(filter), task_mask);
+                GW_DEBUG_C("pattern falls back to std::regex: pattern(%s)", filter.c_str());
+            } catch (const std::regex_error& e) {
+                GW_WARN_C("skipped malformed pattern of trace task: pattern(%s), error(%s)", filter.c_str(), e.what());
+            }
+        }
+    }
+}
+
+
+void GWTraceTaskMatcher::__build_aho_corasick(){
+    std::deque<int32_t> queue;
+    int32_t node = 0, next_node = 0;
+    uint32_t c = 0;
+
+    this->_ac_fails.assign(this->_ac_transitions.size(), 0);
+
+    // breadth-first, so that fail links point to nodes whose transitions are completed
+    for(c=0; c<256; c++){
+        next_node = this->_ac_transitions[0][c];
+        if(next_node < 0){
+            this->_ac_transitions[0][c] = 0;
+        } else {
+            this->_ac_fails[next_node] = 0;
+            queue.push_back(next_node);
+        }
+    }
+    while(!queue.empty()){
+        node = queue.front();
+        queue.pop_front();
+        this->_ac_outputs[node] |= this->_ac_outputs[this->_ac_fails[node]];
+        for(c=0; c<256; c++){
+            next_node = this->_ac_transitions[node][c];
+            if(next_node < 0){
+                this->_ac_transitions[node][c] = this->_ac_transitions[this->_ac_fails[node]][c];
+            } else {
+                this->_ac_fails[next_node] = this->_ac_transitions[this->_ac_fails[node]][c];
+                queue.push_back(next_node);
+            }
+        }
+    }
+}
+
+
+/* ==================== NFA / DFA ==================== */
+int32_t GWTraceTaskMatcher::__add_nfa_state(__gw_nfa_state_kind_t kind, uint32_t byte_set_index){
+    __gw_nfa_state_t state;
+    state.kind = kind;
+    state.byte_set_index = byte_set_index;
+    this->_list_nfa_states.push_back(state);
+    return this->_list_nfa_states.size() - 1;
+}
+
+
+void GWTraceTaskMatcher::__patch_nfa_fragment(const __gw_nfa_fragment_t& fragment, int32_t state_index){
+    for(auto& [dangling_state, is_alt] : fragment.list_dangling_outs){
+        if(is_alt)
+            this->_list_nfa_states[dangling_state].out_alt = state_index;
+        else
+            this->_list_nfa_states[dangling_state].out = state_index;
+    }
+}
+
+
+GWTraceTaskMatcher::__gw_nfa_fragment_t GWTraceTaskMatcher::__compile_nfa(const __gw_regex_node_t& node){
+    __gw_nfa_fragment_t fragment, child_fragment;
+    int32_t state = 0;
+    uint32_t i = 0;
+    bool is_empty = true;
+
+    // append the child fragment to the fragment
+    auto __concat = [&](__gw_nfa_fragment_t&& next){
+        if(is_empty){
+            fragment = std::move(next);
+            is_empty = false;
+        } else {
+            this->__patch_nfa_fragment(fragment, next.start);
+            fragment.list_dangling_outs = std::move(next.list_dangling_outs);
+        }
+    };
+
+    switch(node.kind){
+    case __GW_REGEX_NODE_BYTE_SET:
+        this->_list_nfa_byte_sets.push_back(node.byte_set);
+        state = this->__add_nfa_state(__GW_NFA_STATE_BYTE_SET, this->_list_nfa_byte_sets.size() - 1);
+        return { state, { { state, false } } };
+
+    case __GW_REGEX_NODE_BEGIN:
+        state = this->__add_nfa_state(__GW_NFA_STATE_BEGIN);
+        return { state, { { state, false } } };
+
+    case __GW_REGEX_NODE_END:
+        state = this->__add_nfa_state(__GW_NFA_STATE_END);
+        return { state, { { state, false } } };
+
+    case __GW_REGEX_NODE_CONCAT:
+        for(const __gw_regex_node_t& child : node.children)
+            __concat(this->__compile_nfa(child));
+        break;
+
+    case __GW_REGEX_NODE_ALTERNATE:
+        for(const __gw_regex_node_t& child : node.children){
+            child_fragment = this->__compile_nfa(child);
+            if(is_empty){
+                fragment = std::move(child_fragment);
+                is_empty = false;
+                continue;
+            }
+            state = this->__add_nfa_state(__GW_NFA_STATE_SPLIT);
+            this->_list_nfa_states[state].out = fragment.start;
+            this->_list_nfa_states[state].out_alt = child_fragment.start;
+            fragment.start = state;
+            fragment.list_dangling_outs.insert(
+                fragment.list_dangling_outs.end(),
+                child_fragment.list_dangling_outs.begin(), child_fragment.list_dangling_outs.end()
+            );
+        }
+        break;
+
+    case __GW_REGEX_NODE_REPEAT:
+        GW_ASSERT(node.children.size() == 1);
+        for(i=0; i<node.min_repeat; i++)
+            __concat(this->__compile_nfa(node.children[0]));
+        if(node.max_repeat == UINT32_MAX){
+            // loop back to the split after each iteration
+            child_fragment = this->__compile_nfa(node.children[0]);
+            state = this->__add_nfa_state(__GW_NFA_STATE_SPLIT);
+            this->_list_nfa_states[state].out = child_fragment.start;
+            this->__patch_nfa_fragment(child_fragment, state);
+            __concat({ state, { { state, true } } });
+        } else {
+            for(i=node.min_repeat; i<node.max_repeat; i++){
+                child_fragment = this->__compile_nfa(node.children[0]);
+                state = this->__add_nfa_state(__GW_NFA_STATE_SPLIT);
+                this->_list_nfa_states[state].out = child_fragment.start;
+                child_fragment.start = state;
+                child_fragment.list_dangling_outs.push_back({ state, true });
+                __concat(std::move(child_fragment));
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    // empty pattern
+    if(is_empty){
+        state = this->__add_nfa_state(__GW_NFA_STATE_SPLIT);
+        return { state, { { state, false } } };
+    }
+
+    return fragment;
+}
+
+
+void GWTraceTaskMatcher::__add_nfa_closure(int32_t state_index, std::vector<int32_t>& set){
+    std::vector<int32_t> stack = { state_index };
+    int32_t current = 0;
+
+    while(!stack.empty()){
+        current = stack.back();
+        stack.pop_back();
+        if(current < 0 or this->_nfa_visited[current] == this->_nfa_visit_generation)
+            continue;
+        this->_nfa_visited[current] = this->_nfa_visit_generation;
+
+        const __gw_nfa_state_t& state = this->_list_nfa_states[current];
+        if(state.kind == __GW_NFA_STATE_SPLIT){
+            stack.push_back(state.out_alt);
+            stack.push_back(state.out);
+        } else {
+            set.push_back(current);
+        }
+    }
+}
+
+
+int32_t GWTraceTaskMatcher::__intern_dfa_state(std::vector<int32_t>&& set){
+    uint64_t accept = 0;
+    int32_t dfa_state_index = 0;
+
+    auto [it, is_inserted] = this->_map_dfa_states.emplace(std::move(set), this->_list_dfa_nfa_sets.size());
+    if(!is_inserted)
+        return it->second;
+
+    for(int32_t nfa_state_index : it->first){
+        if(this->_list_nfa_states[nfa_state_index].kind == __GW_NFA_STATE_MATCH)
+            accept |= 1ul << this->_list_nfa_states[nfa_state_index].task_index;
+    }
+
+    dfa_state_index = it->second;
+    this->_list_dfa_nfa_sets.push_back(&it->first);
+    this->_dfa_transitions.emplace_back().fill(-1);
+    this->_dfa_accepts.push_back(accept);
+
+    return dfa_state_index;
+}
+
+
+int32_t GWTraceTaskMatcher::__step_dfa(int32_t dfa_state_index, uint32_t symbol){
+    int32_t next_dfa_state_index = this->_dfa_transitions[dfa_state_index][symbol];
+    std::vector<int32_t> next_set;
+    uint64_t i = 0;
+    bool is_reset = false;
+
+    if(likely(next_dfa_state_index >= 0))
+        return next_dfa_state_index;
+
+    this->_nfa_visit_generation += 1;
+
+    if(symbol == __GW_DFA_SYMBOL_BEGIN or symbol == __GW_DFA_SYMBOL_END){
+        // begin / end are zero-width, so that states not consuming them remain, and states
+        // reached by consuming them could consume them again at the same position (e.g.,
+        // a$$, ^c*^), so the set is stepped until no new state is reached
+        for(int32_t nfa_state_index : *this->_list_dfa_nfa_sets[dfa_state_index]){
+            this->_nfa_visited[nfa_state_index] = this->_nfa_visit_generation;
+            next_set.push_back(nfa_state_index);
+        }
+        for(i=0; i<next_set.size(); i++){
+            const __gw_nfa_state_t& state = this->_list_nfa_states[next_set[i]];
+            if(
+                (state.kind == __GW_NFA_STATE_BEGIN and symbol == __GW_DFA_SYMBOL_BEGIN)
+                or (state.kind == __GW_NFA_STATE_END and symbol == __GW_DFA_SYMBOL_END)
+            ){
+                this->__add_nfa_closure(state.out, next_set);
+            }
+        }
+    } else {
+        for(int32_t nfa_state_index : *this->_list_dfa_nfa_sets[dfa_state_index]){
+            const __gw_nfa_state_t& state = this->_list_nfa_states[nfa_state_index];
+            if(state.kind == __GW_NFA_STATE_BYTE_SET and this->_list_nfa_byte_sets[state.byte_set_index].test(symbol))
+                this->__add_nfa_closure(state.out, next_set);
+        }
+    }
+
+    // patterns are searched, so that they could start from any position
+    for(int32_t nfa_state_index : this->_nfa_start_closure){
+        if(this->_nfa_visited[nfa_state_index] == this->_nfa_visit_generation)
+            continue;
+        this->_nfa_visited[nfa_state_index] = this->_nfa_visit_generation;
+        next_set.push_back(nfa_state_index);
+    }
+    std::sort(next_set.begin(), next_set.end());
+
+    // NOTE(zhuobin): flushing the cache invalidates the current state, so the transition isn't recorded
+    if(unlikely(this->_map_dfa_states.size() >= GW_TRACE_MATCHER_MAX_NB_DFA_STATES)){
+        this->__reset_dfa();
+        is_reset = true;
+    }
+
+    next_dfa_state_index = this->__intern_dfa_state(std::move(next_set));
+    if(likely(!is_reset))
+        this->_dfa_transitions[dfa_state_index][symbol] = next_dfa_state_index;
+
+    return next_dfa_state_index;
+}
+
+
+void GWTraceTaskMatcher::__reset_dfa(){
+    this->_map_dfa_states.clear();
+    this->_list_dfa_nfa_sets.clear();
+    this->_dfa_transitions.clear();
+    this->_dfa_accepts.clear();
+
+    // state 0 is the start state
+    this->__intern_dfa_state(std::vector<int32_t>(this->_nfa_start_closure));
+}
+/* ==================== NFA / DFA ==================== */
+
+
+/* ==================== Regex Parsing ==================== */
+bool GWTraceTaskMatcher::__get_regex_literal(
+    const __gw_regex_node_t& node, std::string& literal, bool& is_begin_anchored, bool& is_end_anchored
+){
+    uint64_t i = 0, nb_children = 0;
+
+    literal.clear();
+    is_begin_anchored = false;
+    is_end_anchored = false;
+
+    if(node.kind == __GW_REGEX_NODE_EMPTY)
+        return true;
+    if(node.kind != __GW_REGEX_NODE_CONCAT)
+        return __get_regex_literal({ .kind = __GW_REGEX_NODE_CONCAT, .children = { node } }, literal, is_begin_anchored, is_end_anchored);
+
+    nb_children = node.children.size();
+    for(i=0; i<nb_children; i++){
+        const __gw_regex_node_t& child = node.children[i];
+        if(child.kind == __GW_REGEX_NODE_BEGIN and i == 0){
+            is_begin_anchored = true;
+        } else if(child.kind == __GW_REGEX_NODE_END and i == nb_children - 1){
+            is_end_anchored = true;
+        } else if(child.kind == __GW_REGEX_NODE_BYTE_SET and child.byte_set.count() == 1){
+            for(uint32_t c=0; c<256; c++){
+                if(child.byte_set.test(c)){
+                    literal.push_back(static_cast<char>(c));
+                    break;
+                }
+            }
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+gw_retval_t GWTraceTaskMatcher::__GWRegexParser::parse(__gw_regex_node_t& node){
+    gw_retval_t retval = GW_SUCCESS;
+
+    this->_pos = 0;
+    if(unlikely((retval = this->__parse_alternate(node)) != GW_SUCCESS))
+        goto exit;
+
+    // unbalanced parenthesis
+    if(unlikely(!this->__is_end()))
+        retval = GW_FAILED_NOT_IMPLEMENTAED;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTaskMatcher::__GWRegexParser::__parse_alternate(__gw_regex_node_t& node){
+    gw_retval_t retval = GW_SUCCESS;
+    __gw_regex_node_t child;
+
+    if(unlikely((retval = this->__parse_concat(node)) != GW_SUCCESS))
+        goto exit;
+    if(this->__is_end() or this->__peek() != '|')
+        goto exit;
+
+    child = std::move(node);
+    node = __gw_regex_node_t();
+    node.kind = __GW_REGEX_NODE_ALTERNATE;
+    node.children.push_back(std::move(child));
+    while(!this->__is_end() and this->__peek() == '|'){
+        this->_pos += 1;
+        child = __gw_regex_node_t();
+        if(unlikely((retval = this->__parse_concat(child)) != GW_SUCCESS))
+            goto exit;
+        node.children.push_back(std::move(child));
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTaskMatcher::__GWRegexParser::__parse_concat(__gw_regex_node_t& node){
+    gw_retval_t retval = GW_SUCCESS;
+    __gw_regex_node_t child;
+
+    node.kind = __GW_REGEX_NODE_CONCAT;
+    while(!this->__is_end() and this->__peek() != '|' and this->__peek() != ')'){
+        child = __gw_regex_node_t();
+        if(unlikely((retval = this->__parse_repeat(child)) != GW_SUCCESS))
+            goto exit;
+        node.children.push_back(std::move(child));
+    }
+
+    if(node.children.size() == 0){
+        node.kind = __GW_REGEX_NODE_EMPTY;
+    } else if(node.children.size() == 1){
+        child = std::move(node.children[0]);
+        node = std::move(child);
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTaskMatcher::__GWRegexParser::__parse_repeat(__gw_regex_node_t& node){
+    gw_retval_t retval = GW_SUCCESS;
+    __gw_regex_node_t child;
+    uint32_t min_repeat = 0, max_repeat = 0;
+    char c = 0;
+
+    if(unlikely((retval = this->__parse_atom(node)) != GW_SUCCESS))
+        goto exit;
+    if(this->__is_end())
+        goto exit;
+
+    c = this->__peek();
+    if(c == '*'){
+        min_repeat = 0; max_repeat = UINT32_MAX;
+        this->_pos += 1;
+    } else if(c == '+'){
+        min_repeat = 1; max_repeat = UINT32_MAX;
+        this->_pos += 1;
+    } else if(c == '?'){
+        min_repeat = 0; max_repeat = 1;
+        this->_pos += 1;
+    } else if(c == '{'){
+        this->_pos += 1;
+        if(!this->__parse_number(min_repeat)){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+        max_repeat = min_repeat;
+        if(!this->__is_end() and this->__peek() == ','){
+            this->_pos += 1;
+            if(!this->__parse_number(max_repeat))
+                max_repeat = UINT32_MAX;
+        }
+        if(this->__is_end() or this->__peek() != '}' or max_repeat < min_repeat){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+        this->_pos += 1;
+        if(
+            min_repeat > GW_TRACE_MATCHER_MAX_REPEAT
+            or (max_repeat != UINT32_MAX and max_repeat > GW_TRACE_MATCHER_MAX_REPEAT)
+        ){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+    } else {
+        goto exit;
+    }
+
+    // assertions can't be repeated
+    if(node.kind == __GW_REGEX_NODE_BEGIN or node.kind == __GW_REGEX_NODE_END){
+        retval = GW_FAILED_NOT_IMPLEMENTAED;
+        goto exit;
+    }
+
+    // lazy quantifier doesn't change whether the pattern is found
+    if(!this->__is_end() and this->__peek() == '?')
+        this->_pos += 1;
+
+    // nested quantifiers (e.g., a**) are malformed
+    if(!this->__is_end() and std::string("*+?{").find(this->__peek()) != std::string::npos){
+        retval = GW_FAILED_NOT_IMPLEMENTAED;
+        goto exit;
+    }
+
+    child = std::move(node);
+    node = __gw_regex_node_t();
+    node.kind = __GW_REGEX_NODE_REPEAT;
+    node.min_repeat = min_repeat;
+    node.max_repeat = max_repeat;
+    node.children.push_back(std::move(child));
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTaskMatcher::__GWRegexParser::__parse_atom(__gw_regex_node_t& node){
+    gw_retval_t retval = GW_SUCCESS;
+    char c = this->__peek();
+
+    switch(c){
+    case '(':
+        this->_pos += 1;
+        if(!this->__is_end() and this->__peek() == '?'){
+            // only non-capturing group is supported, lookaround isn't
+            if(this->_pos + 1 >= this->_pattern.size() or this->_pattern[this->_pos + 1] != ':'){
+                retval = GW_FAILED_NOT_IMPLEMENTAED;
+                goto exit;
+            }
+            this->_pos += 2;
+        }
+        if(unlikely((retval = this->__parse_alternate(node)) != GW_SUCCESS))
+            goto exit;
+        if(this->__is_end() or this->__peek() != ')'){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+        this->_pos += 1;
+        break;
+
+    case '[':
+        node.kind = __GW_REGEX_NODE_BYTE_SET;
+        if(unlikely((retval = this->__parse_class(node.byte_set)) != GW_SUCCESS))
+            goto exit;
+        break;
+
+    case '.':
+        node.kind = __GW_REGEX_NODE_BYTE_SET;
+        node.byte_set.set();
+        node.byte_set.reset('\n');
+        node.byte_set.reset('\r');
+        this->_pos += 1;
+        break;
+
+    case '^':
+        node.kind = __GW_REGEX_NODE_BEGIN;
+        this->_pos += 1;
+        break;
+
+    case '$':
+        node.kind = __GW_REGEX_NODE_END;
+        this->_pos += 1;
+        break;
+
+    case '\\':
+        node.kind = __GW_REGEX_NODE_BYTE_SET;
+        if(unlikely((retval = this->__parse_escape(node.byte_set, /* in_class */ false)) != GW_SUCCESS))
+            goto exit;
+        break;
+
+    case '*': case '+': case '?': case '{':
+        // nothing to repeat
+        retval = GW_FAILED_NOT_IMPLEMENTAED;
+        break;
+
+    default:
+        node.kind = __GW_REGEX_NODE_BYTE_SET;
+        node.byte_set.set(static_cast<uint8_t>(c));
+        this->_pos += 1;
+        break;
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTaskMatcher::__GWRegexParser::__parse_class(std::bitset<256>& byte_set){
+    gw_retval_t retval = GW_SUCCESS;
+    std::bitset<256> item_set;
+    bool is_negated = false;
+    uint32_t low = 0, high = 0, c = 0;
+
+    // obtain a single character of the class, which could be an endpoint of a range
+    auto __parse_class_char = [&](std::bitset<256>& set, uint32_t& single_char) -> gw_retval_t {
+        gw_retval_t _retval = GW_SUCCESS;
+        set.reset();
+        if(this->__peek() == '\\'){
+            if(unlikely((_retval = this->__parse_escape(set, /* in_class */ true)) != GW_SUCCESS))
+                return _retval;
+        } else {
+            set.set(static_cast<uint8_t>(this->__peek()));
+            this->_pos += 1;
+        }
+        single_char = 256;
+        if(set.count() == 1){
+            for(single_char=0; single_char<256 and !set.test(single_char); single_char++);
+        }
+        return _retval;
+    };
+
+    // skip '['
+    this->_pos += 1;
+    if(!this->__is_end() and this->__peek() == '^'){
+        is_negated = true;
+        this->_pos += 1;
+    }
+
+    while(true){
+        if(this->__is_end()){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+        if(this->__peek() == ']'){
+            this->_pos += 1;
+            break;
+        }
+        if(this->__peek() == '[' and this->_pos + 1 < this->_pattern.size()
+            and std::string(":=.").find(this->_pattern[this->_pos + 1]) != std::string::npos
+        ){
+            // posix classes (e.g., [[:alpha:]]) aren't supported
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+
+        if(unlikely((retval = __parse_class_char(item_set, low)) != GW_SUCCESS))
+            goto exit;
+
+        // range
+        if(
+            this->_pos + 1 < this->_pattern.size()
+            and this->__peek() == '-' and this->_pattern[this->_pos + 1] != ']'
+        ){
+            this->_pos += 1;
+            if(unlikely((retval = __parse_class_char(item_set, high)) != GW_SUCCESS))
+                goto exit;
+            if(low >= 256 or high >= 256 or high < low){
+                retval = GW_FAILED_NOT_IMPLEMENTAED;
+                goto exit;
+            }
+            for(c=low; c<=high; c++)
+                byte_set.set(c);
+        } else {
+            byte_set |= item_set;
+        }
+    }
+
+    if(is_negated)
+        byte_set.flip();
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceTaskMatcher::__GWRegexParser::__parse_escape(std::bitset<256>& byte_set, bool in_class){
+    gw_retval_t retval = GW_SUCCESS;
+    std::bitset<256> tmp_set;
+    uint32_t c = 0, i = 0;
+    char escaped = 0;
+
+    auto __set_range = [&](std::bitset<256>& set, char low, char high){
+        for(uint32_t _c=static_cast<uint8_t>(low); _c<=static_cast<uint8_t>(high); _c++)
+            set.set(_c);
+    };
+    auto __hex_value = [](char h) -> int {
+        if(h >= '0' and h <= '9') return h - '0';
+        if(h >= 'a' and h <= 'f') return h - 'a' + 10;
+        if(h >= 'A' and h <= 'F') return h - 'A' + 10;
+        return -1;
+    };
+
+    // skip '\'
+    this->_pos += 1;
+    if(this->__is_end()){
+        retval = GW_FAILED_NOT_IMPLEMENTAED;
+        goto exit;
+    }
+    escaped = this->__peek();
+    this->_pos += 1;
+
+    switch(escaped){
+    case 'd': case 'D':
+        __set_range(tmp_set, '0', '9');
+        byte_set |= (escaped == 'd') ? tmp_set : ~tmp_set;
+        break;
+    case 'w': case 'W':
+        __set_range(tmp_set, '0', '9');
+        __set_range(tmp_set, 'a', 'z');
+        __set_range(tmp_set, 'A', 'Z');
+        tmp_set.set('_');
+        byte_set |= (escaped == 'w') ? tmp_set : ~tmp_set;
+        break;
+    case 's': case 'S':
+        for(const char space : { ' ', '\t', '\n', '\r', '\f', '\v' })
+            tmp_set.set(static_cast<uint8_t>(space));
+        byte_set |= (escaped == 's') ? tmp_set : ~tmp_set;
+        break;
+    case 't': byte_set.set('\t'); break;
+    case 'n': byte_set.set('\n'); break;
+    case 'r': byte_set.set('\r'); break;
+    case 'f': byte_set.set('\f'); break;
+    case 'v': byte_set.set('\v'); break;
+    case '0':
+        if(!this->__is_end() and std::isdigit(this->__peek())){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+        byte_set.set(0);
+        break;
+    case 'x':
+        for(i=0; i<2; i++){
+            if(this->__is_end() or __hex_value(this->__peek()) < 0){
+                retval = GW_FAILED_NOT_IMPLEMENTAED;
+                goto exit;
+            }
+            c = c * 16 + __hex_value(this->__peek());
+            this->_pos += 1;
+        }
+        byte_set.set(c);
+        break;
+    case 'b':
+        // backspace within class, word boundary otherwise
+        if(!in_class){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+        byte_set.set('\b');
+        break;
+    default:
+        // backreference, word boundary, unicode escapes, etc. aren't supported
+        if(std::isalnum(static_cast<uint8_t>(escaped))){
+            retval = GW_FAILED_NOT_IMPLEMENTAED;
+            goto exit;
+        }
+        byte_set.set(static_cast<uint8_t>(escaped));
+        break;
+    }
+
+exit:
+    return retval;
+}
+
+
+bool GWTraceTaskMatcher::__GWRegexParser::__parse_number(uint32_t& number){
+    uint64_t start_pos = this->_pos;
+
+    number = 0;
+    while(!this->__is_end() and std::isdigit(static_cast<uint8_t>(this->__peek()))){
+        number = std::min<uint64_t>(static_cast<uint64_t>(number) * 10 + (this->__peek() - '0'), UINT32_MAX - 1);
+        this->_pos += 1;
+    }
+
+    return this->_pos > start_pos;
+}
+/* ==================== Regex Parsing ==================== */
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <bitset>
+#include <regex>
+#include <atomic>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "capsule/trace.hpp"
+
+
+// maximum number of trace tasks matched in one pass, each task is a bit of the match mask,
+// tasks beyond it fall back to be matched per task
+#define GW_TRACE_MATCHER_MAX_NB_TASKS       64
+
+// maximum number of cached DFA states, the cache is flushed once it's exceeded
+#define GW_TRACE_MATCHER_MAX_NB_DFA_STATES  4096
+
+// maximum bound of counted repetition (i.e., {m,n}) compiled into the DFA
+#define GW_TRACE_MATCHER_MAX_REPEAT         64
+
+
+/*!
+ *  \brief  matcher of kernel names against filters of a set of trace tasks, filters are
+ *          compiled up front, and a kernel name is matched against all tasks in one pass
+ *  \note   filters are read from the metadata of trace tasks, each could be a string or a
+ *          list of strings, and a task matches a kernel name if any of its filters does:
+ *          (1) match_exact: the kernel name equals to the filter, matched via a hash map;
+ *          (2) match_substring: the kernel name contains the filter, matched via an
+ *              Aho-Corasick automaton of all substrings;
+ *          (3) match_pattern: ECMAScript regex searched within the kernel name, literal
+ *              patterns are folded into (1) / (2), others are compiled into a combined
+ *              DFA built lazily from the NFA of all patterns, and patterns beyond the
+ *              supported syntax (e.g., backreference, lookaround) fall back to std::regex;
+ *          the matcher isn't thread safe, as DFA states are built while matching;
+ *          only the first GW_TRACE_MATCHER_MAX_NB_TASKS tasks fit in the match mask, each task
+ *          beyond them is compiled into a matcher of its own and checked via is_matched()
+ */
+class GWTraceTaskMatcher {
+ public:
+    /*!
+     *  \brief  constructor
+     */
+    GWTraceTaskMatcher();
+
+
+    /*!
+     *  \brief  deconstructor
+     */
+    ~GWTraceTaskMatcher();
+
+
+    /*!
+     *  \brief  compile filters of the trace tasks, the i-th task is the i-th bit of match masks,
+     *          the matcher obtains a new version after each compilation
+     *  \param  list_trace_tasks    the trace tasks
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t compile(const std::vector<GWTraceTask*>& list_trace_tasks);
+
+
+    /*!
+     *  \brief  match the kernel name against the first GW_TRACE_MATCHER_MAX_NB_TASKS trace tasks
+     *  \param  name    the kernel name
+     *  \return mask of matched trace tasks
+     */
+    uint64_t match(const std::string& name);
+
+
+    /*!
+     *  \brief  check whether the i-th trace task matches the kernel name
+     *  \param  name        the kernel name
+     *  \param  mask        mask returned by match() on the same kernel name
+     *  \param  task_index  index of the trace task
+     *  \return whether the trace task matches
+     */
+    inline bool is_matched(const std::string& name, uint64_t mask, uint64_t task_index){
+        if(likely(task_index < GW_TRACE_MATCHER_MAX_NB_TASKS))
+            return mask & (1ul << task_index);
+        if(unlikely(task_index >= this->_nb_tasks))
+            return false;
+        return this->_list_overflow_matchers[task_index - GW_TRACE_MATCHER_MAX_NB_TASKS]->match(name) != 0;
+    }
+
+
+    /*!
+     *  \brief  check whether any trace task matches the kernel name
+     *  \param  name    the kernel name
+     *  \return whether any trace task matches
+     */
+    bool match_any(const std::string& name);
+
+
+    /*!
+     *  \brief  obtain the version of the compiled filters, versions are unique within the
+     *          process, so that results could be cached by (version, kernel name) even
+     *          if they come from different matchers; 0 if no trace task is compiled
+     *  \return the version
+     */
+    inline uint64_t get_version() const { return this->_version; }
+
+
+    // getters
+    inline uint64_t get_nb_tasks() const { return this->_nb_tasks; }
+
+ private:
+    /* ==================== Regex Parsing ==================== */
+    /*!
+     *  \brief  kind of regex syntax tree node
+     */
+    enum __gw_regex_node_kind_t : uint8_t {
+        __GW_REGEX_NODE_EMPTY = 0,
+        __GW_REGEX_NODE_BYTE_SET,
+        __GW_REGEX_NODE_BEGIN,
+        __GW_REGEX_NODE_END,
+        __GW_REGEX_NODE_CONCAT,
+        __GW_REGEX_NODE_ALTERNATE,
+        __GW_REGEX_NODE_REPEAT,
+    };
+
+
+    /*!
+     *  \brief  node of regex syntax tree
+     */
+    typedef struct __gw_regex_node {
+        __gw_regex_node_kind_t kind = __GW_REGEX_NODE_EMPTY;
+        std::bitset<256> byte_set;
+        std::vector<struct __gw_regex_node> children;
+        uint32_t min_repeat = 0;
+        uint32_t max_repeat = 0;    // UINT32_MAX for unbounded
+    } __gw_regex_node_t;
+
+
+    /*!
+     *  \brief  recursive-descent parser of the supported subset of ECMAScript regex
+     */
+    class __GWRegexParser {
+     public:
+        __GWRegexParser(const std::string& pattern) : _pattern(pattern) {}
+
+        /*!
+         *  \brief  parse the pattern
+         *  \param  node    root of the syntax tree
+         *  \return GW_SUCCESS if success, GW_FAILED_NOT_IMPLEMENTAED if the pattern is
+         *          beyond the supported syntax or malformed
+         */
+        gw_retval_t parse(__gw_regex_node_t& node);
+
+     private:
+        gw_retval_t __parse_alternate(__gw_regex_node_t& node);
+        gw_retval_t __parse_concat(__gw_regex_node_t& node);
+        gw_retval_t __parse_repeat(__gw_regex_node_t& node);
+        gw_retval_t __parse_atom(__gw_regex_node_t& node);
+        gw_retval_t __parse_class(std::bitset<256>& byte_set);
+        gw_retval_t __parse_escape(std::bitset<256>& byte_set, bool in_class);
+        bool __parse_number(uint32_t& number);
+
+        inline bool __is_end() const { return this->_pos >= this->_pattern.size(); }
+        inline char __peek() const { return this->_pattern[this->_pos]; }
+
+        const std::string& _pattern;
+        uint64_t _pos = 0;
+    };
+
+
+    /*!
+     *  \brief  obtain the literal string of the pattern if it only contains literal characters
+     *  \param  node            root of the syntax tree
+     *  \param  literal         the literal string
+     *  \param  is_begin_anchored   whether the literal is anchored at the begin of the name
+     *  \param  is_end_anchored     whether the literal is anchored at the end of the name
+     *  \return whether the pattern is a literal
+     */
+    static bool __get_regex_literal(
+        const __gw_regex_node_t& node, std::string& literal, bool& is_begin_anchored, bool& is_end_anchored
+    );
+    /* ==================== Regex Parsing ==================== */
+
+
+    /* ==================== NFA / DFA ==================== */
+    /*!
+     *  \brief  kind of NFA state
+     */
+    enum __gw_nfa_state_kind_t : uint8_t {
+        // consume a byte within the byte set
+        __GW_NFA_STATE_BYTE_SET = 0,
+        // consume the begin / end of the name
+        __GW_NFA_STATE_BEGIN,
+        __GW_NFA_STATE_END,
+        // epsilon transition to out and out_alt (if any)
+        __GW_NFA_STATE_SPLIT,
+        // the pattern of the task is matched
+        __GW_NFA_STATE_MATCH,
+    };
+
+
+    /*!
+     *  \brief  NFA state
+     */
+    typedef struct __gw_nfa_state {
+        __gw_nfa_state_kind_t kind = __GW_NFA_STATE_SPLIT;
+        int32_t out = -1;
+        int32_t out_alt = -1;
+        uint32_t byte_set_index = 0;
+        uint32_t task_index = 0;
+    } __gw_nfa_state_t;
+
+
+    /*!
+     *  \brief  NFA fragment under construction, dangling outs are (state index, is_alt)
+     */
+    typedef struct __gw_nfa_fragment {
+        int32_t start = -1;
+        std::vector<std::pair<int32_t, bool>> list_dangling_outs;
+    } __gw_nfa_fragment_t;
+
+
+    // symbols of the DFA: bytes, and the begin / end of the name
+    static constexpr uint32_t __GW_DFA_SYMBOL_BEGIN = 256;
+    static constexpr uint32_t __GW_DFA_SYMBOL_END = 257;
+    static constexpr uint32_t __GW_DFA_NB_SYMBOLS = 258;
+
+
+    /*!
+     *  \brief  compile the syntax tree into NFA
+     *  \param  node    the syntax tree
+     *  \return the NFA fragment
+     */
+    __gw_nfa_fragment_t __compile_nfa(const __gw_regex_node_t& node);
+
+
+    /*!
+     *  \brief  append a NFA state
+     *  \return index of the state
+     */
+    int32_t __add_nfa_state(__gw_nfa_state_kind_t kind, uint32_t byte_set_index = 0);
+
+
+    /*!
+     *  \brief  point dangling outs of the fragment to the state
+     */
+    void __patch_nfa_fragment(const __gw_nfa_fragment_t& fragment, int32_t state_index);
+
+
+    /*!
+     *  \brief  add the epsilon closure of the NFA state into the set
+     *  \param  state_index     the NFA state
+     *  \param  set             the set of NFA states, with marks of visited states
+     */
+    void __add_nfa_closure(int32_t state_index, std::vector<int32_t>& set);
+
+
+    /*!
+     *  \brief  obtain the DFA state of the set of NFA states, create if not exist
+     *  \param  set     the sorted set of NFA states
+     *  \return index of the DFA state
+     */
+    int32_t __intern_dfa_state(std::vector<int32_t>&& set);
+
+
+    /*!
+     *  \brief  obtain the next DFA state after consuming the symbol
+     *  \param  dfa_state_index     the current DFA state
+     *  \param  symbol              the symbol
+     *  \return index of the next DFA state
+     */
+    int32_t __step_dfa(int32_t dfa_state_index, uint32_t symbol);
+
+
+    /*!
+     *  \brief  flush all cached DFA states
+     */
+    void __reset_dfa();
+    /* ==================== NFA / DFA ==================== */
+
+
+    /*!
+     *  \brief  add the filter into the matcher
+     *  \param  key         key of the filter (match_exact / match_substring / match_pattern)
+     *  \param  filter      the filter
+     *  \param  task_index  index of the trace task
+     */
+    void __add_filter(const std::string& key, const std::string& filter, uint32_t task_index);
+
+
+    /*!
+     *  \brief  build fail links and transitions of the Aho-Corasick automaton
+     */
+    void __build_aho_corasick();
+
+    // version of the compiled filters, and the process-wide version counter
+    uint64_t _version = 0;
+    static std::atomic<uint64_t> _version_counter;
+
+    uint64_t _nb_tasks = 0;
+
+    // exact filters: <name, mask of tasks>
+    std::unordered_map<std::string, uint64_t> _map_exact;
+
+    // substring filters: Aho-Corasick automaton with full transitions
+    std::vector<std::array<int32_t, 256>> _ac_transitions;
+    std::vector<int32_t> _ac_fails;
+    std::vector<uint64_t> _ac_outputs;
+
+    // regex filters: NFA of all patterns and the DFA built from it lazily
+    std::vector<__gw_nfa_state_t> _list_nfa_states;
+    std::vector<std::bitset<256>> _list_nfa_byte_sets;
+    std::vector<int32_t> _list_nfa_starts;
+    std::vector<int32_t> _nfa_start_closure;
+    std::vector<uint32_t> _nfa_visited;
+    uint32_t _nfa_visit_generation = 0;
+    std::map<std::vector<int32_t>, int32_t> _map_dfa_states;
+    std::vector<const std::vector<int32_t>*> _list_dfa_nfa_sets;
+    std::vector<std::array<int32_t, __GW_DFA_NB_SYMBOLS>> _dfa_transitions;
+    std::vector<uint64_t> _dfa_accepts;
+    uint64_t _dfa_mask = 0;
+
+    // regex filters beyond the syntax supported by the DFA
+    std::vector<std::pair<std::regex, uint64_t>> _list_fallback_regex;
+
+    // matchers of trace tasks beyond GW_TRACE_MATCHER_MAX_NB_TASKS, one task each
+    std::vector<GWTraceTaskMatcher*> _list_overflow_matchers;
+};
@@ -76,3 +76,25 @@ void GWCapsule::__process_capsule_resp_REGISTER(GWInternalMessage_Capsule *messa
  exit:
     ;
 }
+
+
+void GWCapsule::__process_capsule_resp_BATCH_ACK(GWInternalMessage_Capsule *message){
+    GWInternalMessagePayload_Capsule_BatchAck *payload;
+
+    payload = message->get_payload_ptr<GWInternalMessagePayload_Capsule_BatchAck>(GW_MESSAGE_TYPEID_CAPSULE_BATCH_ACK);
+    GW_CHECK_POINTER(payload);
+
+    // a batch rejected by the scheduler is consumed as well, as replaying it never succeeds
+    if(unlikely(!payload->success)){
+        GW_WARN_C("event batch rejected by scheduler, dropped: uri(%s)", payload->uri.c_str());
+    }
+
+    // acknowledgements come in the order of frames, so the oldest tracked frame is acknowledged,
+    // NOTE(zhuobin): the lock also guards against the spill ring being released on exit
+    std::lock_guard lock(this->_mutex_event_spill_inflight);
+    if(unlikely(this->_queue_event_spill_inflight.empty()))
+        return;
+    if(this->_event_spill_ring != nullptr and this->_queue_event_spill_inflight.front() > 0)
+        this->_event_spill_ring->commit(this->_queue_event_spill_inflight.front());
+    this->_queue_event_spill_inflight.pop_front();
+}
@@ -10,8 +10,10 @@
 #include "common/log.hpp"
 #include "common/utils/string.hpp"
 #include "common/utils/exception.hpp"
+#include "common/utils/hash.hpp"
 #include "common/assemble/operand_def.hpp"
 #include "common/assemble/instruction_def.hpp"
+#include "common/assemble/instruction.hpp"
 
 
 GWInstructionFieldAttr::GWInstructionFieldAttr()
@@ -27,7 +29,19 @@ GWInstructionDef::GWInstructionDef(uint32_t instruction_size_) : instruction_siz
 
 
 GWInstructionDef::~GWInstructionDef()
-{}
+{
+    gw_instruction_text_cache &cache = __get_text_cache();
+    std::unique_lock lock(cache.mutex);
+
+    for(auto it = cache.map_text.begin(); it != cache.map_text.end();){
+        cache.nb_texts -= std::erase_if(it->second, [this](const gw_instruction_text& text){ return text.def == this; });
+        if(it->second.size() == 0){
+            it = cache.map_text.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
 
 
 gw_retval_t GWInstructionDef::get_field_attr_by_value_str(std::string value_str, GWInstructionFieldAttr*& field_attr) const {
@@ -45,3 +59,70 @@ gw_retval_t GWInstructionDef::get_field_attr_by_value_str(std::string value_str,
 exit:
     return retval;
 }
+
+
+GWInstructionDef::gw_instruction_text_cache& GWInstructionDef::__get_text_cache(){
+    static gw_instruction_text_cache *cache = new gw_instruction_text_cache();
+    return *cache;
+}
+
+
+void GWInstructionDef::format_instruction(GWUtilTextBuffer& buffer, GWInstruction* inst, bool flatten, bool simply) const {
+    gw_instruction_text_cache &cache = __get_text_cache();
+    gw_hash_u64_t hash = GW_UTIL_HASH_FNV1A_OFFSET;
+    const GWInstructionDef *def = this;
+    uint8_t flags = (flatten ? 0x1 : 0x0) | (simply ? 0x2 : 0x0);
+    std::unordered_map<uint64_t, std::vector<gw_instruction_text>>::iterator it;
+    std::string text;
+
+    GW_CHECK_POINTER(inst);
+
+    // instruction which hasn't been encoded can't be identified by its bytes
+    if(unlikely(inst->bytes.size() == 0)){
+        buffer.append(inst->str(flatten, simply));
+        return;
+    }
+
+    hash = GWUtilHash::fnv1a(&def, sizeof(def), hash);
+    hash = GWUtilHash::fnv1a(&flags, sizeof(flags), hash);
+    hash = GWUtilHash::fnv1a(inst->bytes.data(), inst->bytes.size(), hash);
+
+    {
+        std::shared_lock lock(cache.mutex);
+        if((it = cache.map_text.find(hash)) != cache.map_text.end()){
+            for(const gw_instruction_text& cached : it->second){
+                if(cached.def == this and cached.flatten == flatten and cached.simply == simply and cached.bytes == inst->bytes){
+                    buffer.append(cached.text);
+                    cache.nb_hits.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+    }
+
+    // render outside of the lock, the same encoding might be rendered by
+    // multiple threads simultaneously, and only the first one is cached
+    text = inst->str(flatten, simply);
+    buffer.append(text);
+    cache.nb_misses.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::unique_lock lock(cache.mutex);
+        if(cache.nb_texts >= GW_INSTRUCTION_TEXT_CACHE_DEFAULT_MAX_NB_TEXTS)
+            return;
+        std::vector<gw_instruction_text>& list_text = cache.map_text[hash];
+        for(const gw_instruction_text& cached : list_text){
+            if(cached.def == this and cached.flatten == flatten and cached.simply == simply and cached.bytes == inst->bytes)
+                return;
+        }
+        list_text.push_back({ this, flatten, simply, inst->bytes, std::move(text) });
+        cache.nb_texts += 1;
+    }
+}
+
+
+void GWInstructionDef::get_text_cache_statistics(uint64_t& nb_hits, uint64_t& nb_misses){
+    gw_instruction_text_cache &cache = __get_text_cache();
+    nb_hits = cache.nb_hits.load();
+    nb_misses = cache.nb_misses.load();
+}
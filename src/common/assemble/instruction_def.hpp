@@ -5,6 +5,9 @@
 #include <map>
 #include <fstream>
 #include <filesystem>
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
 
 #include "nlohmann/json.hpp"
 
@@ -12,6 +15,7 @@
 #include "common/log.hpp"
 #include "common/instrument.hpp"
 #include "common/utils/exception.hpp"
+#include "common/utils/text_buffer.hpp"
 
 
 // forward declaration
@@ -19,6 +23,11 @@ class GWOperandDef;
 class GWInstruction;
 
 
+// maximum number of rendered instruction text to be cached, beyond which
+// instructions are rendered without caching
+#define GW_INSTRUCTION_TEXT_CACHE_DEFAULT_MAX_NB_TEXTS    (1 << 18)
+
+
 using gw_instruction_opcode_t = uint16_t;
 
 
@@ -153,4 +162,66 @@ class GWInstructionDef {
     std::map<std::string, GWOperandDef*> map_operand_defs;
     std::map<std::string, GWOperandDef*> map_modifier_defs;
     /* ==================== Operands ==================== */
+
+
+    /* ==================== Text ==================== */
+ public:
+    /*!
+     *  \brief  append the readable string of an instruction instance of this definition
+     *          to the buffer, the text (i.e., mnemonic, modifiers and operands) is rendered
+     *          once per distinct encoding, and is reused by later instances
+     *  \note   the instance should have been encoded, i.e., its bytes are up to date
+     *  \param  buffer  buffer to append to
+     *  \param  inst    instruction instance of this definition
+     *  \param  flatten whether to flatten the output
+     *  \param  simply  simply the output format
+     */
+    void format_instruction(GWUtilTextBuffer& buffer, GWInstruction* inst, bool flatten=false, bool simply=false) const;
+
+
+    /*!
+     *  \brief  obtain the number of hits / misses of rendered text of all definitions
+     *  \param  nb_hits     number of hits
+     *  \param  nb_misses   number of misses
+     */
+    static void get_text_cache_statistics(uint64_t& nb_hits, uint64_t& nb_misses);
+
+ protected:
+    /*!
+     *  \brief  rendered text of an encoded instruction
+     */
+    struct gw_instruction_text {
+        const GWInstructionDef *def = nullptr;
+        bool flatten = false;
+        bool simply = false;
+        std::vector<uint8_t> bytes;
+        std::string text;
+    };
+
+
+    /*!
+     *  \brief  rendered text of encoded instructions of all definitions
+     *  \note   it's kept aside instead of within this class, as architecture-specific
+     *          definitions derived from this class are prebuilt against its layout
+     */
+    struct gw_instruction_text_cache {
+        std::shared_mutex mutex;
+
+        // rendered text: <hash of def/flatten/simply/bytes, [text]>
+        std::unordered_map<uint64_t, std::vector<gw_instruction_text>> map_text;
+        uint64_t nb_texts = 0;
+
+        std::atomic<uint64_t> nb_hits = 0;
+        std::atomic<uint64_t> nb_misses = 0;
+    };
+
+
+    /*!
+     *  \brief  obtain the rendered text cache shared by all definitions
+     *  \note   the cache is never destroyed, as definitions might be destroyed
+     *          after static objects
+     *  \return the rendered text cache
+     */
+    static gw_instruction_text_cache& __get_text_cache();
+    /* ==================== Text ==================== */
 };
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/assemble/kernel_def.hpp"
+
+
+/*!
+ *  \brief  registry of kernel definitions indexed by normalized fingerprint, used for
+ *          sharing analysis results among identical kernels (e.g., template instantiations
+ *          that differ only by name, or same kernel compiled into multiple modules)
+ */
+class GWKernelDefDedup {
+ public:
+    /*!
+     *  \brief  constructor
+     */
+    GWKernelDefDedup(){}
+
+
+    /*!
+     *  \brief  destructor
+     *  \note   the registry doesn't own the registered kernel definitions
+     */
+    ~GWKernelDefDedup(){}
+
+
+    /*!
+     *  \brief  lookup the representative kernel definition of the same fingerprint,
+     *          the given kernel definition would be registered as representative if
+     *          no one exists
+     *  \param  kernel_def      kernel definition to be looked up, fingerprint must be calculated
+     *  \param  representative  the representative kernel definition, would be nullptr if
+     *                          the given kernel definition is registered as representative
+     *  \note   the kernel isn't counted as deduplicated until record_dedup is called, as
+     *          adopting analysis from the representative could still fail
+     *  \return GW_SUCCESS if success
+     */
+    inline gw_retval_t lookup_or_register(GWKernelDef* kernel_def, GWKernelDef*& representative){
+        gw_retval_t retval = GW_SUCCESS;
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        typename std::map<uint64_t, GWKernelDef*>::iterator it;
+
+        GW_CHECK_POINTER(kernel_def);
+        representative = nullptr;
+
+        if(unlikely(!kernel_def->has_fingerprint())){
+            GW_WARN("failed to lookup kernel dedup registry, fingerprint not calculated: kernel(%s)", kernel_def->mangled_prototype.c_str());
+            retval = GW_FAILED_NOT_READY;
+            goto exit;
+        }
+
+        this->_nb_kernels += 1;
+        it = this->_map_fingerprint_kernel_def.find(kernel_def->get_fingerprint());
+        if(it != this->_map_fingerprint_kernel_def.end() and it->second != kernel_def){
+            representative = it->second;
+        } else {
+            this->_map_fingerprint_kernel_def[kernel_def->get_fingerprint()] = kernel_def;
+        }
+
+    exit:
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  record that a kernel has adopted analysis from its representative
+     */
+    inline void record_dedup(){
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_nb_dedup_kernels += 1;
+    }
+
+
+    /*!
+     *  \brief  remove the kernel definition from the registry, should be called before
+     *          the kernel definition is destroyed (e.g., module unloaded)
+     *  \param  kernel_def  kernel definition to be removed
+     */
+    inline void unregister(GWKernelDef* kernel_def){
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        typename std::map<uint64_t, GWKernelDef*>::iterator it;
+
+        GW_CHECK_POINTER(kernel_def);
+        if(!kernel_def->has_fingerprint())
+            return;
+        it = this->_map_fingerprint_kernel_def.find(kernel_def->get_fingerprint());
+        if(it != this->_map_fingerprint_kernel_def.end() and it->second == kernel_def)
+            this->_map_fingerprint_kernel_def.erase(it);
+    }
+
+
+    /*!
+     *  \brief  obtain the ratio of kernels whose analysis is shared from representatives
+     *  \return the dedup ratio
+     */
+    inline double get_dedup_ratio(){
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        if(this->_nb_kernels == 0)
+            return 0.0f;
+        return (double)(this->_nb_dedup_kernels) / (double)(this->_nb_kernels);
+    }
+
+
+    // getters
+    inline uint64_t get_nb_kernels(){
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        return this->_nb_kernels;
+    }
+    inline uint64_t get_nb_dedup_kernels(){
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        return this->_nb_dedup_kernels;
+    }
+
+ private:
+    std::mutex _mutex;
+
+    // fingerprint -> representative kernel definition
+    std::map<uint64_t, GWKernelDef*> _map_fingerprint_kernel_def;
+
+    // statistics
+    uint64_t _nb_kernels = 0;
+    uint64_t _nb_dedup_kernels = 0;
+};
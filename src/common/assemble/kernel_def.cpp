@@ -5,11 +5,17 @@
 #include <regex>
 #include <fstream>
 #include <filesystem>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "common/common.hpp"
 #include "common/log.hpp"
 #include "common/utils/string.hpp"
 #include "common/utils/exception.hpp"
+#include "common/utils/hash.hpp"
 #include "common/assemble/kernel_def.hpp"
 #include "common/assemble/operand.hpp"
 #include "common/assemble/operand_def.hpp"
@@ -30,6 +36,7 @@ nlohmann::json GWBasicBlock::serialize(){
     uint64_t i = 0, current_pc = 0;
     nlohmann::json bb_json_obj, tmp_json_obj;
     GWInstruction* inst = nullptr;
+    thread_local GWUtilTextBuffer text_buffer(KB(1));
 
     bb_json_obj = nlohmann::json::object();
     tmp_json_obj = nlohmann::json::object();
@@ -44,7 +51,9 @@ nlohmann::json GWBasicBlock::serialize(){
         current_pc = this->base_pc + i * inst->get_def()->instruction_size;
         tmp_json_obj.clear();
         tmp_json_obj["pc"] = current_pc;
-        tmp_json_obj["decode"] = inst->str(/* flatten */ true, /* simply */ true);
+        text_buffer.clear();
+        inst->get_def()->format_instruction(text_buffer, inst, /* flatten */ true, /* simply */ true);
+        tmp_json_obj["decode"] = text_buffer.view();
         bb_json_obj["instructions"].push_back(tmp_json_obj);
     }
 
@@ -202,12 +211,539 @@ exit:
 }
 
 
+std::mutex GWKernelDef::_mutex_state;
+
+
 GWKernelDef::GWKernelDef()
 {}
 
 
 GWKernelDef::~GWKernelDef()
-{}
+{
+    gw_kernel_def_state_t *state = nullptr;
+
+    this->invalidate_pc_index();
+
+    std::lock_guard lock(_mutex_state);
+    if(__get_map_state().find(this, state)){
+        __get_map_state().erase_if([this](const GWKernelDef* const& kernel_def, gw_kernel_def_state_t* const&){
+            return kernel_def == this;
+        });
+        GWUtilEpochDomain::instance().retire(state);
+    }
+}
+
+
+GWKernelDef::gw_kernel_def_state_t* GWKernelDef::__get_state(bool do_create) const {
+    gw_kernel_def_state_t *state = nullptr;
+
+    if(__get_map_state().find(this, state) or !do_create)
+        return state;
+
+    std::lock_guard lock(_mutex_state);
+    if(!__get_map_state().find(this, state)){
+        GW_CHECK_POINTER(state = new gw_kernel_def_state_t());
+        GW_ASSERT(__get_map_state().insert(this, state) == GW_SUCCESS);
+    }
+    return state;
+}
+
+
+void GWKernelDef::__format_text_line(GWUtilTextBuffer& buffer, uint64_t pc, GWInstruction* inst, bool simply){
+    static constexpr uint64_t kTextColumn = 35;
+    uint64_t line_begin = buffer.size();
+
+    buffer.append("        /*", 10);
+    buffer.append_hex(pc, /* min_width */ 4, /* with_prefix */ false);
+    buffer.append("*/", 2);
+    if(buffer.size() - line_begin < kTextColumn)
+        buffer.append_repeat(' ', kTextColumn - (buffer.size() - line_begin));
+    GW_CHECK_POINTER(inst->get_def());
+    inst->get_def()->format_instruction(buffer, inst, /* flatten */ true, simply);
+    buffer.append(" ;\n", 3);
+}
+
+
+gw_retval_t GWKernelDef::dump_text(GWUtilTextBuffer& buffer, bool simply) const {
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t pc = 0;
+
+    buffer.append(".text.", 6);
+    buffer.append(this->mangled_prototype);
+    buffer.append(":\n", 2);
+
+    for(GWInstruction* inst : this->list_instructions){
+        GW_CHECK_POINTER(inst);
+        __format_text_line(buffer, pc, inst, simply);
+        pc += inst->get_def()->instruction_size;
+    }
+
+    return retval;
+}
+
+
+gw_retval_t GWKernelDef::dump_text_to_file(std::string file_path, bool simply, bool append) const {
+    // flush the buffer once it grows beyond this size, so dumping is bound by output
+    static constexpr uint64_t kFlushThreshold = MB(4);
+
+    gw_retval_t retval = GW_SUCCESS;
+    int fd = -1;
+    uint64_t pc = 0;
+    GWUtilTextBuffer buffer(kFlushThreshold + KB(4));
+
+    fd = ::open(file_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+    if(unlikely(fd < 0)){
+        GW_WARN_C("failed to open file to dump disassembly: path(%s), error(%s)", file_path.c_str(), strerror(errno));
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    buffer.append(".text.", 6);
+    buffer.append(this->mangled_prototype);
+    buffer.append(":\n", 2);
+
+    for(GWInstruction* inst : this->list_instructions){
+        GW_CHECK_POINTER(inst);
+        __format_text_line(buffer, pc, inst, simply);
+        pc += inst->get_def()->instruction_size;
+        if(buffer.size() >= kFlushThreshold){
+            GW_IF_FAILED(buffer.flush_to_fd(fd), retval, goto exit;);
+        }
+    }
+    GW_IF_FAILED(buffer.flush_to_fd(fd), retval, goto exit;);
+
+exit:
+    if(fd >= 0)
+        ::close(fd);
+    return retval;
+}
+
+
+gw_retval_t GWKernelDef::build_pc_index(){
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t instruction_size = 0, max_pc = 0, pc = 0, i = 0, nb_slot = 0;
+    gw_kernel_def_state_t *state = nullptr;
+    gw_kernel_def_pc_index_t *index = nullptr;
+    const gw_kernel_def_pc_index_t *stale_index = nullptr;
+    std::unique_lock<std::mutex> lock;
+
+    if(unlikely(this->list_instructions.size() == 0)){
+        GW_WARN_C("failed to build pc index, no instruction parsed: kernel(%s)", this->mangled_prototype.c_str());
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    GW_CHECK_POINTER(state = this->__get_state(/* do_create */ true));
+    lock = std::unique_lock<std::mutex>(state->mutex);
+
+    if(this->is_pc_index_built())
+        goto exit;
+
+    GW_CHECK_POINTER(this->list_instructions[0]);
+    instruction_size = this->list_instructions[0]->get_def()->instruction_size;
+    if(unlikely(instruction_size == 0 or (instruction_size & (instruction_size - 1)) != 0)){
+        GW_WARN_C(
+            "failed to build pc index, instruction size isn't power of 2: kernel(%s), instruction_size(%lu)",
+            this->mangled_prototype.c_str(), instruction_size
+        );
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    GW_CHECK_POINTER(index = new gw_kernel_def_pc_index_t());
+    index->shift = __builtin_ctzll(instruction_size);
+    index->mask = instruction_size - 1;
+    index->nb_instructions = this->list_instructions.size();
+    index->nb_basic_blocks = this->list_basic_blocks.size();
+    index->basic_blocks = this->list_basic_blocks.data();
+
+    // index of instructions
+    if(this->map_pc_to_instruction.size() > 0){
+        max_pc = this->map_pc_to_instruction.rbegin()->first;
+    } else {
+        max_pc = (this->list_instructions.size() - 1) * instruction_size;
+    }
+    nb_slot = (max_pc >> index->shift) + 1;
+    index->list_instruction.assign(nb_slot + 1, nullptr);
+    if(this->map_pc_to_instruction.size() > 0){
+        for(auto& [_pc, inst] : this->map_pc_to_instruction){
+            index->list_instruction[_pc >> index->shift] = inst;
+        }
+    } else {
+        for(i=0; i<this->list_instructions.size(); i++){
+            index->list_instruction[i] = this->list_instructions[i];
+        }
+    }
+
+    // index of basic blocks
+    index->list_basic_block.assign(nb_slot + 1, nullptr);
+    for(GWBasicBlock* bb : this->list_basic_blocks){
+        GW_CHECK_POINTER(bb);
+        for(i=0; i<bb->list_instructions.size(); i++){
+            pc = bb->base_pc + i * instruction_size;
+            if(unlikely((pc >> index->shift) >= nb_slot))
+                break;
+            index->list_basic_block[pc >> index->shift] = bb;
+        }
+    }
+
+    // publish the index, the stale one is freed once no reader holds it
+    stale_index = state->pc_index.exchange(index, std::memory_order_acq_rel);
+    if(stale_index != nullptr)
+        GWUtilEpochDomain::instance().retire(stale_index);
+
+exit:
+    return retval;
+}
+
+
+void GWKernelDef::invalidate_pc_index(){
+    gw_kernel_def_state_t *state = nullptr;
+    const gw_kernel_def_pc_index_t *stale_index = nullptr;
+
+    if((state = this->__get_state(/* do_create */ false)) == nullptr)
+        return;
+
+    std::lock_guard lock(state->mutex);
+    stale_index = state->pc_index.exchange(nullptr, std::memory_order_acq_rel);
+    if(stale_index != nullptr)
+        GWUtilEpochDomain::instance().retire(stale_index);
+}
+
+
+gw_retval_t GWKernelDef::resolve_pcs(
+    const uint64_t* list_pc, uint64_t nb_pc, GWInstruction** list_instruction, GWBasicBlock** list_basic_block
+) const {
+    // number of pcs to be processed per round, so that the index stays in cache
+    static constexpr uint64_t kBatchSize = 1024;
+
+    gw_retval_t retval = GW_SUCCESS;
+    GWUtilEpochDomain::read_guard guard;
+    const gw_kernel_def_pc_index_t *index = nullptr;
+    uint64_t base = 0, i = 0, len = 0, nb_slot = 0, sentinel = 0;
+    uint64_t shift = 0, mask = 0;
+    uint64_t list_idx[kBatchSize];
+
+    if(unlikely((index = this->__get_pc_index()) == nullptr)){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+    GW_CHECK_POINTER(list_pc);
+    shift = index->shift;
+    mask = index->mask;
+
+    // the last slot is the nullptr sentinel
+    sentinel = index->list_instruction.size() - 1;
+    nb_slot = sentinel;
+
+    for(base = 0; base < nb_pc; base += kBatchSize){
+        len = std::min(kBatchSize, nb_pc - base);
+
+        // pass 1: branch-free bounds / alignment check, vectorizable by compiler
+        for(i = 0; i < len; i++){
+            uint64_t idx = list_pc[base + i] >> shift;
+            bool is_valid = (idx < nb_slot) & ((list_pc[base + i] & mask) == 0);
+            list_idx[i] = is_valid ? idx : sentinel;
+        }
+
+        // pass 2: gather from the dense index
+        if(list_instruction != nullptr){
+            for(i = 0; i < len; i++){
+                list_instruction[base + i] = index->list_instruction[list_idx[i]];
+            }
+        }
+        if(list_basic_block != nullptr){
+            for(i = 0; i < len; i++){
+                list_basic_block[base + i] = index->list_basic_block[list_idx[i]];
+            }
+        }
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWKernelDef::__get_normalized_stream(const std::set<uint64_t>& set_relocated_pc, std::vector<uint8_t>& stream) const {
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t pc = 0, value = 0;
+    const GWInstructionDef *inst_def = nullptr;
+
+    auto __append_bytes = [&](const void* data, uint64_t size){
+        stream.insert(stream.end(), reinterpret_cast<const uint8_t*>(data), reinterpret_cast<const uint8_t*>(data) + size);
+    };
+
+    auto __append_string = [&](const std::string& str){
+        value = str.size();
+        __append_bytes(&value, sizeof(uint64_t));
+        __append_bytes(str.data(), str.size());
+    };
+
+    // parameter layout is part of the stream, as instrumentation appends parameters after it
+    value = this->list_param_sizes.size();
+    __append_bytes(&value, sizeof(uint64_t));
+    for(uint64_t param_size : this->list_param_sizes){
+        __append_bytes(&param_size, sizeof(uint64_t));
+    }
+
+    for(GWInstruction* inst : this->list_instructions){
+        GW_CHECK_POINTER(inst);
+        GW_CHECK_POINTER(inst_def = inst->get_def());
+
+        if(set_relocated_pc.count(pc) == 0){
+            __append_bytes(inst->bytes.data(), inst->bytes.size());
+        } else {
+            // NOTE(zhuobin): relocated instructions differ among identical kernels only by the
+            //                patched immediates, so we encode them by opcode and the rest operands
+            __append_string(inst_def->name);
+            for(auto& [opname, operand] : inst->map_operands){
+                __append_string(opname);
+                value = (operand == nullptr or operand->get_def() == nullptr or operand->get_def()->is_imm)
+                        ? 0 : operand->value.u64;
+                __append_bytes(&value, sizeof(uint64_t));
+            }
+            for(auto& [modname, modifier] : inst->map_modifier){
+                __append_string(modname);
+                value = modifier == nullptr ? 0 : modifier->value.u64;
+                __append_bytes(&value, sizeof(uint64_t));
+            }
+        }
+
+        pc += inst_def->instruction_size;
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWKernelDef::calculate_fingerprint(const std::set<uint64_t>& set_relocated_pc){
+    gw_retval_t retval = GW_SUCCESS;
+    gw_kernel_def_state_t *state = nullptr;
+    uint64_t fingerprint = 0, binary_hash = GW_UTIL_HASH_FNV1A_OFFSET, instruction_size = 0;
+    std::set<uint64_t> set_aligned_relocated_pc;
+    std::vector<uint8_t> stream;
+
+    if(unlikely(!this->is_instructions_parsed())){
+        GW_WARN_C("failed to calculate fingerprint, instructions not parsed: kernel(%s)", this->mangled_prototype.c_str());
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    // relocation offsets point to the patched field, align them to the owning instruction
+    if(this->list_instructions.size() > 0){
+        GW_CHECK_POINTER(this->list_instructions[0]->get_def());
+        instruction_size = this->list_instructions[0]->get_def()->instruction_size;
+        GW_ASSERT(instruction_size > 0);
+        for(uint64_t offset : set_relocated_pc){
+            set_aligned_relocated_pc.insert(offset - offset % instruction_size);
+        }
+    }
+
+    GW_IF_FAILED(
+        this->__get_normalized_stream(set_aligned_relocated_pc, stream),
+        retval,
+        {
+            GW_WARN_C("failed to normalize instruction stream: kernel(%s)", this->mangled_prototype.c_str());
+            goto exit;
+        }
+    );
+    fingerprint = GWUtilHash::fnv1a(stream.data(), stream.size());
+
+    for(uint64_t param_size : this->list_param_sizes){
+        binary_hash = GWUtilHash::fnv1a(&param_size, sizeof(uint64_t), binary_hash);
+    }
+    for(GWInstruction* inst : this->list_instructions){
+        binary_hash = GWUtilHash::fnv1a(inst->bytes.data(), inst->bytes.size(), binary_hash);
+    }
+
+    GW_CHECK_POINTER(state = this->__get_state(/* do_create */ true));
+    {
+        std::lock_guard lock(state->mutex);
+        state->fingerprint = fingerprint;
+        state->binary_hash = binary_hash;
+        state->set_relocated_pc = std::move(set_aligned_relocated_pc);
+        state->has_fingerprint = true;
+    }
+
+exit:
+    return retval;
+}
+
+
+bool GWKernelDef::has_fingerprint() const {
+    gw_kernel_def_state_t *state = nullptr;
+
+    if((state = this->__get_state(/* do_create */ false)) == nullptr)
+        return false;
+    std::lock_guard lock(state->mutex);
+    return state->has_fingerprint;
+}
+
+
+uint64_t GWKernelDef::get_fingerprint() const {
+    gw_kernel_def_state_t *state = nullptr;
+
+    if((state = this->__get_state(/* do_create */ false)) == nullptr)
+        return 0;
+    std::lock_guard lock(state->mutex);
+    return state->fingerprint;
+}
+
+
+uint64_t GWKernelDef::get_binary_hash() const {
+    gw_kernel_def_state_t *state = nullptr;
+
+    if((state = this->__get_state(/* do_create */ false)) == nullptr)
+        return 0;
+    std::lock_guard lock(state->mutex);
+    return state->binary_hash;
+}
+
+
+gw_retval_t GWKernelDef::adopt_analysis(const GWKernelDef* other){
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t i = 0, inst_idx = 0, instruction_size = 0;
+    gw_kernel_def_state_t *state = nullptr, *other_state = nullptr;
+    bool has_fingerprint = false, other_has_fingerprint = false;
+    uint64_t fingerprint = 0, other_fingerprint = 0;
+    std::set<uint64_t> set_relocated_pc, other_set_relocated_pc;
+    GWBasicBlock *new_bb = nullptr;
+    std::map<const GWBasicBlock*, GWBasicBlock*> map_old_new_bb;
+    std::map<uint64_t, const GWBasicBlock*> map_pc_other_bb;
+    std::map<uint64_t, const GWBasicBlock*>::iterator other_bb_iter;
+    std::vector<uint8_t> this_stream, other_stream;
+
+    GW_CHECK_POINTER(other);
+
+    if(unlikely(this->is_register_liveness_parsed())){
+        retval = GW_FAILED_ALREADY_EXIST;
+        goto exit;
+    }
+
+    if((state = this->__get_state(/* do_create */ false)) != nullptr){
+        std::lock_guard lock(state->mutex);
+        has_fingerprint = state->has_fingerprint;
+        fingerprint = state->fingerprint;
+        set_relocated_pc = state->set_relocated_pc;
+    }
+    if((other_state = other->__get_state(/* do_create */ false)) != nullptr){
+        std::lock_guard lock(other_state->mutex);
+        other_has_fingerprint = other_state->has_fingerprint;
+        other_fingerprint = other_state->fingerprint;
+        other_set_relocated_pc = other_state->set_relocated_pc;
+    }
+
+    if(unlikely(
+        !has_fingerprint or !other_has_fingerprint
+        or fingerprint != other_fingerprint
+        or this->list_instructions.size() != other->list_instructions.size()
+        or this->list_instructions.size() == 0
+    )){
+        GW_WARN_C(
+            "failed to adopt analysis, fingerprint mismatch: kernel(%s), other(%s)",
+            this->mangled_prototype.c_str(), other->mangled_prototype.c_str()
+        );
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    // the fingerprint is a 64-bit hash, compare the normalized streams to rule out collision
+    GW_IF_FAILED(this->__get_normalized_stream(set_relocated_pc, this_stream), retval, goto exit;);
+    GW_IF_FAILED(other->__get_normalized_stream(other_set_relocated_pc, other_stream), retval, goto exit;);
+    if(unlikely(this_stream != other_stream)){
+        GW_WARN_C(
+            "failed to adopt analysis, fingerprint collision: kernel(%s), other(%s)",
+            this->mangled_prototype.c_str(), other->mangled_prototype.c_str()
+        );
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    if(unlikely(!other->is_cfg_parsed() or !other->is_register_liveness_parsed())){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    instruction_size = this->list_instructions[0]->get_def()->instruction_size;
+
+    if(this->is_cfg_parsed()){
+        // NOTE(zhuobin): CFG of this kernel is usually parsed while loading the module, identical
+        //                streams yield identical CFGs, so only the liveness of the basic blocks is
+        //                adopted, matched by their base pc; all basic blocks are checked before
+        //                anything is adopted, so a mismatch leaves this kernel untouched
+        if(unlikely(this->list_basic_blocks.size() != other->list_basic_blocks.size())){
+            GW_WARN_C(
+                "failed to adopt analysis, CFG mismatch: kernel(%s), other(%s), nb_basic_blocks(%lu), other_nb_basic_blocks(%lu)",
+                this->mangled_prototype.c_str(), other->mangled_prototype.c_str(),
+                this->list_basic_blocks.size(), other->list_basic_blocks.size()
+            );
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        for(GWBasicBlock* bb : other->list_basic_blocks){
+            GW_CHECK_POINTER(bb);
+            map_pc_other_bb[bb->base_pc] = bb;
+        }
+        for(GWBasicBlock* bb : this->list_basic_blocks){
+            GW_CHECK_POINTER(bb);
+            other_bb_iter = map_pc_other_bb.find(bb->base_pc);
+            if(unlikely(
+                other_bb_iter == map_pc_other_bb.end()
+                or other_bb_iter->second->list_instructions.size() != bb->list_instructions.size()
+            )){
+                GW_WARN_C(
+                    "failed to adopt analysis, CFG mismatch: kernel(%s), other(%s), base_pc(%#lx)",
+                    this->mangled_prototype.c_str(), other->mangled_prototype.c_str(), bb->base_pc
+                );
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+        }
+        for(GWBasicBlock* bb : this->list_basic_blocks){
+            bb->map_registers_in = map_pc_other_bb[bb->base_pc]->map_registers_in;
+            bb->map_registers_out = map_pc_other_bb[bb->base_pc]->map_registers_out;
+        }
+    } else {
+        // basic blocks, pointing to instructions of this kernel
+        for(GWBasicBlock* bb : other->list_basic_blocks){
+            GW_CHECK_POINTER(bb);
+            GW_CHECK_POINTER(new_bb = new GWBasicBlock(instruction_size));
+            new_bb->id = bb->id;
+            new_bb->base_pc = bb->base_pc;
+            new_bb->end_pc = bb->end_pc;
+            new_bb->map_registers_in = bb->map_registers_in;
+            new_bb->map_registers_out = bb->map_registers_out;
+            inst_idx = bb->base_pc / instruction_size;
+            for(i=0; i<bb->list_instructions.size(); i++){
+                GW_ASSERT(inst_idx + i < this->list_instructions.size());
+                new_bb->list_instructions.push_back(this->list_instructions[inst_idx + i]);
+            }
+            map_old_new_bb[bb] = new_bb;
+            this->list_basic_blocks.push_back(new_bb);
+        }
+        for(GWBasicBlock* bb : other->list_basic_blocks){
+            for(auto& [in_bb, pc_pair] : bb->map_in_bb)
+                map_old_new_bb[bb]->map_in_bb[map_old_new_bb[in_bb]] = pc_pair;
+            for(auto& [out_bb, pc_pair] : bb->map_out_bb)
+                map_old_new_bb[bb]->map_out_bb[map_old_new_bb[out_bb]] = pc_pair;
+        }
+
+        // basic blocks indexed so far are gone
+        this->invalidate_pc_index();
+    }
+
+    // register liveness of each instruction
+    for(i=0; i<this->list_instructions.size(); i++){
+        this->list_instructions[i]->map_register_set_IN = other->list_instructions[i]->map_register_set_IN;
+        this->list_instructions[i]->map_register_set_OUT = other->list_instructions[i]->map_register_set_OUT;
+    }
+
+    this->_is_register_liveness_parsed = true;
+
+exit:
+    return retval;
+}
 
 
 gw_retval_t GWKernelDef::set_debug_info(
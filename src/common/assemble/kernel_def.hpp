@@ -3,8 +3,11 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <set>
 #include <fstream>
 #include <filesystem>
+#include <mutex>
+#include <atomic>
 
 #include "nlohmann/json.hpp"
 
@@ -12,6 +15,11 @@
 #include "common/log.hpp"
 #include "common/instrument.hpp"
 #include "common/utils/exception.hpp"
+#include "common/utils/text_buffer.hpp"
+#include "common/utils/rcu_map.hpp"
+
+
+class GWOperand;
 
 
 class GWBasicBlock {
@@ -209,6 +217,10 @@ class GWKernelDef {
      *  \return GW_SUCCESS if success
      */
     virtual gw_retval_t get_basic_block_by_pc(uint64_t pc, GWBasicBlock*& basic_block) const {
+        if(this->is_pc_index_built()){
+            basic_block = this->lookup_basic_block(pc);
+            return basic_block != nullptr ? GW_SUCCESS : GW_FAILED_NOT_EXIST;
+        }
         return GW_FAILED_NOT_IMPLEMENTAED;
     }
 
@@ -232,12 +244,265 @@ class GWKernelDef {
         return GW_FAILED_NOT_IMPLEMENTAED;
     }
 
+
+    /*!
+     *  \brief  append the disassembly text of this kernel to the buffer
+     *  \param  buffer  buffer to append to
+     *  \param  simply  simply the output format
+     *  \return GW_SUCCESS for successfully dump
+     */
+    gw_retval_t dump_text(GWUtilTextBuffer& buffer, bool simply=false) const;
+
+
+    /*!
+     *  \brief  dump the disassembly text of this kernel to file
+     *  \param  file_path   path of the file to dump to
+     *  \param  simply      simply the output format
+     *  \param  append      whether to append to the file instead of truncating it
+     *  \return GW_SUCCESS for successfully dump
+     */
+    gw_retval_t dump_text_to_file(std::string file_path, bool simply=false, bool append=false) const;
+
  protected:
+    /*!
+     *  \brief  append a line of disassembly text to the buffer, in the layout
+     *          of cuobjdump (i.e., pc comment, padding, instruction, " ;")
+     *  \param  buffer  buffer to append to
+     *  \param  pc      pc of the instruction
+     *  \param  inst    instruction to be formatted
+     *  \param  simply  simply the output format
+     */
+    static void __format_text_line(GWUtilTextBuffer& buffer, uint64_t pc, GWInstruction* inst, bool simply);
+
     // whether register liveness have been parsed
     bool _is_register_liveness_parsed = false;
     /* ==================== Parser ==================== */
 
 
+    /* ==================== PC Index ==================== */
+ public:
+    /*!
+     *  \brief  build dense index from pc to instruction / basic block
+     *  \note   SASS instructions are fixed-size, so the index is an array indexed by
+     *          pc / instruction_size; basic blocks are indexed only if CFG is parsed;
+     *          this function is thread safe, the index is built under the lock and then
+     *          published to lock-free readers; the index goes stale once instructions or
+     *          CFG change, and is rebuilt by the next call
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t build_pc_index();
+
+
+    /*!
+     *  \brief  drop the dense pc index, should be called once instructions or CFG change
+     */
+    void invalidate_pc_index();
+
+
+    /*!
+     *  \brief  identify whether the dense pc index has been built and is up to date
+     *  \return whether the dense pc index has been built
+     */
+    inline bool is_pc_index_built() const {
+        GWUtilEpochDomain::read_guard guard;
+        return this->__get_pc_index() != nullptr;
+    }
+
+
+    /*!
+     *  \brief  obtain instruction by pc via the dense index
+     *  \param  pc  pc of the instruction
+     *  \return the instruction, nullptr if pc is out of range, misaligned or index not built
+     */
+    inline GWInstruction* lookup_instruction(uint64_t pc) const {
+        GWUtilEpochDomain::read_guard guard;
+        const gw_kernel_def_pc_index_t *index = this->__get_pc_index();
+        uint64_t idx = 0;
+        if(unlikely(index == nullptr))
+            return nullptr;
+        idx = pc >> index->shift;
+        if(unlikely((pc & index->mask) != 0 or idx >= index->list_instruction.size()))
+            return nullptr;
+        return index->list_instruction[idx];
+    }
+
+
+    /*!
+     *  \brief  obtain basic block by pc via the dense index
+     *  \param  pc  pc of the instruction
+     *  \return the basic block, nullptr if pc is out of range, misaligned or index not built
+     */
+    inline GWBasicBlock* lookup_basic_block(uint64_t pc) const {
+        GWUtilEpochDomain::read_guard guard;
+        const gw_kernel_def_pc_index_t *index = this->__get_pc_index();
+        uint64_t idx = 0;
+        if(unlikely(index == nullptr))
+            return nullptr;
+        idx = pc >> index->shift;
+        if(unlikely((pc & index->mask) != 0 or idx >= index->list_basic_block.size()))
+            return nullptr;
+        return index->list_basic_block[idx];
+    }
+
+
+    /*!
+     *  \brief  resolve a batch of pcs (e.g., PC sampling results) to instructions / basic blocks
+     *  \note   unresolvable pcs are mapped to nullptr
+     *  \param  list_pc             list of pcs to be resolved
+     *  \param  nb_pc               number of pcs
+     *  \param  list_instruction    output instructions, could be nullptr if not needed
+     *  \param  list_basic_block    output basic blocks, could be nullptr if not needed
+     *  \return GW_SUCCESS if success, GW_FAILED_NOT_READY if index not built
+     */
+    gw_retval_t resolve_pcs(
+        const uint64_t* list_pc, uint64_t nb_pc, GWInstruction** list_instruction, GWBasicBlock** list_basic_block
+    ) const;
+
+ protected:
+    /*!
+     *  \brief  dense index from pc to instruction / basic block
+     */
+    typedef struct gw_kernel_def_pc_index {
+        // dense index: <pc / instruction_size, instruction / basic block>
+        // NOTE(zhuobin): an extra nullptr slot is appended at the end as the sentinel of invalid pc
+        std::vector<GWInstruction*> list_instruction = {};
+        std::vector<GWBasicBlock*> list_basic_block = {};
+
+        // shift and mask to convert pc to index (instruction size is power of 2)
+        uint64_t shift = 4;
+        uint64_t mask = 0xf;
+
+        // instructions and CFG which the index is built from, to identify stale index
+        uint64_t nb_instructions = 0;
+        uint64_t nb_basic_blocks = 0;
+        GWBasicBlock* const *basic_blocks = nullptr;
+    } gw_kernel_def_pc_index_t;
+
+
+    /*!
+     *  \brief  obtain the up-to-date dense index of this kernel definition
+     *  \note   the caller should be within a read-side critical section of GWUtilEpochDomain
+     *  \return the dense index, nullptr if not built or stale
+     */
+    inline const gw_kernel_def_pc_index_t* __get_pc_index() const {
+        gw_kernel_def_state_t *state = nullptr;
+        const gw_kernel_def_pc_index_t *index = nullptr;
+
+        if(!__get_map_state().find(this, state))
+            return nullptr;
+        index = state->pc_index.load(std::memory_order_acquire);
+        if(unlikely(
+            index == nullptr
+            or index->nb_instructions != this->list_instructions.size()
+            or index->nb_basic_blocks != this->list_basic_blocks.size()
+            or index->basic_blocks != this->list_basic_blocks.data()
+        )){
+            return nullptr;
+        }
+        return index;
+    }
+
+
+    /* ==================== PC Index ==================== */
+
+
+    /* ==================== Fingerprint ==================== */
+ public:
+    /*!
+     *  \brief  calculate the normalized fingerprint of the instruction stream, kernels with
+     *          the same fingerprint are identical apart from relocations and symbol names,
+     *          so that their analysis results (CFG, liveness) could be shared, the hash of
+     *          the raw instruction bytes is calculated as well
+     *  \param  set_relocated_pc    offsets patched by relocations within the text section,
+     *                              which could point to the middle of an instruction
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t calculate_fingerprint(const std::set<uint64_t>& set_relocated_pc = {});
+
+
+    /*!
+     *  \brief  adopt analysis results (CFG and register liveness) from another kernel
+     *          definition with the same fingerprint
+     *  \note   the normalized instruction streams are compared on fingerprint match,
+     *          so that hash collision won't lead to adopting analysis of other kernel
+     *  \param  other   kernel definition to adopt from
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if the kernels differ
+     */
+    gw_retval_t adopt_analysis(const GWKernelDef* other);
+
+
+    // getters
+    bool has_fingerprint() const;
+    uint64_t get_fingerprint() const;
+    uint64_t get_binary_hash() const;
+
+ protected:
+    /*!
+     *  \brief  append the normalized byte sequence of the instruction stream, relocated
+     *          instructions are encoded by their definition and non-immediate operands,
+     *          while other instructions are encoded by their raw bytes
+     *  \param  set_relocated_pc    pcs of relocated instructions, aligned to the instruction size
+     *  \param  stream              output byte sequence
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t __get_normalized_stream(const std::set<uint64_t>& set_relocated_pc, std::vector<uint8_t>& stream) const;
+    /* ==================== Fingerprint ==================== */
+
+
+    /* ==================== State ==================== */
+ protected:
+    /*!
+     *  \brief  state of a kernel definition which is derived from its instructions
+     *  \note   kernel definitions are shared among threads which trace the same kernel,
+     *          so the state is updated under the lock, and the pc index is published
+     *          to lock-free readers by the pointer
+     */
+    typedef struct gw_kernel_def_state {
+        std::mutex mutex;
+
+        // dense pc index, nullptr if not built
+        std::atomic<const gw_kernel_def_pc_index_t*> pc_index = nullptr;
+
+        // normalized fingerprint of the instruction stream
+        bool has_fingerprint = false;
+        uint64_t fingerprint = 0;
+
+        // hash of the raw instruction bytes, calculated along with the fingerprint
+        uint64_t binary_hash = 0;
+
+        // pcs of instructions patched by relocations, aligned to the instruction size
+        std::set<uint64_t> set_relocated_pc;
+    } gw_kernel_def_state_t;
+
+
+    /*!
+     *  \brief  obtain the state of this kernel definition
+     *  \param  do_create   whether to create the state if it doesn't exist
+     *  \return the state, nullptr if it doesn't exist and isn't created
+     */
+    gw_kernel_def_state_t* __get_state(bool do_create) const;
+
+
+    /*!
+     *  \brief  obtain the states of all kernel definitions
+     *  \note   states are kept aside instead of within this class, as architecture-specific
+     *          kernel definitions derived from this class are prebuilt against its layout;
+     *          the map is never destructed, as kernel definitions might be destructed after
+     *          static objects
+     *  \return states of all kernel definitions
+     */
+    static GWUtilRcuMap<const GWKernelDef*, gw_kernel_def_state_t*>& __get_map_state(){
+        static GWUtilRcuMap<const GWKernelDef*, gw_kernel_def_state_t*> *map_state
+            = new GWUtilRcuMap<const GWKernelDef*, gw_kernel_def_state_t*>();
+        return *map_state;
+    }
+
+
+    // lock to create / destroy the state
+    static std::mutex _mutex_state;
+    /* ==================== State ==================== */
+
+
     /* ==================== Debug ==================== */
  public:
     typedef struct gw_dwarf_line_metadata {
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <vector>
+#include <set>
+#include <string>
 
 #include <libelf.h>
 #include <gelf.h>
@@ -16,6 +18,64 @@ GWBinaryImage::GWBinaryImage(){}
 GWBinaryImage::~GWBinaryImage(){}
 
 
+gw_retval_t GWBinaryImage::get_elf_relocated_offsets(const std::string& section_name, std::set<uint64_t>& set_offset){
+    gw_retval_t retval = GW_SUCCESS;
+    Elf *elf = nullptr;
+    Elf_Scn *target_section = nullptr, *section = nullptr;
+    Elf_Data *data = nullptr;
+    GElf_Shdr shdr;
+    GElf_Rel rel;
+    GElf_Rela rela;
+    size_t target_index = 0;
+    uint64_t i = 0, nb_entries = 0;
+
+    set_offset.clear();
+
+    if(unlikely(this->_binary.size() == 0)){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    elf_version(EV_CURRENT);
+    if((elf = elf_memory(reinterpret_cast<char*>(this->_binary.data()), this->_binary.size())) == nullptr){
+        GW_WARN_DETAIL("failed to open binary as ELF: %s", elf_errmsg(-1));
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+    GW_IF_FAILED(GWBinaryImage::__verify_elf(elf), retval, goto exit;);
+
+    if(unlikely(GWBinaryImage::__get_elf_section_by_name(elf, section_name.c_str(), &target_section) != GW_SUCCESS)){
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+    target_index = elf_ndxscn(target_section);
+
+    // relocation sections (e.g., .rel.text.<kernel>) refer to the patched section by sh_info
+    while((section = elf_nextscn(elf, section)) != nullptr){
+        if(gelf_getshdr(section, &shdr) != &shdr)
+            continue;
+        if((shdr.sh_type != SHT_REL and shdr.sh_type != SHT_RELA) or shdr.sh_info != target_index)
+            continue;
+        if(shdr.sh_entsize == 0 or (data = elf_getdata(section, nullptr)) == nullptr)
+            continue;
+
+        nb_entries = shdr.sh_size / shdr.sh_entsize;
+        for(i=0; i<nb_entries; i++){
+            if(shdr.sh_type == SHT_REL and gelf_getrel(data, i, &rel) == &rel){
+                set_offset.insert(rel.r_offset);
+            } else if(shdr.sh_type == SHT_RELA and gelf_getrela(data, i, &rela) == &rela){
+                set_offset.insert(rela.r_offset);
+            }
+        }
+    }
+
+exit:
+    if(elf != nullptr)
+        elf_end(elf);
+    return retval;
+}
+
+
 gw_retval_t GWBinaryImage::__verify_elf(Elf* elf){
     gw_retval_t retval = GW_SUCCESS;
     Elf_Kind ek;
@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <vector>
+#include <set>
+#include <string>
 #include <fstream>
 
 #include <libelf.h>
@@ -119,6 +121,17 @@ class GWBinaryImage {
 
 
     /* ==================== ELF ==================== */
+ public:
+    /*!
+     *  \brief  obtain offsets patched by relocations within the given ELF section
+     *  \note   the binary should be an ELF (e.g., cubin)
+     *  \param  section_name    name of the relocated section (e.g., ".text.<kernel>")
+     *  \param  set_offset      output offsets within the section
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if the binary isn't a valid ELF,
+     *          GW_FAILED_NOT_EXIST if the section doesn't exist
+     */
+    gw_retval_t get_elf_relocated_offsets(const std::string& section_name, std::set<uint64_t>& set_offset);
+
  protected:
     /*!
      *  \brief  verify whether a given binary is a valid ELF binary
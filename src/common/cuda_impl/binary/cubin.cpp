@@ -0,0 +1,265 @@
+#include <iostream>
+#include <vector>
+#include <set>
+#include <map>
+#include <format>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/binary.hpp"
+#include "common/instrument.hpp"
+#include "common/assemble/kernel.hpp"
+#include "common/assemble/kernel_def.hpp"
+#include "common/assemble/instruction.hpp"
+#include "common/cuda_impl/binary/cubin.hpp"
+#include "common/cuda_impl/assemble/kernel_def_sass.hpp"
+
+
+gw_retval_t GWBinaryImageExt_CUDACubin::dynamic_instrument_batch(std::vector<GWInstrumentCxt*>& list_instrument_cxt){
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    GWKernel *kernel = nullptr;
+    GWKernelDef *kernel_def = nullptr;
+    GWKernelDefExt_CUDA_SASS *kernel_def_ext_sass = nullptr;
+    std::map<GWKernelDef*, gw_retval_t> map_kernel_def_retval;
+    uint64_t nb_failed = 0;
+
+    if(unlikely(list_instrument_cxt.size() == 0)){
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    // step 1: verify all contexts instrument kernels of this cubin
+    for(GWInstrumentCxt* instrument_cxt : list_instrument_cxt){
+        GW_CHECK_POINTER(instrument_cxt);
+        GW_CHECK_POINTER(kernel = instrument_cxt->get_kernel());
+        GW_CHECK_POINTER(kernel_def = kernel->get_def());
+        GW_CHECK_POINTER(kernel_def_ext_sass = GWKernelDefExt_CUDA_SASS::get_ext_ptr(kernel_def));
+        if(unlikely(kernel_def_ext_sass->params().binary_cuda_cubin != this->get_base_ptr())){
+            GW_WARN(
+                "failed to instrument in batch, kernel doesn't locate within the cubin: kernel(%s)",
+                kernel_def->mangled_prototype.c_str()
+            );
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        map_kernel_def_retval[kernel_def] = GW_SUCCESS;
+    }
+
+    // step 2: prepare analysis of each kernel once, shared by all its contexts
+    for(auto& [_kernel_def, _retval] : map_kernel_def_retval){
+        if(!_kernel_def->is_register_liveness_parsed()){
+            GW_IF_FAILED(
+                _kernel_def->parse_register_liveness(),
+                _retval,
+                GW_WARN(
+                    "failed to instrument in batch, failed to parse register liveness: kernel(%s)",
+                    _kernel_def->mangled_prototype.c_str()
+                );
+            );
+        }
+    }
+
+    // step 3: rewrite each context
+    for(GWInstrumentCxt* instrument_cxt : list_instrument_cxt){
+        kernel_def = instrument_cxt->get_kernel()->get_def();
+        if(map_kernel_def_retval[kernel_def] == GW_SUCCESS){
+            tmp_retval = this->dynamic_instrument(instrument_cxt);
+        } else {
+            tmp_retval = map_kernel_def_retval[kernel_def];
+        }
+        if(tmp_retval != GW_SUCCESS){
+            GW_WARN(
+                "failed to instrument in batch: kernel(%s), instrumentation(%s), error(%s)",
+                kernel_def->mangled_prototype.c_str(), instrument_cxt->get_type().c_str(), gw_retval_str(tmp_retval)
+            );
+            instrument_cxt->instrumented_binary_bytes.clear();
+            nb_failed += 1;
+        }
+    }
+
+    if(nb_failed > 0)
+        retval = GW_FAILED;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWBinaryImageExt_CUDACubin::verify_instrumented_binary(
+    const std::vector<uint8_t>& instrumented_binary_bytes,
+    const std::vector<GWInstrumentCxt*>& list_instrument_cxt,
+    nlohmann::json& report
+){
+    gw_retval_t retval = GW_SUCCESS;
+    GWBinaryImageExt_CUDACubin *instrumented_cubin = nullptr;
+    GWBinaryImage *instrumented_binary = nullptr, *origin_binary = nullptr;
+    GWKernel *kernel = nullptr;
+    std::map<std::string, std::vector<std::vector<uint8_t>>> map_expected_bytes;
+    std::string kernel_name = "";
+
+    report = nlohmann::json::object();
+
+    GW_CHECK_POINTER(origin_binary = this->get_base_ptr());
+    GW_IF_FAILED(
+        origin_binary->parse(),
+        retval,
+        {
+            GW_WARN("failed to verify instrumented cubin, failed to parse origin cubin: error(%s)", gw_retval_str(retval));
+            goto exit;
+        }
+    );
+
+    // expected instructions of each instrumented kernel
+    for(GWInstrumentCxt* instrument_cxt : list_instrument_cxt){
+        GW_CHECK_POINTER(instrument_cxt);
+        GW_CHECK_POINTER(kernel = instrument_cxt->get_kernel());
+        GW_CHECK_POINTER(kernel->get_def());
+        kernel_name = kernel->get_def()->mangled_prototype;
+        if(unlikely(map_expected_bytes.count(kernel_name) > 0)){
+            GW_WARN("failed to verify instrumented cubin, duplicated kernel in batch: kernel(%s)", kernel_name.c_str());
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        map_expected_bytes[kernel_name] = {};
+        for(GWInstruction* inst : instrument_cxt->list_out_instructions){
+            GW_CHECK_POINTER(inst);
+            map_expected_bytes[kernel_name].push_back(inst->bytes);
+        }
+    }
+
+    // re-parse the instrumented cubin
+    GW_CHECK_POINTER(instrumented_cubin = GWBinaryImageExt_CUDACubin::create());
+    GW_CHECK_POINTER(instrumented_binary = instrumented_cubin->get_base_ptr());
+    GW_IF_FAILED(
+        instrumented_binary->fill(instrumented_binary_bytes.data(), instrumented_binary_bytes.size()),
+        retval,
+        {
+            GW_WARN("failed to verify instrumented cubin, failed to fill: error(%s)", gw_retval_str(retval));
+            goto exit;
+        }
+    );
+    GW_IF_FAILED(
+        instrumented_binary->parse(),
+        retval,
+        {
+            GW_WARN("failed to verify instrumented cubin, failed to parse: error(%s)", gw_retval_str(retval));
+            report["error"] = "failed to parse instrumented cubin";
+            goto exit;
+        }
+    );
+
+    retval = GWBinaryImageExt_CUDACubin::diff_kernels(this, instrumented_cubin, map_expected_bytes, report);
+
+exit:
+    if(instrumented_cubin != nullptr)
+        delete instrumented_cubin;
+    return retval;
+}
+
+
+gw_retval_t GWBinaryImageExt_CUDACubin::diff_kernels(
+    GWBinaryImageExt_CUDACubin* origin_cubin,
+    GWBinaryImageExt_CUDACubin* instrumented_cubin,
+    const std::map<std::string, std::vector<std::vector<uint8_t>>>& map_expected_bytes,
+    nlohmann::json& report
+){
+    gw_retval_t retval = GW_SUCCESS;
+    std::map<std::string, GWKernelDef*> map_origin_kernel_def, map_instrumented_kernel_def;
+    GWKernelDef *instrumented_kernel_def = nullptr;
+    uint64_t i = 0;
+    nlohmann::json mismatch;
+    std::string reason = "";
+    std::vector<std::vector<uint8_t>> list_origin_bytes;
+
+    /*!
+     *  \brief  compare instructions of a kernel against the expected byte sequences
+     *  \param  _kernel_def     kernel to be compared
+     *  \param  _expected       expected byte sequence of each instruction
+     *  \param  _reason         reason of mismatch
+     *  \return whether the kernel matches
+     */
+    auto __match_instructions = [](
+        const GWKernelDef* _kernel_def, const std::vector<std::vector<uint8_t>>& _expected, std::string& _reason
+    ) -> bool {
+        uint64_t _i = 0;
+
+        if(unlikely(!_kernel_def->is_instructions_parsed())){
+            _reason = "instructions not parsed";
+            return false;
+        }
+        if(_kernel_def->list_instructions.size() != _expected.size()){
+            _reason = std::format(
+                "instruction count mismatch: expected({}), actual({})",
+                _expected.size(), _kernel_def->list_instructions.size()
+            );
+            return false;
+        }
+        for(_i=0; _i<_expected.size(); _i++){
+            if(_kernel_def->list_instructions[_i]->bytes != _expected[_i]){
+                _reason = std::format("instruction mismatch: idx({})", _i);
+                return false;
+            }
+        }
+        return true;
+    };
+
+    GW_CHECK_POINTER(origin_cubin);
+    GW_CHECK_POINTER(instrumented_cubin);
+
+    map_origin_kernel_def = origin_cubin->get_map_kernel_def();
+    map_instrumented_kernel_def = instrumented_cubin->get_map_kernel_def();
+
+    report["nb_kernels"] = map_origin_kernel_def.size();
+    report["nb_instrumented_kernels"] = map_expected_bytes.size();
+    report["mismatches"] = nlohmann::json::array();
+
+    // instrumented kernels
+    for(auto& [kernel_name, list_expected_bytes] : map_expected_bytes){
+        mismatch = { { "kernel", kernel_name }, { "instrumented", true } };
+        if(map_instrumented_kernel_def.count(kernel_name) == 0){
+            mismatch["reason"] = "missing in instrumented cubin";
+            report["mismatches"].push_back(mismatch);
+            continue;
+        }
+        GW_CHECK_POINTER(instrumented_kernel_def = map_instrumented_kernel_def[kernel_name]);
+        if(list_expected_bytes.size() == 0)
+            continue;
+        if(!__match_instructions(instrumented_kernel_def, list_expected_bytes, reason)){
+            mismatch["reason"] = reason;
+            report["mismatches"].push_back(mismatch);
+        }
+    }
+
+    // other kernels should be intact
+    for(auto& [kernel_name, origin_kernel_def] : map_origin_kernel_def){
+        if(map_expected_bytes.count(kernel_name) > 0)
+            continue;
+        mismatch = { { "kernel", kernel_name }, { "instrumented", false } };
+        if(map_instrumented_kernel_def.count(kernel_name) == 0){
+            mismatch["reason"] = "missing in instrumented cubin";
+            report["mismatches"].push_back(mismatch);
+            continue;
+        }
+        GW_CHECK_POINTER(origin_kernel_def);
+        GW_CHECK_POINTER(instrumented_kernel_def = map_instrumented_kernel_def[kernel_name]);
+        if(!origin_kernel_def->is_instructions_parsed())
+            continue;
+        list_origin_bytes.clear();
+        for(i=0; i<origin_kernel_def->list_instructions.size(); i++)
+            list_origin_bytes.push_back(origin_kernel_def->list_instructions[i]->bytes);
+        if(!__match_instructions(instrumented_kernel_def, list_origin_bytes, reason)){
+            mismatch["reason"] = reason;
+            report["mismatches"].push_back(mismatch);
+        }
+    }
+
+    if(report["mismatches"].size() > 0){
+        GW_WARN("instrumented cubin mismatches origin cubin: nb_mismatches(%lu)", report["mismatches"].size());
+        retval = GW_FAILED;
+    }
+
+exit:
+    return retval;
+}
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
+#include <set>
+#include <map>
+
+#include <nlohmann/json.hpp>
 
 #include "common/common.hpp"
 #include "common/log.hpp"
@@ -119,6 +124,40 @@ class GW_EXPORT_API GWBinaryImageExt_CUDACubin {
     ) = 0;
 
 
+    /*!
+     *  \brief  verify an instrumented cubin offline by re-parsing it and diffing its kernels
+     *          with this (origin) cubin: instrumented kernels should match the instructions
+     *          emitted by their instrument contexts, other kernels should be intact
+     *  \param  instrumented_binary_bytes   raw bytes of the instrumented cubin
+     *  \param  list_instrument_cxt         instrument contexts applied to the instrumented cubin
+     *  \param  report                      report of the diff, contains mismatched kernels
+     *  \return GW_SUCCESS if verified, GW_FAILED if any kernel mismatches
+     */
+    gw_retval_t verify_instrumented_binary(
+        const std::vector<uint8_t>& instrumented_binary_bytes,
+        const std::vector<GWInstrumentCxt*>& list_instrument_cxt,
+        nlohmann::json& report
+    );
+
+
+    /*!
+     *  \brief  diff kernels between two parsed cubins
+     *  \param  origin_cubin            the origin cubin
+     *  \param  instrumented_cubin      the instrumented cubin
+     *  \param  map_expected_bytes      expected instruction bytes of instrumented kernels:
+     *                                  <kernel_name, list_inst_bytes>; empty list only checks
+     *                                  existence of the kernel
+     *  \param  report                  report of the diff, contains mismatched kernels
+     *  \return GW_SUCCESS if identical, GW_FAILED if any kernel mismatches
+     */
+    static gw_retval_t diff_kernels(
+        GWBinaryImageExt_CUDACubin* origin_cubin,
+        GWBinaryImageExt_CUDACubin* instrumented_cubin,
+        const std::map<std::string, std::vector<std::vector<uint8_t>>>& map_expected_bytes,
+        nlohmann::json& report
+    );
+
+
     /*!
      *  \brief  obtain the map of kernels within this cubin
      *  \return map of kernels within this cubin
@@ -138,4 +177,21 @@ class GW_EXPORT_API GWBinaryImageExt_CUDACubin {
      *  \return reference of parameters
      */
     virtual const GWBinaryImageExt_CUDACubin_Params& params() const = 0;
+
+
+    /*!
+     *  \brief  instrument multiple kernels of this cubin within a single pass, the analysis
+     *          of each kernel (e.g., register liveness) is prepared once and shared by all
+     *          instrument contexts of the kernel
+     *  \note   each context is still rewritten by dynamic_instrument, which relayouts the ELF
+     *          per context; this function isn't virtual, as derived classes are prebuilt
+     *          against the vtable of this class; contexts failed to instrument are left
+     *          without instrumented_binary_bytes, while others proceed
+     *  \param  list_instrument_cxt     instrument contexts to be used, whose kernels should
+     *                                  locate within this cubin
+     *  \return GW_SUCCESS if all contexts are instrumented, GW_FAILED if some failed
+     */
+    gw_retval_t dynamic_instrument_batch(
+        std::vector<GWInstrumentCxt*>& list_instrument_cxt
+    );
 };
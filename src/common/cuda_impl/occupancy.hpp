@@ -0,0 +1,202 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+/*!
+ *  \brief  per-SM resource limits of a CUDA architecture
+ */
+typedef struct gw_cuda_sm_resource {
+    // thread / warp / block limits per SM
+    uint32_t max_threads_per_sm = 0;
+    uint32_t max_warps_per_sm = 0;
+    uint32_t max_blocks_per_sm = 0;
+
+    // register file
+    uint32_t nb_regs_per_sm = 0;
+    uint32_t max_regs_per_thread = 0;
+    uint32_t reg_alloc_unit = 0;        // registers allocated per warp in unit of this size
+
+    // shared memory
+    uint32_t smem_per_sm = 0;
+    uint32_t max_smem_per_block = 0;
+    uint32_t smem_alloc_unit = 0;
+    uint32_t reserved_smem_per_block = 0;
+} gw_cuda_sm_resource_t;
+
+
+/*!
+ *  \brief  occupancy of a kernel under certain launch configuration
+ */
+typedef struct gw_cuda_occupancy {
+    uint32_t nb_active_blocks_per_sm = 0;
+    uint32_t nb_active_warps_per_sm = 0;
+
+    // ratio of active warps to max warps per SM
+    double occupancy = 0.0f;
+
+    // resource which limits the occupancy (threads, blocks, registers, smem)
+    std::string limiter = "";
+} gw_cuda_occupancy_t;
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    gw_cuda_occupancy_t,
+    nb_active_blocks_per_sm, nb_active_warps_per_sm, occupancy, limiter
+);
+
+
+/*!
+ *  \brief  static occupancy calculator for CUDA kernels
+ */
+class GWOccupancyCUDA {
+ public:
+    /*!
+     *  \brief  obtain SM resource of certain architecture
+     *  \note   if the architecture isn't in the table, we fall back to the nearest
+     *          older architecture of the same major version
+     *  \param  arch_version    architecture version (e.g., "86")
+     *  \param  sm_resource     output SM resource
+     *  \return GW_SUCCESS if success
+     */
+    static gw_retval_t get_sm_resource(const std::string& arch_version, gw_cuda_sm_resource_t& sm_resource){
+        gw_retval_t retval = GW_SUCCESS;
+        uint32_t arch = 0;
+        std::map<uint32_t, gw_cuda_sm_resource_t>::const_iterator it;
+        const std::map<uint32_t, gw_cuda_sm_resource_t>& map_sm_resource = __get_sm_resource_table();
+
+        try {
+            arch = std::stoul(arch_version);
+        } catch (...) {
+            GW_WARN("invalid arch version: arch_version(%s)", arch_version.c_str());
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+
+        it = map_sm_resource.upper_bound(arch);
+        if(unlikely(it == map_sm_resource.begin())){
+            GW_WARN("unsupported arch version for occupancy estimation: arch_version(%s)", arch_version.c_str());
+            retval = GW_FAILED_NOT_EXIST;
+            goto exit;
+        }
+        it--;
+        if(unlikely(it->first / 10 != arch / 10)){
+            GW_WARN("unsupported arch version for occupancy estimation: arch_version(%s)", arch_version.c_str());
+            retval = GW_FAILED_NOT_EXIST;
+            goto exit;
+        }
+        sm_resource = it->second;
+
+    exit:
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  calculate the occupancy of a kernel
+     *  \param  sm_resource             SM resource of the architecture
+     *  \param  nb_threads_per_block    number of threads per block
+     *  \param  nb_regs_per_thread      number of registers per thread
+     *  \param  smem_per_block          shared memory usage (static + dynamic) per block
+     *  \param  occupancy               output occupancy
+     *  \return GW_SUCCESS if success, GW_FAILED_HARDWARE if the kernel can't be launched
+     */
+    static gw_retval_t calculate(
+        const gw_cuda_sm_resource_t& sm_resource,
+        uint32_t nb_threads_per_block,
+        uint32_t nb_regs_per_thread,
+        uint32_t smem_per_block,
+        gw_cuda_occupancy_t& occupancy
+    ){
+        gw_retval_t retval = GW_SUCCESS;
+        uint32_t nb_warps_per_block = 0, nb_regs_per_warp = 0, smem_alloc_per_block = 0;
+        uint32_t nb_blocks_by_warps = 0, nb_blocks_by_regs = 0, nb_blocks_by_smem = 0;
+
+        occupancy = gw_cuda_occupancy_t();
+
+        GW_ASSERT(sm_resource.max_warps_per_sm > 0);
+
+        if(unlikely(nb_threads_per_block == 0)){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+
+        if(unlikely(
+            nb_regs_per_thread > sm_resource.max_regs_per_thread
+            or smem_per_block > sm_resource.max_smem_per_block
+        )){
+            occupancy.limiter = nb_regs_per_thread > sm_resource.max_regs_per_thread ? "registers" : "smem";
+            retval = GW_FAILED_HARDWARE;
+            goto exit;
+        }
+
+        nb_warps_per_block = __ceil_div(nb_threads_per_block, 32);
+
+        // limited by warps and blocks
+        nb_blocks_by_warps = sm_resource.max_warps_per_sm / nb_warps_per_block;
+        occupancy.nb_active_blocks_per_sm = std::min(nb_blocks_by_warps, sm_resource.max_blocks_per_sm);
+        occupancy.limiter = nb_blocks_by_warps < sm_resource.max_blocks_per_sm ? "threads" : "blocks";
+
+        // limited by registers
+        if(nb_regs_per_thread > 0){
+            nb_regs_per_warp = __ceil_div(nb_regs_per_thread * 32, sm_resource.reg_alloc_unit) * sm_resource.reg_alloc_unit;
+            nb_blocks_by_regs = (sm_resource.nb_regs_per_sm / nb_regs_per_warp) / nb_warps_per_block;
+            if(nb_blocks_by_regs < occupancy.nb_active_blocks_per_sm){
+                occupancy.nb_active_blocks_per_sm = nb_blocks_by_regs;
+                occupancy.limiter = "registers";
+            }
+        }
+
+        // limited by shared memory
+        smem_alloc_per_block = smem_per_block + sm_resource.reserved_smem_per_block;
+        if(smem_alloc_per_block > 0){
+            smem_alloc_per_block = __ceil_div(smem_alloc_per_block, sm_resource.smem_alloc_unit) * sm_resource.smem_alloc_unit;
+            nb_blocks_by_smem = sm_resource.smem_per_sm / smem_alloc_per_block;
+            if(nb_blocks_by_smem < occupancy.nb_active_blocks_per_sm){
+                occupancy.nb_active_blocks_per_sm = nb_blocks_by_smem;
+                occupancy.limiter = "smem";
+            }
+        }
+
+        occupancy.nb_active_warps_per_sm = occupancy.nb_active_blocks_per_sm * nb_warps_per_block;
+        occupancy.occupancy = (double)(occupancy.nb_active_warps_per_sm) / (double)(sm_resource.max_warps_per_sm);
+
+    exit:
+        return retval;
+    }
+
+ private:
+    static inline uint32_t __ceil_div(uint32_t a, uint32_t b){
+        return (a + b - 1) / b;
+    }
+
+
+    /*!
+     *  \brief  table of SM resources, indexed by arch version (major * 10 + minor)
+     *  \note   values follow the "Technical Specifications per Compute Capability"
+     *          table of the CUDA programming guide
+     */
+    static const std::map<uint32_t, gw_cuda_sm_resource_t>& __get_sm_resource_table(){
+        static const std::map<uint32_t, gw_cuda_sm_resource_t> map_sm_resource = {
+            //        threads warps   blocks   regs     max_regs   unit    smem                 max_smem             unit    reserved
+            { 70,   { 2048,   64,     32,      65536,   255,       256,    (uint32_t)KB(96),    (uint32_t)KB(96),    256,    0 } },
+            { 72,   { 2048,   64,     32,      65536,   255,       256,    (uint32_t)KB(96),    (uint32_t)KB(96),    256,    0 } },
+            { 75,   { 1024,   32,     16,      65536,   255,       256,    (uint32_t)KB(64),    (uint32_t)KB(64),    256,    0 } },
+            { 80,   { 2048,   64,     32,      65536,   255,       256,    (uint32_t)KB(164),   (uint32_t)KB(163),   128,    (uint32_t)KB(1) } },
+            { 86,   { 1536,   48,     16,      65536,   255,       256,    (uint32_t)KB(100),   (uint32_t)KB(99),    128,    (uint32_t)KB(1) } },
+            { 87,   { 1536,   48,     16,      65536,   255,       256,    (uint32_t)KB(164),   (uint32_t)KB(163),   128,    (uint32_t)KB(1) } },
+            { 89,   { 1536,   48,     24,      65536,   255,       256,    (uint32_t)KB(100),   (uint32_t)KB(99),    128,    (uint32_t)KB(1) } },
+            { 90,   { 2048,   64,     32,      65536,   255,       256,    (uint32_t)KB(228),   (uint32_t)KB(227),   128,    (uint32_t)KB(1) } },
+            { 100,  { 2048,   64,     32,      65536,   255,       256,    (uint32_t)KB(228),   (uint32_t)KB(227),   128,    (uint32_t)KB(1) } },
+            { 103,  { 2048,   64,     32,      65536,   255,       256,    (uint32_t)KB(228),   (uint32_t)KB(227),   128,    (uint32_t)KB(1) } },
+            { 120,  { 1536,   48,     32,      65536,   255,       256,    (uint32_t)KB(128),   (uint32_t)KB(99),    128,    (uint32_t)KB(1) } },
+        };
+        return map_sm_resource;
+    }
+};
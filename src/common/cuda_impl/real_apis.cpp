@@ -35,6 +35,7 @@ thread_local cu_module_load_fat_binary_func_t *real_cuModuleLoadFatBinary = null
 thread_local cu_module_load_data_func_t *real_cuModuleLoadData = nullptr;
 thread_local cu_module_load_data_ex_func_t *real_cuModuleLoadDataEx = nullptr;
 thread_local cu_module_get_function_func_t *real_cuModuleGetFunction = nullptr;
+thread_local cu_module_unload_func_t *real_cuModuleUnload = nullptr;
 
 // ==========> Library Management <==========
 thread_local cu_library_load_data_func_t *real_cuLibraryLoadData = nullptr;
@@ -42,6 +43,7 @@ thread_local cu_library_get_module_func_t *real_cuLibraryGetModule = nullptr;
 thread_local cu_library_get_kernel_func_t *real_cuLibraryGetKernel = nullptr;
 thread_local cu_kernel_get_function_func_t *real_cuKernelGetFunction = nullptr;
 thread_local cu_library_load_from_file_func_t *real_cuLibraryLoadFromFile = nullptr;
+thread_local cu_library_unload_func_t *real_cuLibraryUnload = nullptr;
 
 // ==========> Stream Management <==========
 thread_local cu_stream_synchronize_func_t *real_cuStreamSynchronize = nullptr;
@@ -151,6 +153,11 @@ void __init_real_cuda_apis(){
         = (cu_module_get_function_func_t*)real_dlsym(lib_cuda_handle, "cuModuleGetFunction");
     GW_CHECK_POINTER(real_cuModuleGetFunction);
 
+    // cuModuleUnload
+    real_cuModuleUnload
+        = (cu_module_unload_func_t*)real_dlsym(lib_cuda_handle, "cuModuleUnload");
+    GW_CHECK_POINTER(real_cuModuleUnload);
+
     // ==========> Library Management <==========
     // cuLibraryLoadFromFile
     real_cuLibraryLoadFromFile
@@ -177,6 +184,11 @@ void __init_real_cuda_apis(){
         = (cu_kernel_get_function_func_t*)real_dlsym(lib_cuda_handle, "cuKernelGetFunction");
     GW_CHECK_POINTER(real_cuKernelGetFunction);
 
+    // cuLibraryUnload
+    real_cuLibraryUnload
+        = (cu_library_unload_func_t*)real_dlsym(lib_cuda_handle, "cuLibraryUnload");
+    GW_CHECK_POINTER(real_cuLibraryUnload);
+
     // ==========> Stream Management <==========
     // cuStreamSynchronize
     real_cuStreamSynchronize
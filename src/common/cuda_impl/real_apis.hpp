@@ -123,6 +123,11 @@ using cu_module_get_function_func_t = CUresult(CUfunction*, CUmodule, const char
 extern thread_local cu_module_get_function_func_t *real_cuModuleGetFunction;
 
 
+// cuModuleUnload
+using cu_module_unload_func_t = CUresult(CUmodule);
+extern thread_local cu_module_unload_func_t *real_cuModuleUnload;
+
+
 // ==========> Library Management <==========
 // cuLibraryLoadData
 using cu_library_load_data_func_t 
@@ -158,6 +163,11 @@ using cu_library_load_from_file_func_t
 extern thread_local cu_library_load_from_file_func_t *real_cuLibraryLoadFromFile;
 
 
+// cuLibraryUnload
+using cu_library_unload_func_t = CUresult(CUlibrary);
+extern thread_local cu_library_unload_func_t *real_cuLibraryUnload;
+
+
 // ==========> Stream Management <==========
 // cuStreamSynchronize
 using cu_stream_synchronize_func_t = CUresult(CUstream);
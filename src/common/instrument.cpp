@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 
 #include <nlohmann/json.hpp>
 
@@ -11,6 +12,10 @@
 #include "common/assemble/kernel.hpp"
 
 
+std::mutex GWInstrumentRegAllocCxt::_mutex_dead_reg_states;
+std::unordered_map<const GWInstrumentRegAllocCxt*, gw_instrument_dead_reg_state_t> GWInstrumentRegAllocCxt::_map_dead_reg_states;
+
+
 GWInstrumentRegAllocCxt::GWInstrumentRegAllocCxt(GWKernel* kernel)
     : _kernel(kernel)
 {
@@ -19,17 +24,43 @@ GWInstrumentRegAllocCxt::GWInstrumentRegAllocCxt(GWKernel* kernel)
 
 
 GWInstrumentRegAllocCxt::~GWInstrumentRegAllocCxt()
-{}
+{
+    std::lock_guard<std::mutex> lock(_mutex_dead_reg_states);
+    _map_dead_reg_states.erase(this);
+}
 
 
 gw_retval_t GWInstrumentRegAllocCxt::alloc_extra(std::string type, uint64_t& reg_id){
     gw_retval_t retval = GW_SUCCESS;
+    gw_instrument_dead_reg_state_t &state = this->__get_dead_reg_state();
     std::vector<uint64_t> list_reg_idx;
+    uint64_t start_pc = 0, end_pc = 0;
 
-    retval = this->alloc_extra(type, 1, list_reg_idx);
-    if(retval == GW_SUCCESS){
-        GW_ASSERT(list_reg_idx.size() == 1);
-        reg_id = list_reg_idx[0];
+    GW_CHECK_POINTER(this->_kernel_def);
+
+    // hand out the register reserved by alloc_reused first
+    if(state.map_pending_reused_reg[type].size() > 0){
+        reg_id = state.map_pending_reused_reg[type].front();
+        state.map_pending_reused_reg[type].erase(state.map_pending_reused_reg[type].begin());
+        goto exit;
+    }
+
+    // reuse dead register if the liveness is known, otherwise allocate extra one
+    if(this->_kernel_def->is_register_liveness_parsed() and this->_kernel_def->map_pc_to_instruction.size() > 0){
+        if(state.has_reuse_range){
+            start_pc = state.reuse_range.first;
+            end_pc = state.reuse_range.second;
+        } else {
+            start_pc = this->_kernel_def->map_pc_to_instruction.begin()->first;
+            end_pc = this->_kernel_def->map_pc_to_instruction.rbegin()->first;
+        }
+        retval = this->alloc_reused(start_pc, end_pc, type, reg_id);
+    } else {
+        retval = this->alloc_extra(type, 1, list_reg_idx);
+        if(retval == GW_SUCCESS){
+            GW_ASSERT(list_reg_idx.size() == 1);
+            reg_id = list_reg_idx[0];
+        }
     }
 
 exit:
@@ -37,6 +68,62 @@ exit:
 }
 
 
+gw_retval_t GWInstrumentRegAllocCxt::alloc_reused(uint64_t start_pc, uint64_t end_pc, std::string type){
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t reg_id = 0;
+
+    GW_IF_FAILED(this->alloc_reused(start_pc, end_pc, type, reg_id), retval, goto exit;);
+    this->__get_dead_reg_state().map_pending_reused_reg[type].push_back(reg_id);
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentRegAllocCxt::alloc_reused(uint64_t start_pc, uint64_t end_pc, std::string type, uint64_t& reg_id){
+    gw_retval_t retval = GW_SUCCESS;
+    std::vector<uint64_t> list_reg_idx;
+
+    GW_IF_FAILED(
+        this->alloc_dead_or_extra(start_pc, end_pc, type, 1, list_reg_idx),
+        retval,
+        goto exit;
+    );
+    GW_ASSERT(list_reg_idx.size() == 1);
+    reg_id = list_reg_idx[0];
+
+exit:
+    return retval;
+}
+
+
+void GWInstrumentRegAllocCxt::set_reuse_range(uint64_t start_pc, uint64_t end_pc){
+    gw_instrument_dead_reg_state_t &state = this->__get_dead_reg_state();
+    state.reuse_range = { start_pc, end_pc };
+    state.has_reuse_range = true;
+}
+
+
+uint64_t GWInstrumentRegAllocCxt::get_nb_avoided_extra_reg(std::string type) const {
+    gw_instrument_dead_reg_state_t &state = this->__get_dead_reg_state();
+    auto it = state.map_nb_avoided_extra_reg.find(type);
+    return it == state.map_nb_avoided_extra_reg.end() ? 0 : it->second;
+}
+
+
+void GWInstrumentRegAllocCxt::reset_live_intervals(){
+    this->__get_dead_reg_state().map_reg_live_intervals.clear();
+}
+
+
+gw_instrument_dead_reg_state_t& GWInstrumentRegAllocCxt::__get_dead_reg_state() const {
+    // NOTE(zhuobin): nodes of unordered_map are stable, so the reference stays valid
+    //                until the context is destroyed
+    std::lock_guard<std::mutex> lock(_mutex_dead_reg_states);
+    return _map_dead_reg_states[this];
+}
+
+
 uint64_t GWInstrumentRegAllocCxt::get_nb_used_reg(std::string type){
     gw_retval_t retval = GW_SUCCESS;
     uint64_t nb_used_reg = 0;
@@ -51,6 +138,266 @@ uint64_t GWInstrumentRegAllocCxt::get_nb_used_reg(std::string type){
 }
 
 
+gw_retval_t GWInstrumentRegAllocCxt::__build_live_intervals(std::string type){
+    gw_retval_t retval = GW_SUCCESS;
+    gw_instrument_dead_reg_state_t &state = this->__get_dead_reg_state();
+    uint64_t prev_pc = 0, max_reg_id = 0, nb_reusable_reg = 0;
+    bool has_prev_pc = false;
+    std::set<uint64_t> set_live_reg;
+    std::map<uint64_t, std::vector<std::pair<uint64_t, std::string>>> reg_op_trace;
+    std::map<uint64_t, std::vector<std::pair<uint64_t, uint64_t>>> map_intervals;
+
+    GW_CHECK_POINTER(this->_kernel_def);
+
+    if(unlikely(!this->_kernel_def->is_register_liveness_parsed())){
+        GW_WARN_C("failed to build live intervals, register liveness not parsed: type(%s)", type.c_str());
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    // step 1: live ranges from liveness IN/OUT set of each instruction,
+    //         continuous pcs are merged into a single interval
+    for(auto& [pc, inst] : this->_kernel_def->map_pc_to_instruction){
+        GW_CHECK_POINTER(inst);
+        set_live_reg.clear();
+        if(inst->map_register_set_IN.count(type) > 0)
+            set_live_reg.insert(inst->map_register_set_IN[type].begin(), inst->map_register_set_IN[type].end());
+        if(inst->map_register_set_OUT.count(type) > 0)
+            set_live_reg.insert(inst->map_register_set_OUT[type].begin(), inst->map_register_set_OUT[type].end());
+
+        for(uint64_t reg_id : set_live_reg){
+            std::vector<std::pair<uint64_t, uint64_t>>& list_interval = map_intervals[reg_id];
+            if(has_prev_pc and list_interval.size() > 0 and list_interval.back().second == prev_pc){
+                list_interval.back().second = pc;
+            } else {
+                list_interval.push_back({ pc, pc });
+            }
+        }
+
+        prev_pc = pc;
+        has_prev_pc = true;
+    }
+
+    // step 2: registers that are touched but not live (e.g., dead definition) would
+    //         still be clobbered, so we mark every operated pc as live as well
+    if(this->_kernel_def->get_register_op_trace(type, reg_op_trace) == GW_SUCCESS){
+        for(auto& [reg_id, list_op] : reg_op_trace){
+            for(auto& [pc, op] : list_op){
+                __insert_live_interval(map_intervals[reg_id], pc, pc);
+            }
+        }
+    }
+    for(auto& [reg_id, list_op] : this->_map_reg_op[type]){
+        for(auto& [pc, op] : list_op){
+            __insert_live_interval(map_intervals[reg_id], pc, pc);
+        }
+    }
+
+    // step 3: only registers within current register budget could be reused,
+    //         otherwise reusing them is no difference with allocating extra one
+    if(this->get_max_reg_id(type, max_reg_id, /* omit_largest */ true) == GW_SUCCESS){
+        nb_reusable_reg = max_reg_id + 1;
+    } else if(map_intervals.size() > 0){
+        nb_reusable_reg = map_intervals.rbegin()->first + 1;
+    }
+
+    // step 4: re-apply ranges reserved by previously reused registers
+    for(auto& [reg_id, list_range] : state.map_reused_reg_ranges[type]){
+        for(auto& [begin_pc, end_pc] : list_range){
+            __insert_live_interval(map_intervals[reg_id], begin_pc, end_pc);
+        }
+    }
+
+    state.map_reg_live_intervals[type] = std::move(map_intervals);
+    state.map_nb_reusable_reg[type] = nb_reusable_reg;
+    state.map_nb_reg_op_in_intervals[type] = this->__count_reg_op(type);
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentRegAllocCxt::__ensure_live_intervals(std::string type){
+    gw_retval_t retval = GW_SUCCESS;
+    gw_instrument_dead_reg_state_t &state = this->__get_dead_reg_state();
+
+    if(
+        state.map_reg_live_intervals.count(type) == 0
+        or state.map_nb_reg_op_in_intervals[type] != this->__count_reg_op(type)
+    ){
+        GW_IF_FAILED(this->__build_live_intervals(type), retval, goto exit;);
+    }
+
+exit:
+    return retval;
+}
+
+
+uint64_t GWInstrumentRegAllocCxt::__count_reg_op(std::string type){
+    uint64_t nb_reg_op = 0;
+    std::map<std::string, std::map<uint64_t, std::vector<std::pair<uint64_t, std::string>>>>::iterator it;
+
+    if((it = this->_map_reg_op.find(type)) != this->_map_reg_op.end()){
+        for(auto& [reg_id, list_op] : it->second)
+            nb_reg_op += list_op.size();
+    }
+
+    return nb_reg_op;
+}
+
+
+bool GWInstrumentRegAllocCxt::__is_dead_in_range(
+    const std::vector<std::pair<uint64_t, uint64_t>>& list_interval, uint64_t start_pc, uint64_t end_pc
+){
+    std::vector<std::pair<uint64_t, uint64_t>>::const_iterator it;
+
+    // find the first interval which ends at or after start_pc
+    it = std::lower_bound(
+        list_interval.begin(), list_interval.end(), start_pc,
+        [](const std::pair<uint64_t, uint64_t>& interval, uint64_t pc){ return interval.second < pc; }
+    );
+
+    return it == list_interval.end() or it->first > end_pc;
+}
+
+
+void GWInstrumentRegAllocCxt::__insert_live_interval(
+    std::vector<std::pair<uint64_t, uint64_t>>& list_interval, uint64_t start_pc, uint64_t end_pc
+){
+    std::vector<std::pair<uint64_t, uint64_t>>::iterator it, it_end;
+
+    it = std::lower_bound(
+        list_interval.begin(), list_interval.end(), start_pc,
+        [](const std::pair<uint64_t, uint64_t>& interval, uint64_t pc){ return interval.second < pc; }
+    );
+
+    // merge all overlapped intervals into [start_pc, end_pc]
+    it_end = it;
+    while(it_end != list_interval.end() and it_end->first <= end_pc){
+        start_pc = std::min(start_pc, it_end->first);
+        end_pc = std::max(end_pc, it_end->second);
+        it_end++;
+    }
+    it = list_interval.erase(it, it_end);
+    list_interval.insert(it, { start_pc, end_pc });
+}
+
+
+gw_retval_t GWInstrumentRegAllocCxt::get_dead_reg_set(
+    std::string type, uint64_t start_pc, uint64_t end_pc, std::set<uint64_t>& set_dead_reg
+){
+    gw_retval_t retval = GW_SUCCESS;
+    gw_instrument_dead_reg_state_t &state = this->__get_dead_reg_state();
+    uint64_t reg_id = 0;
+    std::map<uint64_t, std::vector<std::pair<uint64_t, uint64_t>>>::iterator it;
+
+    set_dead_reg.clear();
+
+    if(unlikely(start_pc > end_pc)){
+        GW_WARN_C("invalid pc range: start_pc(%lx), end_pc(%lx)", start_pc, end_pc);
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    GW_IF_FAILED(this->__ensure_live_intervals(type), retval, goto exit;);
+
+    for(reg_id = 0; reg_id < state.map_nb_reusable_reg[type]; reg_id++){
+        if(this->_map_extra_allocated_reg[type].count(reg_id) > 0)
+            continue;
+        it = state.map_reg_live_intervals[type].find(reg_id);
+        if(it == state.map_reg_live_intervals[type].end() or __is_dead_in_range(it->second, start_pc, end_pc)){
+            set_dead_reg.insert(reg_id);
+        }
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentRegAllocCxt::find_dead_reg_run(
+    std::string type, uint64_t start_pc, uint64_t end_pc, uint32_t nb_continuous,
+    std::vector<uint64_t>& list_reg_idx, uint32_t alignment
+){
+    gw_retval_t retval = GW_SUCCESS;
+    std::set<uint64_t> set_dead_reg;
+    uint64_t run_begin = 0, run_len = 0, prev_reg_id = 0;
+    bool has_prev = false;
+
+    GW_ASSERT(nb_continuous > 0);
+    if(alignment == 0)
+        alignment = 1;
+
+    list_reg_idx.clear();
+
+    GW_IF_FAILED(
+        this->get_dead_reg_set(type, start_pc, end_pc, set_dead_reg),
+        retval,
+        goto exit;
+    );
+
+    for(uint64_t reg_id : set_dead_reg){
+        if(has_prev and reg_id == prev_reg_id + 1 and run_len > 0){
+            run_len++;
+        } else if(reg_id % alignment == 0){
+            run_begin = reg_id;
+            run_len = 1;
+        } else {
+            run_len = 0;
+        }
+        prev_reg_id = reg_id;
+        has_prev = true;
+
+        if(run_len == nb_continuous){
+            for(uint64_t i=0; i<nb_continuous; i++){
+                list_reg_idx.push_back(run_begin + i);
+            }
+            goto exit;
+        }
+    }
+
+    retval = GW_FAILED_NOT_EXIST;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentRegAllocCxt::alloc_dead_or_extra(
+    uint64_t start_pc, uint64_t end_pc, std::string type, uint32_t nb_continuous,
+    std::vector<uint64_t>& list_reg_idx, uint32_t alignment
+){
+    gw_retval_t retval = GW_SUCCESS;
+    gw_instrument_dead_reg_state_t &state = this->__get_dead_reg_state();
+
+    retval = this->find_dead_reg_run(type, start_pc, end_pc, nb_continuous, list_reg_idx, alignment);
+    if(retval == GW_SUCCESS){
+        // reserve the reused registers so that they won't be handed out again
+        for(uint64_t reg_id : list_reg_idx){
+            __insert_live_interval(state.map_reg_live_intervals[type][reg_id], start_pc, end_pc);
+            state.map_reused_reg_ranges[type][reg_id].push_back({ start_pc, end_pc });
+        }
+        state.map_nb_avoided_extra_reg[type] += nb_continuous;
+        GW_DEBUG_C(
+            "reuse dead register: type(%s), range([%lx, %lx]), first_reg(%lu), nb_continuous(%u)",
+            type.c_str(), start_pc, end_pc, list_reg_idx[0], nb_continuous
+        );
+        goto exit;
+    } else if(retval != GW_FAILED_NOT_EXIST){
+        GW_WARN_C(
+            "failed to query dead register, fall back to extra allocation: type(%s), error(%s)",
+            type.c_str(), gw_retval_str(retval)
+        );
+    }
+
+    // fall back to allocate extra registers
+    retval = this->alloc_extra(type, nb_continuous, list_reg_idx);
+
+exit:
+    return retval;
+}
+
+
 GWInstrumentCxt::GWInstrumentCxt(const GWTraceTask* trace_task, GWKernel* kernel)
     : _trace_task(trace_task), _kernel(kernel)
 {}
@@ -62,3 +409,170 @@ GWInstrumentCxt::~GWInstrumentCxt()
         delete this->_reg_alloc_cxt;
     }
 }
+
+
+void GWInstrumentCxt::release_instrumentation(){
+    std::vector<uint8_t>().swap(this->instrumented_binary_bytes);
+    std::vector<GWInstruction*>().swap(this->list_out_instructions);
+    if(this->_reg_alloc_cxt != nullptr){
+        delete this->_reg_alloc_cxt;
+        this->_reg_alloc_cxt = nullptr;
+    }
+}
+
+
+gw_retval_t GWInstrumentCxt::estimate_instruction_inflation(
+    uint64_t nb_out_instructions, std::map<uint64_t, double>& map_bb_inflation, double& overall_inflation
+) const {
+    gw_retval_t retval = GW_SUCCESS;
+    const GWKernelDef *kernel_def = nullptr;
+    GWBasicBlock *basic_block = nullptr;
+    uint64_t nb_origin_instructions = 0, nb_added_instructions = 0;
+    double nb_added_per_position = 0.0f;
+    std::map<uint64_t, uint64_t> map_bb_nb_position;
+
+    map_bb_inflation.clear();
+    overall_inflation = 1.0f;
+
+    GW_CHECK_POINTER(this->_kernel);
+    GW_CHECK_POINTER(kernel_def = this->_kernel->get_def());
+
+    if(unlikely(!kernel_def->is_cfg_parsed())){
+        GW_WARN_C("failed to estimate instruction inflation, CFG not parsed: kernel(%s)", kernel_def->mangled_prototype.c_str());
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    nb_origin_instructions = kernel_def->get_nb_instructions();
+    if(unlikely(nb_origin_instructions == 0 or nb_out_instructions <= nb_origin_instructions)){
+        goto exit;
+    }
+    nb_added_instructions = nb_out_instructions - nb_origin_instructions;
+    overall_inflation = (double)(nb_out_instructions) / (double)(nb_origin_instructions);
+
+    if(this->list_instrument_pc.size() == 0){
+        goto exit;
+    }
+    nb_added_per_position = (double)(nb_added_instructions) / (double)(this->list_instrument_pc.size());
+
+    for(uint64_t pc : this->list_instrument_pc){
+        if(kernel_def->is_pc_index_built()){
+            basic_block = kernel_def->lookup_basic_block(pc);
+        } else if(kernel_def->get_basic_block_by_pc(pc, basic_block) != GW_SUCCESS){
+            basic_block = nullptr;
+        }
+        if(basic_block == nullptr){
+            continue;
+        }
+        map_bb_nb_position[basic_block->id] += 1;
+    }
+
+    for(GWBasicBlock *bb : kernel_def->list_basic_blocks){
+        GW_CHECK_POINTER(bb);
+        if(bb->list_instructions.size() == 0)
+            continue;
+        map_bb_inflation[bb->id] = 1.0f;
+        if(map_bb_nb_position.count(bb->id) > 0){
+            map_bb_inflation[bb->id] +=
+                (double)(map_bb_nb_position[bb->id]) * nb_added_per_position / (double)(bb->list_instructions.size());
+        }
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentCxt::export_instrumentation(gw_instrument_cache_entry_t& entry) const {
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t i = 0, value = 0, dmem_base = reinterpret_cast<uint64_t>(this->extra_dmem);
+
+    if(unlikely(this->instrumented_binary_bytes.size() == 0)){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    if(unlikely(this->list_added_parameters.size() != this->list_added_parameter_size.size())){
+        GW_WARN_C(
+            "failed to export instrumentation, added parameters not setup: nb_parameters(%lu), nb_parameter_sizes(%lu)",
+            this->list_added_parameters.size(), this->list_added_parameter_size.size()
+        );
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    entry.instrumented_binary_bytes = this->instrumented_binary_bytes;
+    entry.nb_added_general_register = this->nb_added_general_register;
+    entry.nb_updated_general_register = this->nb_updated_general_register;
+    entry.added_shared_memory_size = this->added_shared_memory_size;
+    entry.list_added_parameter_size = this->list_added_parameter_size;
+    entry.list_instrument_pc = this->list_instrument_pc;
+    entry.nb_inserted_origin_instructions = this->nb_inserted_origin_instructions;
+    entry.nb_out_instructions = this->list_out_instructions.size();
+    entry.size_extra_dmem = this->extra_dmem != nullptr ? this->size_extra_dmem : 0;
+
+    // parameters pointing into the extra device memory are recorded as offsets,
+    // so that they could be rebased onto the device memory of a later trace
+    entry.list_added_parameter_dmem_offset.clear();
+    entry.list_added_parameter_value.clear();
+    for(i=0; i<this->list_added_parameters.size(); i++){
+        value = reinterpret_cast<uint64_t>(this->list_added_parameters[i]);
+        if(entry.size_extra_dmem > 0 and value >= dmem_base and value < dmem_base + entry.size_extra_dmem){
+            entry.list_added_parameter_dmem_offset.push_back(static_cast<int64_t>(value - dmem_base));
+            entry.list_added_parameter_value.push_back(0);
+        } else {
+            entry.list_added_parameter_dmem_offset.push_back(-1);
+            entry.list_added_parameter_value.push_back(value);
+        }
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentCxt::adopt_cached_instrumentation(const gw_instrument_cache_entry_t& entry){
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t i = 0;
+    std::vector<void*> list_added_parameters;
+
+    if(unlikely(
+        entry.list_added_parameter_dmem_offset.size() != entry.list_added_parameter_size.size()
+        or entry.list_added_parameter_value.size() != entry.list_added_parameter_size.size()
+    )){
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    // the caller should have prepared the extra device memory for rebasing parameters
+    if(entry.size_extra_dmem > 0 and (this->extra_dmem == nullptr or this->size_extra_dmem < entry.size_extra_dmem)){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    for(i=0; i<entry.list_added_parameter_size.size(); i++){
+        if(entry.list_added_parameter_dmem_offset[i] >= 0){
+            if(unlikely(static_cast<uint64_t>(entry.list_added_parameter_dmem_offset[i]) >= entry.size_extra_dmem)){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            list_added_parameters.push_back(
+                reinterpret_cast<uint8_t*>(this->extra_dmem) + entry.list_added_parameter_dmem_offset[i]
+            );
+        } else {
+            list_added_parameters.push_back(reinterpret_cast<void*>(entry.list_added_parameter_value[i]));
+        }
+    }
+
+    this->instrumented_binary_bytes = entry.instrumented_binary_bytes;
+    this->nb_added_general_register = entry.nb_added_general_register;
+    this->nb_updated_general_register = entry.nb_updated_general_register;
+    this->added_shared_memory_size = entry.added_shared_memory_size;
+    this->list_added_parameter_size = entry.list_added_parameter_size;
+    this->list_added_parameters = list_added_parameters;
+    this->list_instrument_pc = entry.list_instrument_pc;
+    this->nb_inserted_origin_instructions = entry.nb_inserted_origin_instructions;
+
+exit:
+    return retval;
+}
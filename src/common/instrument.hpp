@@ -5,11 +5,14 @@
 #include <set>
 #include <vector>
 #include <any>
+#include <mutex>
+#include <unordered_map>
 
 #include <nlohmann/json.hpp>
 
 #include "common/common.hpp"
 #include "common/log.hpp"
+#include "common/instrument_cache.hpp"
 
 
 class GWInstruction;
@@ -19,6 +22,39 @@ class GWKernel;
 class GWTraceTask;
 
 
+/*!
+ *  \brief  state of dead register reusing of a register allocation context
+ */
+typedef struct gw_instrument_dead_reg_state {
+    // live intervals of each register: <type, <reg_id, [<begin_pc, end_pc>]>>
+    // NOTE(zhuobin): intervals are inclusive, sorted and non-overlapped, registers
+    //                reused by instrumentation are inserted as live intervals as well
+    std::map<std::string, std::map<uint64_t, std::vector<std::pair<uint64_t, uint64_t>>>> map_reg_live_intervals;
+
+    // upper bound (exclusive) of register id that could be reused: <type, nb_reg>
+    std::map<std::string, uint64_t> map_nb_reusable_reg;
+
+    // number of operations in _map_reg_op while building the intervals: <type, nb_op>
+    // NOTE(zhuobin): record_operation is overriden by architecture-specific allocators,
+    //                so intervals are validated against _map_reg_op before each query
+    std::map<std::string, uint64_t> map_nb_reg_op_in_intervals;
+
+    // ranges reserved by reused registers, which are re-applied once intervals are rebuilt:
+    // <type, <reg_id, [<begin_pc, end_pc>]>>
+    std::map<std::string, std::map<uint64_t, std::vector<std::pair<uint64_t, uint64_t>>>> map_reused_reg_ranges;
+
+    // registers reserved by alloc_reused, to be handed out by alloc_extra(type, reg_id): <type, [reg_id]>
+    std::map<std::string, std::vector<uint64_t>> map_pending_reused_reg;
+
+    // range which registers allocated by alloc_extra(type, reg_id) should stay unclobbered
+    std::pair<uint64_t, uint64_t> reuse_range = { 0, 0 };
+    bool has_reuse_range = false;
+
+    // number of extra register avoided by reusing dead register: <type, nb_reg>
+    std::map<std::string, uint64_t> map_nb_avoided_extra_reg;
+} gw_instrument_dead_reg_state_t;
+
+
 class GWInstrumentRegAllocCxt {
     /* ==================== Common ==================== */
  public:
@@ -35,7 +71,8 @@ class GWInstrumentRegAllocCxt {
 
 
     /*!
-     *  \brief  allocate extra register
+     *  \brief  allocate extra register, a register which is dead throughout the reuse
+     *          range (see set_reuse_range) is reused before allocating an extra one
      *  \param  type    type of register
      *  \param  reg_id  id of the extra register
      *  \return GW_SUCCESS if success
@@ -94,14 +131,14 @@ class GWInstrumentRegAllocCxt {
 
     /*!
      *  \brief  allocate existing register
+     *  \note   a register which is dead throughout the range is reserved, and it's
+     *          handed out by the next alloc_extra(type, reg_id) of the same type
      *  \param  start_pc  start pc
      *  \param  end_pc    end pc
      *  \param  type      type of register
      *  \return GW_SUCCESS if success
      */
-    virtual gw_retval_t alloc_reused(uint64_t start_pc, uint64_t end_pc, std::string type){
-        return GW_FAILED_NOT_IMPLEMENTAED;
-    }
+    virtual gw_retval_t alloc_reused(uint64_t start_pc, uint64_t end_pc, std::string type);
 
 
     /*!
@@ -126,6 +163,156 @@ class GWInstrumentRegAllocCxt {
     // NOTE(zhuobin): this map could modified as the register allocate/deallocate
     std::map<std::string, std::map<uint64_t, std::vector<std::pair<uint64_t, std::string>>>> _map_reg_op;
     /* ==================== Common ==================== */
+
+
+    /* ==================== Dead Register ==================== */
+ public:
+    /*!
+     *  \brief  obtain registers which are dead throughout the given pc range
+     *  \note   the range is inclusive, i.e., [start_pc, end_pc]
+     *  \param  type            type of register
+     *  \param  start_pc        start pc of the range
+     *  \param  end_pc          end pc of the range
+     *  \param  set_dead_reg    output set of dead register ids
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t get_dead_reg_set(
+        std::string type, uint64_t start_pc, uint64_t end_pc, std::set<uint64_t>& set_dead_reg
+    );
+
+
+    /*!
+     *  \brief  find a run of continuous registers which are dead throughout the given pc range
+     *  \param  type            type of register
+     *  \param  start_pc        start pc of the range
+     *  \param  end_pc          end pc of the range
+     *  \param  nb_continuous   number of continuous register required
+     *  \param  list_reg_idx    output list of idx of register
+     *  \param  alignment       alignment of the first register id in the run (e.g., 2 for 64-bit pair)
+     *  \return GW_SUCCESS if found, GW_FAILED_NOT_EXIST if no such run exists
+     */
+    gw_retval_t find_dead_reg_run(
+        std::string type, uint64_t start_pc, uint64_t end_pc, uint32_t nb_continuous,
+        std::vector<uint64_t>& list_reg_idx, uint32_t alignment = 1
+    );
+
+
+    /*!
+     *  \brief  allocate registers for the given pc range, prefer reusing dead registers
+     *          and fall back to allocating extra registers
+     *  \note   reused registers are reserved over the range, so that later allocations
+     *          over overlapped range won't obtain the same register
+     *  \param  start_pc        start pc of the range
+     *  \param  end_pc          end pc of the range
+     *  \param  type            type of register
+     *  \param  nb_continuous   number of continuous register to be allocated
+     *  \param  list_reg_idx    output list of idx of register
+     *  \param  alignment       alignment of the first register id in the run
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t alloc_dead_or_extra(
+        uint64_t start_pc, uint64_t end_pc, std::string type, uint32_t nb_continuous,
+        std::vector<uint64_t>& list_reg_idx, uint32_t alignment = 1
+    );
+
+
+    /*!
+     *  \brief  allocate a register which is dead throughout the given pc range, and fall
+     *          back to allocating extra register
+     *  \param  start_pc  start pc of the range
+     *  \param  end_pc    end pc of the range
+     *  \param  type      type of register
+     *  \param  reg_id    id of the allocated register
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t alloc_reused(uint64_t start_pc, uint64_t end_pc, std::string type, uint64_t& reg_id);
+
+
+    /*!
+     *  \brief  set the pc range over which registers allocated by alloc_extra(type, reg_id)
+     *          should stay unclobbered, by default it's the entire kernel, so that only
+     *          registers never touched by the kernel are reused
+     *  \param  start_pc        start pc of the range
+     *  \param  end_pc          end pc of the range
+     */
+    void set_reuse_range(uint64_t start_pc, uint64_t end_pc);
+
+
+    /*!
+     *  \brief  get number of extra register avoided by reusing dead register
+     *  \param  type  type of register
+     *  \return number of avoided extra register
+     */
+    uint64_t get_nb_avoided_extra_reg(std::string type) const;
+
+
+    /*!
+     *  \brief  invalidate the cached live intervals (e.g., after re-parsing liveness)
+     *  \note   intervals are also rebuilt once operations recorded in _map_reg_op change
+     */
+    void reset_live_intervals();
+
+ protected:
+    /*!
+     *  \brief  build the live intervals of all registers of the given type from
+     *          register liveness of the kernel definition
+     *  \param  type    type of register
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t __build_live_intervals(std::string type);
+
+
+    /*!
+     *  \brief  obtain the live intervals of the given type, which are rebuilt if they're
+     *          not built yet or stale
+     *  \param  type    type of register
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t __ensure_live_intervals(std::string type);
+
+
+    /*!
+     *  \brief  count operations recorded in _map_reg_op, to identify stale live intervals
+     *  \param  type    type of register
+     *  \return number of recorded operations
+     */
+    uint64_t __count_reg_op(std::string type);
+
+
+    /*!
+     *  \brief  check whether the register is dead throughout the given pc range
+     *  \param  list_interval   sorted live intervals of the register
+     *  \param  start_pc        start pc of the range
+     *  \param  end_pc          end pc of the range
+     *  \return whether the register is dead
+     */
+    static bool __is_dead_in_range(
+        const std::vector<std::pair<uint64_t, uint64_t>>& list_interval, uint64_t start_pc, uint64_t end_pc
+    );
+
+
+    /*!
+     *  \brief  mark the register as live within the given pc range
+     *  \param  list_interval   sorted live intervals of the register
+     *  \param  start_pc        start pc of the range
+     *  \param  end_pc          end pc of the range
+     */
+    static void __insert_live_interval(
+        std::vector<std::pair<uint64_t, uint64_t>>& list_interval, uint64_t start_pc, uint64_t end_pc
+    );
+
+    /*!
+     *  \brief  obtain the dead register state of this context
+     *  \note   the state is kept aside instead of within this class, as architecture-specific
+     *          allocators derived from this class are prebuilt against its layout
+     *  \return the dead register state
+     */
+    gw_instrument_dead_reg_state_t& __get_dead_reg_state() const;
+
+    // dead register state of each context, erased once the context is destroyed
+    static std::mutex _mutex_dead_reg_states;
+    static std::unordered_map<const GWInstrumentRegAllocCxt*, gw_instrument_dead_reg_state_t> _map_dead_reg_states;
+    /* ==================== Dead Register ==================== */
 };
 
 
@@ -143,10 +330,20 @@ class GWInstrumentCxt {
 
     /*!
      *  \brief  destructor
+     *  \note   the destructor isn't virtual, as instrument contexts derived from this class are
+     *          prebuilt against its vtable, so contexts created by GWInstrumentCxtFactory must
+     *          not be deleted through this class, see release_instrumentation
      */
     ~GWInstrumentCxt();
 
 
+    /*!
+     *  \brief  release buffers of the instrumentation once it's no longer needed (e.g., it has
+     *          been stored to the instrument cache), the context itself is kept
+     */
+    void release_instrumentation();
+
+
     /*!
      *  \brief  instrument kernel
      *  \return GW_SUCCESS if success
@@ -215,6 +412,29 @@ class GWInstrumentCxt {
     GWKernel* get_kernel() const { return this->_kernel; }
 
 
+    /*!
+     *  \brief  obtain register allocation context of this instrumentation context
+     *  \return register allocation context
+     */
+    GWInstrumentRegAllocCxt* get_reg_alloc_cxt() const { return this->_reg_alloc_cxt; }
+
+
+    /*!
+     *  \brief  estimate the inflation of instruction count after instrumentation
+     *  \note   inserted instructions are evenly attributed to each instrumentation
+     *          position, and each position is attributed to the basic block it locates
+     *  \param  nb_out_instructions number of instructions of the instrumented kernel, which is
+     *                              the size of list_out_instructions, or recorded by the cache
+     *                              entry if the instrumentation is adopted from cache
+     *  \param  map_bb_inflation    output inflation ratio of each basic block: <bb_id, ratio>
+     *  \param  overall_inflation   output inflation ratio of the whole kernel
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t estimate_instruction_inflation(
+        uint64_t nb_out_instructions, std::map<uint64_t, double>& map_bb_inflation, double& overall_inflation
+    ) const;
+
+
     // index of the instrument context
     std::string global_id = "";
 
@@ -265,6 +485,29 @@ class GWInstrumentCxt {
     /* ==================== Common ==================== */
 
 
+    /* ==================== Instrument Cache ==================== */
+ public:
+    /*!
+     *  \brief  export result of dynamic instrumentation for caching
+     *  \param  entry   the exported cache entry
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t export_instrumentation(gw_instrument_cache_entry_t& entry) const;
+
+
+    /*!
+     *  \brief  adopt cached result of dynamic instrumentation instead of instrumenting again
+     *  \note   added parameters which point into the extra device memory are rebased onto
+     *          extra_dmem, which should be allocated and initialized by the caller before
+     *          adopting
+     *  \param  entry   the cached entry
+     *  \return GW_SUCCESS if adopted, GW_FAILED_NOT_READY if extra_dmem isn't prepared,
+     *          otherwise the kernel should be instrumented from scratch
+     */
+    gw_retval_t adopt_cached_instrumentation(const gw_instrument_cache_entry_t& entry);
+    /* ==================== Instrument Cache ==================== */
+
+
     /* ==================== Dependencies ==================== */
  public:
     /*!
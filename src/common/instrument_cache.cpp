@@ -0,0 +1,321 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/instrument_cache.hpp"
+#include "common/utils/hash.hpp"
+
+
+// magic number of the cache file on disk ("GWIC")
+static constexpr uint32_t kGWInstrumentCacheFileMagic = 0x43495747;
+
+// version of the cache file on disk, bump when layout of the entry changes
+static constexpr uint32_t kGWInstrumentCacheFileVersion = 3;
+
+
+std::string gw_instrument_cache_key::str() const {
+    std::string key_str = "";
+    char binary_hash_str[17] = { 0 };
+    uint64_t i = 0;
+
+    snprintf(binary_hash_str, sizeof(binary_hash_str), "%016lx", this->kernel_binary_hash);
+    key_str = std::string(binary_hash_str) + "|" + this->kernel_name + "|" + this->trace_task_type + "|";
+    for(i=0; i<this->list_instrument_cxt_type.size(); i++){
+        if(i > 0)
+            key_str += ",";
+        key_str += this->list_instrument_cxt_type[i];
+    }
+    key_str += "|" + std::to_string(this->metadata_hash) + "|sm_" + this->arch_version;
+
+    return key_str;
+}
+
+
+GWInstrumentCache::GWInstrumentCache(uint64_t capacity_bytes, std::string disk_dir)
+    : _capacity_bytes(capacity_bytes)
+{
+    if(disk_dir.size() > 0)
+        this->set_disk_dir(disk_dir);
+}
+
+
+GWInstrumentCache::~GWInstrumentCache()
+{}
+
+
+gw_retval_t GWInstrumentCache::set_disk_dir(std::string disk_dir){
+    gw_retval_t retval = GW_SUCCESS;
+    std::error_code ec;
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    if(disk_dir.size() > 0 and !std::filesystem::is_directory(disk_dir, ec)){
+        if(!std::filesystem::create_directories(disk_dir, ec) and ec){
+            GW_WARN("failed to create directory for instrument cache, disk tier disabled: path(%s), error(%s)",
+                disk_dir.c_str(), ec.message().c_str()
+            );
+            this->_disk_dir = "";
+            retval = GW_FAILED;
+            goto exit;
+        }
+    }
+    this->_disk_dir = disk_dir;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentCache::lookup(const gw_instrument_cache_key_t& key, gw_instrument_cache_entry_t& entry){
+    gw_retval_t retval = GW_SUCCESS;
+    std::string key_str = key.str();
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    typename std::map<std::string, std::list<std::pair<std::string, gw_instrument_cache_entry_t>>::iterator>::iterator it;
+
+    // in-memory tier
+    it = this->_map_memory_entry.find(key_str);
+    if(it != this->_map_memory_entry.end()){
+        this->_list_lru.splice(this->_list_lru.begin(), this->_list_lru, it->second);
+        entry = it->second->second;
+        this->_nb_hits.fetch_add(1, std::memory_order_relaxed);
+        goto exit;
+    }
+
+    // on-disk tier
+    if(this->_disk_dir.size() > 0 and this->__load_disk(key_str, entry) == GW_SUCCESS){
+        this->__insert_memory(key_str, entry);
+        this->_nb_hits.fetch_add(1, std::memory_order_relaxed);
+        this->_nb_disk_hits.fetch_add(1, std::memory_order_relaxed);
+        goto exit;
+    }
+
+    this->_nb_misses.fetch_add(1, std::memory_order_relaxed);
+    retval = GW_FAILED_NOT_EXIST;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentCache::insert(const gw_instrument_cache_key_t& key, const gw_instrument_cache_entry_t& entry){
+    gw_retval_t retval = GW_SUCCESS;
+    std::string key_str = key.str();
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    if(unlikely(entry.instrumented_binary_bytes.size() == 0)){
+        GW_WARN("failed to insert instrument cache, empty instrumented binary: key(%s)", key_str.c_str());
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    this->__insert_memory(key_str, entry);
+
+    if(this->_disk_dir.size() > 0){
+        GW_IF_FAILED(
+            this->__store_disk(key_str, entry),
+            retval,
+            {
+                GW_WARN("failed to store instrument cache to disk: key(%s)", key_str.c_str());
+                goto exit;
+            }
+        );
+    }
+
+exit:
+    return retval;
+}
+
+
+nlohmann::json GWInstrumentCache::get_statistics(){
+    nlohmann::json statistics;
+    uint64_t nb_hits = this->_nb_hits.load(std::memory_order_relaxed);
+    uint64_t nb_misses = this->_nb_misses.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    statistics["nb_hits"] = nb_hits;
+    statistics["nb_misses"] = nb_misses;
+    statistics["nb_disk_hits"] = this->_nb_disk_hits.load(std::memory_order_relaxed);
+    statistics["nb_rejects"] = this->_nb_rejects.load(std::memory_order_relaxed);
+    statistics["nb_evictions"] = this->_nb_evictions.load(std::memory_order_relaxed);
+    statistics["hit_ratio"] = nb_hits + nb_misses > 0 ? (double)(nb_hits) / (double)(nb_hits + nb_misses) : 0.0f;
+    statistics["nb_memory_entries"] = this->_map_memory_entry.size();
+    statistics["memory_size_bytes"] = this->_size_bytes;
+    statistics["disk_dir"] = this->_disk_dir;
+
+    return statistics;
+}
+
+
+void GWInstrumentCache::__insert_memory(const std::string& key_str, const gw_instrument_cache_entry_t& entry){
+    typename std::map<std::string, std::list<std::pair<std::string, gw_instrument_cache_entry_t>>::iterator>::iterator it;
+
+    it = this->_map_memory_entry.find(key_str);
+    if(it != this->_map_memory_entry.end()){
+        this->_size_bytes -= it->second->second.instrumented_binary_bytes.size();
+        this->_list_lru.erase(it->second);
+        this->_map_memory_entry.erase(it);
+    }
+
+    this->_list_lru.emplace_front(key_str, entry);
+    this->_map_memory_entry[key_str] = this->_list_lru.begin();
+    this->_size_bytes += entry.instrumented_binary_bytes.size();
+
+    // evict least recently used entries, the newly inserted one is always kept
+    while(this->_size_bytes > this->_capacity_bytes and this->_list_lru.size() > 1){
+        this->_size_bytes -= this->_list_lru.back().second.instrumented_binary_bytes.size();
+        this->_map_memory_entry.erase(this->_list_lru.back().first);
+        this->_list_lru.pop_back();
+        this->_nb_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+std::string GWInstrumentCache::__get_disk_path(const std::string& key_str) const {
+    char name[32] = { 0 };
+
+    // NOTE(zhuobin): the directory could be shared among processes and builds, so the file name
+    //                is hashed by FNV-1a, which is stable unlike std::hash
+    snprintf(name, sizeof(name), "%016lx.gwic", GWUtilHash::fnv1a(key_str));
+    return (std::filesystem::path(this->_disk_dir) / name).string();
+}
+
+
+gw_retval_t GWInstrumentCache::__load_disk(const std::string& key_str, gw_instrument_cache_entry_t& entry) const {
+    gw_retval_t retval = GW_SUCCESS;
+    std::string path = this->__get_disk_path(key_str);
+    std::ifstream file;
+    std::error_code ec;
+    uint32_t magic = 0, version = 0;
+    uint64_t file_size = 0, remain_size = 0, header_size = 0, binary_size = 0;
+    std::string header_str = "";
+    nlohmann::json header;
+
+    file_size = std::filesystem::file_size(path, ec);
+    if(ec){
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    file.open(path, std::ios::in | std::ios::binary);
+    if(!file.is_open()){
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    // NOTE(zhuobin): the directory could be shared with other processes, so every size read
+    //                from the file is checked against the remaining length before allocating
+    remain_size = file_size;
+    if(remain_size < 2 * sizeof(uint32_t) + sizeof(uint64_t)){
+        GW_WARN("failed to read instrument cache file, truncated: path(%s)", path.c_str());
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+    file.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
+    file.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    if(!file or magic != kGWInstrumentCacheFileMagic or version != kGWInstrumentCacheFileVersion){
+        GW_DEBUG("skip instrument cache file with mismatched magic / version: path(%s)", path.c_str());
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+    file.read(reinterpret_cast<char*>(&header_size), sizeof(uint64_t));
+    remain_size -= 2 * sizeof(uint32_t) + sizeof(uint64_t);
+    if(!file or header_size > remain_size or remain_size - header_size < sizeof(uint64_t)){
+        GW_WARN("failed to read instrument cache file, corrupted header size: path(%s)", path.c_str());
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    header_str.resize(header_size);
+    file.read(header_str.data(), header_size);
+    file.read(reinterpret_cast<char*>(&binary_size), sizeof(uint64_t));
+    remain_size -= header_size + sizeof(uint64_t);
+    if(!file or binary_size != remain_size){
+        GW_WARN("failed to read instrument cache file, corrupted binary size: path(%s)", path.c_str());
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    try {
+        header = nlohmann::json::parse(header_str);
+        // NOTE(zhuobin): file name is a hash of the key, so we verify the full key to rule out collision
+        if(header.at("key").get<std::string>() != key_str){
+            retval = GW_FAILED_NOT_EXIST;
+            goto exit;
+        }
+        entry = header.at("entry").get<gw_instrument_cache_entry_t>();
+    } catch (const std::exception& e) {
+        GW_WARN("failed to parse header of instrument cache file: path(%s), error(%s)", path.c_str(), e.what());
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    entry.instrumented_binary_bytes.resize(binary_size);
+    file.read(reinterpret_cast<char*>(entry.instrumented_binary_bytes.data()), binary_size);
+    if(!file){
+        GW_WARN("failed to read instrument cache file, truncated: path(%s)", path.c_str());
+        entry.instrumented_binary_bytes.clear();
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWInstrumentCache::__store_disk(const std::string& key_str, const gw_instrument_cache_entry_t& entry) const {
+    gw_retval_t retval = GW_SUCCESS;
+    std::string path = this->__get_disk_path(key_str);
+    std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+    std::ofstream file;
+    nlohmann::json header;
+    std::string header_str = "";
+    uint64_t header_size = 0, binary_size = entry.instrumented_binary_bytes.size();
+    std::error_code ec;
+
+    header["key"] = key_str;
+    header["entry"] = entry;
+    header_str = header.dump();
+    header_size = header_str.size();
+
+    file.open(tmp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open()){
+        GW_WARN("failed to open instrument cache file: path(%s), error(%s)", tmp_path.c_str(), strerror(errno));
+        retval = GW_FAILED;
+        goto exit;
+    }
+    file.write(reinterpret_cast<const char*>(&kGWInstrumentCacheFileMagic), sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(&kGWInstrumentCacheFileVersion), sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(&header_size), sizeof(uint64_t));
+    file.write(header_str.data(), header_size);
+    file.write(reinterpret_cast<const char*>(&binary_size), sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(entry.instrumented_binary_bytes.data()), binary_size);
+    file.close();
+    if(!file){
+        GW_WARN("failed to write instrument cache file: path(%s)", tmp_path.c_str());
+        std::filesystem::remove(tmp_path, ec);
+        retval = GW_FAILED;
+        goto exit;
+    }
+
+    std::filesystem::rename(tmp_path, path, ec);
+    if(ec){
+        GW_WARN("failed to commit instrument cache file: path(%s), error(%s)", path.c_str(), ec.message().c_str());
+        std::filesystem::remove(tmp_path, ec);
+        retval = GW_FAILED;
+        goto exit;
+    }
+
+exit:
+    return retval;
+}
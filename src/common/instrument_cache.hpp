@@ -0,0 +1,225 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <list>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+// maximum size of the initial content of extra device memory recorded in a cache entry
+#define GW_INSTRUMENT_CACHE_MAX_DMEM_INIT_SIZE     KB(4)
+
+
+/*!
+ *  \brief  key of an instrumented binary, two instrumentations with the same key
+ *          produce the same instrumented binary
+ */
+typedef struct gw_instrument_cache_key {
+    // hash of the raw instruction bytes of the kernel definition, the instrumented binary
+    // embeds relocated fields, so kernels which only share the normalized fingerprint can't
+    // share the instrumented binary
+    uint64_t kernel_binary_hash = 0;
+
+    // mangled name of the kernel, as the instrumented function is obtained by name
+    std::string kernel_name = "";
+
+    // type of the trace task
+    std::string trace_task_type = "";
+
+    // types of instrument contexts applied to the kernel
+    std::vector<std::string> list_instrument_cxt_type = {};
+
+    // hash of the metadata of the trace task
+    uint64_t metadata_hash = 0;
+
+    // architecture version (e.g., "90")
+    std::string arch_version = "";
+
+    /*!
+     *  \brief  obtain the string form of the key
+     *  \return the string form of the key
+     */
+    std::string str() const;
+} gw_instrument_cache_key_t;
+
+
+/*!
+ *  \brief  cached result of dynamic instrumentation
+ */
+typedef struct gw_instrument_cache_entry {
+    // raw bytes of the instrumented binary
+    std::vector<uint8_t> instrumented_binary_bytes = {};
+
+    // number of added / updated register
+    uint32_t nb_added_general_register = 0;
+    uint64_t nb_updated_general_register = 0;
+
+    // size of extra shared memory usage
+    uint64_t added_shared_memory_size = 0;
+
+    // size of added parameters
+    std::vector<uint32_t> list_added_parameter_size = {};
+
+    // layout of added parameters, each is either an offset within the extra device memory,
+    // or a scalar value when the offset is negative
+    std::vector<int64_t> list_added_parameter_dmem_offset = {};
+    std::vector<uint64_t> list_added_parameter_value = {};
+
+    // size of extra device memory, and its initial content before the first launch,
+    // bytes beyond the initial content are zero
+    uint64_t size_extra_dmem = 0;
+    std::vector<uint8_t> extra_dmem_init_bytes = {};
+
+    // instrumentation positions
+    std::vector<uint64_t> list_instrument_pc = {};
+
+    // number of origin instructions that have been inserted
+    uint64_t nb_inserted_origin_instructions = 0;
+
+    // number of instructions of the instrumented kernel, for estimating instruction inflation
+    uint64_t nb_out_instructions = 0;
+
+    // report of verifying the instrumented binary, null if the trace task doesn't verify
+    nlohmann::json verification_report = nullptr;
+} gw_instrument_cache_entry_t;
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    gw_instrument_cache_entry_t,
+    nb_added_general_register, nb_updated_general_register,
+    added_shared_memory_size, list_added_parameter_size, list_added_parameter_dmem_offset,
+    list_added_parameter_value, size_extra_dmem, extra_dmem_init_bytes, list_instrument_pc,
+    nb_inserted_origin_instructions, nb_out_instructions, verification_report
+);
+
+
+/*!
+ *  \brief  two-tier (memory / disk) cache of instrumented binaries, so that repeated
+ *          traces of the same kernel skip the CPU-side binary rewriting
+ */
+class GWInstrumentCache {
+ public:
+    /*!
+     *  \brief  constructor
+     *  \param  capacity_bytes  capacity of the in-memory tier, in bytes of instrumented binaries
+     *  \param  disk_dir        directory of the on-disk tier, empty for disabling the disk tier
+     */
+    GWInstrumentCache(uint64_t capacity_bytes = MB(512), std::string disk_dir = "");
+
+
+    /*!
+     *  \brief  destructor
+     */
+    ~GWInstrumentCache();
+
+
+    /*!
+     *  \brief  lookup cached instrumented binary, the in-memory tier is checked first,
+     *          entries found on disk are promoted to the in-memory tier
+     *  \param  key     key of the instrumented binary
+     *  \param  entry   the cached entry
+     *  \return GW_SUCCESS if hit, GW_FAILED_NOT_EXIST if miss
+     */
+    gw_retval_t lookup(const gw_instrument_cache_key_t& key, gw_instrument_cache_entry_t& entry);
+
+
+    /*!
+     *  \brief  insert instrumented binary to the cache, and write through to the disk tier
+     *  \param  key     key of the instrumented binary
+     *  \param  entry   the entry to be cached
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t insert(const gw_instrument_cache_key_t& key, const gw_instrument_cache_entry_t& entry);
+
+
+    /*!
+     *  \brief  set the directory of the on-disk tier
+     *  \param  disk_dir    directory of the on-disk tier, empty for disabling the disk tier
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t set_disk_dir(std::string disk_dir);
+
+
+    /*!
+     *  \brief  record that a cached entry can't be adopted by the instrument context,
+     *          which is accounted as a miss
+     */
+    inline void record_reject(){
+        this->_nb_rejects.fetch_add(1, std::memory_order_relaxed);
+        this->_nb_misses.fetch_add(1, std::memory_order_relaxed);
+        this->_nb_hits.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+
+    /*!
+     *  \brief  export statistics of the cache
+     *  \return statistics of the cache
+     */
+    nlohmann::json get_statistics();
+
+
+    // getters
+    inline uint64_t get_nb_hits() const { return this->_nb_hits.load(std::memory_order_relaxed); }
+    inline uint64_t get_nb_misses() const { return this->_nb_misses.load(std::memory_order_relaxed); }
+
+ private:
+    /*!
+     *  \brief  insert entry to the in-memory tier, evicting least recently used entries
+     *  \note   caller should hold _mutex
+     *  \param  key_str     string form of the key
+     *  \param  entry       the entry to be cached
+     */
+    void __insert_memory(const std::string& key_str, const gw_instrument_cache_entry_t& entry);
+
+
+    /*!
+     *  \brief  obtain path of the cache file on disk
+     *  \param  key_str     string form of the key
+     *  \return path of the cache file
+     */
+    std::string __get_disk_path(const std::string& key_str) const;
+
+
+    /*!
+     *  \brief  load entry from the on-disk tier
+     *  \param  key_str     string form of the key
+     *  \param  entry       the loaded entry
+     *  \return GW_SUCCESS if success, GW_FAILED_NOT_EXIST if not cached on disk
+     */
+    gw_retval_t __load_disk(const std::string& key_str, gw_instrument_cache_entry_t& entry) const;
+
+
+    /*!
+     *  \brief  store entry to the on-disk tier
+     *  \note   the file is written to a temporary path and renamed, so that concurrent
+     *          processes sharing the directory never observe a partial file
+     *  \param  key_str     string form of the key
+     *  \param  entry       the entry to be stored
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t __store_disk(const std::string& key_str, const gw_instrument_cache_entry_t& entry) const;
+
+    std::mutex _mutex;
+
+    // in-memory tier, with LRU order: <key_str, entry>
+    std::list<std::pair<std::string, gw_instrument_cache_entry_t>> _list_lru;
+    std::map<std::string, std::list<std::pair<std::string, gw_instrument_cache_entry_t>>::iterator> _map_memory_entry;
+    uint64_t _capacity_bytes = 0;
+    uint64_t _size_bytes = 0;
+
+    // directory of the on-disk tier
+    std::string _disk_dir = "";
+
+    // statistics
+    std::atomic<uint64_t> _nb_hits = 0;
+    std::atomic<uint64_t> _nb_misses = 0;
+    std::atomic<uint64_t> _nb_disk_hits = 0;
+    std::atomic<uint64_t> _nb_rejects = 0;
+    std::atomic<uint64_t> _nb_evictions = 0;
+};
@@ -37,6 +37,7 @@ enum :gw_message_typeid_t {
     GW_MESSAGE_TYPEID_COMMON_TS_STREAM_DB,
     GW_MESSAGE_TYPEID_COMMON_TS_SUBSCRIBE_DB,
     GW_MESSAGE_TYPEID_COMMON_TS_UNSUBSCRIBE_DB,
+    GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB,
 
     // sql database
     GW_MESSAGE_TYPEID_COMMON_SQL_WRITE_DB = 40,
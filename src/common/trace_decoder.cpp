@@ -0,0 +1,520 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <format>
+#include <filesystem>
+
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/trace_decoder.hpp"
+
+
+// magic number of the spill file ("GWTS")
+static constexpr uint32_t kGWTraceSpillFileMagic = 0x53545747;
+
+// minimum number of records decoded by a single thread, small buffers are decoded inline
+static constexpr uint64_t kGWTraceDecodeMinRecordsPerThread = 1 << 16;
+
+// maximum number of slots of the flat pc histogram, sparser pcs are counted by sorting
+static constexpr uint64_t kGWTraceMaxFlatHistogramSize = 1 << 20;
+
+// size of a record within the spill file
+static constexpr uint64_t kGWTraceSpillRecordSize
+    = sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint16_t);
+
+
+GWTraceBufferDecoder::GWTraceBufferDecoder(uint64_t nb_threads, std::string spill_path, uint64_t spill_threshold)
+    : _nb_threads(nb_threads > 0 ? nb_threads : 1), _spill_path(spill_path), _spill_threshold(spill_threshold)
+{
+    static std::atomic<uint64_t> nb_decoders = 0;
+    uint32_t version = GW_TRACE_BUFFER_VERSION;
+    std::error_code ec;
+
+    // NOTE(zhuobin): memory-store traces run to GBs, so columns are spilled to a temporary
+    //                file by default, unless the caller disables spilling explicitly
+    if(this->_spill_threshold == 0){
+        this->_spill_path = "";
+    } else if(this->_spill_path.size() == 0){
+        this->_spill_path = (
+            std::filesystem::temp_directory_path(ec) / std::format(
+                "gw_trace_spill_{}_{}.bin", getpid(), nb_decoders.fetch_add(1, std::memory_order_relaxed)
+            )
+        ).string();
+        if(ec){
+            GW_WARN("failed to obtain temporary directory for spilling, spilling disabled: error(%s)", ec.message().c_str());
+            this->_spill_path = "";
+        } else {
+            this->_is_spill_path_temporary = true;
+        }
+    }
+
+    if(this->_spill_path.size() > 0){
+        this->_spill_file.open(this->_spill_path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!this->_spill_file.is_open()){
+            GW_WARN(
+                "failed to open spill file of trace decoder, spilling disabled: path(%s), error(%s)",
+                this->_spill_path.c_str(), strerror(errno)
+            );
+            this->_spill_path = "";
+        } else {
+            this->_spill_file.write(reinterpret_cast<const char*>(&kGWTraceSpillFileMagic), sizeof(uint32_t));
+            this->_spill_file.write(reinterpret_cast<const char*>(&version), sizeof(uint32_t));
+        }
+    }
+}
+
+
+GWTraceBufferDecoder::~GWTraceBufferDecoder(){
+    std::error_code ec;
+
+    if(this->_spill_file.is_open()){
+        this->flush();
+        this->_spill_file.close();
+    }
+    if(this->_is_spill_path_temporary)
+        std::filesystem::remove(this->_spill_path, ec);
+}
+
+
+gw_retval_t GWTraceBufferDecoder::feed(const void* buffer, uint64_t size){
+    gw_retval_t retval = GW_SUCCESS;
+    const gw_trace_buffer_header_t *header = nullptr;
+    const gw_trace_record_mem_access_t *records = nullptr;
+    uint64_t nb_records = 0, nb_valid_records = 0, offset = 0;
+    uint64_t i = 0, nb_threads = 1, nb_records_per_thread = 0, slice_begin = 0, slice_size = 0;
+    std::vector<__gw_partial_aggregation_t> list_aggregation;
+    std::vector<std::thread> list_threads;
+
+    GW_CHECK_POINTER(buffer);
+
+    if(unlikely(size < sizeof(gw_trace_buffer_header_t))){
+        GW_WARN("failed to decode trace buffer, buffer too small: size(%lu)", size);
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    header = reinterpret_cast<const gw_trace_buffer_header_t*>(buffer);
+    if(unlikely(header->magic != GW_TRACE_BUFFER_MAGIC or header->version != GW_TRACE_BUFFER_VERSION)){
+        GW_WARN(
+            "failed to decode trace buffer, mismatched magic / version: magic(%x), version(%u)",
+            header->magic, header->version
+        );
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+    if(unlikely(
+        header->record_type != GW_TRACE_RECORD_MEM_ACCESS
+        or header->record_size != sizeof(gw_trace_record_mem_access_t)
+    )){
+        GW_WARN(
+            "failed to decode trace buffer, unsupported record: record_type(%u), record_size(%u)",
+            header->record_type, header->record_size
+        );
+        retval = GW_FAILED_NOT_IMPLEMENTAED;
+        goto exit;
+    }
+
+    // records beyond capacity or beyond the copied buffer are dropped by the device
+    nb_records = header->nb_records;
+    nb_valid_records = std::min(nb_records, header->capacity);
+    nb_valid_records = std::min(
+        nb_valid_records, (size - sizeof(gw_trace_buffer_header_t)) / sizeof(gw_trace_record_mem_access_t)
+    );
+    this->_nb_dropped_records += nb_records - nb_valid_records;
+    if(nb_valid_records == 0)
+        goto exit;
+
+    records = reinterpret_cast<const gw_trace_record_mem_access_t*>(
+        reinterpret_cast<const uint8_t*>(buffer) + sizeof(gw_trace_buffer_header_t)
+    );
+
+    // decode slices in parallel, each thread writes to a disjoint range of the columns
+    offset = this->_columns.size();
+    this->_columns.resize(offset + nb_valid_records);
+    nb_threads = std::min(
+        this->_nb_threads, std::max<uint64_t>(1, nb_valid_records / kGWTraceDecodeMinRecordsPerThread)
+    );
+    nb_records_per_thread = (nb_valid_records + nb_threads - 1) / nb_threads;
+    list_aggregation.resize(nb_threads);
+    for(i=0; i<nb_threads; i++){
+        slice_begin = i * nb_records_per_thread;
+        if(slice_begin >= nb_valid_records)
+            break;
+        slice_size = std::min(nb_records_per_thread, nb_valid_records - slice_begin);
+        if(i == nb_threads - 1){
+            // the last slice is decoded on current thread
+            this->__decode_mem_access_slice(records + slice_begin, slice_size, offset + slice_begin, list_aggregation[i]);
+        } else {
+            list_threads.emplace_back(
+                &GWTraceBufferDecoder::__decode_mem_access_slice, this,
+                records + slice_begin, slice_size, offset + slice_begin, std::ref(list_aggregation[i])
+            );
+        }
+    }
+    for(auto& thread : list_threads)
+        thread.join();
+
+    // merge partial aggregations, which are compact (per distinct pc / range)
+    for(auto& aggregation : list_aggregation){
+        for(auto& [pc, count] : aggregation.list_pc_count)
+            this->_map_pc_count[pc] += count;
+        for(auto& [start, end] : aggregation.list_address_range)
+            GWTraceBufferDecoder::__coalesce_range(this->_map_address_range, start, end);
+        this->_nb_bytes += aggregation.nb_bytes;
+    }
+    this->_nb_records += nb_valid_records;
+
+    // attribute records to basic blocks of the traced kernel
+    if(this->_kernel_def != nullptr)
+        this->__count_basic_blocks(this->_columns.list_pc.data() + offset, nb_valid_records);
+
+    if(this->_spill_path.size() > 0 and this->_columns.size() >= this->_spill_threshold){
+        GW_IF_FAILED(this->__spill(), retval, goto exit;);
+    }
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceBufferDecoder::flush(){
+    gw_retval_t retval = GW_SUCCESS;
+
+    if(this->_spill_path.size() > 0 and this->_columns.size() > 0){
+        GW_IF_FAILED(this->__spill(), retval, goto exit;);
+    }
+    if(this->_spill_file.is_open())
+        this->_spill_file.flush();
+
+exit:
+    return retval;
+}
+
+
+nlohmann::json GWTraceBufferDecoder::export_summary(uint64_t max_nb_ranges) const {
+    nlohmann::json summary, list_range = nlohmann::json::array();
+    std::map<std::string, uint64_t> map_pc_count;
+    char pc_str[32] = { 0 };
+    uint64_t nb_ranges = 0;
+
+    for(auto& [pc, count] : this->_map_pc_count){
+        snprintf(pc_str, sizeof(pc_str), "0x%lx", pc);
+        map_pc_count[pc_str] = count;
+    }
+    for(auto& [start, end] : this->_map_address_range){
+        if(nb_ranges++ >= max_nb_ranges)
+            break;
+        list_range.push_back({ start, end });
+    }
+
+    summary["nb_records"] = this->_nb_records;
+    summary["nb_dropped_records"] = this->_nb_dropped_records;
+    summary["nb_spilled_records"] = this->_nb_spilled_records;
+    summary["nb_bytes"] = this->_nb_bytes;
+    summary["pc_histogram"] = map_pc_count;
+    if(this->_kernel_def != nullptr){
+        summary["basic_block_histogram"] = this->_map_basic_block_count;
+        summary["nb_unresolved_records"] = this->_nb_unresolved_records;
+    }
+    summary["nb_address_ranges"] = this->_map_address_range.size();
+    summary["address_ranges"] = list_range;
+    summary["spill_path"] = this->_spill_path;
+
+    return summary;
+}
+
+
+gw_retval_t GWTraceBufferDecoder::set_kernel_def(GWKernelDef* kernel_def){
+    gw_retval_t retval = GW_SUCCESS;
+
+    if(kernel_def != nullptr and !kernel_def->is_pc_index_built()){
+        GW_IF_FAILED(kernel_def->build_pc_index(), retval, goto exit;);
+    }
+    this->_kernel_def = kernel_def;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWTraceBufferDecoder::load_spill(std::string spill_path, gw_trace_columns_mem_access_t& columns){
+    gw_retval_t retval = GW_SUCCESS;
+    std::ifstream file;
+    std::error_code ec;
+    uint32_t magic = 0, version = 0;
+    uint64_t nb_records = 0, offset = 0, file_size = 0, remain_size = 0;
+
+    columns.clear();
+
+    file_size = std::filesystem::file_size(spill_path, ec);
+    if(ec){
+        GW_WARN("failed to open spill file of trace decoder: path(%s), error(%s)", spill_path.c_str(), ec.message().c_str());
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    file.open(spill_path, std::ios::in | std::ios::binary);
+    if(!file.is_open()){
+        GW_WARN("failed to open spill file of trace decoder: path(%s)", spill_path.c_str());
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    file.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
+    file.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    if(!file or magic != kGWTraceSpillFileMagic or version != GW_TRACE_BUFFER_VERSION){
+        GW_WARN("failed to load spill file of trace decoder, mismatched magic / version: path(%s)", spill_path.c_str());
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+    remain_size = file_size - 2 * sizeof(uint32_t);
+
+    // the file is a sequence of column chunks, the size of each is checked against
+    // the remaining length before allocating
+    while(remain_size >= sizeof(uint64_t) and file.read(reinterpret_cast<char*>(&nb_records), sizeof(uint64_t))){
+        remain_size -= sizeof(uint64_t);
+        if(unlikely(nb_records > remain_size / kGWTraceSpillRecordSize)){
+            GW_WARN(
+                "failed to load spill file of trace decoder, corrupted chunk: path(%s), nb_records(%lu)",
+                spill_path.c_str(), nb_records
+            );
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        remain_size -= nb_records * kGWTraceSpillRecordSize;
+
+        offset = columns.size();
+        columns.resize(offset + nb_records);
+        file.read(reinterpret_cast<char*>(columns.list_pc.data() + offset), nb_records * sizeof(uint64_t));
+        file.read(reinterpret_cast<char*>(columns.list_warp_id.data() + offset), nb_records * sizeof(uint32_t));
+        file.read(reinterpret_cast<char*>(columns.list_address.data() + offset), nb_records * sizeof(uint64_t));
+        file.read(reinterpret_cast<char*>(columns.list_size.data() + offset), nb_records * sizeof(uint16_t));
+        if(!file){
+            GW_WARN("failed to load spill file of trace decoder, truncated chunk: path(%s)", spill_path.c_str());
+            columns.resize(offset);
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+    }
+    if(unlikely(remain_size > 0)){
+        GW_WARN("failed to load spill file of trace decoder, trailing bytes: path(%s), size(%lu)", spill_path.c_str(), remain_size);
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+exit:
+    return retval;
+}
+
+
+void GWTraceBufferDecoder::__decode_mem_access_slice(
+    const gw_trace_record_mem_access_t* records, uint64_t nb_records, uint64_t offset,
+    __gw_partial_aggregation_t& aggregation
+){
+    uint64_t i = 0, pc = 0, address = 0, range_start = 0, range_end = 0;
+    uint64_t min_pc = UINT64_MAX, max_pc = 0, pc_diff_bits = 0;
+    uint16_t size = 0;
+    uint64_t *list_pc = this->_columns.list_pc.data() + offset;
+    uint32_t *list_warp_id = this->_columns.list_warp_id.data() + offset;
+    uint64_t *list_address = this->_columns.list_address.data() + offset;
+    uint16_t *list_size = this->_columns.list_size.data() + offset;
+    bool has_range = false;
+
+    if(nb_records == 0)
+        return;
+
+    for(i=0; i<nb_records; i++){
+        pc = records[i].pc;
+        address = records[i].address;
+        size = records[i].size;
+
+        list_pc[i] = pc;
+        list_warp_id[i] = records[i].warp_id;
+        list_address[i] = address;
+        list_size[i] = size;
+
+        min_pc = std::min(min_pc, pc);
+        max_pc = std::max(max_pc, pc);
+        pc_diff_bits |= pc ^ records[0].pc;
+        aggregation.nb_bytes += size;
+
+        // NOTE(zhuobin): successive records are mostly contiguous (e.g., lanes of a warp),
+        //                so we extend the running range and only record it once broken
+        if(has_range and address <= range_end and address + size >= range_start){
+            range_start = std::min(range_start, address);
+            range_end = std::max(range_end, address + size);
+        } else {
+            if(has_range)
+                aggregation.list_address_range.emplace_back(range_start, range_end);
+            range_start = address;
+            range_end = address + size;
+            has_range = true;
+        }
+    }
+    if(has_range)
+        aggregation.list_address_range.emplace_back(range_start, range_end);
+
+    GWTraceBufferDecoder::__count_pcs(
+        list_pc, nb_records, min_pc, max_pc,
+        pc_diff_bits == 0 ? 0 : static_cast<uint64_t>(__builtin_ctzll(pc_diff_bits)),
+        aggregation.list_pc_count
+    );
+    GWTraceBufferDecoder::__merge_ranges(aggregation.list_address_range);
+}
+
+
+void GWTraceBufferDecoder::__count_pcs(
+    const uint64_t* list_pc, uint64_t nb_records, uint64_t min_pc, uint64_t max_pc, uint64_t pc_shift,
+    std::vector<std::pair<uint64_t, uint64_t>>& list_pc_count
+){
+    uint64_t i = 0, nb_slots = 0, run_pc = 0, run_len = 0;
+    std::vector<uint64_t> list_count, list_sorted_pc;
+
+    list_pc_count.clear();
+    if(nb_records == 0)
+        return;
+
+    nb_slots = ((max_pc - min_pc) >> pc_shift) + 1;
+    if(nb_slots <= kGWTraceMaxFlatHistogramSize and nb_slots <= 4 * nb_records){
+        // pcs of a kernel are dense, so a flat count array covers the pc range
+        list_count.assign(nb_slots, 0);
+        for(i=0; i<nb_records; i++)
+            list_count[(list_pc[i] - min_pc) >> pc_shift] += 1;
+        for(i=0; i<nb_slots; i++){
+            if(list_count[i] > 0)
+                list_pc_count.emplace_back(min_pc + (i << pc_shift), list_count[i]);
+        }
+    } else {
+        list_sorted_pc.assign(list_pc, list_pc + nb_records);
+        std::sort(list_sorted_pc.begin(), list_sorted_pc.end());
+        run_pc = list_sorted_pc[0];
+        for(i=0; i<nb_records; i++){
+            if(list_sorted_pc[i] != run_pc){
+                list_pc_count.emplace_back(run_pc, run_len);
+                run_pc = list_sorted_pc[i];
+                run_len = 0;
+            }
+            run_len++;
+        }
+        list_pc_count.emplace_back(run_pc, run_len);
+    }
+}
+
+
+void GWTraceBufferDecoder::__merge_ranges(std::vector<std::pair<uint64_t, uint64_t>>& list_range){
+    uint64_t i = 0, nb_merged = 0;
+
+    if(list_range.size() == 0)
+        return;
+
+    std::sort(list_range.begin(), list_range.end());
+    for(i=1; i<list_range.size(); i++){
+        if(list_range[i].first <= list_range[nb_merged].second){
+            list_range[nb_merged].second = std::max(list_range[nb_merged].second, list_range[i].second);
+        } else {
+            list_range[++nb_merged] = list_range[i];
+        }
+    }
+    list_range.resize(nb_merged + 1);
+}
+
+
+void GWTraceBufferDecoder::__count_basic_blocks(const uint64_t* list_pc, uint64_t nb_records){
+    // number of pcs resolved per round
+    static constexpr uint64_t kBatchSize = 4096;
+
+    GWBasicBlock *list_basic_block[kBatchSize];
+    GWBasicBlock *run_basic_block = nullptr;
+    uint64_t base = 0, i = 0, len = 0, run_len = 0;
+
+    for(base = 0; base < nb_records; base += kBatchSize){
+        len = std::min(kBatchSize, nb_records - base);
+        if(unlikely(this->_kernel_def->resolve_pcs(list_pc + base, len, nullptr, list_basic_block) != GW_SUCCESS))
+            return;
+
+        // NOTE(zhuobin): successive records mostly come from the same basic block,
+        //                so the map is only touched once per run
+        for(i = 0; i < len; i++){
+            if(list_basic_block[i] == run_basic_block){
+                run_len++;
+                continue;
+            }
+            if(run_len > 0){
+                if(run_basic_block != nullptr)
+                    this->_map_basic_block_count[run_basic_block->id] += run_len;
+                else
+                    this->_nb_unresolved_records += run_len;
+            }
+            run_basic_block = list_basic_block[i];
+            run_len = 1;
+        }
+    }
+    if(run_len > 0){
+        if(run_basic_block != nullptr)
+            this->_map_basic_block_count[run_basic_block->id] += run_len;
+        else
+            this->_nb_unresolved_records += run_len;
+    }
+}
+
+
+void GWTraceBufferDecoder::__coalesce_range(std::map<uint64_t, uint64_t>& map_range, uint64_t start, uint64_t end){
+    typename std::map<uint64_t, uint64_t>::iterator it;
+
+    // merge with the preceding range if overlapped or adjacent
+    it = map_range.upper_bound(start);
+    if(it != map_range.begin()){
+        --it;
+        if(it->second >= start){
+            start = it->first;
+            end = std::max(end, it->second);
+            it = map_range.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // merge with following ranges
+    while(it != map_range.end() and it->first <= end){
+        end = std::max(end, it->second);
+        it = map_range.erase(it);
+    }
+
+    map_range[start] = end;
+}
+
+
+gw_retval_t GWTraceBufferDecoder::__spill(){
+    gw_retval_t retval = GW_SUCCESS;
+    uint64_t nb_records = this->_columns.size();
+
+    GW_ASSERT(this->_spill_file.is_open());
+
+    this->_spill_file.write(reinterpret_cast<const char*>(&nb_records), sizeof(uint64_t));
+    this->_spill_file.write(reinterpret_cast<const char*>(this->_columns.list_pc.data()), nb_records * sizeof(uint64_t));
+    this->_spill_file.write(reinterpret_cast<const char*>(this->_columns.list_warp_id.data()), nb_records * sizeof(uint32_t));
+    this->_spill_file.write(reinterpret_cast<const char*>(this->_columns.list_address.data()), nb_records * sizeof(uint64_t));
+    this->_spill_file.write(reinterpret_cast<const char*>(this->_columns.list_size.data()), nb_records * sizeof(uint16_t));
+    if(!this->_spill_file){
+        GW_WARN("failed to spill decoded trace to disk: path(%s)", this->_spill_path.c_str());
+        retval = GW_FAILED;
+        goto exit;
+    }
+
+    this->_nb_spilled_records += nb_records;
+    this->_columns.clear();
+
+exit:
+    return retval;
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/assemble/kernel_def.hpp"
+
+
+/* ==================== Device Trace Buffer Layout ==================== */
+
+// magic number of the device trace buffer ("GWTR"), distinct from frames of time-series
+// batches ("GWTB"), as both are exchanged as raw buffers
+#define GW_TRACE_BUFFER_MAGIC       0x52545747
+
+// version of the record layout, bump when layout of any record changes
+#define GW_TRACE_BUFFER_VERSION     1
+
+
+/*!
+ *  \brief  type of records within the device trace buffer
+ */
+enum gw_trace_record_type_t : uint16_t {
+    GW_TRACE_RECORD_UNKNOWN = 0,
+    GW_TRACE_RECORD_MEM_ACCESS
+};
+
+
+/*!
+ *  \brief  header of the device trace buffer, locates at the beginning of extra_dmem
+ *  \note   nb_records is increased by the instrumented kernel, which might exceed
+ *          capacity when the buffer overflows, records beyond capacity are dropped
+ */
+typedef struct gw_trace_buffer_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_type;
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t nb_records;
+    uint64_t capacity;
+} gw_trace_buffer_header_t;
+static_assert(sizeof(gw_trace_buffer_header_t) == 32, "unexpected size of gw_trace_buffer_header_t");
+
+
+/*!
+ *  \brief  record of a single memory access of a warp
+ */
+typedef struct gw_trace_record_mem_access {
+    // pc of the memory instruction
+    uint64_t pc;
+
+    // accessed address
+    uint64_t address;
+
+    // global warp index
+    uint32_t warp_id;
+
+    // size of the access in bytes
+    uint16_t size;
+
+    // flags of the access (e.g., load / store)
+    uint16_t flags;
+} gw_trace_record_mem_access_t;
+static_assert(sizeof(gw_trace_record_mem_access_t) == 24, "unexpected size of gw_trace_record_mem_access_t");
+
+/* ==================== Device Trace Buffer Layout ==================== */
+
+
+/* ==================== Host-side Decoder ==================== */
+
+/*!
+ *  \brief  columnar form of decoded memory access records
+ */
+typedef struct gw_trace_columns_mem_access {
+    std::vector<uint64_t> list_pc = {};
+    std::vector<uint32_t> list_warp_id = {};
+    std::vector<uint64_t> list_address = {};
+    std::vector<uint16_t> list_size = {};
+
+    inline uint64_t size() const { return this->list_pc.size(); }
+
+    inline void resize(uint64_t nb_records){
+        this->list_pc.resize(nb_records);
+        this->list_warp_id.resize(nb_records);
+        this->list_address.resize(nb_records);
+        this->list_size.resize(nb_records);
+    }
+
+    inline void clear(){
+        this->list_pc.clear();
+        this->list_warp_id.clear();
+        this->list_address.clear();
+        this->list_size.clear();
+    }
+} gw_trace_columns_mem_access_t;
+
+
+/*!
+ *  \brief  streaming decoder of device trace buffers, which decodes raw records into
+ *          columnar arrays with multiple threads, aggregates them on-the-fly and spills
+ *          columns to disk once they exceed the in-memory budget
+ */
+class GWTraceBufferDecoder {
+ public:
+    /*!
+     *  \brief  constructor
+     *  \param  nb_threads          number of threads for decoding a buffer
+     *  \param  spill_path          path of the spill file, empty for a temporary file
+     *  \param  spill_threshold     number of records kept in memory before spilling,
+     *                              0 for disabling spilling and keeping all columns in memory
+     */
+    GWTraceBufferDecoder(uint64_t nb_threads = 4, std::string spill_path = "", uint64_t spill_threshold = 1 << 24);
+
+
+    /*!
+     *  \brief  destructor
+     *  \note   the temporary spill file is removed, load it before destroying the decoder
+     */
+    ~GWTraceBufferDecoder();
+
+
+    /*!
+     *  \brief  decode a raw device trace buffer, could be called multiple times to
+     *          stream buffers of successive launches through the decoder
+     *  \param  buffer  host copy of the device trace buffer, starting with the header
+     *  \param  size    size of the buffer in bytes
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed buffer
+     */
+    gw_retval_t feed(const void* buffer, uint64_t size);
+
+
+    /*!
+     *  \brief  write remaining in-memory columns to the spill file
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t flush();
+
+
+    /*!
+     *  \brief  export aggregated result, which is compact enough to be used as trace result
+     *  \param  max_nb_ranges   maximum number of coalesced address ranges to be exported
+     *  \return aggregated result
+     */
+    nlohmann::json export_summary(uint64_t max_nb_ranges = 1024) const;
+
+
+    /*!
+     *  \brief  set the kernel definition of the traced kernel, so that pcs of decoded
+     *          records are resolved to basic blocks via its dense pc index
+     *  \note   the pc index is built if it's not built yet
+     *  \param  kernel_def  the kernel definition, nullptr for disabling the resolution
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t set_kernel_def(GWKernelDef* kernel_def);
+
+
+    /*!
+     *  \brief  read a spill file back into columnar arrays
+     *  \param  spill_path  path of the spill file
+     *  \param  columns     the loaded columns
+     *  \return GW_SUCCESS if success
+     */
+    static gw_retval_t load_spill(std::string spill_path, gw_trace_columns_mem_access_t& columns);
+
+
+    // getters
+    inline const gw_trace_columns_mem_access_t& get_columns() const { return this->_columns; }
+    inline const std::map<uint64_t, uint64_t>& get_map_pc_count() const { return this->_map_pc_count; }
+    inline const std::map<uint64_t, uint64_t>& get_map_address_range() const { return this->_map_address_range; }
+    inline const std::map<uint64_t, uint64_t>& get_map_basic_block_count() const { return this->_map_basic_block_count; }
+    inline uint64_t get_nb_records() const { return this->_nb_records; }
+    inline uint64_t get_nb_dropped_records() const { return this->_nb_dropped_records; }
+
+ private:
+    /*!
+     *  \brief  aggregation produced by a decoding thread
+     */
+    typedef struct __gw_partial_aggregation {
+        // <pc, count>, sorted by pc
+        std::vector<std::pair<uint64_t, uint64_t>> list_pc_count;
+        // disjoint <start, end>, sorted by start
+        std::vector<std::pair<uint64_t, uint64_t>> list_address_range;
+        uint64_t nb_bytes = 0;
+    } __gw_partial_aggregation_t;
+
+
+    /*!
+     *  \brief  decode a slice of memory access records into columns and partial aggregation
+     *  \param  records     start of the record slice
+     *  \param  nb_records  number of records within the slice
+     *  \param  offset      offset of the slice within the columns
+     *  \param  aggregation partial aggregation of this slice
+     */
+    void __decode_mem_access_slice(
+        const gw_trace_record_mem_access_t* records, uint64_t nb_records, uint64_t offset,
+        __gw_partial_aggregation_t& aggregation
+    );
+
+
+    /*!
+     *  \brief  resolve pcs of decoded records to basic blocks and count them
+     *  \param  list_pc     pcs of decoded records
+     *  \param  nb_records  number of records
+     */
+    void __count_basic_blocks(const uint64_t* list_pc, uint64_t nb_records);
+
+
+    /*!
+     *  \brief  count occurrence of each pc, with a flat count array over the pc range,
+     *          or sorting the pcs if the range is too sparse
+     *  \param  list_pc         pcs to be counted
+     *  \param  nb_records      number of pcs
+     *  \param  min_pc          minimum pc
+     *  \param  max_pc          maximum pc
+     *  \param  pc_shift        pcs share the same lower bits below the shift
+     *  \param  list_pc_count   output <pc, count>, sorted by pc
+     */
+    static void __count_pcs(
+        const uint64_t* list_pc, uint64_t nb_records, uint64_t min_pc, uint64_t max_pc, uint64_t pc_shift,
+        std::vector<std::pair<uint64_t, uint64_t>>& list_pc_count
+    );
+
+
+    /*!
+     *  \brief  sort address ranges and merge overlapped or adjacent ones in-place
+     *  \param  list_range  address ranges: <start, end>
+     */
+    static void __merge_ranges(std::vector<std::pair<uint64_t, uint64_t>>& list_range);
+
+
+    /*!
+     *  \brief  insert [start, end) to a set of disjoint address ranges, merging overlapped
+     *          or adjacent ranges
+     *  \param  map_range   disjoint address ranges: <start, end>
+     *  \param  start       start of the range
+     *  \param  end         end of the range
+     */
+    static void __coalesce_range(std::map<uint64_t, uint64_t>& map_range, uint64_t start, uint64_t end);
+
+
+    /*!
+     *  \brief  append in-memory columns to the spill file and clear them
+     *  \return GW_SUCCESS if success
+     */
+    gw_retval_t __spill();
+
+    // number of decoding threads
+    uint64_t _nb_threads = 1;
+
+    // decoded columns kept in memory
+    gw_trace_columns_mem_access_t _columns;
+
+    // aggregations: <pc, count>, <start, end>
+    std::map<uint64_t, uint64_t> _map_pc_count;
+    std::map<uint64_t, uint64_t> _map_address_range;
+
+    // kernel definition to resolve pcs, and records per basic block: <bb_id, count>
+    GWKernelDef *_kernel_def = nullptr;
+    std::map<uint64_t, uint64_t> _map_basic_block_count;
+    uint64_t _nb_unresolved_records = 0;
+
+    // statistics
+    uint64_t _nb_records = 0;
+    uint64_t _nb_dropped_records = 0;
+    uint64_t _nb_bytes = 0;
+    uint64_t _nb_spilled_records = 0;
+
+    // spill file, the temporary one is removed on destruction
+    std::string _spill_path = "";
+    uint64_t _spill_threshold = 0;
+    std::ofstream _spill_file;
+    bool _is_spill_path_temporary = false;
+};
+
+/* ==================== Host-side Decoder ==================== */
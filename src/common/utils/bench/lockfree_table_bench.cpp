@@ -0,0 +1,172 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/lockfree_table.hpp"
+
+
+/*!
+ *  \brief  microbenchmark of the launch descriptor cache (see GWCapsule::CUDA_get_launch_desc),
+ *          which measures the per-launch overhead of the launch hook against a stub driver
+ *          in the non-traced case, and the cost of misses on a nearly full table
+ *  \note   usage: gwatch_bench_lockfree_table [nb_functions] [nb_launches] [nb_threads],
+ *          exits with failure if the overhead exceeds GW_BENCH_LAUNCH_OVERHEAD_TARGET_NS
+ */
+
+
+#define GW_BENCH_LAUNCH_OVERHEAD_TARGET_NS  50.0
+
+
+// mirror of gw_capsule_launch_desc_t, without CUDA types
+typedef struct gw_bench_launch_desc {
+    std::string name = "";
+    void *function = nullptr;
+    std::atomic<void*> kernel_def = nullptr;
+    std::atomic<uint64_t> trace_decision = 0;
+    uint64_t module_generation = 0;
+} gw_bench_launch_desc_t;
+
+
+static GWUtilLockFreeTable<gw_bench_launch_desc_t> table_launch_desc;
+static std::atomic<uint64_t> cumodule_generation = 0;
+static std::atomic<uint64_t> trace_task_version = 0;
+
+
+// stub of the driver API, which isn't inlined so that only the hook is measured
+__attribute__((noinline)) static int __stub_cuLaunchKernel(void *function, uint32_t grid_dim_x){
+    asm volatile("" : : "r"(function), "r"(grid_dim_x) : "memory");
+    return 0;
+}
+
+
+// mirror of the fast path of launch hooks: descriptor lookup + trace decision
+__attribute__((noinline)) static int __hooked_cuLaunchKernel(void *function, uint32_t grid_dim_x){
+    gw_bench_launch_desc_t *launch_desc = nullptr;
+    uint64_t version = 0, decision = 0;
+
+    launch_desc = table_launch_desc.find(reinterpret_cast<uint64_t>(function));
+    if(unlikely(
+        launch_desc == nullptr
+        or launch_desc->module_generation != cumodule_generation.load(std::memory_order_acquire)
+    )){
+        GW_ERROR("descriptor should have been cached: function(%p)", function);
+    }
+
+    version = trace_task_version.load(std::memory_order_relaxed);
+    if(unlikely(version != 0)){
+        decision = launch_desc->trace_decision.load(std::memory_order_relaxed);
+        if((decision >> 1) != version)
+            launch_desc->trace_decision.store(version << 1, std::memory_order_relaxed);
+    }
+
+    return __stub_cuLaunchKernel(function, grid_dim_x);
+}
+
+
+static double __measure_ns_per_launch(
+    int(*launch)(void*, uint32_t), const std::vector<void*>& list_functions, uint64_t nb_launches, uint64_t nb_threads
+){
+    std::vector<std::thread> list_threads;
+    std::atomic<uint64_t> nb_ready = 0;
+    std::atomic<bool> do_start = false;
+    std::chrono::steady_clock::time_point begin, end;
+    uint64_t i = 0;
+
+    for(i=0; i<nb_threads; i++){
+        list_threads.emplace_back([&, i](){
+            uint64_t j = 0, index = (i * 7919) % list_functions.size();
+            nb_ready.fetch_add(1);
+            while(!do_start.load(std::memory_order_acquire))
+                __builtin_ia32_pause();
+            for(j=0; j<nb_launches; j++){
+                launch(list_functions[index], static_cast<uint32_t>(j));
+                index = (index + 1 == list_functions.size()) ? 0 : index + 1;
+            }
+        });
+    }
+    while(nb_ready.load() < nb_threads)
+        __builtin_ia32_pause();
+
+    begin = std::chrono::steady_clock::now();
+    do_start.store(true, std::memory_order_release);
+    for(std::thread& thread : list_threads)
+        thread.join();
+    end = std::chrono::steady_clock::now();
+
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count())
+            / static_cast<double>(nb_launches);
+}
+
+
+static double __measure_ns_per_miss(uint64_t capacity, uint64_t nb_lookups){
+    GWUtilLockFreeTable<uint64_t> table(capacity);
+    uint64_t *existing_value = nullptr, key = 0, i = 0, nb_found = 0;
+    std::chrono::steady_clock::time_point begin, end;
+
+    // fill the table until inserts start to fail
+    for(key=1; table.insert(key << 12, new uint64_t(key), existing_value) == GW_SUCCESS; key++){}
+
+    begin = std::chrono::steady_clock::now();
+    for(i=0; i<nb_lookups; i++)
+        nb_found += (table.find((key + i + 1) << 12) != nullptr);
+    end = std::chrono::steady_clock::now();
+    GW_ASSERT(nb_found == 0);
+
+    GW_LOG(
+        "filled table for misses: capacity(%lu), size(%lu), load_factor(%.2f)",
+        table.capacity(), table.size(), static_cast<double>(table.size()) / table.capacity()
+    );
+
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count())
+            / static_cast<double>(nb_lookups);
+}
+
+
+int main(int argc, char **argv){
+    gw_bench_launch_desc_t *launch_desc = nullptr, *existing_desc = nullptr;
+    std::vector<void*> list_functions;
+    std::mt19937_64 rng(2025);
+    uint64_t nb_functions = 4096, nb_launches = 20000000, nb_threads = 1, i = 0;
+    double ns_stub = 0, ns_hooked = 0, ns_hooked_mt = 0, ns_miss = 0, overhead = 0;
+
+    if(argc > 1) nb_functions = std::stoul(argv[1]);
+    if(argc > 2) nb_launches = std::stoul(argv[2]);
+    if(argc > 3) nb_threads = std::stoul(argv[3]);
+
+    // fake CUfunctions, which are 4KiB-aligned like handles from the driver
+    for(i=0; i<nb_functions; i++){
+        list_functions.push_back(reinterpret_cast<void*>(0x7f0000000000ul + ((i + 1) << 12)));
+        GW_CHECK_POINTER(launch_desc = new gw_bench_launch_desc_t());
+        launch_desc->function = list_functions.back();
+        launch_desc->name = "kernel_" + std::to_string(i);
+        GW_ASSERT(table_launch_desc.insert(
+            reinterpret_cast<uint64_t>(list_functions.back()), launch_desc, existing_desc
+        ) == GW_SUCCESS);
+    }
+    std::shuffle(list_functions.begin(), list_functions.end(), rng);
+
+    ns_stub = __measure_ns_per_launch(__stub_cuLaunchKernel, list_functions, nb_launches, 1);
+    ns_hooked = __measure_ns_per_launch(__hooked_cuLaunchKernel, list_functions, nb_launches, 1);
+    ns_hooked_mt = __measure_ns_per_launch(__hooked_cuLaunchKernel, list_functions, nb_launches, nb_threads);
+    ns_miss = __measure_ns_per_miss(GW_UTIL_LOCKFREE_TABLE_DEFAULT_CAPACITY, nb_launches / 10);
+    overhead = ns_hooked - ns_stub;
+
+    GW_LOG("nb_functions(%lu), nb_launches(%lu), nb_threads(%lu)", nb_functions, nb_launches, nb_threads);
+    GW_LOG("stub launch: %.2f ns/launch", ns_stub);
+    GW_LOG("hooked launch: %.2f ns/launch, overhead(%.2f ns)", ns_hooked, overhead);
+    GW_LOG("hooked launch with %lu threads: %.2f ns/launch per thread", nb_threads, ns_hooked_mt);
+    GW_LOG("miss on full table: %.2f ns/lookup", ns_miss);
+
+    if(overhead > GW_BENCH_LAUNCH_OVERHEAD_TARGET_NS){
+        GW_WARN("launch overhead exceeds the target: overhead(%.2f ns), target(%.2f ns)", overhead, GW_BENCH_LAUNCH_OVERHEAD_TARGET_NS);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/rcu_map.hpp"
+
+
+/*!
+ *  \brief  stress and throughput test of GWUtilRcuMap, readers look up keys while writers
+ *          keep inserting and erasing, which checks that stable keys are never missed,
+ *          values are never torn and retired tables are reclaimed, and measures lookups
+ *          against a std::unordered_map guarded by std::shared_mutex
+ *  \note   usage: gwatch_bench_rcu_map [nb_readers] [nb_writers] [duration_ms],
+ *          exits with failure if any check fails
+ */
+
+
+// keys which are inserted before the test and never erased
+#define GW_BENCH_RCU_MAP_NB_STABLE_KEYS     4096
+
+// keys which are inserted and erased by each writer in each round
+#define GW_BENCH_RCU_MAP_NB_CHURN_KEYS      1024
+
+
+typedef GWUtilRcuMap<uint64_t, uint64_t> gw_bench_rcu_map_t;
+
+
+// values are derived from keys, so that torn or stale entries could be detected
+static inline uint64_t __value_of(uint64_t key){
+    return key * 0x9e3779b97f4a7c15ull + 1;
+}
+
+
+// stable keys are 4KiB-aligned like CUfunctions, churn keys are tagged by their writer
+static inline uint64_t __stable_key(uint64_t i){
+    return 0x7f0000000000ull + ((i + 1) << 12);
+}
+
+static inline uint64_t __churn_key(uint64_t writer_id, uint64_t i){
+    return (1ull << 63) | (writer_id << 48) | ((i + 1) << 4);
+}
+
+
+static std::atomic<uint64_t> nb_errors = 0;
+
+
+static void __report_error(const char *what, uint64_t key){
+    if(nb_errors.fetch_add(1) < 16)
+        GW_WARN("check failed: %s, key(%#lx)", what, key);
+}
+
+
+/*!
+ *  \brief  run readers and writers concurrently on the map for the given duration
+ *  \return lookups per second of all readers
+ */
+static double __run_stress(gw_bench_rcu_map_t& map, uint64_t nb_readers, uint64_t nb_writers, uint64_t duration_ms){
+    std::vector<std::thread> list_threads;
+    std::vector<uint64_t> list_nb_lookups(nb_readers, 0);
+    std::atomic<uint64_t> nb_rounds = 0;
+    std::atomic<bool> do_stop = false;
+    uint64_t i = 0, nb_lookups = 0;
+
+    for(i=0; i<nb_readers; i++){
+        list_threads.emplace_back([&, i](){
+            uint64_t key = 0, value = 0, j = (i * 7919) % GW_BENCH_RCU_MAP_NB_STABLE_KEYS, nb = 0;
+
+            while(!do_stop.load(std::memory_order_relaxed)){
+                // stable keys must always be found
+                key = __stable_key(j);
+                if(unlikely(!map.find(key, value)))
+                    __report_error("stable key is missed", key);
+                else if(unlikely(value != __value_of(key)))
+                    __report_error("value of stable key is torn", key);
+
+                // churn keys might come and go, but must never carry a wrong value
+                key = __churn_key(nb % std::max<uint64_t>(nb_writers, 1), j % GW_BENCH_RCU_MAP_NB_CHURN_KEYS);
+                if(map.find(key, value) and unlikely(value != __value_of(key)))
+                    __report_error("value of churn key is torn", key);
+
+                j = (j + 1 == GW_BENCH_RCU_MAP_NB_STABLE_KEYS) ? 0 : j + 1;
+                nb += 2;
+            }
+            list_nb_lookups[i] = nb;
+        });
+    }
+
+    for(i=0; i<nb_writers; i++){
+        list_threads.emplace_back([&, i](){
+            uint64_t round = 0, j = 0, value = 0;
+
+            while(!do_stop.load(std::memory_order_relaxed)){
+                for(j=0; j<GW_BENCH_RCU_MAP_NB_CHURN_KEYS; j++){
+                    if(unlikely(map.insert(__churn_key(i, j), __value_of(__churn_key(i, j))) != GW_SUCCESS))
+                        __report_error("churn key is inserted twice", __churn_key(i, j));
+                }
+
+                // writers own their churn keys, so all of them must be visible now
+                for(j=0; j<GW_BENCH_RCU_MAP_NB_CHURN_KEYS; j++){
+                    if(unlikely(!map.find(__churn_key(i, j), value)))
+                        __report_error("inserted churn key is missed", __churn_key(i, j));
+                }
+
+                if(unlikely(map.erase_if([i](const uint64_t& key, const uint64_t&){
+                    return (key >> 63) == 1 and ((key >> 48) & 0x7fff) == i;
+                }) != GW_BENCH_RCU_MAP_NB_CHURN_KEYS)){
+                    __report_error("wrong number of churn keys are erased", __churn_key(i, 0));
+                }
+
+                for(j=0; j<GW_BENCH_RCU_MAP_NB_CHURN_KEYS; j++){
+                    if(unlikely(map.find(__churn_key(i, j), value)))
+                        __report_error("erased churn key is found", __churn_key(i, j));
+                }
+
+                round += 1;
+            }
+            nb_rounds.fetch_add(round);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    do_stop.store(true);
+    for(std::thread& thread : list_threads)
+        thread.join();
+
+    for(uint64_t nb : list_nb_lookups)
+        nb_lookups += nb;
+
+    GW_LOG(
+        "stress: nb_readers(%lu), nb_writers(%lu), duration(%lu ms), nb_lookups(%lu), nb_writer_rounds(%lu)",
+        nb_readers, nb_writers, duration_ms, nb_lookups, nb_rounds.load()
+    );
+
+    return static_cast<double>(nb_lookups) * 1000.0 / static_cast<double>(duration_ms);
+}
+
+
+/*!
+ *  \brief  measure lookups of stable keys by multiple readers, without writers
+ *  \return nanoseconds per lookup of each reader
+ */
+template<typename F>
+static double __measure_ns_per_lookup(F&& lookup, uint64_t nb_threads, uint64_t nb_lookups){
+    std::vector<std::thread> list_threads;
+    std::atomic<uint64_t> nb_ready = 0, nb_found = 0;
+    std::atomic<bool> do_start = false;
+    std::chrono::steady_clock::time_point begin, end;
+    uint64_t i = 0;
+
+    for(i=0; i<nb_threads; i++){
+        list_threads.emplace_back([&, i](){
+            uint64_t j = 0, index = (i * 7919) % GW_BENCH_RCU_MAP_NB_STABLE_KEYS, nb = 0;
+            nb_ready.fetch_add(1);
+            while(!do_start.load(std::memory_order_acquire))
+                __builtin_ia32_pause();
+            for(j=0; j<nb_lookups; j++){
+                nb += lookup(__stable_key(index));
+                index = (index + 1 == GW_BENCH_RCU_MAP_NB_STABLE_KEYS) ? 0 : index + 1;
+            }
+            nb_found.fetch_add(nb);
+        });
+    }
+    while(nb_ready.load() < nb_threads)
+        __builtin_ia32_pause();
+
+    begin = std::chrono::steady_clock::now();
+    do_start.store(true, std::memory_order_release);
+    for(std::thread& thread : list_threads)
+        thread.join();
+    end = std::chrono::steady_clock::now();
+
+    if(unlikely(nb_found.load() != nb_threads * nb_lookups))
+        __report_error("stable key is missed while measuring", 0);
+
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count())
+            / static_cast<double>(nb_lookups);
+}
+
+
+int main(int argc, char **argv){
+    gw_bench_rcu_map_t map;
+    std::unordered_map<uint64_t, uint64_t> locked_map;
+    std::shared_mutex mutex_locked_map;
+    uint64_t nb_readers = 4, nb_writers = 2, duration_ms = 2000, nb_lookups = 5000000, i = 0;
+    uint64_t expected_size = 0, nb_visited = 0, nb_retired = 0;
+    double ns_rcu = 0, ns_rcu_mt = 0, ns_locked = 0, ns_locked_mt = 0, lookups_per_sec = 0;
+
+    if(argc > 1) nb_readers = std::stoul(argv[1]);
+    if(argc > 2) nb_writers = std::stoul(argv[2]);
+    if(argc > 3) duration_ms = std::stoul(argv[3]);
+
+    for(i=0; i<GW_BENCH_RCU_MAP_NB_STABLE_KEYS; i++){
+        GW_ASSERT(map.insert(__stable_key(i), __value_of(__stable_key(i))) == GW_SUCCESS);
+        locked_map[__stable_key(i)] = __value_of(__stable_key(i));
+    }
+    GW_ASSERT(map.insert(__stable_key(0), 0) == GW_FAILED_ALREADY_EXIST);
+    expected_size = GW_BENCH_RCU_MAP_NB_STABLE_KEYS;
+
+    // throughput of lookups without writers
+    auto rcu_lookup = [&](uint64_t key) -> uint64_t {
+        uint64_t value = 0;
+        return map.find(key, value) and value == __value_of(key);
+    };
+    auto locked_lookup = [&](uint64_t key) -> uint64_t {
+        std::shared_lock lock(mutex_locked_map);
+        auto it = locked_map.find(key);
+        return it != locked_map.end() and it->second == __value_of(key);
+    };
+    ns_rcu = __measure_ns_per_lookup(rcu_lookup, 1, nb_lookups);
+    ns_locked = __measure_ns_per_lookup(locked_lookup, 1, nb_lookups);
+    ns_rcu_mt = __measure_ns_per_lookup(rcu_lookup, nb_readers, nb_lookups);
+    ns_locked_mt = __measure_ns_per_lookup(locked_lookup, nb_readers, nb_lookups);
+
+    // lookups under concurrent inserts and erases
+    lookups_per_sec = __run_stress(map, nb_readers, nb_writers, duration_ms);
+
+    // all churn keys have been erased by their writers
+    if(map.size() != expected_size){
+        GW_WARN("size of map is wrong after stress: size(%lu), expected(%lu)", map.size(), expected_size);
+        nb_errors += 1;
+    }
+    map.for_each([&](const uint64_t& key, const uint64_t& value){
+        nb_visited += 1;
+        if(unlikely(value != __value_of(key)))
+            __report_error("value is torn after stress", key);
+    });
+    if(nb_visited != expected_size){
+        GW_WARN("number of visited entries is wrong after stress: nb_visited(%lu), expected(%lu)", nb_visited, expected_size);
+        nb_errors += 1;
+    }
+
+    // no reader is left, so the next retirement reclaims all tables retired before
+    GW_ASSERT(map.insert(__stable_key(GW_BENCH_RCU_MAP_NB_STABLE_KEYS), 1) == GW_SUCCESS);
+    map.erase_if([](const uint64_t& key, const uint64_t&){ return key == __stable_key(GW_BENCH_RCU_MAP_NB_STABLE_KEYS); });
+    nb_retired = GWUtilEpochDomain::instance().get_nb_retired();
+    if(nb_retired != 0){
+        GW_WARN("retired tables aren't reclaimed after stress: nb_retired(%lu)", nb_retired);
+        nb_errors += 1;
+    }
+
+    GW_LOG("lookup with 1 thread: rcu_map(%.2f ns), shared_mutex(%.2f ns)", ns_rcu, ns_locked);
+    GW_LOG(
+        "lookup with %lu threads: rcu_map(%.2f ns), shared_mutex(%.2f ns) per lookup of each thread",
+        nb_readers, ns_rcu_mt, ns_locked_mt
+    );
+    GW_LOG("lookup under %lu writers: %.2f M lookups/s in total", nb_writers, lookups_per_sec / 1e6);
+
+    if(nb_errors.load() > 0){
+        GW_WARN("stress test of rcu map failed: nb_errors(%lu)", nb_errors.load());
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/binary.hpp"
+#include "common/instrument.hpp"
+#include "common/assemble/kernel.hpp"
+#include "common/assemble/kernel_def.hpp"
+#include "common/assemble/instruction.hpp"
+#include "common/cuda_impl/binary/cubin.hpp"
+#include "common/cuda_impl/assemble/kernel_cuda.hpp"
+
+
+/*!
+ *  \brief  offline check of dead register reusing on a cubin, for each kernel, registers
+ *          reused over each basic block are checked against the register liveness, so that
+ *          instrumentation never clobbers a live register, and registers reserved over
+ *          overlapped ranges are checked to be distinct
+ *  \note   usage: gwatch_bench_reg_reuse <cubin_path> [reg_type],
+ *          exits with failure if any check fails
+ */
+
+
+static uint64_t nb_errors = 0;
+
+
+static void __report_error(const char *what, const std::string& kernel_name, uint64_t reg_id, uint64_t pc){
+    if(nb_errors++ < 16)
+        GW_WARN("check failed: %s, kernel(%s), reg(%lu), pc(%#lx)", what, kernel_name.c_str(), reg_id, pc);
+}
+
+
+/*!
+ *  \brief  check whether the register is touched by any instruction within the pc range
+ *  \param  kernel_def  kernel definition with register liveness
+ *  \param  reg_type    type of register
+ *  \param  reg_id      id of register
+ *  \param  start_pc    start pc of the range
+ *  \param  end_pc      end pc of the range
+ *  \param  touched_pc  pc of the first instruction which touches the register
+ *  \return whether the register is touched
+ */
+static bool __is_touched_in_range(
+    const GWKernelDef *kernel_def, const std::string& reg_type, uint64_t reg_id,
+    uint64_t start_pc, uint64_t end_pc, uint64_t& touched_pc
+){
+    std::map<uint64_t, GWInstruction*>::const_iterator it;
+
+    for(it = kernel_def->map_pc_to_instruction.lower_bound(start_pc); it != kernel_def->map_pc_to_instruction.end() and it->first <= end_pc; it++){
+        const GWInstruction *inst = it->second;
+        if(
+            (inst->map_register_set_IN.count(reg_type) > 0 and inst->map_register_set_IN.at(reg_type).count(reg_id) > 0)
+            or (inst->map_register_set_OUT.count(reg_type) > 0 and inst->map_register_set_OUT.at(reg_type).count(reg_id) > 0)
+        ){
+            touched_pc = it->first;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+int main(int argc, char **argv){
+    gw_retval_t retval = GW_SUCCESS;
+    GWBinaryImageExt_CUDACubin *cubin = nullptr;
+    GWBinaryImage *binary = nullptr;
+    GWKernelExt_CUDA *kernel_ext_cuda = nullptr;
+    GWInstrumentRegAllocCxt *reg_alloc_cxt = nullptr;
+    std::string cubin_path = "", reg_type = "general";
+    std::map<const GWInstruction*, uint64_t> map_instruction_pc;
+    std::map<uint64_t, std::pair<uint64_t, uint64_t>> map_bb_range;
+    std::set<uint64_t> set_dead_reg, set_reused_in_bb;
+    std::vector<uint64_t> list_reg_idx;
+    uint64_t reg_id = 0, touched_pc = 0, start_pc = 0, end_pc = 0;
+    uint64_t nb_kernels = 0, nb_skipped_kernels = 0, nb_bbs = 0, nb_reused = 0, nb_reused_in_kernel = 0, nb_dead_over_kernel = 0;
+    std::chrono::steady_clock::time_point begin, end;
+    double query_ns = 0;
+    uint64_t nb_queries = 0;
+
+    if(argc < 2){
+        GW_WARN("usage: %s <cubin_path> [reg_type]", argv[0]);
+        return -1;
+    }
+    cubin_path = argv[1];
+    if(argc > 2) reg_type = argv[2];
+
+    GW_CHECK_POINTER(cubin = GWBinaryImageExt_CUDACubin::create());
+    GW_CHECK_POINTER(binary = cubin->get_base_ptr());
+    GW_IF_FAILED(binary->fill(cubin_path), retval, {
+        GW_WARN("failed to fill cubin: path(%s), error(%s)", cubin_path.c_str(), gw_retval_str(retval));
+        return -1;
+    });
+    GW_IF_FAILED(binary->parse(), retval, {
+        GW_WARN("failed to parse cubin: path(%s), error(%s)", cubin_path.c_str(), gw_retval_str(retval));
+        return -1;
+    });
+
+    for(auto& [kernel_name, kernel_def] : cubin->get_map_kernel_def()){
+        GW_CHECK_POINTER(kernel_def);
+
+        if(!kernel_def->is_register_liveness_parsed() and kernel_def->parse_register_liveness() != GW_SUCCESS){
+            nb_skipped_kernels += 1;
+            continue;
+        }
+        if(kernel_def->map_pc_to_instruction.size() == 0){
+            nb_skipped_kernels += 1;
+            continue;
+        }
+        nb_kernels += 1;
+        nb_reused_in_kernel = 0;
+
+        GW_CHECK_POINTER(kernel_ext_cuda = GWKernelExt_CUDA::create(kernel_def));
+        GW_CHECK_POINTER(reg_alloc_cxt = new GWInstrumentRegAllocCxt(kernel_ext_cuda->get_base_ptr()));
+
+        // registers dead over the whole kernel must never be touched
+        start_pc = kernel_def->map_pc_to_instruction.begin()->first;
+        end_pc = kernel_def->map_pc_to_instruction.rbegin()->first;
+        begin = std::chrono::steady_clock::now();
+        retval = reg_alloc_cxt->get_dead_reg_set(reg_type, start_pc, end_pc, set_dead_reg);
+        end = std::chrono::steady_clock::now();
+        query_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        nb_queries += 1;
+        if(retval != GW_SUCCESS){
+            __report_error("failed to query dead register over kernel", kernel_name, 0, start_pc);
+            goto next_kernel;
+        }
+        nb_dead_over_kernel += set_dead_reg.size();
+        for(uint64_t dead_reg_id : set_dead_reg){
+            if(__is_touched_in_range(kernel_def, reg_type, dead_reg_id, start_pc, end_pc, touched_pc))
+                __report_error("dead register is touched within kernel", kernel_name, dead_reg_id, touched_pc);
+        }
+
+        // pc range of each basic block
+        map_instruction_pc.clear();
+        map_bb_range.clear();
+        for(auto& [pc, inst] : kernel_def->map_pc_to_instruction)
+            map_instruction_pc[inst] = pc;
+        for(GWBasicBlock *bb : kernel_def->list_basic_blocks){
+            GW_CHECK_POINTER(bb);
+            for(GWInstruction *inst : bb->list_instructions){
+                if(map_instruction_pc.count(inst) == 0)
+                    continue;
+                if(map_bb_range.count(bb->id) == 0){
+                    map_bb_range[bb->id] = { map_instruction_pc[inst], map_instruction_pc[inst] };
+                } else {
+                    map_bb_range[bb->id].first = std::min(map_bb_range[bb->id].first, map_instruction_pc[inst]);
+                    map_bb_range[bb->id].second = std::max(map_bb_range[bb->id].second, map_instruction_pc[inst]);
+                }
+            }
+        }
+
+        // reuse registers over each basic block until falling back to extra allocation,
+        // registers reserved within the same basic block must be distinct and dead
+        for(auto& [bb_id, bb_range] : map_bb_range){
+            nb_bbs += 1;
+            set_reused_in_bb.clear();
+            while(true){
+                begin = std::chrono::steady_clock::now();
+                retval = reg_alloc_cxt->find_dead_reg_run(reg_type, bb_range.first, bb_range.second, 1, list_reg_idx);
+                end = std::chrono::steady_clock::now();
+                query_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+                nb_queries += 1;
+                if(retval != GW_SUCCESS)
+                    break;
+                if(reg_alloc_cxt->alloc_reused(bb_range.first, bb_range.second, reg_type, reg_id) != GW_SUCCESS){
+                    __report_error("failed to reuse dead register", kernel_name, 0, bb_range.first);
+                    break;
+                }
+                if(set_reused_in_bb.count(reg_id) > 0){
+                    __report_error("dead register is reused twice over overlapped range", kernel_name, reg_id, bb_range.first);
+                    break;
+                }
+                if(__is_touched_in_range(kernel_def, reg_type, reg_id, bb_range.first, bb_range.second, touched_pc))
+                    __report_error("reused register is touched within basic block", kernel_name, reg_id, touched_pc);
+                set_reused_in_bb.insert(reg_id);
+                nb_reused_in_kernel += 1;
+            }
+        }
+
+        // every reused register is accounted as an avoided extra register
+        if(reg_alloc_cxt->get_nb_avoided_extra_reg(reg_type) != nb_reused_in_kernel)
+            __report_error("wrong number of avoided extra register", kernel_name, nb_reused_in_kernel, 0);
+        nb_reused += nb_reused_in_kernel;
+
+    next_kernel:
+        delete reg_alloc_cxt;
+        reg_alloc_cxt = nullptr;
+    }
+
+    GW_LOG(
+        "register reuse: cubin(%s), nb_kernels(%lu), nb_skipped_kernels(%lu), nb_basic_blocks(%lu)",
+        cubin_path.c_str(), nb_kernels, nb_skipped_kernels, nb_bbs
+    );
+    GW_LOG(
+        "register reuse: avg dead %s register over kernel(%.2f), avg reused per basic block(%.2f), avg query(%.2f us)",
+        reg_type.c_str(),
+        nb_kernels > 0 ? static_cast<double>(nb_dead_over_kernel) / nb_kernels : 0.0,
+        nb_bbs > 0 ? static_cast<double>(nb_reused) / nb_bbs : 0.0,
+        nb_queries > 0 ? query_ns / nb_queries / 1000.0 : 0.0
+    );
+
+    delete cubin;
+
+    if(nb_errors > 0){
+        GW_WARN("register reuse check failed: nb_errors(%lu)", nb_errors);
+        return -1;
+    }
+    return 0;
+}
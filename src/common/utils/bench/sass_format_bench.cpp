@@ -0,0 +1,191 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/binary.hpp"
+#include "common/assemble/kernel_def.hpp"
+#include "common/assemble/instruction.hpp"
+#include "common/assemble/instruction_def.hpp"
+#include "common/utils/text_buffer.hpp"
+#include "common/cuda_impl/binary/cubin.hpp"
+
+
+/*!
+ *  \brief  throughput test of the buffered SASS text formatter, dumps disassembly of all
+ *          kernels of a cubin through GWKernelDef::dump_text and compares it against
+ *          formatting each line through iostreams and GWInstruction::str, the text of
+ *          both should be identical, and dumping to file should be bound by writing
+ *  \note   usage: gwatch_bench_sass_format <cubin_path> [nb_rounds] [output_path],
+ *          exits with failure if the text mismatches
+ */
+
+
+static double __mb_per_sec(uint64_t nb_bytes, std::chrono::steady_clock::duration duration){
+    double sec = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1e9;
+    return sec > 0 ? static_cast<double>(nb_bytes) / MB(1) / sec : 0;
+}
+
+
+/*!
+ *  \brief  format disassembly of a kernel through iostreams, one string per instruction
+ *  \param  kernel_def  kernel to be formatted
+ *  \param  ss          stream to format to
+ */
+static void __format_with_iostream(GWKernelDef *kernel_def, std::ostringstream& ss){
+    uint64_t pc = 0;
+    std::ostringstream ss_pc;
+    std::string pc_str;
+
+    ss << ".text." << kernel_def->mangled_prototype << ":\n";
+    for(GWInstruction* inst : kernel_def->list_instructions){
+        ss_pc.str("");
+        ss_pc << "        /*" << std::hex << std::setw(4) << std::setfill('0') << pc << "*/";
+        pc_str = ss_pc.str();
+        ss << std::left << std::setw(35) << std::setfill(' ') << pc_str;
+        ss << inst->str(/* flatten */ true, /* simply */ false) << " ;\n";
+        pc += inst->get_def()->instruction_size;
+    }
+}
+
+
+int main(int argc, char **argv){
+    gw_retval_t retval = GW_SUCCESS;
+    GWBinaryImageExt_CUDACubin *cubin = nullptr;
+    GWBinaryImage *binary = nullptr;
+    std::vector<GWKernelDef*> list_kernel_def;
+    std::string cubin_path = "", output_path = "/tmp/gwatch_bench_sass_format.txt";
+    std::ostringstream ss;
+    std::string iostream_text;
+    GWUtilTextBuffer buffer(MB(16));
+    std::chrono::steady_clock::time_point begin, end;
+    std::chrono::steady_clock::duration duration_iostream{0}, duration_cold{0}, duration_warm{0}, duration_file{0}, duration_write{0};
+    uint64_t nb_rounds = 10, round = 0, nb_instructions = 0, nb_bytes = 0, nb_hits = 0, nb_misses = 0;
+    int fd = -1;
+    bool is_mismatched = false;
+
+    if(argc < 2){
+        GW_WARN("usage: %s <cubin_path> [nb_rounds] [output_path]", argv[0]);
+        return -1;
+    }
+    cubin_path = argv[1];
+    if(argc > 2) nb_rounds = std::max<uint64_t>(std::stoul(argv[2]), 1);
+    if(argc > 3) output_path = argv[3];
+
+    GW_CHECK_POINTER(cubin = GWBinaryImageExt_CUDACubin::create());
+    GW_CHECK_POINTER(binary = cubin->get_base_ptr());
+    GW_IF_FAILED(binary->fill(cubin_path), retval, {
+        GW_WARN("failed to fill cubin: path(%s), error(%s)", cubin_path.c_str(), gw_retval_str(retval));
+        return -1;
+    });
+    GW_IF_FAILED(binary->parse(), retval, {
+        GW_WARN("failed to parse cubin: path(%s), error(%s)", cubin_path.c_str(), gw_retval_str(retval));
+        return -1;
+    });
+    for(auto& [kernel_name, kernel_def] : cubin->get_map_kernel_def()){
+        GW_CHECK_POINTER(kernel_def);
+        if(!kernel_def->is_instructions_parsed())
+            continue;
+        list_kernel_def.push_back(kernel_def);
+        nb_instructions += kernel_def->get_nb_instructions();
+    }
+
+    // the first round of the formatter renders each distinct encoding, later rounds reuse them
+    for(round=0; round<nb_rounds; round++){
+        buffer.clear();
+        begin = std::chrono::steady_clock::now();
+        for(GWKernelDef* kernel_def : list_kernel_def)
+            kernel_def->dump_text(buffer, /* simply */ false);
+        end = std::chrono::steady_clock::now();
+        if(round == 0){
+            duration_cold = end - begin;
+        } else {
+            duration_warm += end - begin;
+        }
+    }
+    nb_bytes = buffer.size();
+    GWInstructionDef::get_text_cache_statistics(nb_hits, nb_misses);
+
+    // formatting through iostreams
+    for(round=0; round<nb_rounds; round++){
+        ss.str("");
+        begin = std::chrono::steady_clock::now();
+        for(GWKernelDef* kernel_def : list_kernel_def)
+            __format_with_iostream(kernel_def, ss);
+        end = std::chrono::steady_clock::now();
+        duration_iostream += end - begin;
+    }
+    iostream_text = ss.str();
+    if(iostream_text != buffer.view()){
+        GW_WARN(
+            "text of formatter mismatches iostreams: size(%lu), expected_size(%lu)",
+            buffer.size(), iostream_text.size()
+        );
+        is_mismatched = true;
+    }
+
+    // dumping to file against writing the same amount of bytes
+    begin = std::chrono::steady_clock::now();
+    for(round=0; round<nb_rounds; round++){
+        for(GWKernelDef* kernel_def : list_kernel_def){
+            GW_IF_FAILED(
+                kernel_def->dump_text_to_file(output_path, /* simply */ false, /* append */ kernel_def != list_kernel_def[0]),
+                retval,
+                {
+                    GW_WARN("failed to dump disassembly: path(%s), error(%s)", output_path.c_str(), gw_retval_str(retval));
+                    return -1;
+                }
+            );
+        }
+    }
+    end = std::chrono::steady_clock::now();
+    duration_file = end - begin;
+
+    begin = std::chrono::steady_clock::now();
+    for(round=0; round<nb_rounds; round++){
+        fd = ::open(output_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | O_TRUNC, 0644);
+        if(unlikely(fd < 0)){
+            GW_WARN("failed to open output file: path(%s), error(%s)", output_path.c_str(), strerror(errno));
+            return -1;
+        }
+        if(unlikely(::write(fd, iostream_text.data(), iostream_text.size()) != static_cast<ssize_t>(iostream_text.size()))){
+            GW_WARN("failed to write output file: path(%s), error(%s)", output_path.c_str(), strerror(errno));
+            ::close(fd);
+            return -1;
+        }
+        ::close(fd);
+    }
+    end = std::chrono::steady_clock::now();
+    duration_write = end - begin;
+    ::unlink(output_path.c_str());
+
+    GW_LOG(
+        "sass format: cubin(%s), nb_kernels(%lu), nb_instructions(%lu), size(%.2f MB), text cache hits(%lu), misses(%lu)",
+        cubin_path.c_str(), list_kernel_def.size(), nb_instructions, static_cast<double>(nb_bytes) / MB(1), nb_hits, nb_misses
+    );
+    GW_LOG(
+        "sass format: iostreams(%.2f MB/s), formatter cold(%.2f MB/s), formatter warm(%.2f MB/s)",
+        __mb_per_sec(nb_bytes * nb_rounds, duration_iostream),
+        __mb_per_sec(nb_bytes, duration_cold),
+        nb_rounds > 1 ? __mb_per_sec(nb_bytes * (nb_rounds - 1), duration_warm) : 0.0
+    );
+    GW_LOG(
+        "sass format: dump to file(%.2f MB/s), raw write(%.2f MB/s)",
+        __mb_per_sec(nb_bytes * nb_rounds, duration_file),
+        __mb_per_sec(nb_bytes * nb_rounds, duration_write)
+    );
+
+    delete cubin;
+
+    return is_mismatched ? -1 : 0;
+}
@@ -0,0 +1,250 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+#include <unistd.h>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/trace_decoder.hpp"
+#include "scheduler/serve/database_ts_message.hpp"
+
+
+/*!
+ *  \brief  correctness and throughput test of GWTraceBufferDecoder on synthetic device trace
+ *          buffers, which checks the pc histogram, coalesced address ranges, accounting of
+ *          dropped records, rejection of malformed buffers and the spill file round trip,
+ *          and measures decoding throughput over the number of decoding threads
+ *  \note   usage: gwatch_bench_trace_decoder [nb_records] [max_nb_threads],
+ *          exits with failure if any check fails
+ */
+
+
+// number of distinct pcs within synthetic buffers
+#define GW_BENCH_TRACE_DECODER_NB_PCS       256
+
+// size of each synthetic memory access
+#define GW_BENCH_TRACE_DECODER_ACCESS_SIZE  4
+
+
+static uint64_t nb_errors = 0;
+
+
+static void __report_error(const char *what, uint64_t expected, uint64_t actual){
+    if(nb_errors++ < 16)
+        GW_WARN("check failed: %s, expected(%lu), actual(%lu)", what, expected, actual);
+}
+
+
+static inline uint64_t __pc_of(uint64_t i){
+    return (i % GW_BENCH_TRACE_DECODER_NB_PCS) * 16;
+}
+
+
+/*!
+ *  \brief  form a synthetic device trace buffer, records access contiguous addresses
+ *          starting from base_address
+ *  \param  buffer          the formed buffer
+ *  \param  nb_records      number of records within the buffer
+ *  \param  base_address    address accessed by the first record
+ *  \param  nb_overflowed   number of records claimed by the header beyond the capacity
+ */
+static void __form_buffer(std::vector<uint8_t>& buffer, uint64_t nb_records, uint64_t base_address, uint64_t nb_overflowed){
+    gw_trace_buffer_header_t *header = nullptr;
+    gw_trace_record_mem_access_t *records = nullptr;
+    uint64_t i = 0;
+
+    buffer.assign(sizeof(gw_trace_buffer_header_t) + nb_records * sizeof(gw_trace_record_mem_access_t), 0);
+    header = reinterpret_cast<gw_trace_buffer_header_t*>(buffer.data());
+    header->magic = GW_TRACE_BUFFER_MAGIC;
+    header->version = GW_TRACE_BUFFER_VERSION;
+    header->record_type = GW_TRACE_RECORD_MEM_ACCESS;
+    header->record_size = sizeof(gw_trace_record_mem_access_t);
+    header->nb_records = nb_records + nb_overflowed;
+    header->capacity = nb_records;
+
+    records = reinterpret_cast<gw_trace_record_mem_access_t*>(buffer.data() + sizeof(gw_trace_buffer_header_t));
+    for(i=0; i<nb_records; i++){
+        records[i].pc = __pc_of(i);
+        records[i].address = base_address + i * GW_BENCH_TRACE_DECODER_ACCESS_SIZE;
+        records[i].warp_id = static_cast<uint32_t>(i / 32);
+        records[i].size = GW_BENCH_TRACE_DECODER_ACCESS_SIZE;
+        records[i].flags = 0;
+    }
+}
+
+
+/*!
+ *  \brief  check aggregations of a decoder which is fed by buffers of __form_buffer
+ *  \param  decoder         the decoder to be checked
+ *  \param  nb_records      number of records within each buffer
+ *  \param  list_base       base addresses of the fed buffers, which are far apart
+ *  \param  nb_dropped      expected number of dropped records
+ */
+static void __check_aggregation(
+    const GWTraceBufferDecoder& decoder, uint64_t nb_records, const std::vector<uint64_t>& list_base, uint64_t nb_dropped
+){
+    uint64_t pc_idx = 0, expected_count = 0, nb_fed = nb_records * list_base.size();
+
+    if(decoder.get_nb_records() != nb_fed)
+        __report_error("wrong number of decoded records", nb_fed, decoder.get_nb_records());
+    if(decoder.get_nb_dropped_records() != nb_dropped)
+        __report_error("wrong number of dropped records", nb_dropped, decoder.get_nb_dropped_records());
+
+    // each buffer visits pcs round-robin
+    if(decoder.get_map_pc_count().size() != std::min<uint64_t>(nb_records, GW_BENCH_TRACE_DECODER_NB_PCS))
+        __report_error("wrong number of distinct pcs", GW_BENCH_TRACE_DECODER_NB_PCS, decoder.get_map_pc_count().size());
+    for(auto& [pc, count] : decoder.get_map_pc_count()){
+        pc_idx = pc / 16;
+        expected_count = (nb_records / GW_BENCH_TRACE_DECODER_NB_PCS + (pc_idx < nb_records % GW_BENCH_TRACE_DECODER_NB_PCS ? 1 : 0))
+                        * list_base.size();
+        if(pc % 16 != 0 or count != expected_count){
+            __report_error("wrong count of pc", expected_count, count);
+            break;
+        }
+    }
+
+    // each buffer is a single contiguous range
+    if(decoder.get_map_address_range().size() != list_base.size())
+        __report_error("wrong number of address ranges", list_base.size(), decoder.get_map_address_range().size());
+    for(uint64_t base : list_base){
+        auto it = decoder.get_map_address_range().find(base);
+        if(it == decoder.get_map_address_range().end()){
+            __report_error("address range is missed", base, 0);
+            continue;
+        }
+        if(it->second != base + nb_records * GW_BENCH_TRACE_DECODER_ACCESS_SIZE)
+            __report_error("wrong end of address range", base + nb_records * GW_BENCH_TRACE_DECODER_ACCESS_SIZE, it->second);
+    }
+}
+
+
+int main(int argc, char **argv){
+    gw_retval_t retval = GW_SUCCESS;
+    std::vector<uint8_t> buffer, malformed_buffer;
+    std::vector<uint64_t> list_base = { 0x7f0000000000ull, 0x7f0100000000ull };
+    gw_trace_columns_mem_access_t columns;
+    gw_trace_buffer_header_t *header = nullptr;
+    std::string spill_path = "";
+    uint64_t nb_records = 1 << 21, max_nb_threads = 8, nb_overflowed = 100, nb_threads = 0, i = 0, j = 0;
+    std::chrono::steady_clock::time_point begin, end;
+    double sec = 0;
+
+    if(argc > 1) nb_records = std::max<uint64_t>(std::stoul(argv[1]), 1);
+    if(argc > 2) max_nb_threads = std::max<uint64_t>(std::stoul(argv[2]), 1);
+
+    // decoding in memory, across the number of threads
+    for(nb_threads = 1; nb_threads <= max_nb_threads; nb_threads *= 2){
+        GWTraceBufferDecoder decoder(nb_threads, /* spill_path */ "", /* spill_threshold */ 0);
+
+        sec = 0;
+        for(uint64_t base : list_base){
+            __form_buffer(buffer, nb_records, base, nb_overflowed);
+            begin = std::chrono::steady_clock::now();
+            retval = decoder.feed(buffer.data(), buffer.size());
+            end = std::chrono::steady_clock::now();
+            sec += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1e9;
+            if(retval != GW_SUCCESS)
+                __report_error("failed to decode well-formed buffer", GW_SUCCESS, retval);
+        }
+        __check_aggregation(decoder, nb_records, list_base, nb_overflowed * list_base.size());
+
+        GW_LOG(
+            "decode: nb_threads(%lu), nb_records(%lu), %.2f M records/s, %.2f MB/s",
+            nb_threads, nb_records * list_base.size(),
+            sec > 0 ? static_cast<double>(nb_records * list_base.size()) / sec / 1e6 : 0.0,
+            sec > 0 ? static_cast<double>(nb_records * list_base.size() * sizeof(gw_trace_record_mem_access_t)) / MB(1) / sec : 0.0
+        );
+    }
+
+    // buffers copied partially drop records beyond the copy
+    {
+        GWTraceBufferDecoder decoder(1, /* spill_path */ "", /* spill_threshold */ 0);
+        __form_buffer(buffer, nb_records, list_base[0], 0);
+        retval = decoder.feed(buffer.data(), buffer.size() - sizeof(gw_trace_record_mem_access_t));
+        if(retval != GW_SUCCESS or decoder.get_nb_records() != nb_records - 1 or decoder.get_nb_dropped_records() != 1)
+            __report_error("wrong accounting of truncated buffer", nb_records - 1, decoder.get_nb_records());
+    }
+
+    // malformed buffers are rejected without touching the decoder
+    {
+        GWTraceBufferDecoder decoder(1, /* spill_path */ "", /* spill_threshold */ 0);
+
+        __form_buffer(malformed_buffer, 16, list_base[0], 0);
+        header = reinterpret_cast<gw_trace_buffer_header_t*>(malformed_buffer.data());
+
+        // NOTE(zhuobin): frames of time-series batches are also exchanged as raw buffers,
+        //                which must never be mistaken as trace buffers
+        header->magic = GW_TS_BATCH_FRAME_MAGIC;
+        if(decoder.feed(malformed_buffer.data(), malformed_buffer.size()) != GW_FAILED_INVALID_INPUT)
+            __report_error("time-series batch frame is decoded as trace buffer", GW_FAILED_INVALID_INPUT, 0);
+
+        header->magic = GW_TRACE_BUFFER_MAGIC;
+        header->version = GW_TRACE_BUFFER_VERSION + 1;
+        if(decoder.feed(malformed_buffer.data(), malformed_buffer.size()) != GW_FAILED_INVALID_INPUT)
+            __report_error("buffer of mismatched version is decoded", GW_FAILED_INVALID_INPUT, 0);
+
+        header->version = GW_TRACE_BUFFER_VERSION;
+        header->record_size = sizeof(gw_trace_record_mem_access_t) + 8;
+        if(decoder.feed(malformed_buffer.data(), malformed_buffer.size()) == GW_SUCCESS)
+            __report_error("buffer of mismatched record size is decoded", GW_FAILED_NOT_IMPLEMENTAED, GW_SUCCESS);
+
+        if(decoder.feed(malformed_buffer.data(), sizeof(gw_trace_buffer_header_t) - 1) != GW_FAILED_INVALID_INPUT)
+            __report_error("buffer smaller than header is decoded", GW_FAILED_INVALID_INPUT, 0);
+
+        if(decoder.get_nb_records() != 0)
+            __report_error("malformed buffers are decoded", 0, decoder.get_nb_records());
+    }
+
+    // spilled columns are loaded back in the order of feeding
+    spill_path = (std::filesystem::temp_directory_path() / ("gwatch_bench_trace_decoder_" + std::to_string(getpid()) + ".bin")).string();
+    {
+        GWTraceBufferDecoder decoder(max_nb_threads, spill_path, /* spill_threshold */ std::max<uint64_t>(nb_records / 3, 1));
+
+        for(uint64_t base : list_base){
+            __form_buffer(buffer, nb_records, base, 0);
+            if(decoder.feed(buffer.data(), buffer.size()) != GW_SUCCESS)
+                __report_error("failed to decode well-formed buffer with spilling", GW_SUCCESS, 1);
+        }
+        if(decoder.flush() != GW_SUCCESS)
+            __report_error("failed to flush spill file", GW_SUCCESS, 1);
+        __check_aggregation(decoder, nb_records, list_base, 0);
+
+        begin = std::chrono::steady_clock::now();
+        retval = GWTraceBufferDecoder::load_spill(spill_path, columns);
+        end = std::chrono::steady_clock::now();
+        if(retval != GW_SUCCESS or columns.size() != nb_records * list_base.size()){
+            __report_error("wrong number of records in spill file", nb_records * list_base.size(), columns.size());
+        } else {
+            for(j=0; j<list_base.size(); j++){
+                for(i=0; i<nb_records; i++){
+                    if(
+                        columns.list_pc[j * nb_records + i] != __pc_of(i)
+                        or columns.list_address[j * nb_records + i] != list_base[j] + i * GW_BENCH_TRACE_DECODER_ACCESS_SIZE
+                        or columns.list_warp_id[j * nb_records + i] != i / 32
+                        or columns.list_size[j * nb_records + i] != GW_BENCH_TRACE_DECODER_ACCESS_SIZE
+                    ){
+                        __report_error("spilled record mismatches", i, j * nb_records + i);
+                        break;
+                    }
+                }
+            }
+        }
+        GW_LOG(
+            "load spill: nb_records(%lu), %.2f M records/s",
+            columns.size(),
+            static_cast<double>(columns.size()) / (std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1e9) / 1e6
+        );
+    }
+    std::filesystem::remove(spill_path);
+
+    if(nb_errors > 0){
+        GW_WARN("trace decoder check failed: nb_errors(%lu)", nb_errors);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,259 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/database_timeseries.hpp"
+#include "scheduler/serve/database_ts_message.hpp"
+
+
+/*!
+ *  \brief  loopback throughput test of batches of timeseries samples, a sender thread packs
+ *          event-like samples into binary frames as the capsule does, and the receiver unpacks
+ *          them and appends them to a GWUtilTimeSeriesDatabase with a subscriber as the scheduler
+ *          does, frames go through a local socket pair; all samples are checked to arrive intact,
+ *          and moving received batches is measured against copying them through json
+ *  \note   usage: gwatch_bench_ts_batch [nb_samples] [batch_size] [encoding: compact|compact_lz4],
+ *          exits with failure if any check fails
+ */
+
+
+#define GW_BENCH_TS_BATCH_URI   "/capsule/bench/event"
+
+
+static uint64_t nb_errors = 0;
+
+
+static void __report_error(const char *what, uint64_t index){
+    if(nb_errors++ < 16)
+        GW_WARN("check failed: %s, index(%lu)", what, index);
+}
+
+
+static const char* __list_names[] = { "kernel_launch", "memcpy_h2d", "memcpy_d2h", "memset", "sync" };
+
+
+// timestamp and payload of each sample are derived from its index, so that the receiver could check them
+static inline uint64_t __timestamp_of(uint64_t index){
+    return 0x100000000ull + index * 1700 + (index % 7) * 13;
+}
+
+static inline void __write_payload(GWUtilCompactJson::Writer& writer, uint64_t index){
+    writer.begin_object(5);
+    writer.key("type_id");
+    writer.write_uint(index % 5);
+    writer.key("name");
+    writer.write_string(__list_names[index % 5]);
+    writer.key("device_id");
+    writer.write_uint(index % 4);
+    writer.key("begin_tsc");
+    writer.write_uint(__timestamp_of(index));
+    writer.key("end_tsc");
+    writer.write_uint(__timestamp_of(index) + 900 + (index % 11));
+    writer.end();
+}
+
+static inline bool __is_payload_intact(const nlohmann::json& payload, uint64_t index){
+    return payload.is_object() and payload.size() == 5
+        and payload["type_id"] == index % 5
+        and payload["name"] == __list_names[index % 5]
+        and payload["device_id"] == index % 4
+        and payload["begin_tsc"] == __timestamp_of(index)
+        and payload["end_tsc"] == __timestamp_of(index) + 900 + (index % 11);
+}
+
+
+static gw_retval_t __write_all(int fd, const void* data, uint64_t size){
+    const uint8_t *cursor = reinterpret_cast<const uint8_t*>(data);
+    ssize_t nb_written = 0;
+
+    while(size > 0){
+        nb_written = ::write(fd, cursor, size);
+        if(unlikely(nb_written <= 0)){
+            if(nb_written < 0 and errno == EINTR)
+                continue;
+            return GW_FAILED;
+        }
+        cursor += nb_written;
+        size -= nb_written;
+    }
+    return GW_SUCCESS;
+}
+
+
+static gw_retval_t __read_all(int fd, void* data, uint64_t size){
+    uint8_t *cursor = reinterpret_cast<uint8_t*>(data);
+    ssize_t nb_read = 0;
+
+    while(size > 0){
+        nb_read = ::read(fd, cursor, size);
+        if(unlikely(nb_read <= 0)){
+            if(nb_read < 0 and errno == EINTR)
+                continue;
+            return GW_FAILED;
+        }
+        cursor += nb_read;
+        size -= nb_read;
+    }
+    return GW_SUCCESS;
+}
+
+
+int main(int argc, char **argv){
+    GWUtilTimeSeriesDatabase db;
+    GWInternalMessagePayload_Common_DB_TS_BatchWrite payload, payload_copy;
+    gw_ts_batch_encoding_t encoding = GW_TS_BATCH_ENCODING_COMPACT_LZ4;
+    std::vector<GWUtilTimeSeriesSample> list_queried;
+    std::vector<std::string> list_frames;
+    std::string frame = "", encoding_str = "compact_lz4";
+    std::thread sender;
+    std::atomic<uint64_t> nb_sent_bytes = 0;
+    std::chrono::steady_clock::time_point begin, end;
+    double loopback_sec = 0, move_ns = 0, json_copy_ns = 0;
+    uint64_t nb_samples = 1000000, batch_size = 1024, nb_received = 0, nb_notified = 0, frame_size = 0, i = 0;
+    int fds[2] = { -1, -1 };
+
+    if(argc > 1) nb_samples = std::max<uint64_t>(std::stoul(argv[1]), 1);
+    if(argc > 2) batch_size = std::max<uint64_t>(std::stoul(argv[2]), 1);
+    if(argc > 3) encoding_str = argv[3];
+    if(encoding_str == "compact"){
+        encoding = GW_TS_BATCH_ENCODING_COMPACT;
+    } else if(encoding_str != "compact_lz4"){
+        GW_WARN("usage: %s [nb_samples] [batch_size] [encoding: compact|compact_lz4]", argv[0]);
+        return -1;
+    }
+
+    GW_ASSERT(db.subscribe(
+        &db, "bench", GW_BENCH_TS_BATCH_URI,
+        [&](gw_db_subscribe_context_t*, const nlohmann::json new_val, const nlohmann::json) -> gw_retval_t {
+            if(unlikely(!new_val.contains("index") or new_val["index"] != nb_notified))
+                __report_error("subscriber is notified out of order", nb_notified);
+            nb_notified += 1;
+            return GW_SUCCESS;
+        }
+    ) == GW_SUCCESS);
+
+    if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0){
+        GW_WARN("failed to create socket pair: %s", strerror(errno));
+        return -1;
+    }
+
+    begin = std::chrono::steady_clock::now();
+
+    // sender, as the event reporter of the capsule
+    sender = std::thread([&](){
+        std::string batch_frame = "";
+        uint64_t index = 0, size = 0;
+
+        while(index < nb_samples){
+            GWInternalMessagePayload_Common_DB_TS_BatchWrite batch;
+            batch.uri = GW_BENCH_TS_BATCH_URI;
+            batch.encoding = encoding;
+            for(; index < nb_samples and batch.get_nb_samples() < batch_size; index++){
+                __write_payload(batch.begin_sample(index, __timestamp_of(index)), index);
+                batch.end_sample();
+            }
+            batch.serialize_frame(batch_frame);
+            size = batch_frame.size();
+            if(unlikely(
+                __write_all(fds[0], &size, sizeof(uint64_t)) != GW_SUCCESS
+                or __write_all(fds[0], batch_frame.data(), size) != GW_SUCCESS
+            )){
+                GW_WARN("failed to send frame: %s", strerror(errno));
+                break;
+            }
+            nb_sent_bytes.fetch_add(size);
+        }
+        ::close(fds[0]);
+    });
+
+    // receiver, as the scheduler
+    while(__read_all(fds[1], &frame_size, sizeof(uint64_t)) == GW_SUCCESS){
+        frame.resize(frame_size);
+        if(unlikely(__read_all(fds[1], frame.data(), frame_size) != GW_SUCCESS)){
+            __report_error("frame is truncated", nb_received);
+            break;
+        }
+        if(unlikely(payload.deserialize_frame(reinterpret_cast<const uint8_t*>(frame.data()), frame.size()) != GW_SUCCESS)){
+            __report_error("failed to unpack frame", nb_received);
+            break;
+        }
+        payload_copy.move_from(payload);
+        nb_received += payload_copy.list_samples.size();
+        if(unlikely(db.append_batch(payload_copy.uri, payload_copy.list_samples) != GW_SUCCESS)){
+            __report_error("failed to append batch", nb_received);
+            break;
+        }
+        list_frames.push_back(std::move(frame));
+    }
+    end = std::chrono::steady_clock::now();
+    sender.join();
+    ::close(fds[1]);
+    loopback_sec = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1e9;
+
+    // all samples arrive in order and intact
+    if(nb_received != nb_samples)
+        __report_error("wrong number of received samples", nb_received);
+    if(nb_notified != nb_samples)
+        __report_error("wrong number of notified samples", nb_notified);
+    GW_ASSERT(db.query(GW_BENCH_TS_BATCH_URI, list_queried) == GW_SUCCESS);
+    if(list_queried.size() != nb_samples)
+        __report_error("wrong number of stored samples", list_queried.size());
+    for(i=0; i<list_queried.size(); i++){
+        if(unlikely(
+            list_queried[i].index != i
+            or list_queried[i].timestamp != __timestamp_of(i)
+            or !__is_payload_intact(list_queried[i].payload, i)
+        )){
+            __report_error("stored sample is corrupted", i);
+        }
+    }
+
+    // received batches are handed to the worker by moving, against copying through json
+    for(const std::string& received_frame : list_frames){
+        GW_ASSERT(payload.deserialize_frame(reinterpret_cast<const uint8_t*>(received_frame.data()), received_frame.size()) == GW_SUCCESS);
+        payload_copy.list_samples.clear();
+        begin = std::chrono::steady_clock::now();
+        payload_copy.deserialize(payload.serialize());
+        end = std::chrono::steady_clock::now();
+        json_copy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+
+        // the destination is emptied first, so that only handing over is measured
+        payload_copy.list_samples.clear();
+        begin = std::chrono::steady_clock::now();
+        payload_copy.move_from(payload);
+        end = std::chrono::steady_clock::now();
+        move_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    }
+
+    GW_LOG(
+        "ts batch: nb_samples(%lu), batch_size(%lu), encoding(%s), nb_frames(%lu), size(%.2f B/sample)",
+        nb_samples, batch_size, encoding_str.c_str(), list_frames.size(),
+        nb_samples > 0 ? static_cast<double>(nb_sent_bytes.load()) / nb_samples : 0.0
+    );
+    GW_LOG(
+        "ts batch: loopback %.2f K samples/s, %.2f MB/s on the wire",
+        loopback_sec > 0 ? nb_samples / loopback_sec / 1e3 : 0.0,
+        loopback_sec > 0 ? nb_sent_bytes.load() / loopback_sec / MB(1) : 0.0
+    );
+    GW_LOG(
+        "ts batch: handing over a batch by move(%.2f us), by json copy(%.2f us)",
+        list_frames.size() > 0 ? move_ns / list_frames.size() / 1e3 : 0.0,
+        list_frames.size() > 0 ? json_copy_ns / list_frames.size() / 1e3 : 0.0
+    );
+
+    if(nb_errors > 0){
+        GW_WARN("loopback test of timeseries batches failed: nb_errors(%lu)", nb_errors);
+        return -1;
+    }
+    return 0;
+}
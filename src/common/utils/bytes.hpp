@@ -5,6 +5,8 @@
 #include <string>
 #include <array>
 #include <cassert>
+#include <fstream>
+#include <algorithm>
 
 #include <string.h>
 
@@ -483,6 +485,58 @@ class GWUtilBytes {
     }
 
 
+    /*!
+     *  \brief  append an unsigned LEB128 (varint) to a byte sequence
+     *  \param  bytes   byte sequence to be appended
+     *  \param  value   value to be encoded
+     */
+    static inline void write_uleb128(std::vector<uint8_t>& bytes, uint64_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+
+    /*!
+     *  \brief  read an unsigned LEB128 (varint) within the given bound
+     *  \param  data    cursor of the byte sequence, moved after the varint
+     *  \param  end     end of the byte sequence
+     *  \param  value   decoded value
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if truncated or overlong
+     */
+    static inline gw_retval_t read_uleb128(const uint8_t **data, const uint8_t *end, uint64_t& value) {
+        uint64_t shift = 0;
+        uint8_t byte = 0;
+
+        value = 0;
+        do {
+            if (unlikely(*data >= end || shift >= 64))
+                return GW_FAILED_INVALID_INPUT;
+            byte = **data;
+            (*data)++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        return GW_SUCCESS;
+    }
+
+
+    /*!
+     *  \brief  zigzag encoding, which maps signed value of small magnitude to small unsigned value
+     *  \param  value   value to be encoded / decoded
+     *  \return encoded / decoded value
+     */
+    static inline uint64_t zigzag_encode(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+    static inline int64_t zigzag_decode(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+
     static int64_t read_sleb128(const uint8_t **data) {
         int64_t result = 0;
         int shift = 0;
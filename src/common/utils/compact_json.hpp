@@ -0,0 +1,728 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/bytes.hpp"
+
+
+// version of the compact json stream, bump when the layout changes
+#define GW_UTIL_COMPACT_JSON_VERSION    1
+
+
+/*!
+ *  \brief  compact binary encoding of json values for streams of similar records (e.g., events),
+ *          which is self-contained so that each encoded stream could be decoded independently:
+ *          (1) strings (including object keys) are interned into a dictionary on first appearance,
+ *              new strings are front-coded against the previous new string, later appearances
+ *              only carry the index;
+ *          (2) integers are encoded as zigzag varints of delta-of-delta against the previous
+ *              integer under the same object key, so that monotonic ids and TSC ticks of
+ *              successive records shrink to a few bytes
+ */
+class GWUtilCompactJson {
+ public:
+    /*!
+     *  \brief  encode a json value
+     *  \param  value   the json value to be encoded
+     *  \param  output  encoded bytes, overwritten
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if the value contains binary
+     */
+    static gw_retval_t encode(const nlohmann::json& value, std::vector<uint8_t>& output){
+        gw_retval_t retval = GW_SUCCESS;
+        __gw_context_t context;
+
+        output.clear();
+        output.push_back(GW_UTIL_COMPACT_JSON_VERSION);
+        retval = __encode_value(value, context, 0, output);
+
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  decode a json value
+     *  \param  input       encoded bytes
+     *  \param  input_size  number of encoded bytes
+     *  \param  value       the decoded json value
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed input
+     */
+    static gw_retval_t decode(const uint8_t* input, uint64_t input_size, nlohmann::json& value){
+        gw_retval_t retval = GW_SUCCESS;
+        __gw_context_t context;
+        const uint8_t *cursor = input, *end = input + input_size;
+
+        if(unlikely(input_size == 0 or input[0] != GW_UTIL_COMPACT_JSON_VERSION)){
+            GW_WARN("failed to decode compact json, unknown version");
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        cursor += 1;
+
+        retval = __decode_value(&cursor, end, context, 0, value, 0);
+        if(unlikely(retval != GW_SUCCESS))
+            goto exit;
+        if(unlikely(cursor != end))
+            retval = GW_FAILED_INVALID_INPUT;
+
+    exit:
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  decode a sequence of json values, as produced by GWUtilCompactJson::Writer
+     *  \param  input       encoded bytes
+     *  \param  input_size  number of encoded bytes
+     *  \param  list_value  the decoded json values, as a json array
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed input
+     */
+    static gw_retval_t decode_sequence(const uint8_t* input, uint64_t input_size, nlohmann::json& list_value){
+        gw_retval_t retval = GW_SUCCESS;
+        __gw_context_t context;
+        const uint8_t *cursor = input, *end = input + input_size;
+
+        list_value = nlohmann::json::array();
+        if(unlikely(input_size == 0 or input[0] != GW_UTIL_COMPACT_JSON_VERSION)){
+            GW_WARN("failed to decode compact json, unknown version");
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        cursor += 1;
+
+        while(cursor < end){
+            list_value.push_back(nullptr);
+            retval = __decode_value(&cursor, end, context, 0, list_value.back(), 0);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+        }
+
+    exit:
+        return retval;
+    }
+
+ private:
+    /*!
+     *  \brief  tag of an encoded value
+     */
+    enum __gw_tag_t : uint8_t {
+        __GW_TAG_NULL = 0,
+        __GW_TAG_FALSE,
+        __GW_TAG_TRUE,
+        __GW_TAG_UINT,
+        __GW_TAG_INT,
+        __GW_TAG_FLOAT,
+        __GW_TAG_STRING_NEW,
+        __GW_TAG_STRING_REF,
+        __GW_TAG_ARRAY,
+        __GW_TAG_OBJECT
+    };
+
+
+    /*!
+     *  \brief  delta-of-delta state of integers under an object key
+     */
+    typedef struct __gw_integer_state {
+        uint64_t prev = 0;
+        uint64_t prev_delta = 0;
+    } __gw_integer_state_t;
+
+
+    /*!
+     *  \brief  coding context shared by the encoder and the decoder
+     */
+    typedef struct __gw_context {
+        // string dictionary: <string, index> for encoding, list of strings for decoding
+        std::unordered_map<std::string, uint64_t> map_string_index;
+        std::vector<std::string> list_string;
+
+        // last newly interned string, for front coding
+        std::string last_new_string = "";
+
+        // integer state of each object key, indexed by (1 + string index of the key),
+        // and 0 is for integers outside any object
+        std::vector<__gw_integer_state_t> list_integer_state = std::vector<__gw_integer_state_t>(1);
+    } __gw_context_t;
+
+    // maximum depth of nested values accepted by the decoder
+    static constexpr uint64_t __GW_MAX_DEPTH = 256;
+
+
+    static inline uint64_t __shared_prefix_len(const std::string& a, const std::string& b){
+        uint64_t i = 0, len = std::min(a.size(), b.size());
+        while(i < len and a[i] == b[i])
+            i++;
+        return i;
+    }
+
+
+    /*!
+     *  \brief  encode a string into the dictionary (if not exist)
+     *  \return index of the string within the dictionary
+     */
+    static uint64_t __encode_string(const std::string& str, __gw_context_t& context, std::vector<uint8_t>& output){
+        uint64_t index = 0, prefix_len = 0;
+
+        auto it = context.map_string_index.find(str);
+        if(it != context.map_string_index.end()){
+            output.push_back(__GW_TAG_STRING_REF);
+            GWUtilBytes::write_uleb128(output, it->second);
+            return it->second;
+        }
+
+        index = context.map_string_index.size();
+        context.map_string_index.emplace(str, index);
+        context.list_integer_state.emplace_back();
+
+        prefix_len = __shared_prefix_len(context.last_new_string, str);
+        output.push_back(__GW_TAG_STRING_NEW);
+        GWUtilBytes::write_uleb128(output, prefix_len);
+        GWUtilBytes::write_uleb128(output, str.size() - prefix_len);
+        output.insert(output.end(), str.begin() + prefix_len, str.end());
+        context.last_new_string = str;
+
+        return index;
+    }
+
+
+    static gw_retval_t __decode_string(
+        const uint8_t **cursor, const uint8_t *end, __gw_context_t& context, uint8_t tag, uint64_t& index
+    ){
+        gw_retval_t retval = GW_SUCCESS;
+        uint64_t prefix_len = 0, suffix_len = 0;
+        std::string str;
+
+        if(tag == __GW_TAG_STRING_REF){
+            retval = GWUtilBytes::read_uleb128(cursor, end, index);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            if(unlikely(index >= context.list_string.size()))
+                retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+
+        retval = GWUtilBytes::read_uleb128(cursor, end, prefix_len);
+        if(unlikely(retval != GW_SUCCESS))
+            goto exit;
+        retval = GWUtilBytes::read_uleb128(cursor, end, suffix_len);
+        if(unlikely(retval != GW_SUCCESS))
+            goto exit;
+        if(unlikely(prefix_len > context.last_new_string.size() or suffix_len > (uint64_t)(end - *cursor))){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        str = context.last_new_string.substr(0, prefix_len);
+        str.append(reinterpret_cast<const char*>(*cursor), suffix_len);
+        *cursor += suffix_len;
+
+        index = context.list_string.size();
+        context.list_string.push_back(str);
+        context.list_integer_state.emplace_back();
+        context.last_new_string = std::move(str);
+
+    exit:
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  encode an integer (after its tag) as delta-of-delta against the previous
+     *          integer under the same key slot
+     */
+    static inline void __encode_integer(
+        uint64_t integer, __gw_context_t& context, uint64_t key_slot, std::vector<uint8_t>& output
+    ){
+        __gw_integer_state_t *state = &context.list_integer_state[key_slot];
+        uint64_t delta = integer - state->prev;
+
+        GWUtilBytes::write_uleb128(output, GWUtilBytes::zigzag_encode(static_cast<int64_t>(delta - state->prev_delta)));
+        state->prev = integer;
+        state->prev_delta = delta;
+    }
+
+
+    static inline void __encode_float(double number_float, std::vector<uint8_t>& output){
+        uint8_t float_bytes[sizeof(double)];
+
+        output.push_back(__GW_TAG_FLOAT);
+        std::memcpy(float_bytes, &number_float, sizeof(double));
+        output.insert(output.end(), float_bytes, float_bytes + sizeof(double));
+    }
+
+
+    static gw_retval_t __encode_value(
+        const nlohmann::json& value, __gw_context_t& context, uint64_t key_slot, std::vector<uint8_t>& output
+    ){
+        gw_retval_t retval = GW_SUCCESS;
+        uint64_t integer = 0, key_index = 0;
+
+        switch(value.type()){
+        case nlohmann::json::value_t::null:
+        case nlohmann::json::value_t::discarded:
+            output.push_back(__GW_TAG_NULL);
+            break;
+
+        case nlohmann::json::value_t::boolean:
+            output.push_back(value.get<bool>() ? __GW_TAG_TRUE : __GW_TAG_FALSE);
+            break;
+
+        case nlohmann::json::value_t::number_unsigned:
+        case nlohmann::json::value_t::number_integer:
+            if(value.type() == nlohmann::json::value_t::number_unsigned){
+                output.push_back(__GW_TAG_UINT);
+                integer = value.get<uint64_t>();
+            } else {
+                output.push_back(__GW_TAG_INT);
+                integer = static_cast<uint64_t>(value.get<int64_t>());
+            }
+            __encode_integer(integer, context, key_slot, output);
+            break;
+
+        case nlohmann::json::value_t::number_float:
+            __encode_float(value.get<double>(), output);
+            break;
+
+        case nlohmann::json::value_t::string:
+            __encode_string(value.get_ref<const std::string&>(), context, output);
+            break;
+
+        case nlohmann::json::value_t::array:
+            output.push_back(__GW_TAG_ARRAY);
+            GWUtilBytes::write_uleb128(output, value.size());
+            for(auto& element : value){
+                retval = __encode_value(element, context, key_slot, output);
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+            }
+            break;
+
+        case nlohmann::json::value_t::object:
+            output.push_back(__GW_TAG_OBJECT);
+            GWUtilBytes::write_uleb128(output, value.size());
+            for(auto& [key, element] : value.items()){
+                key_index = __encode_string(key, context, output);
+                retval = __encode_value(element, context, key_index + 1, output);
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+            }
+            break;
+
+        default:
+            GW_WARN("failed to encode compact json, unsupported type: type(%s)", value.type_name());
+            retval = GW_FAILED_INVALID_INPUT;
+        }
+
+    exit:
+        return retval;
+    }
+
+
+    static gw_retval_t __decode_value(
+        const uint8_t **cursor, const uint8_t *end, __gw_context_t& context, uint64_t key_slot,
+        nlohmann::json& value, uint64_t depth
+    ){
+        gw_retval_t retval = GW_SUCCESS;
+        __gw_integer_state_t *state = nullptr;
+        uint64_t zigzag = 0, delta = 0, integer = 0, nb_elements = 0, index = 0, i = 0;
+        double number_float = 0;
+        uint8_t tag = 0;
+
+        if(unlikely(*cursor >= end or depth > __GW_MAX_DEPTH)){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        tag = **cursor;
+        *cursor += 1;
+
+        switch(tag){
+        case __GW_TAG_NULL:
+            value = nullptr;
+            break;
+
+        case __GW_TAG_FALSE:
+        case __GW_TAG_TRUE:
+            value = (tag == __GW_TAG_TRUE);
+            break;
+
+        case __GW_TAG_UINT:
+        case __GW_TAG_INT:
+            retval = GWUtilBytes::read_uleb128(cursor, end, zigzag);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            state = &context.list_integer_state[key_slot];
+            delta = state->prev_delta + static_cast<uint64_t>(GWUtilBytes::zigzag_decode(zigzag));
+            integer = state->prev + delta;
+            state->prev = integer;
+            state->prev_delta = delta;
+            if(tag == __GW_TAG_UINT)
+                value = integer;
+            else
+                value = static_cast<int64_t>(integer);
+            break;
+
+        case __GW_TAG_FLOAT:
+            if(unlikely((uint64_t)(end - *cursor) < sizeof(double))){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            std::memcpy(&number_float, *cursor, sizeof(double));
+            *cursor += sizeof(double);
+            value = number_float;
+            break;
+
+        case __GW_TAG_STRING_NEW:
+        case __GW_TAG_STRING_REF:
+            retval = __decode_string(cursor, end, context, tag, index);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            value = context.list_string[index];
+            break;
+
+        case __GW_TAG_ARRAY:
+            retval = GWUtilBytes::read_uleb128(cursor, end, nb_elements);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            value = nlohmann::json::array();
+            for(i=0; i<nb_elements; i++){
+                value.push_back(nullptr);
+                retval = __decode_value(cursor, end, context, key_slot, value.back(), depth + 1);
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+            }
+            break;
+
+        case __GW_TAG_OBJECT:
+            retval = GWUtilBytes::read_uleb128(cursor, end, nb_elements);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            value = nlohmann::json::object();
+            for(i=0; i<nb_elements; i++){
+                if(unlikely(*cursor >= end)){
+                    retval = GW_FAILED_INVALID_INPUT;
+                    goto exit;
+                }
+                tag = **cursor;
+                *cursor += 1;
+                if(unlikely(tag != __GW_TAG_STRING_NEW and tag != __GW_TAG_STRING_REF)){
+                    retval = GW_FAILED_INVALID_INPUT;
+                    goto exit;
+                }
+                retval = __decode_string(cursor, end, context, tag, index);
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+                retval = __decode_value(cursor, end, context, index + 1, value[context.list_string[index]], depth + 1);
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+            }
+            break;
+
+        default:
+            retval = GW_FAILED_INVALID_INPUT;
+        }
+
+    exit:
+        return retval;
+    }
+
+
+ public:
+    /*!
+     *  \brief  streaming encoder, which produces the same stream as encode() while records are
+     *          written field by field, so that records never need to be built as json values;
+     *          the stream is a sequence of top-level values, to be decoded by decode_sequence()
+     *  \note   containers are opened with their number of elements, and closed by end()
+     */
+    class Writer {
+     public:
+        Writer(){ this->reset(); }
+        ~Writer() = default;
+
+
+        /*!
+         *  \brief  drop all written values, and reset the dictionary and integer states
+         */
+        inline void reset(){
+            this->_output.clear();
+            this->_output.push_back(GW_UTIL_COMPACT_JSON_VERSION);
+            this->_context = __gw_context_t();
+            this->_key_slot = 0;
+            this->_list_key_slot.clear();
+            this->_nb_values = 0;
+        }
+
+
+        /*!
+         *  \brief  open an object / array
+         *  \param  nb_elements number of fields / elements to be written before end()
+         */
+        inline void begin_object(uint64_t nb_elements){ this->__begin(__GW_TAG_OBJECT, nb_elements); }
+        inline void begin_array(uint64_t nb_elements){ this->__begin(__GW_TAG_ARRAY, nb_elements); }
+
+
+        /*!
+         *  \brief  close the innermost object / array
+         */
+        inline void end(){
+            GW_ASSERT(!this->_list_key_slot.empty());
+            this->_key_slot = this->_list_key_slot.back();
+            this->_list_key_slot.pop_back();
+            this->__finish_value();
+        }
+
+
+        /*!
+         *  \brief  write the key of the next field within an object
+         *  \param  key the key
+         */
+        inline void key(const std::string& key){
+            this->_key_slot = __encode_string(key, this->_context, this->_output) + 1;
+        }
+
+
+        /*!
+         *  \brief  write a scalar value
+         *  \param  value   the value
+         */
+        inline void write_null(){
+            this->_output.push_back(__GW_TAG_NULL);
+            this->__finish_value();
+        }
+        inline void write_bool(bool value){
+            this->_output.push_back(value ? __GW_TAG_TRUE : __GW_TAG_FALSE);
+            this->__finish_value();
+        }
+        inline void write_uint(uint64_t value){
+            this->_output.push_back(__GW_TAG_UINT);
+            __encode_integer(value, this->_context, this->_key_slot, this->_output);
+            this->__finish_value();
+        }
+        inline void write_int(int64_t value){
+            this->_output.push_back(__GW_TAG_INT);
+            __encode_integer(static_cast<uint64_t>(value), this->_context, this->_key_slot, this->_output);
+            this->__finish_value();
+        }
+        inline void write_float(double value){
+            __encode_float(value, this->_output);
+            this->__finish_value();
+        }
+        inline void write_string(const std::string& value){
+            __encode_string(value, this->_context, this->_output);
+            this->__finish_value();
+        }
+
+
+        /*!
+         *  \brief  write a json value
+         *  \param  value   the value
+         *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if the value contains binary
+         */
+        inline gw_retval_t write_json(const nlohmann::json& value){
+            gw_retval_t retval = __encode_value(value, this->_context, this->_key_slot, this->_output);
+            this->__finish_value();
+            return retval;
+        }
+
+
+        /*!
+         *  \brief  obtain the encoded stream
+         *  \return the encoded bytes
+         */
+        inline const std::vector<uint8_t>& get_bytes() const { return this->_output; }
+
+
+        /*!
+         *  \brief  obtain the number of complete top-level values within the stream
+         *  \return number of top-level values
+         */
+        inline uint64_t get_nb_values() const { return this->_nb_values; }
+
+
+     private:
+        inline void __begin(uint8_t tag, uint64_t nb_elements){
+            this->_output.push_back(tag);
+            GWUtilBytes::write_uleb128(this->_output, nb_elements);
+            this->_list_key_slot.push_back(this->_key_slot);
+        }
+
+        inline void __finish_value(){
+            if(this->_list_key_slot.empty())
+                this->_nb_values += 1;
+        }
+
+        // encoded stream
+        std::vector<uint8_t> _output;
+
+        // dictionary and integer states
+        __gw_context_t _context;
+
+        // key slot of the value to be written, and of each opened container
+        uint64_t _key_slot = 0;
+        std::vector<uint64_t> _list_key_slot;
+
+        // number of complete top-level values
+        uint64_t _nb_values = 0;
+    };
+
+
+    /*!
+     *  \brief  streaming decoder of the stream produced by Writer, which reads records field by
+     *          field, so that known fields are decoded straight into their destination instead
+     *          of building each record as a json value first
+     *  \note   containers are opened with their number of elements, and closed by end()
+     */
+    class Reader {
+     public:
+        /*!
+         *  \brief  constructor
+         *  \param  input       encoded bytes, which must outlive the reader
+         *  \param  input_size  number of encoded bytes
+         */
+        Reader(const uint8_t* input, uint64_t input_size)
+            : _cursor(input), _end(input + input_size) {}
+        ~Reader() = default;
+
+
+        /*!
+         *  \brief  check the version of the stream, must be called before reading any value
+         *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for unknown version
+         */
+        inline gw_retval_t open(){
+            if(unlikely(this->_cursor >= this->_end or *this->_cursor != GW_UTIL_COMPACT_JSON_VERSION)){
+                GW_WARN("failed to decode compact json, unknown version");
+                return GW_FAILED_INVALID_INPUT;
+            }
+            this->_cursor += 1;
+            return GW_SUCCESS;
+        }
+
+
+        /*!
+         *  \brief  obtain whether all values within the stream are read
+         *  \return whether all values are read
+         */
+        inline bool is_end() const { return this->_cursor >= this->_end; }
+
+
+        /*!
+         *  \brief  open an object
+         *  \param  nb_elements number of fields to be read before end()
+         *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if the next value isn't an object
+         */
+        inline gw_retval_t begin_object(uint64_t& nb_elements){
+            gw_retval_t retval = GW_SUCCESS;
+
+            if(unlikely(
+                this->_cursor >= this->_end or *this->_cursor != __GW_TAG_OBJECT
+                or this->_list_key_slot.size() >= __GW_MAX_DEPTH
+            )){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            this->_cursor += 1;
+            retval = GWUtilBytes::read_uleb128(&this->_cursor, this->_end, nb_elements);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            this->_list_key_slot.push_back(this->_key_slot);
+
+        exit:
+            return retval;
+        }
+
+
+        /*!
+         *  \brief  close the innermost object
+         */
+        inline void end(){
+            GW_ASSERT(!this->_list_key_slot.empty());
+            this->_key_slot = this->_list_key_slot.back();
+            this->_list_key_slot.pop_back();
+        }
+
+
+        /*!
+         *  \brief  read the key of the next field within an object
+         *  \param  key the key, which stays valid until the reader is destroyed
+         *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed input
+         */
+        inline gw_retval_t key(const std::string*& key){
+            gw_retval_t retval = GW_SUCCESS;
+            uint64_t index = 0;
+            uint8_t tag = 0;
+
+            if(unlikely(this->_cursor >= this->_end)){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            tag = *this->_cursor;
+            this->_cursor += 1;
+            if(unlikely(tag != __GW_TAG_STRING_NEW and tag != __GW_TAG_STRING_REF)){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            retval = __decode_string(&this->_cursor, this->_end, this->_context, tag, index);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            this->_key_slot = index + 1;
+            key = &this->_context.list_string[index];
+
+        exit:
+            return retval;
+        }
+
+
+        /*!
+         *  \brief  read an integer value
+         *  \param  value   the value
+         *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if the next value isn't an integer
+         */
+        inline gw_retval_t read_uint(uint64_t& value){
+            gw_retval_t retval = GW_SUCCESS;
+            nlohmann::json integer;
+
+            if(unlikely(
+                this->_cursor >= this->_end
+                or (*this->_cursor != __GW_TAG_UINT and *this->_cursor != __GW_TAG_INT)
+            )){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            retval = this->read_json(integer);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            value = integer.is_number_unsigned() ? integer.get<uint64_t>() : static_cast<uint64_t>(integer.get<int64_t>());
+
+        exit:
+            return retval;
+        }
+
+
+        /*!
+         *  \brief  read a json value
+         *  \param  value   the value, overwritten
+         *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed input
+         */
+        inline gw_retval_t read_json(nlohmann::json& value){
+            return __decode_value(&this->_cursor, this->_end, this->_context, this->_key_slot, value, this->_list_key_slot.size());
+        }
+
+
+     private:
+        // remaining encoded bytes
+        const uint8_t *_cursor = nullptr;
+        const uint8_t *_end = nullptr;
+
+        // dictionary and integer states
+        __gw_context_t _context;
+
+        // key slot of the value to be read, and of each opened container
+        uint64_t _key_slot = 0;
+        std::vector<uint64_t> _list_key_slot;
+    };
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+/*!
+ *  \brief  block compression utilities
+ */
+class GWUtilCompress {
+ public:
+    /*!
+     *  \brief  compress a block in LZ4 block format (greedy, single-pass), the output is
+     *          compatible with standard LZ4 block decompressors
+     *  \param  input       pointer to the input data
+     *  \param  input_size  size of the input data
+     *  \param  output      compressed block, overwritten
+     */
+    static void lz4_compress(const uint8_t* input, uint64_t input_size, std::vector<uint8_t>& output){
+        uint32_t hash_table[1 << GW_UTIL_COMPRESS_LZ4_HASH_LOG];
+        uint64_t ip = 0, anchor = 0, ref = 0, match_len = 0, match_limit = 0;
+        uint32_t sequence = 0, hash = 0;
+
+        output.clear();
+        output.reserve(input_size + input_size / 255 + 16);
+
+        // NOTE(zhuobin): LZ4 requires the last 5 bytes to be literals, and the last match
+        //                to start at least 12 bytes before the end of the block
+        if(input_size >= 13){
+            std::memset(hash_table, 0xff, sizeof(hash_table));
+            match_limit = input_size - 5;
+
+            while(ip + 12 <= input_size){
+                std::memcpy(&sequence, input + ip, sizeof(uint32_t));
+                hash = (sequence * 2654435761u) >> (32 - GW_UTIL_COMPRESS_LZ4_HASH_LOG);
+                ref = hash_table[hash];
+                hash_table[hash] = static_cast<uint32_t>(ip);
+
+                if(
+                    ref == 0xffffffff
+                    or ip - ref > 65535
+                    or std::memcmp(input + ref, input + ip, sizeof(uint32_t)) != 0
+                ){
+                    ip += 1;
+                    continue;
+                }
+
+                match_len = 4;
+                while(ip + match_len < match_limit and input[ref + match_len] == input[ip + match_len])
+                    match_len += 1;
+
+                __emit_sequence(output, input + anchor, ip - anchor, ip - ref, match_len);
+                ip += match_len;
+                anchor = ip;
+            }
+        }
+
+        // last literals
+        __emit_sequence(output, input + anchor, input_size - anchor, 0, 0);
+    }
+
+
+    /*!
+     *  \brief  obtain the upper bound of the decompressed size of an LZ4 block, used to reject
+     *          forged sizes before allocating the output
+     *  \note   each byte of a block expands to at most 255 bytes (a run of 255 length bytes)
+     *  \param  input_size  size of the compressed block
+     *  \return upper bound of the decompressed size
+     */
+    static inline uint64_t lz4_max_decompressed_size(uint64_t input_size){
+        if(unlikely(input_size > UINT64_MAX / GW_UTIL_COMPRESS_LZ4_MAX_RATIO))
+            return UINT64_MAX;
+        return input_size * GW_UTIL_COMPRESS_LZ4_MAX_RATIO;
+    }
+
+
+    /*!
+     *  \brief  decompress a block in LZ4 block format
+     *  \param  input           pointer to the compressed block
+     *  \param  input_size      size of the compressed block
+     *  \param  output          decompressed data, overwritten
+     *  \param  original_size   size of the data before compression
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed block
+     */
+    static gw_retval_t lz4_decompress(
+        const uint8_t* input, uint64_t input_size, std::vector<uint8_t>& output, uint64_t original_size
+    ){
+        gw_retval_t retval = GW_SUCCESS;
+        uint64_t ip = 0, op = 0, literal_len = 0, match_len = 0, offset = 0, i = 0;
+        uint8_t token = 0;
+
+        if(unlikely(original_size > lz4_max_decompressed_size(input_size))){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        output.resize(original_size);
+
+        while(ip < input_size){
+            token = input[ip++];
+
+            literal_len = token >> 4;
+            if(literal_len == 15){
+                retval = __read_length(input, input_size, ip, literal_len);
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+            }
+            if(unlikely(ip + literal_len > input_size or op + literal_len > original_size)){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            if(literal_len > 0)
+                std::memcpy(output.data() + op, input + ip, literal_len);
+            ip += literal_len;
+            op += literal_len;
+
+            // the last sequence only contains literals
+            if(ip >= input_size)
+                break;
+
+            if(unlikely(ip + 2 > input_size)){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            offset = input[ip] | (input[ip + 1] << 8);
+            ip += 2;
+            match_len = (token & 0xf) + 4;
+            if((token & 0xf) == 15){
+                retval = __read_length(input, input_size, ip, match_len);
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+            }
+            if(unlikely(offset == 0 or offset > op or op + match_len > original_size)){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+
+            // byte-wise copy, as the match could overlap with itself
+            for(i=0; i<match_len; i++)
+                output[op + i] = output[op + i - offset];
+            op += match_len;
+        }
+
+        if(unlikely(op != original_size))
+            retval = GW_FAILED_INVALID_INPUT;
+
+    exit:
+        return retval;
+    }
+
+ private:
+    /*!
+     *  \brief  append a sequence (literals followed by a match) to the compressed block
+     *  \param  output          compressed block
+     *  \param  literals        start of the literals
+     *  \param  literal_len     number of literals
+     *  \param  offset          offset of the match, ignored if match_len is 0
+     *  \param  match_len       length of the match, 0 for the last sequence
+     */
+    static inline void __emit_sequence(
+        std::vector<uint8_t>& output, const uint8_t* literals, uint64_t literal_len, uint64_t offset, uint64_t match_len
+    ){
+        uint64_t match_code = match_len >= 4 ? match_len - 4 : 0;
+
+        output.push_back(
+            static_cast<uint8_t>((std::min<uint64_t>(literal_len, 15) << 4) | std::min<uint64_t>(match_code, 15))
+        );
+        if(literal_len >= 15)
+            __write_length(output, literal_len - 15);
+        output.insert(output.end(), literals, literals + literal_len);
+
+        if(match_len == 0)
+            return;
+
+        output.push_back(static_cast<uint8_t>(offset & 0xff));
+        output.push_back(static_cast<uint8_t>(offset >> 8));
+        if(match_code >= 15)
+            __write_length(output, match_code - 15);
+    }
+
+
+    static inline void __write_length(std::vector<uint8_t>& output, uint64_t length){
+        while(length >= 255){
+            output.push_back(255);
+            length -= 255;
+        }
+        output.push_back(static_cast<uint8_t>(length));
+    }
+
+
+    static inline gw_retval_t __read_length(const uint8_t* input, uint64_t input_size, uint64_t& ip, uint64_t& length){
+        uint8_t byte = 0;
+
+        do {
+            if(unlikely(ip >= input_size))
+                return GW_FAILED_INVALID_INPUT;
+            byte = input[ip++];
+            length += byte;
+        } while(byte == 255);
+
+        return GW_SUCCESS;
+    }
+
+    static constexpr uint32_t GW_UTIL_COMPRESS_LZ4_HASH_LOG = 12;
+    static constexpr uint64_t GW_UTIL_COMPRESS_LZ4_MAX_RATIO = 255;
+};
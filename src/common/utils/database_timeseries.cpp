@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <iterator>
 
 #include "common/common.hpp"
 #include "common/log.hpp"
@@ -105,6 +106,51 @@ exit:
 }
 
 
+gw_retval_t GWUtilTimeSeriesDatabase::append_batch(std::string uri, std::vector<GWUtilTimeSeriesSample>& list_data){
+    gw_retval_t retval = GW_SUCCESS;
+    std::vector<gw_db_subscribe_context_t*> list_subs_ctx = {};
+    std::vector<nlohmann::json> list_serialized_data = {};
+    std::vector<GWUtilTimeSeriesSample> *series = nullptr;
+    std::lock_guard<std::mutex> lock_callback(this->_callback_mutex);
+    std::lock_guard<std::mutex> lock_db(this->_db_mutex);
+
+    if(unlikely(list_data.size() == 0))
+        goto exit;
+
+    // execute callback, samples are serialized once and shared by all subscribers
+    this->__get_all_subscribers(nullptr, "", uri, /* uri_precise_match */ true, list_subs_ctx);
+    if(list_subs_ctx.size() > 0){
+        list_serialized_data.reserve(list_data.size());
+        for(auto& data : list_data)
+            list_serialized_data.push_back(data.serialize());
+    }
+    for(auto& subs_ctx : list_subs_ctx){
+        for(auto& serialized_data : list_serialized_data){
+            GW_IF_FAILED(
+                subs_ctx->callback(
+                    /* subscribe_cxt */ subs_ctx,
+                    /* new_value */ serialized_data,
+                    /* old_value */ ""
+                ),
+                retval,
+                {
+                    GW_WARN_C("failed to execute callback, set failed: uri(%s)", uri.c_str());
+                    goto exit;
+                }
+            );
+        }
+    }
+
+    // append the data
+    // NOTE(zhuobin): no exact reserve here, which would reallocate the whole series on every batch
+    series = &(this->_map_series[uri]);
+    series->insert(series->end(), std::make_move_iterator(list_data.begin()), std::make_move_iterator(list_data.end()));
+
+exit:
+    return retval;
+}
+
+
 gw_retval_t GWUtilTimeSeriesDatabase::query(std::string uri, std::vector<GWUtilTimeSeriesSample> &response){
     gw_retval_t retval = GW_SUCCESS;
     std::lock_guard<std::mutex> lock_callback(this->_callback_mutex);
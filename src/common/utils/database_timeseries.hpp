@@ -46,10 +46,11 @@ class GWUtilTimeSeriesSample {
     nlohmann::json payload = "";
 
 
-    GWUtilTimeSeriesSample& operator=(const GWUtilTimeSeriesSample& other){
-        this->timestamp = other.timestamp;
-        this->payload = other.payload;
-    }
+    // samples are moved into series without copying their payload
+    GWUtilTimeSeriesSample(const GWUtilTimeSeriesSample& other) = default;
+    GWUtilTimeSeriesSample(GWUtilTimeSeriesSample&& other) = default;
+    GWUtilTimeSeriesSample& operator=(const GWUtilTimeSeriesSample& other) = default;
+    GWUtilTimeSeriesSample& operator=(GWUtilTimeSeriesSample&& other) = default;
 };
 
 
@@ -68,6 +69,17 @@ class GWUtilTimeSeriesDatabase final : public GWUtilDatabase {
     gw_retval_t append(std::string uri, GWUtilTimeSeriesSample& data);
 
 
+    /*!
+     *  \brief  append a batch of samples to the series, under a single acquisition of the lock
+     *  \note   samples are moved into the series, and each sample is serialized only once
+     *          for all subscribers
+     *  \param  uri         uri of the series
+     *  \param  list_data   new samples, which are moved from on success
+     *  \return GW_SUCCESS for successfully appended
+     */
+    gw_retval_t append_batch(std::string uri, std::vector<GWUtilTimeSeriesSample>& list_data);
+
+
     /*!
      *  \brief  query samples from the series
      *  \param  uri     uri of the series
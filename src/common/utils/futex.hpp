@@ -0,0 +1,58 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <climits>
+
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+/*!
+ *  \brief  thin wrapper of linux futex on a 32-bit atomic word
+ */
+class GWUtilFutex {
+ public:
+    /*!
+     *  \brief  sleep until the word is woken, as long as it still holds the expected value
+     *  \param  word        the futex word
+     *  \param  expected    expected value of the word
+     *  \param  timeout_us  timeout of the wait (us), 0 for waiting without timeout
+     *  \return GW_SUCCESS if woken or the word has changed,
+     *          GW_FAILED_NOT_READY if timeout
+     */
+    static inline gw_retval_t wait(std::atomic<uint32_t>& word, uint32_t expected, uint64_t timeout_us){
+        gw_retval_t retval = GW_SUCCESS;
+        struct timespec timeout;
+        long sys_retval = 0;
+
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word should be 32-bit");
+
+        timeout.tv_sec = timeout_us / 1000000;
+        timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+        sys_retval = syscall(
+            SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected,
+            timeout_us > 0 ? &timeout : nullptr, nullptr, 0
+        );
+        if(sys_retval != 0 and errno == ETIMEDOUT)
+            retval = GW_FAILED_NOT_READY;
+
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  wake threads waiting on the word
+     *  \param  word        the futex word
+     *  \param  nb_waiters  maximum number of threads to be woken
+     */
+    static inline void wake(std::atomic<uint32_t>& word, int nb_waiters = INT_MAX){
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, nb_waiters, nullptr, nullptr, 0);
+    }
+};
@@ -11,6 +11,11 @@
 using gw_hash_u64_t = uint64_t;
 
 
+// offset basis and prime of 64-bit FNV-1a
+#define GW_UTIL_HASH_FNV1A_OFFSET   1469598103934665603ULL
+#define GW_UTIL_HASH_FNV1A_PRIME    1099511628211ULL
+
+
 /*!
  *  \brief  utilities to calculate hash value
  */
@@ -52,4 +57,28 @@ class GWUtilHash {
 
         return hash;
     }
+
+
+    /*!
+     *  \brief  obtain the FNV-1a hash value of a byte sequence
+     *  \note   unlike std::hash, the value is stable across standard library
+     *          implementations and runs, so it could be persisted
+     *  \param  data    byte sequence to be hashed
+     *  \param  size    size of the byte sequence
+     *  \param  hash    hash value to continue with, for hashing multiple sequences
+     *  \return hash result
+     */
+    static inline gw_hash_u64_t fnv1a(const void* data, uint64_t size, gw_hash_u64_t hash = GW_UTIL_HASH_FNV1A_OFFSET){
+        const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data);
+        uint64_t i = 0;
+
+        for(i=0; i<size; i++){
+            hash ^= bytes[i];
+            hash *= GW_UTIL_HASH_FNV1A_PRIME;
+        }
+        return hash;
+    }
+    static inline gw_hash_u64_t fnv1a(const std::string& str, gw_hash_u64_t hash = GW_UTIL_HASH_FNV1A_OFFSET){
+        return fnv1a(str.data(), str.size(), hash);
+    }
 };
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <iostream>
+#include <atomic>
+#include <functional>
 
 #include "common/common.hpp"
 #include "common/log.hpp"
@@ -148,8 +150,8 @@ class GWUtilsLockFreeQueue {
     moodycamel::ReaderWriterQueue<T, GW_LOCKLESS_QUEUE_LEN> *_q;
 
     // identify whether this queue is locked, if locked, nothing would be enqueued/dequeued
-    bool _is_enqueue_locked;
-    bool _is_dequeue_locked;
+    std::atomic<bool> _is_enqueue_locked;
+    std::atomic<bool> _is_dequeue_locked;
     
     // destructor for remaining elements in the queue while this queue is destroyed
     std::function<gw_retval_t(T)> _destructor_callback;
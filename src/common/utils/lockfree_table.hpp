@@ -0,0 +1,201 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <vector>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+#define GW_UTIL_LOCKFREE_TABLE_DEFAULT_CAPACITY    65536
+
+// maximum number of slots probed by a lookup / insert, so that a miss costs O(1) even if
+// the table is nearly full; inserts fail once no slot is free within the window
+#define GW_UTIL_LOCKFREE_TABLE_MAX_PROBE           32
+
+
+/*!
+ *  \brief  insert-only lock-free hash table from non-zero 64-bit keys (e.g., handles,
+ *          pointers) to heap-allocated values, with open addressing and linear probing
+ *  \note   lookups are wait-free and never block inserts, which makes the table
+ *          suitable for read-mostly caches on hot paths; probing is bounded by
+ *          GW_UTIL_LOCKFREE_TABLE_MAX_PROBE, so callers should fall back to another
+ *          container once an insert fails; entries can't be removed, but their values
+ *          could be replaced (e.g., once they are invalidated); values are owned by the
+ *          table, replaced values are kept until destruction as readers could still
+ *          hold them
+ *  \tparam T   value type
+ */
+template<typename T>
+class GWUtilLockFreeTable {
+ public:
+    /*!
+     *  \brief  constructor
+     *  \param  capacity    number of slots, rounded up to the power of 2
+     */
+    GWUtilLockFreeTable(uint64_t capacity = GW_UTIL_LOCKFREE_TABLE_DEFAULT_CAPACITY)
+        : _capacity(std::bit_ceil(std::max<uint64_t>(capacity, 2))),
+          _max_probe(std::min<uint64_t>(this->_capacity, GW_UTIL_LOCKFREE_TABLE_MAX_PROBE))
+    {
+        GW_CHECK_POINTER(this->_slots = new __gw_slot_t[this->_capacity]);
+    }
+
+
+    ~GWUtilLockFreeTable(){
+        uint64_t i = 0;
+        for(i=0; i<this->_capacity; i++){
+            if(this->_slots[i].value.load(std::memory_order_acquire) != nullptr)
+                delete this->_slots[i].value.load(std::memory_order_acquire);
+        }
+        delete[] this->_slots;
+        for(T* value : this->_list_retired_values)
+            delete value;
+    }
+
+
+    /*!
+     *  \brief  find the value of the key
+     *  \param  key     the key, must be non-zero
+     *  \return the value, nullptr if the key doesn't exist (or is being inserted)
+     */
+    inline T* find(uint64_t key) const {
+        uint64_t index = __hash(key) & (this->_capacity - 1), i = 0, slot_key = 0;
+
+        for(i=0; i<this->_max_probe; i++){
+            slot_key = this->_slots[index].key.load(std::memory_order_acquire);
+            if(likely(slot_key == key))
+                return this->_slots[index].value.load(std::memory_order_acquire);
+            if(slot_key == 0)
+                return nullptr;
+            index = (index + 1) & (this->_capacity - 1);
+        }
+
+        return nullptr;
+    }
+
+
+    /*!
+     *  \brief  insert a value of the key, the table takes the ownership of the value
+     *          once it's inserted
+     *  \param  key             the key, must be non-zero
+     *  \param  value           the value to be inserted
+     *  \param  existing_value  the value inserted by others if the key already exists,
+     *                          in which case the given value isn't inserted
+     *  \return GW_SUCCESS if inserted,
+     *          GW_FAILED_ALREADY_EXIST if the key already exists,
+     *          GW_FAILED_NOT_READY if no slot is free within the probe window
+     */
+    gw_retval_t insert(uint64_t key, T* value, T*& existing_value){
+        gw_retval_t retval = GW_FAILED_NOT_READY;
+        uint64_t index = __hash(key) & (this->_capacity - 1), i = 0, slot_key = 0;
+
+        GW_ASSERT(key != 0);
+        GW_CHECK_POINTER(value);
+
+        for(i=0; i<this->_max_probe; i++){
+            slot_key = this->_slots[index].key.load(std::memory_order_acquire);
+            if(slot_key == 0){
+                if(this->_slots[index].key.compare_exchange_strong(slot_key, key, std::memory_order_acq_rel)){
+                    this->_slots[index].value.store(value, std::memory_order_release);
+                    this->_size.fetch_add(1, std::memory_order_relaxed);
+                    retval = GW_SUCCESS;
+                    goto exit;
+                }
+                // slot_key is updated with the key claimed by the racing insert
+            }
+            if(slot_key == key){
+                // NOTE(zhuobin): the racing insert publishes its value right after claiming
+                //                the key, so the spin is short
+                while((existing_value = this->_slots[index].value.load(std::memory_order_acquire)) == nullptr)
+                    __builtin_ia32_pause();
+                retval = GW_FAILED_ALREADY_EXIST;
+                goto exit;
+            }
+            index = (index + 1) & (this->_capacity - 1);
+        }
+
+    exit:
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  replace the value of the key if it's still the expected one, the table takes
+     *          the ownership of the new value once it's replaced, while the expected value
+     *          is kept until destruction as readers could still hold it
+     *  \param  key             the key, must be non-zero
+     *  \param  expected_value  the value expected to be replaced
+     *  \param  value           the new value
+     *  \param  current_value   the value replaced by others if the value of the key isn't
+     *                          the expected one, in which case the new value isn't inserted
+     *  \return GW_SUCCESS if replaced,
+     *          GW_FAILED_ALREADY_EXIST if the value has been replaced by others,
+     *          GW_FAILED_NOT_EXIST if the key doesn't exist
+     */
+    gw_retval_t replace(uint64_t key, T* expected_value, T* value, T*& current_value){
+        gw_retval_t retval = GW_FAILED_NOT_EXIST;
+        uint64_t index = __hash(key) & (this->_capacity - 1), i = 0, slot_key = 0;
+
+        GW_ASSERT(key != 0);
+        GW_CHECK_POINTER(expected_value);
+        GW_CHECK_POINTER(value);
+
+        for(i=0; i<this->_max_probe; i++){
+            slot_key = this->_slots[index].key.load(std::memory_order_acquire);
+            if(slot_key == 0)
+                goto exit;
+            if(slot_key == key){
+                current_value = expected_value;
+                if(this->_slots[index].value.compare_exchange_strong(current_value, value, std::memory_order_acq_rel)){
+                    std::lock_guard lock(this->_mutex_retired_values);
+                    this->_list_retired_values.push_back(expected_value);
+                    retval = GW_SUCCESS;
+                } else {
+                    retval = GW_FAILED_ALREADY_EXIST;
+                }
+                goto exit;
+            }
+            index = (index + 1) & (this->_capacity - 1);
+        }
+
+    exit:
+        return retval;
+    }
+
+
+    // getters
+    inline uint64_t size() const { return this->_size.load(std::memory_order_relaxed); }
+    inline uint64_t capacity() const { return this->_capacity; }
+
+ private:
+    /*!
+     *  \brief  slot of the table, key is claimed before value is published
+     */
+    typedef struct __gw_slot {
+        std::atomic<uint64_t> key = 0;
+        std::atomic<T*> value = nullptr;
+    } __gw_slot_t;
+
+
+    /*!
+     *  \brief  mix bits of the key, as low bits of pointers are mostly zero
+     */
+    static inline uint64_t __hash(uint64_t key){
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        return key;
+    }
+
+    const uint64_t _capacity;
+    const uint64_t _max_probe;
+    __gw_slot_t *_slots = nullptr;
+    std::atomic<uint64_t> _size = 0;
+
+    // replaced values, which are freed on destruction
+    std::mutex _mutex_retired_values;
+    std::vector<T*> _list_retired_values;
+};
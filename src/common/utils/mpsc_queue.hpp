@@ -0,0 +1,324 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+#define GW_UTILS_MPSC_QUEUE_DEFAULT_CAPACITY        16384
+#define GW_UTILS_MPSC_QUEUE_DEFAULT_SAMPLE_RATE     16
+
+
+/*!
+ *  \brief  policy of a bounded queue once it's overflowed
+ */
+enum gw_utils_queue_overflow_policy_t : uint8_t {
+    // wait until the consumer frees a slot
+    GW_UTILS_QUEUE_OVERFLOW_BLOCK = 0,
+
+    // drop the element being pushed
+    GW_UTILS_QUEUE_OVERFLOW_DROP_NEWEST,
+
+    // evict the oldest element to make room for the element being pushed
+    GW_UTILS_QUEUE_OVERFLOW_DROP_OLDEST,
+
+    // admit 1-in-N elements once the queue is half full, and drop the element being pushed once full
+    GW_UTILS_QUEUE_OVERFLOW_SAMPLE
+};
+
+
+/*!
+ *  \brief  parse overflow policy from its name
+ *  \param  name    name of the policy: block / drop_newest / drop_oldest / sample
+ *  \param  policy  the parsed policy
+ *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for unknown name
+ */
+inline gw_retval_t gw_utils_queue_string_to_policy(const std::string& name, gw_utils_queue_overflow_policy_t& policy){
+    gw_retval_t retval = GW_SUCCESS;
+
+    if(name == "block"){
+        policy = GW_UTILS_QUEUE_OVERFLOW_BLOCK;
+    } else if(name == "drop_newest"){
+        policy = GW_UTILS_QUEUE_OVERFLOW_DROP_NEWEST;
+    } else if(name == "drop_oldest"){
+        policy = GW_UTILS_QUEUE_OVERFLOW_DROP_OLDEST;
+    } else if(name == "sample"){
+        policy = GW_UTILS_QUEUE_OVERFLOW_SAMPLE;
+    } else {
+        retval = GW_FAILED_INVALID_INPUT;
+    }
+
+    return retval;
+}
+
+
+/*!
+ *  \brief  statistics of a bounded queue
+ */
+typedef struct gw_utils_queue_stat {
+    uint64_t capacity = 0;
+    uint64_t nb_enqueued = 0;
+    uint64_t nb_dropped = 0;
+    uint64_t high_water = 0;
+
+    /*!
+     *  \brief  accumulate statistics of another queue
+     *  \param  other   statistics of another queue
+     */
+    inline void merge(const gw_utils_queue_stat& other){
+        this->capacity += other.capacity;
+        this->nb_enqueued += other.nb_enqueued;
+        this->nb_dropped += other.nb_dropped;
+        this->high_water = std::max(this->high_water, other.high_water);
+    }
+} gw_utils_queue_stat_t;
+
+
+/*!
+ *  \brief  bounded multi-producer / single-consumer queue over a fixed ring, with selectable
+ *          policy on overflow and accounting of enqueued / dropped elements
+ *  \note   each slot carries a sequence number (D. Vyukov's bounded queue), so producers
+ *          never take a lock and the memory footprint is fixed at construction
+ *  \tparam T   element type, should be default constructible and copy assignable
+ */
+template<typename T>
+class GWUtilsMPSCQueue {
+ public:
+    /*!
+     *  \brief  constructor
+     *  \param  capacity            capacity of the queue, rounded up to the power of 2
+     *  \param  policy              policy once the queue is overflowed
+     *  \param  sample_rate         N of the 1-in-N sampling, only used by GW_UTILS_QUEUE_OVERFLOW_SAMPLE
+     *  \param  destructor_callback destructor for dropped elements and elements remain in the queue
+     */
+    GWUtilsMPSCQueue(
+        uint64_t capacity = GW_UTILS_MPSC_QUEUE_DEFAULT_CAPACITY,
+        gw_utils_queue_overflow_policy_t policy = GW_UTILS_QUEUE_OVERFLOW_DROP_NEWEST,
+        uint64_t sample_rate = GW_UTILS_MPSC_QUEUE_DEFAULT_SAMPLE_RATE,
+        std::function<gw_retval_t(T)> destructor_callback = [](T element){return GW_SUCCESS;}
+    )   :   _policy(policy),
+            _sample_rate(std::max<uint64_t>(sample_rate, 1)),
+            _destructor_callback(destructor_callback)
+    {
+        uint64_t i = 0;
+
+        this->_capacity = 2;
+        while(this->_capacity < capacity)
+            this->_capacity <<= 1;
+        this->_mask = this->_capacity - 1;
+
+        this->_list_cell = std::vector<__gw_cell_t>(this->_capacity);
+        for(i=0; i<this->_capacity; i++)
+            this->_list_cell[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+
+    /*!
+     *  \brief  destructor
+     */
+    ~GWUtilsMPSCQueue(){
+        this->drain();
+    }
+
+
+    /*!
+     *  \brief  push an element to the queue, applying the overflow policy if the queue is full
+     *  \note   a dropped element is released by the destructor callback, hence the caller
+     *          shouldn't touch the element after pushing regardless of the return value
+     *  \param  element element to be pushed
+     *  \return GW_SUCCESS if the element is enqueued, GW_FAILED_NOT_READY if it's dropped
+     */
+    inline gw_retval_t push(T element){
+        gw_retval_t retval = GW_SUCCESS;
+        T evicted;
+
+        // sampling kicks in once the queue is under pressure
+        if(this->_policy == GW_UTILS_QUEUE_OVERFLOW_SAMPLE and this->len() >= (this->_capacity >> 1)){
+            if(this->_sample_counter.fetch_add(1, std::memory_order_relaxed) % this->_sample_rate != 0){
+                retval = GW_FAILED_NOT_READY;
+                goto exit;
+            }
+        }
+
+        while(!this->__try_enqueue(element)){
+            if(this->_policy == GW_UTILS_QUEUE_OVERFLOW_BLOCK){
+                std::this_thread::yield();
+            } else if(this->_policy == GW_UTILS_QUEUE_OVERFLOW_DROP_OLDEST){
+                if(this->__try_dequeue(evicted)){
+                    this->_nb_dropped.fetch_add(1, std::memory_order_relaxed);
+                    this->_destructor_callback(evicted);
+                }
+            } else {
+                retval = GW_FAILED_NOT_READY;
+                goto exit;
+            }
+        }
+
+    exit:
+        if(unlikely(retval != GW_SUCCESS)){
+            this->_nb_dropped.fetch_add(1, std::memory_order_relaxed);
+            this->_destructor_callback(element);
+        }
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  dequeue the head element of the queue, should only be called by the consumer
+     *  \param  element reference to the variable to stored dequeued element (if any)
+     *  \return GW_SUCCESS for successfully dequeued
+     *          GW_FAILED_NOT_READY for empty queue
+     */
+    inline gw_retval_t dequeue(T& element){
+        return this->__try_dequeue(element) ? GW_SUCCESS : GW_FAILED_NOT_READY;
+    }
+
+
+    /*!
+     *  \brief  obtain the approximate number of elements in the queue
+     *  \return length of the queue
+     */
+    inline uint64_t len() const {
+        uint64_t enqueue_pos = this->_enqueue_pos.load(std::memory_order_relaxed);
+        uint64_t dequeue_pos = this->_dequeue_pos.load(std::memory_order_relaxed);
+        return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+    }
+
+
+    /*!
+     *  \brief  release all elements remain in the queue
+     */
+    inline void drain(){
+        T element;
+        while(this->__try_dequeue(element))
+            this->_destructor_callback(element);
+    }
+
+
+    /*!
+     *  \brief  obtain statistics of the queue
+     *  \return statistics of the queue
+     */
+    inline gw_utils_queue_stat_t get_stat() const {
+        gw_utils_queue_stat_t stat;
+        stat.capacity = this->_capacity;
+        stat.nb_enqueued = this->_nb_enqueued.load(std::memory_order_relaxed);
+        stat.nb_dropped = this->_nb_dropped.load(std::memory_order_relaxed);
+        stat.high_water = this->_high_water.load(std::memory_order_relaxed);
+        return stat;
+    }
+
+
+    // getters
+    inline uint64_t get_capacity() const { return this->_capacity; }
+    inline gw_utils_queue_overflow_policy_t get_policy() const { return this->_policy; }
+
+ private:
+    /*!
+     *  \brief  slot of the ring
+     */
+    typedef struct __gw_cell {
+        std::atomic<uint64_t> seq = 0;
+        T element = {};
+
+        __gw_cell() = default;
+        __gw_cell(const __gw_cell& other) : seq(other.seq.load()), element(other.element) {}
+    } __gw_cell_t;
+
+
+    /*!
+     *  \brief  try to enqueue an element without applying the overflow policy
+     *  \param  element element to be enqueued
+     *  \return true if enqueued, false if the queue is full
+     */
+    inline bool __try_enqueue(const T& element){
+        __gw_cell_t *cell = nullptr;
+        uint64_t pos = this->_enqueue_pos.load(std::memory_order_relaxed), seq = 0, occupancy = 0, high_water = 0;
+        int64_t diff = 0;
+
+        while(true){
+            cell = &this->_list_cell[pos & this->_mask];
+            seq = cell->seq.load(std::memory_order_acquire);
+            diff = (int64_t)seq - (int64_t)pos;
+            if(diff == 0){
+                if(this->_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if(diff < 0){
+                return false;
+            } else {
+                pos = this->_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->element = element;
+        cell->seq.store(pos + 1, std::memory_order_release);
+
+        this->_nb_enqueued.fetch_add(1, std::memory_order_relaxed);
+        occupancy = pos + 1 - std::min(pos + 1, this->_dequeue_pos.load(std::memory_order_relaxed));
+        high_water = this->_high_water.load(std::memory_order_relaxed);
+        while(unlikely(occupancy > high_water)){
+            if(this->_high_water.compare_exchange_weak(high_water, occupancy, std::memory_order_relaxed))
+                break;
+        }
+
+        return true;
+    }
+
+
+    /*!
+     *  \brief  try to dequeue an element
+     *  \note   safe to be called by producers as well, which evicts for GW_UTILS_QUEUE_OVERFLOW_DROP_OLDEST
+     *  \param  element the dequeued element
+     *  \return true if dequeued, false if the queue is empty
+     */
+    inline bool __try_dequeue(T& element){
+        __gw_cell_t *cell = nullptr;
+        uint64_t pos = this->_dequeue_pos.load(std::memory_order_relaxed), seq = 0;
+        int64_t diff = 0;
+
+        while(true){
+            cell = &this->_list_cell[pos & this->_mask];
+            seq = cell->seq.load(std::memory_order_acquire);
+            diff = (int64_t)seq - (int64_t)(pos + 1);
+            if(diff == 0){
+                if(this->_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if(diff < 0){
+                return false;
+            } else {
+                pos = this->_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        element = cell->element;
+        cell->seq.store(pos + this->_mask + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // ring of the queue
+    std::vector<__gw_cell_t> _list_cell;
+    uint64_t _capacity = 0;
+    uint64_t _mask = 0;
+
+    // positions of producers and the consumer, placed on separated cache lines
+    alignas(64) std::atomic<uint64_t> _enqueue_pos = 0;
+    alignas(64) std::atomic<uint64_t> _dequeue_pos = 0;
+
+    // overflow policy
+    gw_utils_queue_overflow_policy_t _policy;
+    uint64_t _sample_rate = 1;
+    alignas(64) std::atomic<uint64_t> _sample_counter = 0;
+
+    // statistics
+    alignas(64) std::atomic<uint64_t> _nb_enqueued = 0;
+    std::atomic<uint64_t> _nb_dropped = 0;
+    std::atomic<uint64_t> _high_water = 0;
+
+    // destructor for dropped elements and remaining elements while this queue is destroyed
+    std::function<gw_retval_t(T)> _destructor_callback;
+};
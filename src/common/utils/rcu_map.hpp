@@ -0,0 +1,459 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <span>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+#define GW_UTIL_RCU_MAP_DEFAULT_NB_SHARDS       16
+#define GW_UTIL_RCU_MAP_INIT_SHARD_CAPACITY     16
+
+
+/*!
+ *  \brief  process-wide domain of epoch-based reclamation, objects retired by writers are
+ *          freed once no reader could still hold them
+ *  \note   each thread announces the global epoch in its own slot while reading, and an
+ *          object retired at epoch e is freed once every announced epoch is beyond e;
+ *          the domain is never destructed, so that threads exiting after static
+ *          destruction could still release their slots
+ */
+class GWUtilEpochDomain {
+ public:
+    static GWUtilEpochDomain& instance(){
+        static GWUtilEpochDomain *domain = new GWUtilEpochDomain();
+        return *domain;
+    }
+
+
+    /*!
+     *  \brief  RAII read-side critical section, objects loaded within the section stay
+     *          valid till the end of the section, sections could be nested
+     */
+    class read_guard {
+     public:
+        read_guard(){ GWUtilEpochDomain::instance().enter(); }
+        ~read_guard(){ GWUtilEpochDomain::instance().leave(); }
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+    };
+
+
+    /*!
+     *  \brief  enter the read-side critical section of current thread
+     */
+    inline void enter(){
+        __gw_reader_slot_t *slot = this->__get_slot();
+
+        // NOTE(zhuobin): the announcement must be ordered before loads of protected
+        //                objects, which is only guaranteed by seq_cst
+        if(slot->depth++ == 0)
+            slot->epoch.store(this->_global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+
+
+    /*!
+     *  \brief  leave the read-side critical section of current thread
+     */
+    inline void leave(){
+        __gw_reader_slot_t *slot = this->__get_slot();
+
+        GW_ASSERT(slot->depth > 0);
+        if(--slot->depth == 0)
+            slot->epoch.store(0, std::memory_order_release);
+    }
+
+
+    /*!
+     *  \brief  retire an object which has been unlinked from readers, the object is freed
+     *          once all readers which could observe it have left
+     *  \param  object  the object to be retired
+     */
+    template<typename T>
+    void retire(const T* object){
+        std::lock_guard lock(this->_mutex);
+
+        this->_list_retired.push_back({
+            .object = object,
+            .deleter = [](const void* ptr){ delete static_cast<const T*>(ptr); },
+            .epoch = this->_global_epoch.fetch_add(1, std::memory_order_seq_cst)
+        });
+        this->__reclaim();
+    }
+
+
+    // getters
+    inline uint64_t get_nb_retired() {
+        std::lock_guard lock(this->_mutex);
+        return this->_list_retired.size();
+    }
+
+ private:
+    GWUtilEpochDomain(){}
+    ~GWUtilEpochDomain() = default;
+
+
+    /*!
+     *  \brief  slot of a reader thread
+     */
+    typedef struct __gw_reader_slot {
+        // announced epoch, 0 if the thread isn't reading
+        alignas(64) std::atomic<uint64_t> epoch = 0;
+        // nesting depth of read-side critical sections, only accessed by the owner
+        uint64_t depth = 0;
+        bool is_used = false;
+    } __gw_reader_slot_t;
+
+
+    /*!
+     *  \brief  holder of the slot of current thread, which releases the slot on thread exit
+     */
+    typedef struct __gw_reader_slot_holder {
+        __gw_reader_slot_t *slot = nullptr;
+        ~__gw_reader_slot_holder(){
+            if(this->slot != nullptr){
+                std::lock_guard lock(GWUtilEpochDomain::instance()._mutex);
+                this->slot->epoch.store(0, std::memory_order_release);
+                this->slot->depth = 0;
+                this->slot->is_used = false;
+            }
+        }
+    } __gw_reader_slot_holder_t;
+
+
+    /*!
+     *  \brief  object retired by writers
+     */
+    typedef struct __gw_retired_object {
+        const void *object = nullptr;
+        void (*deleter)(const void*) = nullptr;
+        uint64_t epoch = 0;
+    } __gw_retired_object_t;
+
+
+    /*!
+     *  \brief  obtain the slot of current thread, acquire one on the first call
+     *  \return the slot
+     */
+    inline __gw_reader_slot_t* __get_slot(){
+        static thread_local __gw_reader_slot_holder_t holder;
+
+        if(unlikely(holder.slot == nullptr)){
+            std::lock_guard lock(this->_mutex);
+            for(__gw_reader_slot_t& slot : this->_list_slots){
+                if(!slot.is_used){
+                    holder.slot = &slot;
+                    break;
+                }
+            }
+            if(holder.slot == nullptr)
+                holder.slot = &this->_list_slots.emplace_back();
+            holder.slot->is_used = true;
+        }
+
+        return holder.slot;
+    }
+
+
+    /*!
+     *  \brief  free retired objects which can't be observed by any reader,
+     *          should be called with _mutex held
+     */
+    inline void __reclaim(){
+        uint64_t min_epoch = UINT64_MAX, epoch = 0;
+
+        for(__gw_reader_slot_t& slot : this->_list_slots){
+            epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if(epoch != 0 and epoch < min_epoch)
+                min_epoch = epoch;
+        }
+
+        // readers announced epoch e might observe objects retired at epoch >= e
+        std::erase_if(this->_list_retired, [min_epoch](const __gw_retired_object_t& retired){
+            if(retired.epoch >= min_epoch)
+                return false;
+            retired.deleter(retired.object);
+            return true;
+        });
+    }
+
+    // global epoch, starts from 1 as 0 stands for quiescent readers
+    alignas(64) std::atomic<uint64_t> _global_epoch = 1;
+
+    // slots of reader threads, and objects to be freed
+    std::mutex _mutex;
+    std::deque<__gw_reader_slot_t> _list_slots;
+    std::vector<__gw_retired_object_t> _list_retired;
+};
+
+
+/*!
+ *  \brief  read-mostly concurrent hash map, lookups are lock-free and never block
+ *          writers, e.g., registries which are looked up on hot paths
+ *  \note   keys are spread across shards, each shard is an insert-only table with open
+ *          addressing and linear probing, where an entry is published at once by marking
+ *          its slot ready after the key and value are written; writers of a shard are
+ *          serialized, and the table is grown by building a new table and swapping it in
+ *          (i.e., RCU), while the old table is reclaimed via the process-wide epoch
+ *          domain once no reader could hold it; entries are removed the same way by
+ *          rebuilding the table without them, which is meant for rare events (e.g.,
+ *          unloading modules)
+ *  \tparam K           key type
+ *  \tparam V           value type, should be cheap to copy (e.g., pointers, handles)
+ *  \tparam Hash        hash of the key
+ *  \tparam nb_shards   number of shards, should be power of 2
+ */
+template<typename K, typename V, typename Hash = std::hash<K>, uint64_t nb_shards = GW_UTIL_RCU_MAP_DEFAULT_NB_SHARDS>
+class GWUtilRcuMap {
+    static_assert(nb_shards > 0 and (nb_shards & (nb_shards - 1)) == 0, "number of shards of rcu map should be power of 2");
+
+ public:
+    GWUtilRcuMap(){
+        uint64_t i = 0;
+        for(i=0; i<nb_shards; i++)
+            GW_CHECK_POINTER(this->_shards[i].table = new __gw_table_t(GW_UTIL_RCU_MAP_INIT_SHARD_CAPACITY));
+    }
+
+
+    ~GWUtilRcuMap(){
+        uint64_t i = 0;
+        for(i=0; i<nb_shards; i++)
+            delete this->_shards[i].table.load(std::memory_order_acquire);
+    }
+
+
+    /*!
+     *  \brief  find the value of the key
+     *  \note   this function is lock-free
+     *  \param  key     the key
+     *  \param  value   the value, untouched if the key doesn't exist
+     *  \return whether the key exists
+     */
+    inline bool find(const K& key, V& value) const {
+        GWUtilEpochDomain::read_guard guard;
+        const uint64_t hash = __hash(key);
+        const __gw_table_t *table = this->_shards[__get_shard_index(hash)].table.load(std::memory_order_seq_cst);
+        const __gw_slot_t *slot = nullptr;
+        uint64_t index = hash & (table->capacity - 1), i = 0;
+
+        // NOTE(zhuobin): slots are never emptied, so a ready entry is never behind a slot
+        //                which isn't ready along its probe sequence
+        for(i=0; i<table->capacity; i++){
+            slot = &table->slots[index];
+            if(!slot->is_ready.load(std::memory_order_acquire))
+                return false;
+            if(slot->key == key){
+                value = slot->value;
+                return true;
+            }
+            index = (index + 1) & (table->capacity - 1);
+        }
+
+        return false;
+    }
+
+
+    /*!
+     *  \brief  insert a value of the key
+     *  \param  key     the key
+     *  \param  value   the value
+     *  \return GW_SUCCESS if inserted, GW_FAILED_ALREADY_EXIST if the key already exists
+     */
+    gw_retval_t insert(const K& key, const V& value){
+        gw_retval_t retval = GW_SUCCESS;
+        const uint64_t hash = __hash(key);
+        __gw_shard_t& shard = this->_shards[__get_shard_index(hash)];
+        __gw_table_t *table = nullptr, *new_table = nullptr;
+        __gw_slot_t *slot = nullptr;
+        std::lock_guard lock(shard.mutex);
+
+        table = shard.table.load(std::memory_order_relaxed);
+        if(__find_slot(table, key, hash, slot)){
+            retval = GW_FAILED_ALREADY_EXIST;
+            goto exit;
+        }
+
+        // keep the load factor under 1/2, otherwise grow the table and publish it
+        if((shard.size.load(std::memory_order_relaxed) + 1) * 2 > table->capacity){
+            GW_CHECK_POINTER(new_table = new __gw_table_t(table->capacity * 2));
+            for(__gw_slot_t& old_slot : std::span(table->slots.get(), table->capacity)){
+                if(!old_slot.is_ready.load(std::memory_order_relaxed))
+                    continue;
+                __find_slot(new_table, old_slot.key, __hash(old_slot.key), slot);
+                slot->key = old_slot.key;
+                slot->value = old_slot.value;
+                slot->is_ready.store(true, std::memory_order_relaxed);
+            }
+            shard.table.store(new_table, std::memory_order_seq_cst);
+            GWUtilEpochDomain::instance().retire(table);
+            table = new_table;
+            __find_slot(table, key, hash, slot);
+        }
+
+        slot->key = key;
+        slot->value = value;
+        slot->is_ready.store(true, std::memory_order_release);
+        shard.size.store(shard.size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    exit:
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  remove all entries matched by the predicate
+     *  \note   each shard containing matched entries is rebuilt without them and swapped in,
+     *          so the cost is linear to the size of the map, readers are never blocked
+     *  \param  predicate   predicate of entries to be removed, in form of bool(const K&, const V&),
+     *                      which could be called more than once on each entry
+     *  \return number of removed entries
+     */
+    template<typename F>
+    uint64_t erase_if(F&& predicate){
+        __gw_table_t *table = nullptr, *new_table = nullptr;
+        __gw_slot_t *slot = nullptr;
+        uint64_t i = 0, nb_erased = 0, nb_shard_erased = 0;
+
+        for(i=0; i<nb_shards; i++){
+            __gw_shard_t& shard = this->_shards[i];
+            std::lock_guard lock(shard.mutex);
+
+            table = shard.table.load(std::memory_order_relaxed);
+            nb_shard_erased = 0;
+            for(const __gw_slot_t& old_slot : std::span(table->slots.get(), table->capacity)){
+                if(old_slot.is_ready.load(std::memory_order_relaxed) and predicate(old_slot.key, old_slot.value))
+                    nb_shard_erased += 1;
+            }
+            if(nb_shard_erased == 0)
+                continue;
+
+            // NOTE(zhuobin): slots can't be emptied in place as probe sequences of readers
+            //                would break, so the remaining entries are moved to a new table
+            GW_CHECK_POINTER(new_table = new __gw_table_t(table->capacity));
+            for(__gw_slot_t& old_slot : std::span(table->slots.get(), table->capacity)){
+                if(!old_slot.is_ready.load(std::memory_order_relaxed) or predicate(old_slot.key, old_slot.value))
+                    continue;
+                __find_slot(new_table, old_slot.key, __hash(old_slot.key), slot);
+                slot->key = old_slot.key;
+                slot->value = old_slot.value;
+                slot->is_ready.store(true, std::memory_order_relaxed);
+            }
+            shard.table.store(new_table, std::memory_order_seq_cst);
+            GWUtilEpochDomain::instance().retire(table);
+            shard.size.store(shard.size.load(std::memory_order_relaxed) - nb_shard_erased, std::memory_order_relaxed);
+            nb_erased += nb_shard_erased;
+        }
+
+        return nb_erased;
+    }
+
+
+    /*!
+     *  \brief  visit all entries, entries inserted during the visit might be missed
+     *  \param  callback    callback for each entry, in form of void(const K&, const V&)
+     */
+    template<typename F>
+    void for_each(F&& callback) const {
+        GWUtilEpochDomain::read_guard guard;
+        const __gw_table_t *table = nullptr;
+        uint64_t i = 0;
+
+        for(i=0; i<nb_shards; i++){
+            table = this->_shards[i].table.load(std::memory_order_seq_cst);
+            for(const __gw_slot_t& slot : std::span(table->slots.get(), table->capacity)){
+                if(slot.is_ready.load(std::memory_order_acquire))
+                    callback(slot.key, slot.value);
+            }
+        }
+    }
+
+
+    /*!
+     *  \brief  obtain number of entries
+     *  \return number of entries
+     */
+    inline uint64_t size() const {
+        uint64_t i = 0, size = 0;
+        for(i=0; i<nb_shards; i++)
+            size += this->_shards[i].size.load(std::memory_order_relaxed);
+        return size;
+    }
+
+ private:
+    /*!
+     *  \brief  slot of the table, the key and value are immutable once the slot is ready
+     */
+    typedef struct __gw_slot {
+        std::atomic<bool> is_ready = false;
+        K key;
+        V value;
+    } __gw_slot_t;
+
+
+    /*!
+     *  \brief  table of a shard
+     */
+    typedef struct __gw_table {
+        __gw_table(uint64_t capacity_) : capacity(capacity_), slots(new __gw_slot_t[capacity_]) {}
+        const uint64_t capacity;
+        std::unique_ptr<__gw_slot_t[]> slots;
+    } __gw_table_t;
+
+
+    /*!
+     *  \brief  shard of the map, writers of the shard are serialized by the mutex
+     */
+    typedef struct __gw_shard {
+        alignas(64) std::atomic<__gw_table_t*> table = nullptr;
+        std::atomic<uint64_t> size = 0;
+        std::mutex mutex;
+    } __gw_shard_t;
+
+
+    /*!
+     *  \brief  find the slot of the key, or the empty slot to insert the key,
+     *          should be called by writers of the shard
+     *  \return whether the key exists
+     */
+    static inline bool __find_slot(__gw_table_t *table, const K& key, uint64_t hash, __gw_slot_t*& slot){
+        uint64_t index = hash & (table->capacity - 1);
+
+        while(true){
+            slot = &table->slots[index];
+            if(!slot->is_ready.load(std::memory_order_relaxed))
+                return false;
+            if(slot->key == key)
+                return true;
+            index = (index + 1) & (table->capacity - 1);
+        }
+    }
+
+
+    /*!
+     *  \brief  hash the key, bits are mixed as low bits of hashed pointers are mostly zero
+     */
+    static inline uint64_t __hash(const K& key){
+        uint64_t hash = static_cast<uint64_t>(Hash()(key));
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+
+    /*!
+     *  \brief  obtain the shard of the hash, high bits are used as low bits index the table
+     */
+    static inline uint64_t __get_shard_index(uint64_t hash){
+        return (hash >> 48) & (nb_shards - 1);
+    }
+
+    __gw_shard_t _shards[nb_shards];
+};
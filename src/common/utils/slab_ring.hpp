@@ -0,0 +1,265 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <type_traits>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/mpsc_queue.hpp"
+
+
+#define GW_UTILS_SLAB_RING_DEFAULT_SLAB_LEN     4096
+
+
+/*!
+ *  \brief  bounded single-producer / single-consumer ring of fixed-size records, stored by
+ *          value within a chain of slabs, e.g., per-thread trace records on hot paths
+ *  \note   the producer only writes the record and publishes the committed length of the
+ *          tail slab on each push; slabs are allocated lazily up to the capacity and
+ *          recycled once drained, and the lock is only taken by the producer on crossing
+ *          a slab, so pushes are allocation-free and lock-free in the common case
+ *  \tparam T           record type, should be trivially copyable
+ *  \tparam slab_len    number of records within a slab
+ */
+template<typename T, uint64_t slab_len = GW_UTILS_SLAB_RING_DEFAULT_SLAB_LEN>
+class GWUtilsSlabRing {
+    static_assert(std::is_trivially_copyable_v<T>, "records of slab ring should be trivially copyable");
+
+ public:
+    /*!
+     *  \brief  constructor
+     *  \param  capacity        capacity of the ring, rounded up to multiple of slab_len
+     *  \param  policy          policy once the ring is overflowed
+     *  \param  sample_rate     N of the 1-in-N sampling, only used by GW_UTILS_QUEUE_OVERFLOW_SAMPLE
+     */
+    GWUtilsSlabRing(
+        uint64_t capacity = GW_UTILS_MPSC_QUEUE_DEFAULT_CAPACITY,
+        gw_utils_queue_overflow_policy_t policy = GW_UTILS_QUEUE_OVERFLOW_DROP_NEWEST,
+        uint64_t sample_rate = GW_UTILS_MPSC_QUEUE_DEFAULT_SAMPLE_RATE
+    )   :   _policy(policy),
+            _sample_rate(std::max<uint64_t>(sample_rate, 1))
+    {
+        // NOTE(zhuobin): evicting the oldest slab requires the tail to be another slab
+        this->_max_nb_slabs = std::max<uint64_t>((capacity + slab_len - 1) / slab_len, 2);
+        GW_CHECK_POINTER(this->_head = this->_tail = new __gw_slab_t());
+        this->_nb_slabs = 1;
+    }
+
+
+    /*!
+     *  \brief  destructor
+     */
+    ~GWUtilsSlabRing(){
+        __gw_slab_t *slab = this->_head, *next_slab = nullptr;
+
+        while(slab != nullptr){
+            next_slab = slab->next.load(std::memory_order_acquire);
+            delete slab;
+            slab = next_slab;
+        }
+        for(__gw_slab_t* free_slab : this->_list_free_slabs)
+            delete free_slab;
+    }
+
+
+    /*!
+     *  \brief  push a record to the ring, applying the overflow policy if the ring is full,
+     *          should only be called by the producer
+     *  \param  record  record to be pushed
+     *  \return GW_SUCCESS if the record is pushed, GW_FAILED_NOT_READY if it's dropped
+     */
+    inline gw_retval_t push(const T& record){
+        gw_retval_t retval = GW_SUCCESS;
+
+        // sampling kicks in once the ring is under pressure
+        if(this->_policy == GW_UTILS_QUEUE_OVERFLOW_SAMPLE and this->_is_under_pressure){
+            if(this->_sample_counter++ % this->_sample_rate != 0){
+                retval = GW_FAILED_NOT_READY;
+                goto exit;
+            }
+        }
+
+        if(unlikely(this->_tail_len == slab_len)){
+            if(unlikely((retval = this->__advance_tail()) != GW_SUCCESS))
+                goto exit;
+        }
+
+        this->_tail->records[this->_tail_len] = record;
+        this->_tail_len += 1;
+        this->_tail->nb_committed.store(this->_tail_len, std::memory_order_release);
+
+        // NOTE(zhuobin): counters are only written by the producer, so no atomic RMW is needed
+        this->_nb_enqueued.store(this->_nb_enqueued.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    exit:
+        if(unlikely(retval != GW_SUCCESS))
+            this->_nb_dropped.store(this->_nb_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  consume all committed records in the order of being pushed, should only be
+     *          called by the consumer
+     *  \note   the producer could be blocked while crossing a slab during draining, so the
+     *          callback should be cheap (e.g., copying the record out)
+     *  \param  callback    callback for each record, in form of void(const T&)
+     *  \return number of consumed records
+     */
+    template<typename F>
+    uint64_t drain(F&& callback){
+        uint64_t nb_consumed = 0, nb_committed = 0;
+        __gw_slab_t *next_slab = nullptr;
+        std::lock_guard lock(this->_mutex_slabs);
+
+        while(true){
+            nb_committed = this->_head->nb_committed.load(std::memory_order_acquire);
+            for(; this->_head_pos < nb_committed; this->_head_pos++, nb_consumed++)
+                callback(this->_head->records[this->_head_pos]);
+
+            // the head is being written, or the producer hasn't crossed it yet
+            if(this->_head_pos < slab_len)
+                break;
+            if((next_slab = this->_head->next.load(std::memory_order_acquire)) == nullptr)
+                break;
+
+            this->_list_free_slabs.push_back(this->_head);
+            this->_nb_recycled_slabs.store(this->_nb_recycled_slabs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            this->_head = next_slab;
+            this->_head_pos = 0;
+        }
+
+        return nb_consumed;
+    }
+
+
+    /*!
+     *  \brief  obtain statistics of the ring, high water is tracked at the granularity of slabs
+     *  \return statistics of the ring
+     */
+    inline gw_utils_queue_stat_t get_stat() const {
+        gw_utils_queue_stat_t stat;
+        stat.capacity = this->get_capacity();
+        stat.nb_enqueued = this->_nb_enqueued.load(std::memory_order_relaxed);
+        stat.nb_dropped = this->_nb_dropped.load(std::memory_order_relaxed);
+        stat.high_water = this->_high_water.load(std::memory_order_relaxed);
+        return stat;
+    }
+
+
+    // getters
+    inline uint64_t get_capacity() const { return this->_max_nb_slabs * slab_len; }
+    inline gw_utils_queue_overflow_policy_t get_policy() const { return this->_policy; }
+
+ private:
+    /*!
+     *  \brief  slab of records
+     */
+    typedef struct __gw_slab {
+        // number of records committed by the producer
+        alignas(64) std::atomic<uint64_t> nb_committed = 0;
+
+        // next slab, published once the producer crosses this slab
+        std::atomic<struct __gw_slab*> next = nullptr;
+
+        alignas(64) T records[slab_len];
+    } __gw_slab_t;
+
+
+    /*!
+     *  \brief  move the producer to a new slab once the tail slab is full
+     *  \return GW_SUCCESS if success, GW_FAILED_NOT_READY if the ring is full
+     */
+    gw_retval_t __advance_tail(){
+        gw_retval_t retval = GW_SUCCESS;
+        __gw_slab_t *slab = nullptr;
+        uint64_t nb_slabs_in_use = 0;
+
+        // the ring remains full until the consumer recycles a slab, so that pushes to be
+        // dropped don't contend the lock with the consumer
+        if(
+            this->_policy != GW_UTILS_QUEUE_OVERFLOW_BLOCK
+            and this->_nb_recycled_slabs_once_full == this->_nb_recycled_slabs.load(std::memory_order_relaxed)
+        ){
+            retval = GW_FAILED_NOT_READY;
+            goto exit;
+        }
+
+        while(true){
+            std::lock_guard lock(this->_mutex_slabs);
+
+            if(!this->_list_free_slabs.empty()){
+                slab = this->_list_free_slabs.back();
+                this->_list_free_slabs.pop_back();
+            } else if(this->_nb_slabs < this->_max_nb_slabs){
+                GW_CHECK_POINTER(slab = new __gw_slab_t());
+                this->_nb_slabs += 1;
+            } else if(this->_policy == GW_UTILS_QUEUE_OVERFLOW_DROP_OLDEST){
+                // evict the head slab, which is full as the tail is another slab
+                slab = this->_head;
+                this->_nb_dropped.store(
+                    this->_nb_dropped.load(std::memory_order_relaxed)
+                        + slab->nb_committed.load(std::memory_order_relaxed) - this->_head_pos,
+                    std::memory_order_relaxed
+                );
+                this->_head = slab->next.load(std::memory_order_relaxed);
+                this->_head_pos = 0;
+            }
+
+            if(slab != nullptr){
+                nb_slabs_in_use = this->_nb_slabs - this->_list_free_slabs.size();
+                this->_is_under_pressure = nb_slabs_in_use * 2 >= this->_max_nb_slabs;
+                if(nb_slabs_in_use * slab_len > this->_high_water.load(std::memory_order_relaxed))
+                    this->_high_water.store(nb_slabs_in_use * slab_len, std::memory_order_relaxed);
+                break;
+            }
+
+            if(this->_policy != GW_UTILS_QUEUE_OVERFLOW_BLOCK){
+                this->_nb_recycled_slabs_once_full = this->_nb_recycled_slabs.load(std::memory_order_relaxed);
+                retval = GW_FAILED_NOT_READY;
+                goto exit;
+            }
+            this->_is_under_pressure = true;
+            std::this_thread::yield();
+        }
+
+        slab->nb_committed.store(0, std::memory_order_relaxed);
+        slab->next.store(nullptr, std::memory_order_relaxed);
+        this->_tail->next.store(slab, std::memory_order_release);
+        this->_tail = slab;
+        this->_tail_len = 0;
+
+    exit:
+        return retval;
+    }
+
+    // state of the producer
+    alignas(64) __gw_slab_t *_tail = nullptr;
+    uint64_t _tail_len = 0;
+    bool _is_under_pressure = false;
+    uint64_t _sample_counter = 0;
+    uint64_t _nb_recycled_slabs_once_full = UINT64_MAX;
+
+    // state of the consumer, and slabs shared with the producer
+    alignas(64) std::mutex _mutex_slabs;
+    __gw_slab_t *_head = nullptr;
+    uint64_t _head_pos = 0;
+    std::vector<__gw_slab_t*> _list_free_slabs;
+    uint64_t _nb_slabs = 0;
+    uint64_t _max_nb_slabs = 0;
+    std::atomic<uint64_t> _nb_recycled_slabs = 0;
+
+    // overflow policy
+    gw_utils_queue_overflow_policy_t _policy;
+    uint64_t _sample_rate = 1;
+
+    // statistics, only written by the producer
+    alignas(64) std::atomic<uint64_t> _nb_enqueued = 0;
+    std::atomic<uint64_t> _nb_dropped = 0;
+    std::atomic<uint64_t> _high_water = 0;
+};
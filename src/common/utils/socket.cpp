@@ -57,14 +57,15 @@ gw_retval_t GWUtilWebSocketInstance::send(
 }
 
 
-gw_retval_t GWUtilWebSocketInstance::send(std::string message){
+gw_retval_t GWUtilWebSocketInstance::send(std::string message, bool is_binary){
     gw_retval_t retval = GW_SUCCESS;
     std::lock_guard<std::mutex> lock_guard(this->_send_mutex);
 
     // TODO(zhuobin): we need to change to async send
 
-    this->send_queue.push(message);
+    this->send_queue.push(std::move(message));
     this->send_offset_queue.push_back(0);
+    this->send_is_binary_queue.push_back(is_binary);
     lws_callback_on_writable(this->_wsi);
 
     return retval;
@@ -81,11 +82,11 @@ gw_retval_t GWUtilWebSocketInstance::sync_send(){
 gw_retval_t GWUtilWebSocketInstance::wsi_send_chunk(GWUtilWebSocketInstance* ws_instance){
     gw_retval_t retval = GW_SUCCESS;
     int send_bytes;
-    std::string send_message;
+    const std::string *send_message = nullptr;
     uint64_t send_offset;
     uint64_t send_size;
     char *send_buf = nullptr;
-    int write_mode;
+    int write_mode, first_write_mode;
     bool is_first_chunk, is_only_chunk, is_last_chunk;
 
     GW_CHECK_POINTER(ws_instance);
@@ -100,18 +101,19 @@ gw_retval_t GWUtilWebSocketInstance::wsi_send_chunk(GWUtilWebSocketInstance* ws_
     }
 
     // obtain the message chunk to be sent
-    send_message = ws_instance->send_queue.front();
+    send_message = &(ws_instance->send_queue.front());
     send_offset = ws_instance->send_offset_queue.front();
-    send_size = (send_message.length()-send_offset > GW_WEBSOCKET_CHUNK_SIZE) 
-        ? GW_WEBSOCKET_CHUNK_SIZE : (send_message.length()-send_offset);
+    first_write_mode = ws_instance->send_is_binary_queue.front() ? (int)LWS_WRITE_BINARY : (int)LWS_WRITE_TEXT;
+    send_size = (send_message->length()-send_offset > GW_WEBSOCKET_CHUNK_SIZE) 
+        ? GW_WEBSOCKET_CHUNK_SIZE : (send_message->length()-send_offset);
 
     // check some flags
-    if(send_message.length() <= GW_WEBSOCKET_CHUNK_SIZE){
+    if(send_message->length() <= GW_WEBSOCKET_CHUNK_SIZE){
         is_only_chunk = true;
     } else {
         is_only_chunk = false;
     }
-    if(send_offset + GW_WEBSOCKET_CHUNK_SIZE >= send_message.length()) {
+    if(send_offset + GW_WEBSOCKET_CHUNK_SIZE >= send_message->length()) {
         is_last_chunk = true;
     } else {
         is_last_chunk = false;
@@ -125,9 +127,9 @@ gw_retval_t GWUtilWebSocketInstance::wsi_send_chunk(GWUtilWebSocketInstance* ws_
     // make the write mode
     if (is_first_chunk) {
         if (is_only_chunk) {
-            write_mode = (int)LWS_WRITE_TEXT;
+            write_mode = first_write_mode;
         } else {
-            write_mode = (int)LWS_WRITE_TEXT | (int)LWS_WRITE_NO_FIN;
+            write_mode = first_write_mode | (int)LWS_WRITE_NO_FIN;
         }
     } else {
         if (is_last_chunk) {
@@ -140,7 +142,7 @@ gw_retval_t GWUtilWebSocketInstance::wsi_send_chunk(GWUtilWebSocketInstance* ws_
     // make sendbuf
     GW_CHECK_POINTER(send_buf = new char[send_size+LWS_PRE]);
     memset(send_buf, 0, send_size+LWS_PRE);
-    memcpy(send_buf+LWS_PRE, send_message.c_str()+send_offset, send_size);
+    memcpy(send_buf+LWS_PRE, send_message->c_str()+send_offset, send_size);
 
     // send
     send_bytes = lws_write(
@@ -160,6 +162,7 @@ gw_retval_t GWUtilWebSocketInstance::wsi_send_chunk(GWUtilWebSocketInstance* ws_
     if(is_last_chunk){
         ws_instance->send_queue.pop();
         ws_instance->send_offset_queue.pop_front();
+        ws_instance->send_is_binary_queue.pop_front();
     } else {
         ws_instance->send_offset_queue.front() = send_offset + send_size;
     }
@@ -196,6 +199,11 @@ char* GWUtilWebSocketInstance::export_recv_buf(){
 }
 
 
+uint64_t GWUtilWebSocketInstance::get_recv_buf_size(){
+    return this->_recv_buf_offset;
+}
+
+
 void GWUtilWebSocketInstance::reset_recv_buf(){
     memset(this->_recv_buf, 0, this->_recv_buf_offset);
     this->_recv_buf_offset = 0;
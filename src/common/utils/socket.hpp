@@ -130,7 +130,14 @@ class GWUtilWebSocketInstance {
      *  \return GW_SUCCESS if the message is sent successfully, GW_FAILED otherwise
      */
     gw_retval_t send(std::map<std::string, nlohmann::json> &&message_map);
-    gw_retval_t send(std::string message);
+
+    /*!
+     *  \brief  send a message to the other side of the connection
+     *  \param  message     the message to send
+     *  \param  is_binary   whether to send the message as binary frames (otherwise text frames)
+     *  \return GW_SUCCESS if the message is sent successfully, GW_FAILED otherwise
+     */
+    gw_retval_t send(std::string message, bool is_binary = false);
 
     /*!
      *  \brief  sync all send message to be finished
@@ -144,11 +151,13 @@ class GWUtilWebSocketInstance {
      */
     gw_retval_t recv_to_buf(void* in, size_t len);
     char* export_recv_buf();
+    uint64_t get_recv_buf_size();
     void reset_recv_buf();
 
     // send queue
     std::queue<std::string> send_queue;
     std::deque<uint64_t> send_offset_queue;
+    std::deque<bool> send_is_binary_queue;
 
  private:
     // send buffer
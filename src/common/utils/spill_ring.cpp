@@ -0,0 +1,424 @@
+#include <iostream>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/spill_ring.hpp"
+
+
+GWUtilSpillRing::GWUtilSpillRing()
+{}
+
+
+GWUtilSpillRing::~GWUtilSpillRing(){
+    this->close();
+}
+
+
+gw_retval_t GWUtilSpillRing::open(const std::string& path, uint64_t capacity, bool is_read_only){
+    gw_retval_t retval = GW_SUCCESS;
+    struct stat file_stat;
+    bool is_new = false;
+    void *map_base = nullptr;
+
+    std::lock_guard lock(this->_mutex);
+
+    if(unlikely(this->_header != nullptr)){
+        GW_WARN_C("spill ring already opened: path(%s)", this->_path.c_str());
+        retval = GW_FAILED_ALREADY_EXIST;
+        goto exit;
+    }
+
+    this->_path = path;
+    this->_is_read_only = is_read_only;
+
+    this->_fd = ::open(path.c_str(), is_read_only ? O_RDONLY : (O_RDWR | O_CREAT), 0644);
+    if(unlikely(this->_fd < 0)){
+        GW_WARN_C("failed to open spill ring: path(%s), err(%s)", path.c_str(), strerror(errno));
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    if(unlikely(fstat(this->_fd, &file_stat) != 0)){
+        GW_WARN_C("failed to stat spill ring: path(%s), err(%s)", path.c_str(), strerror(errno));
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+
+    if(file_stat.st_size == 0 and !is_read_only){
+        capacity = std::max<uint64_t>(__align(capacity), GW_UTIL_SPILL_RING_HEADER_SIZE);
+        if(unlikely(ftruncate(this->_fd, GW_UTIL_SPILL_RING_HEADER_SIZE + capacity) != 0)){
+            GW_WARN_C(
+                "failed to allocate spill ring: path(%s), capacity(%lu), err(%s)",
+                path.c_str(), capacity, strerror(errno)
+            );
+            retval = GW_FAILED_NOT_EXIST;
+            goto exit;
+        }
+        this->_map_size = GW_UTIL_SPILL_RING_HEADER_SIZE + capacity;
+        is_new = true;
+    } else if(unlikely((uint64_t)file_stat.st_size <= GW_UTIL_SPILL_RING_HEADER_SIZE)){
+        GW_WARN_C("invalid spill ring, file too small: path(%s), size(%ld)", path.c_str(), file_stat.st_size);
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    } else {
+        this->_map_size = file_stat.st_size;
+    }
+
+    // NOTE(zhuobin): a read-only ring is mapped privately, so that recovery could
+    //                patch the header without touching the file
+    map_base = mmap(
+        nullptr, this->_map_size, PROT_READ | PROT_WRITE,
+        is_read_only ? MAP_PRIVATE : MAP_SHARED, this->_fd, 0
+    );
+    if(unlikely(map_base == MAP_FAILED)){
+        GW_WARN_C("failed to map spill ring: path(%s), err(%s)", path.c_str(), strerror(errno));
+        retval = GW_FAILED_NOT_EXIST;
+        goto exit;
+    }
+    this->_map_base = static_cast<uint8_t*>(map_base);
+    this->_header = reinterpret_cast<__gw_header_t*>(this->_map_base);
+    this->_data = this->_map_base + GW_UTIL_SPILL_RING_HEADER_SIZE;
+
+    if(is_new){
+        std::memset(this->_header, 0, sizeof(__gw_header_t));
+        this->_header->version = GW_UTIL_SPILL_RING_VERSION;
+        this->_header->capacity = this->_map_size - GW_UTIL_SPILL_RING_HEADER_SIZE;
+        std::atomic_thread_fence(std::memory_order_release);
+        this->_header->magic = GW_UTIL_SPILL_RING_MAGIC;
+    } else if(unlikely(
+        this->_header->magic != GW_UTIL_SPILL_RING_MAGIC
+        or this->_header->version != GW_UTIL_SPILL_RING_VERSION
+        or this->_header->capacity != this->_map_size - GW_UTIL_SPILL_RING_HEADER_SIZE
+        or this->_header->capacity % 8 != 0
+    )){
+        GW_WARN_C(
+            "invalid spill ring, header mismatched: path(%s), magic(%x), version(%u), capacity(%lu)",
+            path.c_str(), this->_header->magic, this->_header->version, this->_header->capacity
+        );
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    } else {
+        this->__recover();
+    }
+
+    this->_read_cursor = this->_header->tail;
+
+    GW_DEBUG_C(
+        "opened spill ring: path(%s), capacity(%lu), nb_pending_bytes(%lu), is_read_only(%d)",
+        path.c_str(), this->_header->capacity, this->_header->head - this->_header->tail, is_read_only
+    );
+
+exit:
+    if(unlikely(retval != GW_SUCCESS)){
+        if(this->_map_base != nullptr){
+            munmap(this->_map_base, this->_map_size);
+            this->_map_base = nullptr;
+            this->_header = nullptr;
+            this->_data = nullptr;
+        }
+        if(this->_fd >= 0){
+            ::close(this->_fd);
+            this->_fd = -1;
+        }
+    }
+    return retval;
+}
+
+
+void GWUtilSpillRing::close(){
+    std::lock_guard lock(this->_mutex);
+
+    if(this->_map_base != nullptr){
+        if(!this->_is_read_only)
+            msync(this->_map_base, this->_map_size, MS_SYNC);
+        munmap(this->_map_base, this->_map_size);
+        this->_map_base = nullptr;
+        this->_header = nullptr;
+        this->_data = nullptr;
+    }
+    if(this->_fd >= 0){
+        ::close(this->_fd);
+        this->_fd = -1;
+    }
+}
+
+
+gw_retval_t GWUtilSpillRing::append(const void* data, uint64_t size){
+    gw_retval_t retval = GW_SUCCESS;
+    __gw_record_header_t record_header;
+    uint64_t capacity = 0, head = 0, position = 0, record_size = 0, wrap_size = 0, evict_size = 0;
+
+    std::lock_guard lock(this->_mutex);
+
+    if(unlikely(this->_header == nullptr or this->_is_read_only)){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    capacity = this->_header->capacity;
+    record_size = __align(sizeof(__gw_record_header_t) + size);
+    if(unlikely(size >= __GW_RECORD_LENGTH_WRAP or record_size > capacity)){
+        GW_WARN_C("record too large for spill ring: size(%lu), capacity(%lu)", size, capacity);
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    // records never straddle the end of the data region
+    head = this->_header->head;
+    position = head % capacity;
+    wrap_size = capacity - position < record_size ? capacity - position : 0;
+
+    // evict the oldest records until there's room, the tail is advanced before
+    // the records are overwritten, so a crash never exposes a half-written record
+    while(head + wrap_size + record_size - this->_header->tail > capacity){
+        if(this->_header->tail == head){
+            // the ring is empty, skip to the start of the data region without the wrap marker
+            head += wrap_size;
+            this->_header->tail = head;
+            position = 0;
+            wrap_size = 0;
+            break;
+        }
+        if(unlikely(this->__record_size_at(this->_header->tail, evict_size, false) != GW_SUCCESS)){
+            this->_header->tail = head;
+            continue;
+        }
+        if(reinterpret_cast<__gw_record_header_t*>(
+            this->_data + this->_header->tail % capacity)->length != __GW_RECORD_LENGTH_WRAP
+        ){
+            this->_header->nb_overwritten += 1;
+        }
+        this->_header->tail = this->_header->tail + evict_size;
+    }
+    if(unlikely(this->_read_cursor < this->_header->tail))
+        this->_read_cursor = this->_header->tail;
+
+    if(wrap_size > 0){
+        record_header.length = __GW_RECORD_LENGTH_WRAP;
+        record_header.crc = 0;
+        std::memcpy(this->_data + position, &record_header, sizeof(__gw_record_header_t));
+        position = 0;
+    }
+
+    // payload and record header go first, then the head is published
+    if(size > 0)
+        std::memcpy(this->_data + position + sizeof(__gw_record_header_t), data, size);
+    record_header.length = static_cast<uint32_t>(size);
+    record_header.crc = __crc32(data, size);
+    std::memcpy(this->_data + position, &record_header, sizeof(__gw_record_header_t));
+    std::atomic_thread_fence(std::memory_order_release);
+
+    this->_header->head = head + wrap_size + record_size;
+    this->_header->nb_appended += 1;
+
+exit:
+    return retval;
+}
+
+
+gw_retval_t GWUtilSpillRing::read_next(std::string& data, uint64_t& end_offset){
+    gw_retval_t retval = GW_SUCCESS;
+    __gw_record_header_t *record_header = nullptr;
+    uint64_t record_size = 0;
+
+    std::lock_guard lock(this->_mutex);
+
+    if(unlikely(this->_header == nullptr)){
+        retval = GW_FAILED_NOT_READY;
+        goto exit;
+    }
+
+    if(unlikely(this->_read_cursor < this->_header->tail))
+        this->_read_cursor = this->_header->tail;
+
+    while(true){
+        if(this->_read_cursor >= this->_header->head){
+            retval = GW_FAILED_NOT_EXIST;
+            goto exit;
+        }
+
+        if(unlikely(this->__record_size_at(this->_read_cursor, record_size, true) != GW_SUCCESS)){
+            GW_WARN_C(
+                "corrupted record in spill ring, drop remaining records: path(%s), offset(%lu), nb_dropped_bytes(%lu)",
+                this->_path.c_str(), this->_read_cursor, this->_header->head - this->_read_cursor
+            );
+            this->_header->nb_corrupted += 1;
+            this->_read_cursor = this->_header->head;
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+
+        record_header = reinterpret_cast<__gw_record_header_t*>(this->_data + this->_read_cursor % this->_header->capacity);
+        this->_read_cursor += record_size;
+        if(record_header->length == __GW_RECORD_LENGTH_WRAP)
+            continue;
+
+        data.assign(reinterpret_cast<const char*>(record_header + 1), record_header->length);
+        end_offset = this->_read_cursor;
+        break;
+    }
+
+exit:
+    return retval;
+}
+
+
+void GWUtilSpillRing::commit(uint64_t end_offset){
+    std::lock_guard lock(this->_mutex);
+
+    if(unlikely(this->_header == nullptr or this->_is_read_only))
+        return;
+
+    // records evicted after being read leave the tail ahead of the offset
+    end_offset = std::min(end_offset, this->_read_cursor);
+    if(end_offset > this->_header->tail)
+        this->_header->tail = end_offset;
+}
+
+
+void GWUtilSpillRing::rewind(uint64_t end_offset){
+    std::lock_guard lock(this->_mutex);
+
+    if(unlikely(this->_header == nullptr))
+        return;
+    this->_read_cursor = std::max(end_offset, this->_header->tail);
+}
+
+
+void GWUtilSpillRing::flush(bool is_blocking){
+    std::lock_guard lock(this->_mutex);
+
+    if(unlikely(this->_header == nullptr or this->_is_read_only))
+        return;
+    if(unlikely(msync(this->_map_base, this->_map_size, is_blocking ? MS_SYNC : MS_ASYNC) != 0)){
+        GW_WARN_C("failed to flush spill ring: path(%s), err(%s)", this->_path.c_str(), strerror(errno));
+    }
+}
+
+
+gw_util_spill_ring_stat_t GWUtilSpillRing::get_stat(){
+    gw_util_spill_ring_stat_t stat;
+
+    std::lock_guard lock(this->_mutex);
+
+    if(unlikely(this->_header == nullptr))
+        return stat;
+
+    stat.capacity = this->_header->capacity;
+    stat.used = this->_header->head - this->_header->tail;
+    stat.nb_appended = this->_header->nb_appended;
+    stat.nb_overwritten = this->_header->nb_overwritten;
+    stat.nb_corrupted = this->_header->nb_corrupted;
+
+    return stat;
+}
+
+
+bool GWUtilSpillRing::is_all_read(){
+    std::lock_guard lock(this->_mutex);
+
+    if(unlikely(this->_header == nullptr))
+        return true;
+    return std::max<uint64_t>(this->_read_cursor, this->_header->tail) >= this->_header->head;
+}
+
+
+gw_retval_t GWUtilSpillRing::__record_size_at(uint64_t offset, uint64_t& size, bool validate){
+    gw_retval_t retval = GW_SUCCESS;
+    __gw_record_header_t *record_header = nullptr;
+    uint64_t capacity = this->_header->capacity, position = offset % capacity;
+
+    // the record header never straddles the end of the data region, as records are 8-byte aligned
+    record_header = reinterpret_cast<__gw_record_header_t*>(this->_data + position);
+
+    if(record_header->length == __GW_RECORD_LENGTH_WRAP){
+        size = capacity - position;
+        goto exit;
+    }
+
+    size = __align(sizeof(__gw_record_header_t) + record_header->length);
+    if(unlikely(position + size > capacity)){
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+    if(validate and unlikely(__crc32(record_header + 1, record_header->length) != record_header->crc)){
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+exit:
+    return retval;
+}
+
+
+void GWUtilSpillRing::__recover(){
+    uint64_t offset = 0, record_size = 0, nb_records = 0;
+
+    // offsets beyond the data region can't be trusted at all
+    if(unlikely(
+        this->_header->tail > this->_header->head
+        or this->_header->head - this->_header->tail > this->_header->capacity
+        or this->_header->tail % 8 != 0
+        or this->_header->head % 8 != 0
+    )){
+        GW_WARN_C(
+            "spill ring has invalid offsets, drop all records: path(%s), head(%lu), tail(%lu)",
+            this->_path.c_str(), this->_header->head, this->_header->tail
+        );
+        this->_header->tail = this->_header->head = __align(std::max(this->_header->head, this->_header->tail));
+        return;
+    }
+
+    // truncate the ring at the first torn record
+    for(offset = this->_header->tail; offset < this->_header->head; offset += record_size){
+        if(unlikely(
+            this->__record_size_at(offset, record_size, true) != GW_SUCCESS
+            or offset + record_size > this->_header->head
+        )){
+            GW_WARN_C(
+                "spill ring has torn records, truncated: path(%s), offset(%lu), nb_dropped_bytes(%lu)",
+                this->_path.c_str(), offset, this->_header->head - offset
+            );
+            this->_header->nb_corrupted += 1;
+            this->_header->head = offset;
+            break;
+        }
+        nb_records += 1;
+    }
+
+    GW_DEBUG_C("recovered spill ring: path(%s), nb_records(%lu)", this->_path.c_str(), nb_records);
+}
+
+
+uint32_t GWUtilSpillRing::__crc32(const void* data, uint64_t size){
+    static uint32_t table[256] = { 0 };
+    static std::once_flag table_flag;
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    uint32_t crc = 0xffffffff, value = 0;
+    uint64_t i = 0, j = 0;
+
+    std::call_once(table_flag, [&](){
+        for(i=0; i<256; i++){
+            value = static_cast<uint32_t>(i);
+            for(j=0; j<8; j++)
+                value = (value & 1) ? (0xedb88320 ^ (value >> 1)) : (value >> 1);
+            table[i] = value;
+        }
+    });
+
+    for(i=0; i<size; i++)
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+
+    return crc ^ 0xffffffff;
+}
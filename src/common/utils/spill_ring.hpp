@@ -0,0 +1,211 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <mutex>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+#define GW_UTIL_SPILL_RING_MAGIC            0x52535747  // "GWSR"
+#define GW_UTIL_SPILL_RING_VERSION          1
+#define GW_UTIL_SPILL_RING_HEADER_SIZE      4096
+#define GW_UTIL_SPILL_RING_DEFAULT_CAPACITY (256ul << 20)
+
+
+/*!
+ *  \brief  statistics of a spill ring
+ */
+typedef struct gw_util_spill_ring_stat {
+    // capacity of the data region (bytes)
+    uint64_t capacity = 0;
+
+    // bytes occupied by unconsumed records
+    uint64_t used = 0;
+
+    // number of records appended
+    uint64_t nb_appended = 0;
+
+    // number of unconsumed records evicted by newer records once the ring is full
+    uint64_t nb_overwritten = 0;
+
+    // number of records dropped due to checksum mismatch
+    uint64_t nb_corrupted = 0;
+} gw_util_spill_ring_stat_t;
+
+
+/*!
+ *  \brief  crash-safe ring of opaque records backed by a mmap-ed file, records are
+ *          appended by producers and consumed in order by a single consumer, the
+ *          ring evicts the oldest records once it's full
+ *  \note   layout of the file: a header page, followed by the data region of
+ *          records, each record is [u32 length][u32 crc32][payload] aligned to
+ *          8 bytes; the file is a shared mapping, so records survive the crash of
+ *          the process, and records are checksumed so that the ring recovers to the
+ *          last intact record after the crash of the node
+ */
+class GWUtilSpillRing {
+ public:
+    GWUtilSpillRing();
+    ~GWUtilSpillRing();
+
+
+    /*!
+     *  \brief  open the ring file, create it if not exist
+     *  \param  path            path to the ring file
+     *  \param  capacity        capacity of the data region (bytes), only used while creating
+     *                          the file, the capacity of an existing file is preserved
+     *  \param  is_read_only    whether to open the file read-only, records read from a
+     *                          read-only ring can't be committed
+     *  \return GW_SUCCESS if successful,
+     *          GW_FAILED_NOT_EXIST if failed to open / map the file,
+     *          GW_FAILED_INVALID_INPUT if the file isn't a spill ring
+     */
+    gw_retval_t open(
+        const std::string& path, uint64_t capacity = GW_UTIL_SPILL_RING_DEFAULT_CAPACITY, bool is_read_only = false
+    );
+
+
+    /*!
+     *  \brief  flush and close the ring file
+     */
+    void close();
+
+
+    /*!
+     *  \brief  append a record to the ring, evict the oldest records if there's no room
+     *  \param  data    pointer to the record
+     *  \param  size    size of the record
+     *  \return GW_SUCCESS if successful,
+     *          GW_FAILED_NOT_READY if the ring isn't opened for writing,
+     *          GW_FAILED_INVALID_INPUT if the record is larger than the ring
+     */
+    gw_retval_t append(const void* data, uint64_t size);
+    gw_retval_t append(const std::string& data){ return this->append(data.data(), data.size()); }
+
+
+    /*!
+     *  \brief  read the next unread record, the record stays in the ring until it's committed
+     *  \param  data        the record
+     *  \param  end_offset  logical offset right after the record, used to commit / rewind
+     *                      up to the record
+     *  \return GW_SUCCESS if successful,
+     *          GW_FAILED_NOT_EXIST if all records have been read,
+     *          GW_FAILED_INVALID_INPUT if the record is corrupted, in which case the
+     *          remaining records are dropped
+     */
+    gw_retval_t read_next(std::string& data, uint64_t& end_offset);
+    gw_retval_t read_next(std::string& data){
+        uint64_t end_offset = 0;
+        return this->read_next(data, end_offset);
+    }
+
+
+    /*!
+     *  \brief  consume records read so far up to the given offset
+     *  \param  end_offset  end offset of the last record to be consumed (see read_next)
+     */
+    void commit(uint64_t end_offset);
+
+
+    /*!
+     *  \brief  move the read cursor back to the given offset, so that records after the
+     *          offset are read again, the cursor never goes before the oldest unconsumed record
+     *  \param  end_offset  end offset of the last record not to be read again, 0 to read
+     *                      all unconsumed records again
+     */
+    void rewind(uint64_t end_offset = 0);
+
+
+    /*!
+     *  \brief  flush the mapping to the file
+     *  \param  is_blocking whether to wait until the data reaches the file
+     */
+    void flush(bool is_blocking = false);
+
+
+    /*!
+     *  \brief  obtain statistics of the ring
+     *  \return statistics of the ring
+     */
+    gw_util_spill_ring_stat_t get_stat();
+
+
+    /*!
+     *  \brief  check whether all records have been read
+     *  \return true if all records have been read
+     */
+    bool is_all_read();
+
+
+    // getters
+    inline bool is_opened() const { return this->_header != nullptr; }
+    inline const std::string& get_path() const { return this->_path; }
+
+ private:
+    /*!
+     *  \brief  header page of the ring file
+     *  \note   head / tail are monotonic logical offsets within the data region,
+     *          the physical offset is the logical one modulo the capacity
+     */
+    typedef struct __gw_header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+        uint64_t head;
+        uint64_t tail;
+        uint64_t nb_appended;
+        uint64_t nb_overwritten;
+        uint64_t nb_corrupted;
+    } __gw_header_t;
+
+
+    /*!
+     *  \brief  header of a record
+     */
+    typedef struct __gw_record_header {
+        uint32_t length;
+        uint32_t crc;
+    } __gw_record_header_t;
+
+    // length of the padding record which marks the wrap of the data region
+    static constexpr uint32_t __GW_RECORD_LENGTH_WRAP = 0xffffffff;
+
+
+    /*!
+     *  \brief  obtain the logical size of the record at the given offset
+     *  \param  offset      logical offset of the record
+     *  \param  size        logical size of the record, including its header and padding
+     *  \param  validate    whether to validate the checksum of the record
+     *  \return GW_SUCCESS if the record is intact,
+     *          GW_FAILED_INVALID_INPUT if the record is corrupted
+     */
+    gw_retval_t __record_size_at(uint64_t offset, uint64_t& size, bool validate);
+
+
+    /*!
+     *  \brief  drop records which are torn by the crash, from the last intact record to the head
+     */
+    void __recover();
+
+
+    static uint32_t __crc32(const void* data, uint64_t size);
+
+    static inline uint64_t __align(uint64_t size){ return (size + 7) & ~7ul; }
+
+    std::string _path = "";
+    int _fd = -1;
+    bool _is_read_only = false;
+
+    // mapping of the file
+    uint8_t *_map_base = nullptr;
+    uint64_t _map_size = 0;
+    __gw_header_t *_header = nullptr;
+    uint8_t *_data = nullptr;
+
+    // logical offset of the next record to be read
+    uint64_t _read_cursor = 0;
+
+    std::mutex _mutex;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+/*!
+ *  \brief  growable text buffer for formatting large amount of text (e.g., disassembly)
+ *          without allocating per-item strings or going through iostreams
+ */
+class GWUtilTextBuffer {
+ public:
+    /*!
+     *  \brief  constructor
+     *  \param  init_capacity   initial capacity of the buffer
+     */
+    GWUtilTextBuffer(uint64_t init_capacity = KB(64)){
+        this->_buffer.reserve(init_capacity);
+    }
+
+
+    /*!
+     *  \brief  destructor
+     */
+    ~GWUtilTextBuffer(){}
+
+
+    /*!
+     *  \brief  append a string to the buffer
+     *  \param  str     string to be appended
+     *  \param  len     length of the string
+     */
+    inline void append(const char* str, uint64_t len){
+        this->_buffer.insert(this->_buffer.end(), str, str + len);
+    }
+    inline void append(std::string_view str){
+        this->append(str.data(), str.size());
+    }
+    inline void append(char c){
+        this->_buffer.push_back(c);
+    }
+
+
+    /*!
+     *  \brief  append repeated character to the buffer
+     *  \param  c       character to be appended
+     *  \param  count   number of repeats
+     */
+    inline void append_repeat(char c, uint64_t count){
+        this->_buffer.insert(this->_buffer.end(), count, c);
+    }
+
+
+    /*!
+     *  \brief  append an integer in decimal
+     *  \param  value   value to be appended
+     */
+    template<typename T>
+    inline void append_dec(T value){
+        char tmp[24];
+        std::to_chars_result res = std::to_chars(tmp, tmp + sizeof(tmp), value);
+        this->append(tmp, res.ptr - tmp);
+    }
+
+
+    /*!
+     *  \brief  append an unsigned integer in hexadecimal
+     *  \param  value       value to be appended
+     *  \param  min_width   minimum width, padded with '0'
+     *  \param  with_prefix whether to prepend "0x"
+     */
+    inline void append_hex(uint64_t value, uint32_t min_width = 0, bool with_prefix = true){
+        char tmp[16];
+        std::to_chars_result res = std::to_chars(tmp, tmp + sizeof(tmp), value, 16);
+        uint64_t len = res.ptr - tmp;
+
+        if(with_prefix)
+            this->append("0x", 2);
+        if(min_width > len)
+            this->append_repeat('0', min_width - len);
+        this->append(tmp, len);
+    }
+
+
+    /*!
+     *  \brief  flush the content of the buffer to file descriptor, and clear the buffer
+     *  \param  fd  file descriptor to write to
+     *  \return GW_SUCCESS if success
+     */
+    inline gw_retval_t flush_to_fd(int fd){
+        gw_retval_t retval = GW_SUCCESS;
+        uint64_t pos = 0;
+        ssize_t nb_written = 0;
+
+        while(pos < this->_buffer.size()){
+            nb_written = ::write(fd, this->_buffer.data() + pos, this->_buffer.size() - pos);
+            if(unlikely(nb_written < 0)){
+                if(errno == EINTR)
+                    continue;
+                GW_WARN("failed to flush text buffer: fd(%d), error(%s)", fd, strerror(errno));
+                retval = GW_FAILED;
+                goto exit;
+            }
+            pos += nb_written;
+        }
+        this->_buffer.clear();
+
+    exit:
+        return retval;
+    }
+
+
+    // getters
+    inline const char* data() const { return this->_buffer.data(); }
+    inline uint64_t size() const { return this->_buffer.size(); }
+    inline std::string_view view() const { return std::string_view(this->_buffer.data(), this->_buffer.size()); }
+    inline std::string str() const { return std::string(this->_buffer.data(), this->_buffer.size()); }
+
+    // modifiers
+    inline void clear(){ this->_buffer.clear(); }
+    inline void reserve(uint64_t capacity){ this->_buffer.reserve(capacity); }
+    inline void resize(uint64_t size){ this->_buffer.resize(size); }
+
+ private:
+    std::vector<char> _buffer;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+
+
+/*!
+ *  \brief  fixed-size pool of worker threads executing submitted jobs in FIFO order
+ */
+class GWUtilThreadPool {
+ public:
+    /*!
+     *  \brief  constructor
+     *  \param  nb_workers  number of worker threads
+     */
+    GWUtilThreadPool(uint64_t nb_workers){
+        uint64_t i = 0;
+
+        GW_ASSERT(nb_workers > 0);
+        for(i=0; i<nb_workers; i++){
+            this->_list_workers.emplace_back([this](){ this->__worker_func(); });
+        }
+    }
+
+
+    /*!
+     *  \brief  destructor
+     *  \note   pending jobs are drained before the workers exit
+     */
+    ~GWUtilThreadPool(){
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_is_stopping = true;
+        }
+        this->_cv_job.notify_all();
+        for(auto& worker : this->_list_workers){
+            if(worker.joinable())
+                worker.join();
+        }
+    }
+
+
+    /*!
+     *  \brief  submit a job to the pool
+     *  \param  job     the job to be executed
+     *  \return GW_SUCCESS if success, GW_FAILED_NOT_READY if the pool is stopping
+     */
+    inline gw_retval_t submit(std::function<void()> job){
+        gw_retval_t retval = GW_SUCCESS;
+
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            if(unlikely(this->_is_stopping)){
+                retval = GW_FAILED_NOT_READY;
+                goto exit;
+            }
+            this->_queue_job.push(std::move(job));
+        }
+        this->_cv_job.notify_one();
+
+    exit:
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  block until all submitted jobs are finished
+     */
+    inline void wait_idle(){
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_cv_idle.wait(lock, [this](){
+            return this->_queue_job.empty() and this->_nb_running_jobs == 0;
+        });
+    }
+
+
+    // getters
+    inline uint64_t get_nb_workers() const { return this->_list_workers.size(); }
+    inline uint64_t get_nb_pending_jobs(){
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        return this->_queue_job.size();
+    }
+
+ private:
+    /*!
+     *  \brief  main loop of worker threads
+     */
+    void __worker_func(){
+        std::function<void()> job;
+
+        while(true){
+            {
+                std::unique_lock<std::mutex> lock(this->_mutex);
+                this->_cv_job.wait(lock, [this](){
+                    return this->_is_stopping or !this->_queue_job.empty();
+                });
+                if(this->_queue_job.empty())
+                    return;
+                job = std::move(this->_queue_job.front());
+                this->_queue_job.pop();
+                this->_nb_running_jobs += 1;
+            }
+
+            job();
+
+            {
+                std::lock_guard<std::mutex> lock(this->_mutex);
+                this->_nb_running_jobs -= 1;
+                if(this->_queue_job.empty() and this->_nb_running_jobs == 0)
+                    this->_cv_idle.notify_all();
+            }
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _cv_job;
+    std::condition_variable _cv_idle;
+    std::queue<std::function<void()>> _queue_job;
+    std::vector<std::thread> _list_workers;
+    uint64_t _nb_running_jobs = 0;
+    bool _is_stopping = false;
+};
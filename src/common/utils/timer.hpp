@@ -6,8 +6,39 @@
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <atomic>
+#include <mutex>
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+#endif
 
 #include "common/common.hpp"
+#include "common/log.hpp"
+
+
+// window of the initial calibration of TSC against CLOCK_MONOTONIC_RAW (ms)
+#define GW_UTIL_CLOCK_CALIBRATION_WINDOW_MS     20
+
+// period of re-estimating the TSC frequency to correct the drift (ms)
+#define GW_UTIL_CLOCK_RECALIBRATION_PERIOD_MS   1000
+
+// number of samples while pairing a TSC tick with CLOCK_MONOTONIC_RAW, the tightest one is used
+#define GW_UTIL_CLOCK_NB_PAIRING_SAMPLES        16
+
+// fractional bits of the fixed-point conversion between ticks and ns
+#define GW_UTIL_CLOCK_FIXED_POINT_SHIFT         32
+
+
+/*!
+ *  \brief  source of ticks of the clock service
+ */
+typedef enum gw_util_clock_source : uint8_t {
+    GW_UTIL_CLOCK_SOURCE_TSC = 0,
+    GW_UTIL_CLOCK_SOURCE_MONOTONIC_RAW,
+} gw_util_clock_source_t;
+
 
 /*!
  *  \brief  HPET-based timer
@@ -68,12 +99,353 @@ class GWUtilHpetTimer {
 };
 
 
+/*!
+ *  \brief  process-wide clock service, all timers read ticks from the same source and
+ *          convert them with the same calibration
+ *  \note   TSC is used as the source only if it's invariant (i.e., CPUID.80000007H:EDX[8],
+ *          ticking at a constant rate across P-/C-states), otherwise ticks are read from
+ *          CLOCK_MONOTONIC_RAW in ns; TSC is calibrated against CLOCK_MONOTONIC_RAW once the
+ *          service is constructed (see init), and its frequency is re-estimated by the first
+ *          conversion after each recalibration period to correct the drift; conversions are
+ *          in fixed point
+ */
+class GWUtilClock {
+ public:
+    static GWUtilClock& instance(){
+        static GWUtilClock clock;
+        return clock;
+    }
+
+
+    /*!
+     *  \brief  construct and calibrate the clock service
+     *  \note   the initial calibration sleeps for GW_UTIL_CLOCK_CALIBRATION_WINDOW_MS, so it
+     *          should be done eagerly at init, rather than by the first tick read in a hook
+     */
+    static inline void init(){
+        GWUtilClock& clock = GWUtilClock::instance();
+        GW_DEBUG("clock service initialized: source(%s), freq(%lf)", clock.get_source_name(), clock.get_freq());
+    }
+
+
+    /*!
+     *  \brief  obtain tick of the active clock source
+     *  \return the tick
+     */
+    static inline uint64_t get_tick(){
+        if(likely(GWUtilClock::instance()._source == GW_UTIL_CLOCK_SOURCE_TSC))
+            return GWUtilClock::__read_tsc();
+        return GWUtilClock::__read_monotonic_raw_ns();
+    }
+
+
+    /*!
+     *  \brief  convert tick steps to duration (ns)
+     *  \param  ticks   tick steps
+     *  \return duration (ns)
+     */
+    inline uint64_t ticks_to_ns(uint64_t ticks){
+        this->__correct_drift();
+        return __mul_shift(ticks, this->_mult.load(std::memory_order_relaxed));
+    }
+
+
+    /*!
+     *  \brief  convert duration (ns) to tick steps
+     *  \param  ns  duration (ns)
+     *  \return tick steps
+     */
+    inline uint64_t ns_to_ticks(uint64_t ns){
+        this->__correct_drift();
+        return __mul_shift(ns, this->_mult_inv.load(std::memory_order_relaxed));
+    }
+
+
+    /*!
+     *  \brief  convert tick to time on CLOCK_MONOTONIC_RAW (ns), which is comparable across
+     *          processes on the same node
+     *  \note   the drift is corrected once a tick beyond the recalibration period is converted
+     *  \param  tick    the tick
+     *  \return time on CLOCK_MONOTONIC_RAW (ns)
+     */
+    inline uint64_t tick_to_ns(uint64_t tick){
+        uint64_t seq = 0, anchor_tick = 0, anchor_ns = 0, mult = 0, delta_ns = 0;
+
+        do {
+            seq = this->_seq.load(std::memory_order_acquire);
+            anchor_tick = this->_anchor_tick.load(std::memory_order_relaxed);
+            anchor_ns = this->_anchor_ns.load(std::memory_order_relaxed);
+            mult = this->_mult.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while((seq & 1) or seq != this->_seq.load(std::memory_order_relaxed));
+
+        if(tick >= anchor_tick){
+            if(unlikely(tick - anchor_tick >= this->_recalibration_period_ticks))
+                this->__try_recalibrate();
+            return anchor_ns + __mul_shift(tick - anchor_tick, mult);
+        }
+
+        delta_ns = __mul_shift(anchor_tick - tick, mult);
+        return anchor_ns > delta_ns ? anchor_ns - delta_ns : 0;
+    }
+
+
+    /*!
+     *  \brief  obtain current time on CLOCK_MONOTONIC_RAW (ns) via the active clock source
+     *  \return current time (ns)
+     */
+    inline uint64_t now_ns(){
+        return this->tick_to_ns(GWUtilClock::get_tick());
+    }
+
+
+    /*!
+     *  \brief  re-estimate the TSC frequency from the first calibration till now, and
+     *          re-anchor the conversion at now
+     */
+    void recalibrate(){
+        std::lock_guard lock(this->_mutex_calibration);
+        this->__recalibrate();
+    }
+
+
+    /*!
+     *  \brief  obtain name of the clock source
+     *  \param  source  the clock source
+     *  \return name of the clock source
+     */
+    static inline const char* get_source_name(gw_util_clock_source_t source){
+        switch(source){
+        case GW_UTIL_CLOCK_SOURCE_TSC:
+            return "tsc";
+        case GW_UTIL_CLOCK_SOURCE_MONOTONIC_RAW:
+            return "monotonic_raw";
+        default:
+            return "unknown";
+        }
+    }
+
+
+    // getters
+    inline gw_util_clock_source_t get_source() const { return this->_source; }
+    inline const char* get_source_name() const { return GWUtilClock::get_source_name(this->_source); }
+    inline double get_freq() const { return this->_freq.load(std::memory_order_relaxed); }
+
+ private:
+    GWUtilClock(){
+        uint64_t tick = 0, ns = 0;
+
+        if(!GWUtilClock::__is_tsc_invariant()){
+            GW_WARN("TSC isn't invariant, use CLOCK_MONOTONIC_RAW as the clock source");
+            this->__use_monotonic_raw();
+            return;
+        }
+
+        this->_source = GW_UTIL_CLOCK_SOURCE_TSC;
+        GWUtilClock::__sample_tsc_pair(this->_base_tick, this->_base_ns);
+        do {
+            std::this_thread::sleep_for(std::chrono::milliseconds(GW_UTIL_CLOCK_CALIBRATION_WINDOW_MS));
+            GWUtilClock::__sample_tsc_pair(tick, ns);
+        } while(ns - this->_base_ns < GW_UTIL_CLOCK_CALIBRATION_WINDOW_MS * 1000000ull);
+        this->__calibrate(tick, ns);
+
+        // NOTE(zhuobin): TSC could be invariant but still unusable (e.g., misreported
+        //                by the hypervisor), in which case it barely ticks
+        if(unlikely(this->get_freq() < 1e8)){
+            GW_WARN(
+                "TSC frequency is implausible, use CLOCK_MONOTONIC_RAW as the clock source: freq(%lf)",
+                this->get_freq()
+            );
+            this->__use_monotonic_raw();
+            return;
+        }
+
+        this->_recalibration_period_ticks = this->ns_to_ticks(GW_UTIL_CLOCK_RECALIBRATION_PERIOD_MS * 1000000ull);
+    }
+
+
+    ~GWUtilClock() = default;
+
+
+    /*!
+     *  \brief  use CLOCK_MONOTONIC_RAW as the clock source, whose ticks are in ns
+     */
+    inline void __use_monotonic_raw(){
+        this->_source = GW_UTIL_CLOCK_SOURCE_MONOTONIC_RAW;
+        this->_mult.store(1ull << GW_UTIL_CLOCK_FIXED_POINT_SHIFT, std::memory_order_relaxed);
+        this->_mult_inv.store(1ull << GW_UTIL_CLOCK_FIXED_POINT_SHIFT, std::memory_order_relaxed);
+        this->_anchor_tick.store(0, std::memory_order_relaxed);
+        this->_anchor_ns.store(0, std::memory_order_relaxed);
+        this->_freq.store(1e9, std::memory_order_relaxed);
+        this->_recalibration_period_ticks = UINT64_MAX;
+    }
+
+
+    /*!
+     *  \brief  recalibrate once the anchor is older than the recalibration period
+     *  \note   this is checked on every conversion, it costs a TSC read and is skipped
+     *          if ticks come from CLOCK_MONOTONIC_RAW
+     */
+    inline void __correct_drift(){
+        if(this->_source != GW_UTIL_CLOCK_SOURCE_TSC)
+            return;
+        if(unlikely(
+            GWUtilClock::__read_tsc() - this->_anchor_tick.load(std::memory_order_relaxed)
+                >= this->_recalibration_period_ticks
+        )){
+            this->__try_recalibrate();
+        }
+    }
+
+
+    /*!
+     *  \brief  recalibrate if no one else is doing so, readers never wait for the recalibration
+     */
+    inline void __try_recalibrate(){
+        std::unique_lock lock(this->_mutex_calibration, std::try_to_lock);
+        if(!lock.owns_lock())
+            return;
+
+        // NOTE(zhuobin): another thread might have just recalibrated before we take the lock
+        if(GWUtilClock::__read_tsc() - this->_anchor_tick.load(std::memory_order_relaxed) < this->_recalibration_period_ticks)
+            return;
+        this->__recalibrate();
+    }
+
+
+    /*!
+     *  \brief  recalibrate, should be called with _mutex_calibration held
+     */
+    inline void __recalibrate(){
+        uint64_t tick = 0, ns = 0;
+        if(this->_source != GW_UTIL_CLOCK_SOURCE_TSC)
+            return;
+        GWUtilClock::__sample_tsc_pair(tick, ns);
+        this->__calibrate(tick, ns);
+    }
+
+
+    /*!
+     *  \brief  estimate the TSC frequency from the base pair to the given pair, and anchor
+     *          the conversion at the given pair
+     *  \param  tick    TSC tick
+     *  \param  ns      time on CLOCK_MONOTONIC_RAW (ns) paired with the tick
+     */
+    inline void __calibrate(uint64_t tick, uint64_t ns){
+        const uint64_t nb_ticks = tick - this->_base_tick, nb_ns = ns - this->_base_ns;
+        const uint64_t seq = this->_seq.load(std::memory_order_relaxed);
+
+        if(unlikely(nb_ticks == 0 or nb_ns == 0))
+            return;
+
+        // seqlock: readers retry while the sequence is odd or changed
+        this->_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        this->_mult.store(
+            static_cast<uint64_t>((static_cast<unsigned __int128>(nb_ns) << GW_UTIL_CLOCK_FIXED_POINT_SHIFT) / nb_ticks),
+            std::memory_order_relaxed
+        );
+        this->_mult_inv.store(
+            static_cast<uint64_t>((static_cast<unsigned __int128>(nb_ticks) << GW_UTIL_CLOCK_FIXED_POINT_SHIFT) / nb_ns),
+            std::memory_order_relaxed
+        );
+        this->_anchor_tick.store(tick, std::memory_order_relaxed);
+        this->_anchor_ns.store(ns, std::memory_order_relaxed);
+        this->_seq.store(seq + 2, std::memory_order_release);
+
+        this->_freq.store(static_cast<double>(nb_ticks) * 1e9 / static_cast<double>(nb_ns), std::memory_order_relaxed);
+    }
+
+
+    /*!
+     *  \brief  pair a TSC tick with CLOCK_MONOTONIC_RAW, the tick is taken as the midpoint
+     *          of the tightest bracket around reading CLOCK_MONOTONIC_RAW
+     *  \param  tick    TSC tick
+     *  \param  ns      time on CLOCK_MONOTONIC_RAW (ns)
+     */
+    static inline void __sample_tsc_pair(uint64_t& tick, uint64_t& ns){
+        uint64_t i = 0, s_tick = 0, e_tick = 0, sample_ns = 0, min_bracket = UINT64_MAX;
+
+        for(i=0; i<GW_UTIL_CLOCK_NB_PAIRING_SAMPLES; i++){
+            s_tick = GWUtilClock::__read_tsc();
+            sample_ns = GWUtilClock::__read_monotonic_raw_ns();
+            e_tick = GWUtilClock::__read_tsc();
+            if(e_tick - s_tick < min_bracket){
+                min_bracket = e_tick - s_tick;
+                tick = s_tick + min_bracket / 2;
+                ns = sample_ns;
+            }
+        }
+    }
+
+
+    /*!
+     *  \brief  check whether TSC is invariant
+     *  \return whether TSC is invariant
+     */
+    static inline bool __is_tsc_invariant(){
+    #if defined(__x86_64__) || defined(__i386__)
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if(__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 or eax < 0x80000007)
+            return false;
+        if(__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0)
+            return false;
+        return (edx & (1u << 8)) != 0;
+    #else
+        return false;
+    #endif
+    }
+
+
+    static inline uint64_t __read_tsc(){
+    #if defined(__x86_64__) || defined(__i386__)
+        uint64_t a, d;
+        __asm__ volatile("rdtsc" : "=a"(a), "=d"(d));
+        return (d << 32) | a;
+    #else
+        return GWUtilClock::__read_monotonic_raw_ns();
+    #endif
+    }
+
+
+    static inline uint64_t __read_monotonic_raw_ns(){
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+
+    static inline uint64_t __mul_shift(uint64_t value, uint64_t mult){
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(value) * mult) >> GW_UTIL_CLOCK_FIXED_POINT_SHIFT);
+    }
+
+    // source of ticks, fixed once the service is constructed
+    gw_util_clock_source_t _source = GW_UTIL_CLOCK_SOURCE_MONOTONIC_RAW;
+
+    // pair of the first calibration, the frequency is estimated from it
+    uint64_t _base_tick = 0;
+    uint64_t _base_ns = 0;
+    uint64_t _recalibration_period_ticks = UINT64_MAX;
+    std::mutex _mutex_calibration;
+
+    // conversion parameters, the anchor and multiplier are published under the seqlock
+    alignas(64) std::atomic<uint64_t> _seq = 0;
+    std::atomic<uint64_t> _anchor_tick = 0;
+    std::atomic<uint64_t> _anchor_ns = 0;
+    std::atomic<uint64_t> _mult = 0;
+    std::atomic<uint64_t> _mult_inv = 0;
+    std::atomic<double> _freq = 0;
+};
+
+
 /*!
  *  \brief  TSC-based timer
+ *  \note   ticks and the frequency come from the process-wide clock service, so ticks of
+ *          all timers are comparable, and constructing a timer doesn't measure the frequency
  */
 class GWUtilTscTimer {
  public:
-    GWUtilTscTimer(){ this->update_tsc_freq(); }
+    GWUtilTscTimer() : _clock(GWUtilClock::instance()) {}
 
 
     ~GWUtilTscTimer() = default;
@@ -81,12 +453,11 @@ class GWUtilTscTimer {
 
     /*!
      *  \brief  ontain TSC tick
+     *  \note   the tick comes from CLOCK_MONOTONIC_RAW (ns) if TSC isn't invariant
      *  \return TSC tick
      */
     static inline uint64_t get_tsc(){
-        uint64_t a, d;
-        __asm__ volatile("rdtsc" : "=a"(a), "=d"(d));
-        return (d << 32) | a;
+        return GWUtilClock::get_tick();
     }
 
 
@@ -115,25 +486,10 @@ class GWUtilTscTimer {
 
 
     /*!
-     *  \brief  update the TSC frequency
+     *  \brief  update the TSC frequency, i.e., recalibrate the clock service
      */
     inline void update_tsc_freq(){
-        GWUtilHpetTimer hpet;
-        uint64_t sum = 5;
-
-        hpet.start();
-
-        // Do not change this loop! The hardcoded value below depends on this loop
-        // and prevents it from being optimized out.
-        const uint64_t rdtsc_start = this->get_tsc();
-        for (uint64_t i = 0; i < 1000000; i++) {
-            sum += i + (sum + i) * (i % sum);
-        }
-        GW_ASSERT(sum == 13580802877818827968ull);
-        const uint64_t rdtsc_cycles = this->get_tsc() - rdtsc_start;
-
-        this->_tsc_freq_g = rdtsc_cycles * 1.0 / hpet.stop_get_ns();
-        this->_tsc_freq = this->_tsc_freq_g * 1000000000;
+        this->_clock.recalibrate();
     }
 
 
@@ -144,7 +500,7 @@ class GWUtilTscTimer {
      *  \return duration (ms)
      */
     inline double tick_range_to_ms(uint64_t e_tick, uint64_t s_tick){
-        return (double)(e_tick - s_tick) / (double) this->_tsc_freq * (double)1000.0f;
+        return (double)(this->_clock.ticks_to_ns(e_tick - s_tick)) / (double)1000000.0f;
     }
 
 
@@ -155,7 +511,7 @@ class GWUtilTscTimer {
      *  \return duration (us)
      */
     inline double tick_range_to_us(uint64_t e_tick, uint64_t s_tick){
-        return (double)(e_tick - s_tick) / (double) this->_tsc_freq * (double)1000000.0f;
+        return (double)(this->_clock.ticks_to_ns(e_tick - s_tick)) / (double)1000.0f;
     }
 
 
@@ -165,7 +521,7 @@ class GWUtilTscTimer {
      *  \return tick steps
      */
     inline double ms_to_tick(uint64_t duration){
-        return (double)(duration) / (double)1000.0f * (double) this->_tsc_freq;
+        return (double)(this->_clock.ns_to_ticks(duration * 1000000));
     }
 
 
@@ -175,7 +531,7 @@ class GWUtilTscTimer {
      *  \return tick steps
      */
     inline double us_to_tick(uint64_t duration){
-        return (double)(duration) / (double)1000000.0f * (double) this->_tsc_freq;
+        return (double)(this->_clock.ns_to_ticks(duration * 1000));
     }
 
 
@@ -185,7 +541,7 @@ class GWUtilTscTimer {
      *  \return duration  duration (ms)
      */
     inline double tick_to_ms(uint64_t ticks){
-        return (double)(ticks) * (double)1000.0f / (double) this->_tsc_freq;
+        return (double)(this->_clock.ticks_to_ns(ticks)) / (double)1000000.0f;
     }
 
 
@@ -195,20 +551,19 @@ class GWUtilTscTimer {
      *  \return duration  duration (us)
      */
     inline double tick_to_us(uint64_t ticks){
-        return (double)(ticks) * (double)1000000.0f / (double) this->_tsc_freq;
+        return (double)(this->_clock.ticks_to_ns(ticks)) / (double)1000.0f;
     }
 
 
     /*!
      *  \brief  obtain TSC frequency
-     *  \return TSC frequency (GHz)
+     *  \return TSC frequency (Hz)
      */
     inline double get_tsc_freq(){
-        return this->_tsc_freq;
+        return this->_clock.get_freq();
     }
 
  private:
-    // frequency of TSC register
-    double _tsc_freq_g;
-    double _tsc_freq;
+    // the process-wide clock service
+    GWUtilClock& _clock;
 };
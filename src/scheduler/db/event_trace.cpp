@@ -0,0 +1,117 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <format>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/database_sql.hpp"
+#include "common/utils/database_timeseries.hpp"
+#include "capsule/event.hpp"
+#include "capsule/event_merge.hpp"
+#include "capsule/event_exporter.hpp"
+#include "scheduler/scheduler.hpp"
+
+
+gw_retval_t GWScheduler::export_event_trace(const std::string& output_path, const std::string& format, uint64_t& nb_events){
+    gw_retval_t retval = GW_SUCCESS;
+    gw_event_trace_export_format_t export_format = GW_EVENT_TRACE_EXPORT_PERFETTO;
+    GWUtilSqlQueryResult result;
+    GWEventTraceMerger merger;
+    std::deque<GWEvent> list_events;
+    std::deque<GWEventTraceView> list_views;
+    std::vector<GWUtilTimeSeriesSample> list_samples;
+    gw_event_trace_clock_t clock;
+    uint64_t nb_skipped_events = 0;
+    const gw_event_typeid_t list_type_ids[] = {
+        GW_EVENT_TYPE_CPU, GW_EVENT_TYPE_GPU, GW_EVENT_TYPE_APP, GW_EVENT_TYPE_GWATCH
+    };
+
+    nb_events = 0;
+
+    GW_IF_FAILED(
+        GWEventTraceExporter::string_to_format(format, export_format),
+        retval,
+        {
+            GW_WARN_C("unknown format of trace file: format(%s)", format.c_str());
+            goto exit;
+        }
+    );
+
+    // clock domain of each capsule comes from its own record and the record of its node
+    GW_IF_FAILED(
+        this->_db_sql.query(
+            "SELECT mgnt_capsule.global_id, mgnt_cpu.tsc_freq, mgnt_capsule.start_tsc, mgnt_capsule.start_time "
+            "FROM mgnt_capsule JOIN mgnt_cpu ON mgnt_capsule.cpu_global_id = mgnt_cpu.global_id;",
+            result
+        ),
+        retval,
+        {
+            GW_WARN_C("failed to query clock domains of capsules: error(%s)", gw_retval_str(retval));
+            goto exit;
+        }
+    );
+
+    for(const std::vector<std::string>& row : result.rows){
+        std::map<uint64_t, std::vector<const GWEvent*>> map_event_trace;
+
+        if(unlikely(row.size() != 4)){
+            GW_WARN_C("skipped malformed record of capsule: nb_columns(%lu)", row.size());
+            continue;
+        }
+
+        if(unlikely(GWEventTraceMerger::build_clock(row[1], row[2], row[3], clock) != GW_SUCCESS)){
+            GW_WARN_C("skipped events of capsule with malformed clock domain: global_id(%s)", row[0].c_str());
+            continue;
+        }
+
+        for(gw_event_typeid_t type_id : list_type_ids){
+            list_samples.clear();
+            if(this->_db_ts.query(
+                std::format("/capsule/{}/{}event", row[0], GWEvent::typeid_to_string(type_id)), list_samples
+            ) != GW_SUCCESS){
+                continue;
+            }
+
+            for(GWUtilTimeSeriesSample& raw_sample : list_samples){
+                GWEvent& event = list_events.emplace_back();
+                if(unlikely(event.from_json(raw_sample.payload) != GW_SUCCESS)){
+                    list_events.pop_back();
+                    nb_skipped_events += 1;
+                    continue;
+                }
+                map_event_trace[event.thread_id].push_back(&event);
+            }
+        }
+        if(map_event_trace.empty())
+            continue;
+
+        GWEventTraceView& view = list_views.emplace_back();
+        view.load(std::move(map_event_trace));
+        view.set_clock(clock);
+        merger.add_view(&view);
+    }
+    if(unlikely(nb_skipped_events > 0)){
+        GW_WARN_C("skipped malformed events while exporting event trace: nb_skipped_events(%lu)", nb_skipped_events);
+    }
+
+    GW_IF_FAILED(
+        merger.export_trace(output_path, export_format),
+        retval,
+        {
+            GW_WARN_C("failed to export event trace: path(%s), error(%s)", output_path.c_str(), gw_retval_str(retval));
+            goto exit;
+        }
+    );
+    nb_events = list_events.size();
+
+    GW_DEBUG_C(
+        "exported event trace: output(%s), nb_capsules(%lu), nb_events(%lu)",
+        output_path.c_str(), list_views.size(), nb_events
+    );
+
+exit:
+    return retval;
+}
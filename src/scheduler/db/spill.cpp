@@ -0,0 +1,105 @@
+#include <iostream>
+#include <string>
+
+#include "common/common.hpp"
+#include "common/log.hpp"
+#include "common/utils/spill_ring.hpp"
+#include "common/utils/database_timeseries.hpp"
+#include "capsule/event.hpp"
+#include "capsule/event_exporter.hpp"
+#include "scheduler/scheduler.hpp"
+#include "scheduler/serve/capsule_message.hpp"
+#include "scheduler/serve/database_ts_message.hpp"
+
+
+gw_retval_t GWScheduler::export_event_spill(
+    const std::string& spill_path, const std::string& output_path, const std::string& format, uint64_t& nb_events
+){
+    gw_retval_t retval = GW_SUCCESS, tmp_retval = GW_SUCCESS;
+    GWUtilSpillRing spill_ring;
+    GWInternalMessagePayload_Common_DB_TS_BatchWrite payload;
+    GWEventTraceExporter exporter;
+    gw_event_trace_export_format_t export_format = GW_EVENT_TRACE_EXPORT_PERFETTO;
+    std::string frame = "";
+    uint64_t nb_frames = 0, nb_skipped_events = 0;
+
+    nb_events = 0;
+
+    GW_IF_FAILED(
+        GWEventTraceExporter::string_to_format(format, export_format),
+        retval,
+        {
+            GW_WARN("unknown format of trace file: format(%s)", format.c_str());
+            goto exit;
+        }
+    );
+
+    // the ring is opened read-only, so that exporting never consumes batches to be replayed
+    GW_IF_FAILED(
+        spill_ring.open(spill_path, 0, true),
+        retval,
+        {
+            GW_WARN("failed to open spill ring: path(%s)", spill_path.c_str());
+            goto exit;
+        }
+    );
+
+    // NOTE(zhuobin): spill rings are exported on the node of the capsule, so ticks are
+    //                converted by the TSC frequency measured on current node
+    GW_IF_FAILED(
+        exporter.open(output_path, export_format),
+        retval,
+        {
+            GW_WARN("failed to open trace file: path(%s)", output_path.c_str());
+            goto exit;
+        }
+    );
+
+    while(true){
+        retval = spill_ring.read_next(frame);
+        if(retval == GW_FAILED_NOT_EXIST){
+            retval = GW_SUCCESS;
+            break;
+        } else if(unlikely(retval != GW_SUCCESS)){
+            GW_WARN("malformed spill ring, exported partially: path(%s), nb_frames(%lu)", spill_path.c_str(), nb_frames);
+            break;
+        }
+        nb_frames += 1;
+
+        if(unlikely(payload.deserialize_frame(reinterpret_cast<const uint8_t*>(frame.data()), frame.size()) != GW_SUCCESS)){
+            GW_WARN("skipped unknown frame in spill ring: path(%s), index(%lu)", spill_path.c_str(), nb_frames - 1);
+            continue;
+        }
+
+        // each sample carries an event as its payload
+        for(const GWUtilTimeSeriesSample& sample : payload.list_samples){
+            GWEvent event;
+            if(unlikely(event.from_json(sample.payload) != GW_SUCCESS)){
+                nb_skipped_events += 1;
+                continue;
+            }
+            tmp_retval = exporter.write_event(&event);
+            if(unlikely(tmp_retval != GW_SUCCESS)){
+                nb_skipped_events += 1;
+                continue;
+            }
+            nb_events += 1;
+        }
+    }
+    if(unlikely(nb_skipped_events > 0)){
+        GW_WARN("skipped malformed events while exporting spill ring: nb_skipped_events(%lu)", nb_skipped_events);
+    }
+
+    // keep the partially exported trace readable even if the spill ring is malformed
+    tmp_retval = exporter.close();
+    if(retval == GW_SUCCESS)
+        retval = tmp_retval;
+
+    GW_DEBUG(
+        "exported spill ring: path(%s), output(%s), nb_frames(%lu), nb_events(%lu)",
+        spill_path.c_str(), output_path.c_str(), nb_frames, nb_events
+    );
+
+exit:
+    return retval;
+}
@@ -47,6 +47,7 @@ gw_retval_t GWScheduler::__init_sql(){
                                     "cpu_name           TEXT NOT NULL, "
                                     "ip_addr            TEXT NOT NULL, "
                                     "tsc_freq           DOUBLE NOT NULL, "
+                                    "clock_source       TEXT NOT NULL, "
                                     "num_cpu_cores      INTEGER NOT NULL, "
                                     "num_numa_nodes     INTEGER NOT NULL, "
                                     "dram_size          INTEGER NOT NULL"
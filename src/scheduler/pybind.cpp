@@ -43,8 +43,29 @@ PYBIND11_MODULE(libgwatch_scheduler, m) {
        .def("get_capsule_world_size", [](GWScheduler &self){
             return self.get_capsule_world_size();
        })
+        .def("export_event_trace", [](GWScheduler &self, std::string output_path, std::string format){
+            gw_retval_t retval;
+            uint64_t nb_events = 0;
+            GW_IF_FAILED(
+                self.export_event_trace(output_path, format, nb_events),
+                retval,
+                throw GWException("scheduler failed to export event trace");
+            );
+            return nb_events;
+        })
     ;
 
+    m.def("export_event_spill", [](std::string spill_path, std::string output_path, std::string format){
+        gw_retval_t retval;
+        uint64_t nb_events = 0;
+        GW_IF_FAILED(
+            GWScheduler::export_event_spill(spill_path, output_path, format, nb_events),
+            retval,
+            throw GWException("failed to export event spill ring");
+        );
+        return nb_events;
+    });
+
     /* ==================== Agent ==================== */
     pybind11::class_<gw_scheduler_config_t>(m, "GWSchedulerConfig")
         .def(pybind11::init<>())
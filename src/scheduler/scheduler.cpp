@@ -43,6 +43,12 @@ GWScheduler::~GWScheduler() {
     int sdk_retval = 0;
     gw_process_launch_meta_t *profiler_launch_meta = nullptr;
 
+    // pending batches of timeseries samples are drained before the worker exits
+    if(this->_ts_batch_pool != nullptr){
+        delete this->_ts_batch_pool;
+        this->_ts_batch_pool = nullptr;
+    }
+
     // kill main capsule
     if(this->_main_capsule_launch_meta != nullptr){
         if(this->_main_capsule_launch_meta->pipe != nullptr){
@@ -751,10 +757,31 @@ int GWScheduler::__websocket_callback(
             );
             if(lws_is_final_fragment(wsi)){
                 recv_buf = capsule_instance->export_recv_buf();
-                GW_DEBUG("received message from capsule: wsi(%p), ip(%s), port(%u), message(%s)", wsi, client_ip, client_port, recv_buf);
 
-                capsule_message.deserialize(recv_buf);
-                capsule_instance->reset_recv_buf();
+                // batches of timeseries samples come as binary frames, other messages are json
+                if(lws_frame_is_binary(wsi)){
+                    GW_DEBUG(
+                        "received binary message from capsule: wsi(%p), ip(%s), port(%u), size(%lu)",
+                        wsi, client_ip, client_port, capsule_instance->get_recv_buf_size()
+                    );
+                    capsule_message.type_id = GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB;
+                    sdk_retval = capsule_message.get_payload_ptr<GWInternalMessagePayload_Common_DB_TS_BatchWrite>(
+                        GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB
+                    )->deserialize_frame(
+                        reinterpret_cast<const uint8_t*>(recv_buf), capsule_instance->get_recv_buf_size()
+                    );
+                    capsule_instance->reset_recv_buf();
+
+                    // a malformed frame goes on without samples, so that it's still acknowledged
+                    // in the order of frames, and the capsule doesn't retry it forever
+                    if(unlikely(sdk_retval != GW_SUCCESS)){
+                        GW_WARN("failed to unpack binary message from capsule, dropped: ip(%s), port(%u)", client_ip, client_port);
+                    }
+                } else {
+                    GW_DEBUG("received message from capsule: wsi(%p), ip(%s), port(%u), message(%s)", wsi, client_ip, client_port, recv_buf);
+                    capsule_message.deserialize(recv_buf);
+                    capsule_instance->reset_recv_buf();
+                }
 
                 GW_IF_FAILED(
                     scheduler->__process_capsule_resp(capsule_instance, client_socket_addr, &capsule_message),
@@ -25,6 +25,8 @@
 #include "common/utils/database_kv.hpp"
 #include "common/utils/database_sql.hpp"
 #include "common/utils/database_timeseries.hpp"
+#include "common/utils/spill_ring.hpp"
+#include "common/utils/thread_pool.hpp"
 #include "scheduler/serve/capsule_message.hpp"
 #include "scheduler/serve/capsule_instance.hpp"
 #include "scheduler/serve/gtrace_message.hpp"
@@ -96,6 +98,37 @@ class GWScheduler {
     gw_retval_t __init_db();
     gw_retval_t __init_sql();
     gw_retval_t __init_vector();
+
+ public:
+    /*!
+     *  \brief  export events spilled by a capsule (see GW_EVENT_SPILL_DIR) to a trace file
+     *          through GWEventTraceExporter, so that traces of offline capsules could be
+     *          collected without the scheduler
+     *  \param  spill_path  path to the spill ring of the capsule
+     *  \param  output_path path to the trace file
+     *  \param  format      format of the trace file: perfetto / chrome_json
+     *  \param  nb_events   number of exported events
+     *  \return GW_SUCCESS if successful,
+     *          GW_FAILED_NOT_EXIST if failed to open the spill ring or the trace file,
+     *          GW_FAILED_INVALID_INPUT for unknown format or malformed spill ring
+     */
+    static gw_retval_t export_event_spill(
+        const std::string& spill_path, const std::string& output_path, const std::string& format, uint64_t& nb_events
+    );
+
+
+    /*!
+     *  \brief  export events reported by all capsules to a single trace file, ticks of each
+     *          capsule are aligned onto a common timeline by the clock domain built from
+     *          its records in mgnt_capsule / mgnt_cpu, and events are k-way merged
+     *  \param  output_path path to the trace file
+     *  \param  format      format of the trace file: perfetto / chrome_json
+     *  \param  nb_events   number of exported events
+     *  \return GW_SUCCESS if successful,
+     *          GW_FAILED_INVALID_INPUT for unknown format,
+     *          otherwise the error of the database or the exporter
+     */
+    gw_retval_t export_event_trace(const std::string& output_path, const std::string& format, uint64_t& nb_events);
     /* ===================== Database ====================== */
 
 
@@ -146,6 +179,9 @@ class GWScheduler {
     // processing thread of per-capsule
     std::map<GWCapsuleInstance*, std::thread*> _map_capsule_processing_thread;
 
+    // persistent worker processing batches of timeseries samples from capsules in order
+    GWUtilThreadPool *_ts_batch_pool = nullptr;
+
     // set of ip addresses of all active capsule 
     std::set<std::string> _set_all_active_capsule_ip;
 
@@ -308,6 +344,9 @@ class GWScheduler {
     gw_retval_t __process_capsule_resp_DB_TS_WRITE(
         GWCapsuleInstance *capsule_instance, gw_socket_addr_t addr, GWInternalMessage_Capsule *message
     );
+    gw_retval_t __process_capsule_resp_DB_TS_BATCH_WRITE(
+        GWCapsuleInstance *capsule_instance, gw_socket_addr_t addr, GWInternalMessage_Capsule *message
+    );
     gw_retval_t __process_capsule_resp_DB_SQL_CREATE_TABLE(
         GWCapsuleInstance *capsule_instance, gw_socket_addr_t addr, GWInternalMessage_Capsule *message
     );
@@ -26,6 +26,9 @@ enum :gw_message_typeid_t {
 
     // message for capsule to report topology to scheduler
     GW_MESSAGE_TYPEID_CAPSULE_REGISTER,
+
+    // message for scheduler to acknowledge a batch frame of timeseries samples
+    GW_MESSAGE_TYPEID_CAPSULE_BATCH_ACK,
 };
 
 
@@ -139,6 +142,9 @@ typedef struct gw_capsule_cpu_info {
     // TSC frequency
     double tsc_freq = 0;
 
+    // source of ticks, i.e., "tsc" or "monotonic_raw" (ticks are in ns)
+    std::string clock_source = "";
+
     // CPU name
     std::string cpu_name = "";
 
@@ -156,6 +162,7 @@ typedef struct gw_capsule_cpu_info {
             this->global_id = other.global_id;
             this->ip_addr = other.ip_addr;
             this->tsc_freq = other.tsc_freq;
+            this->clock_source = other.clock_source;
             this->cpu_name = other.cpu_name;
             this->num_cpu_cores = other.num_cpu_cores;
             this->num_numa_nodes = other.num_numa_nodes;
@@ -176,6 +183,7 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
     cpu_name,
     ip_addr,
     tsc_freq,
+    clock_source,
     num_cpu_cores,
     num_numa_nodes,
     dram_size
@@ -323,15 +331,67 @@ class GWInternalMessagePayload_Capsule_Register final : public GWInternalMessage
 };
 
 
+/*!
+ *  \brief  acknowledgement of a binary batch frame, sent by the scheduler once the batch is
+ *          written to the database (or dropped as malformed), in the order of frames received,
+ *          so that the capsule consumes the batch from its spill ring
+ */
+class GWInternalMessagePayload_Capsule_BatchAck final : public GWInternalMessagePayload {
+ public:
+    GWInternalMessagePayload_Capsule_BatchAck() : GWInternalMessagePayload() {}
+    ~GWInternalMessagePayload_Capsule_BatchAck() = default;
+
+    /*!
+     *  \brief  serialize the payload to json object
+     *  \return json object
+     */
+    nlohmann::json serialize() override {
+        nlohmann::json object;
+        object["success"] = this->success;
+        object["uri"] = this->uri;
+        object["nb_samples"] = this->nb_samples;
+        return object;
+    }
+
+    /*!
+     *  \brief  deserialize the payload from json object
+     *  \param  json object
+     *  \return GW_SUCCESS for successfully deserialized
+     */
+    void deserialize(const nlohmann::json& json) override {
+        if(json.contains("success"))
+            this->success = json["success"];
+        if(json.contains("uri"))
+            this->uri = json["uri"];
+        if(json.contains("nb_samples"))
+            this->nb_samples = json["nb_samples"];
+    }
+
+    // index of the message type
+    static constexpr gw_message_typeid_t msg_typeid = GW_MESSAGE_TYPEID_CAPSULE_BATCH_ACK;
+
+    // whether the batch is written to the database
+    bool success = false;
+
+    // uri of the batch
+    std::string uri = "";
+
+    // number of samples written
+    uint64_t nb_samples = 0;
+};
+
+
 class GWInternalMessage_Capsule final : public GWInternalMessage<
     GWInternalMessagePayload_Common_PingPong,
     GWInternalMessagePayload_Common_DB_KV_Write,
     GWInternalMessagePayload_Common_DB_TS_Write,
+    GWInternalMessagePayload_Common_DB_TS_BatchWrite,
     GWInternalMessagePayload_Common_DB_SQL_Write,
     GWInternalMessagePayload_Common_DB_SQL_CreateTable,
     GWInternalMessagePayload_Common_DB_SQL_DropTable,
     GWInternalMessagePayload_Capsule_Heartbeat,
-    GWInternalMessagePayload_Capsule_Register
+    GWInternalMessagePayload_Capsule_Register,
+    GWInternalMessagePayload_Capsule_BatchAck
 >{
  public:
     GWInternalMessage_Capsule() : GWInternalMessage() {}
@@ -132,6 +132,7 @@ gw_retval_t GWScheduler::__process_capsule_resp_REGISTER(
                     { "cpu_name", payload->cpu_info.cpu_name },
                     { "ip_addr", payload->cpu_info.ip_addr },
                     { "tsc_freq", std::to_string(payload->cpu_info.tsc_freq) },
+                    { "clock_source", payload->cpu_info.clock_source },
                     { "num_cpu_cores", std::to_string(payload->cpu_info.num_cpu_cores) },
                     { "num_numa_nodes", std::to_string(payload->cpu_info.num_numa_nodes) },
                     { "dram_size", std::to_string(payload->cpu_info.dram_size) },
@@ -141,11 +142,12 @@ gw_retval_t GWScheduler::__process_capsule_resp_REGISTER(
             goto exit;
         )
         GW_DEBUG_C(
-            "record new CPU to database: global_id(%s), cpu_name(%s), ip_addr(%s), tsc_freq(%lf), num_cpu_cores(%d), num_numa_nodes(%d), dram_size(%lu)", 
+            "record new CPU to database: global_id(%s), cpu_name(%s), ip_addr(%s), tsc_freq(%lf), clock_source(%s), num_cpu_cores(%d), num_numa_nodes(%d), dram_size(%lu)", 
             payload->cpu_info.global_id.c_str(),
             payload->cpu_info.cpu_name.c_str(),
             payload->cpu_info.ip_addr.c_str(),
             payload->cpu_info.tsc_freq,
+            payload->cpu_info.clock_source.c_str(),
             payload->cpu_info.num_cpu_cores,
             payload->cpu_info.num_numa_nodes,
             payload->cpu_info.dram_size
@@ -298,6 +300,58 @@ exit:
 }
 
 
+gw_retval_t GWScheduler::__process_capsule_resp_DB_TS_BATCH_WRITE(
+    GWCapsuleInstance *capsule_instance, gw_socket_addr_t addr, GWInternalMessage_Capsule *message
+){
+    gw_retval_t retval = GW_SUCCESS;
+    GWInternalMessagePayload_Common_DB_TS_BatchWrite *payload;
+    GWInternalMessage_Capsule ack_message;
+    GWInternalMessagePayload_Capsule_BatchAck *ack_payload;
+    uint64_t nb_samples = 0;
+
+    GW_CHECK_POINTER(message);
+    GW_CHECK_POINTER(capsule_instance);
+    GW_ASSERT(message->type_id == GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB);
+
+    payload = message->get_payload_ptr<GWInternalMessagePayload_Common_DB_TS_BatchWrite>(GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB);
+    GW_CHECK_POINTER(payload);
+
+    // malformed frames arrive without samples, they are acknowledged as failed below
+    if(unlikely(payload->list_samples.empty())){
+        retval = GW_FAILED_INVALID_INPUT;
+        goto exit;
+    }
+
+    // samples were decoded from the frame straight into the payload, and are moved into the series
+    nb_samples = payload->list_samples.size();
+    GW_IF_FAILED(
+        this->_db_ts.append_batch(payload->uri, payload->list_samples),
+        retval,
+        {
+            GW_WARN_C("failed to write batch to timeseries database: uri(%s)", payload->uri.c_str());
+            goto exit;
+        }
+    );
+    GW_DEBUG_C("capsule write batch to timeseries database: uri(%s), nb_samples(%lu)", payload->uri.c_str(), nb_samples);
+
+exit:
+    // acknowledge the batch so that the capsule consumes it from its spill ring, batches
+    // are processed one at a time per capsule, so acknowledgements keep the order of frames
+    ack_message.type_id = GW_MESSAGE_TYPEID_CAPSULE_BATCH_ACK;
+    ack_payload = ack_message.get_payload_ptr<GWInternalMessagePayload_Capsule_BatchAck>(GW_MESSAGE_TYPEID_CAPSULE_BATCH_ACK);
+    GW_CHECK_POINTER(ack_payload);
+    ack_payload->success = (retval == GW_SUCCESS);
+    ack_payload->uri = payload->uri;
+    ack_payload->nb_samples = retval == GW_SUCCESS ? nb_samples : 0;
+    if(unlikely(capsule_instance->send(ack_message.serialize()) != GW_SUCCESS)){
+        GW_WARN_C("failed to acknowledge batch to capsule: uri(%s)", payload->uri.c_str());
+    }
+
+    delete message;
+    return retval;
+}
+
+
 gw_retval_t GWScheduler::__process_capsule_resp_DB_SQL_CREATE_TABLE(
     GWCapsuleInstance *capsule_instance, gw_socket_addr_t addr, GWInternalMessage_Capsule *message
 ){
@@ -374,10 +428,30 @@ gw_retval_t GWScheduler::__process_capsule_resp(
         delete process_thread;
     }
 
+    // other messages are processed after pending batches, to keep the order of messages from capsules
+    if(
+        this->_ts_batch_pool != nullptr
+        and message->type_id != GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB
+        and message->type_id != GW_MESSAGE_TYPEID_CAPSULE_HEARTBEAT
+    ){
+        this->_ts_batch_pool->wait_idle();
+    }
+
     // we need to make a copy of the message to avoid the message being freed
     // message should be freed within callback
     GW_CHECK_POINTER(message_copy = new GWInternalMessage_Capsule());
-    message_copy->load_from_other(message);
+    if(message->type_id == GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB){
+        // batches carry thousands of samples, so they are moved instead of copied through json
+        message_copy->type_id = message->type_id;
+        message_copy->ref_id = message->ref_id;
+        message_copy->get_payload_ptr<GWInternalMessagePayload_Common_DB_TS_BatchWrite>(
+            GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB
+        )->move_from(*message->get_payload_ptr<GWInternalMessagePayload_Common_DB_TS_BatchWrite>(
+            GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB
+        ));
+    } else {
+        message_copy->load_from_other(message);
+    }
 
     switch(message->type_id){
         case GW_MESSAGE_TYPEID_COMMON_PINGPONG:
@@ -404,6 +478,24 @@ gw_retval_t GWScheduler::__process_capsule_resp(
             this->_map_capsule_processing_thread[capsule_instance] = process_thread;
             break;
 
+        case GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB:
+            // batches of all capsules are processed in order by a single persistent worker,
+            // as they serialize on the lock of the timeseries database anyway
+            if(unlikely(this->_ts_batch_pool == nullptr)){
+                GW_CHECK_POINTER(this->_ts_batch_pool = new GWUtilThreadPool(1));
+            }
+            GW_IF_FAILED(
+                this->_ts_batch_pool->submit([this, capsule_instance, addr, message_copy](){
+                    this->__process_capsule_resp_DB_TS_BATCH_WRITE(capsule_instance, addr, message_copy);
+                }),
+                retval,
+                {
+                    GW_WARN_C("failed to submit batch of timeseries samples");
+                    delete message_copy;
+                }
+            );
+            break;
+
         case GW_MESSAGE_TYPEID_COMMON_SQL_WRITE_DB:
             process_thread = new std::thread(
                 &GWScheduler::__process_capsule_resp_DB_SQL_WRITE, this, capsule_instance, addr, message_copy
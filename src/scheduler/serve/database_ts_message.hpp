@@ -4,6 +4,7 @@
 #include <map>
 #include <any>
 #include <string>
+#include <cstring>
 
 #include <stdint.h>
 #include <nlohmann/json.hpp>
@@ -12,6 +13,10 @@
 #include "common/log.hpp"
 #include "common/utils/exception.hpp"
 #include "common/utils/timer.hpp"
+#include "common/utils/bytes.hpp"
+#include "common/utils/compress.hpp"
+#include "common/utils/compact_json.hpp"
+#include "common/utils/database_timeseries.hpp"
 #include "common/message.hpp"
 
 
@@ -79,6 +84,331 @@ class GWInternalMessagePayload_Common_DB_TS_Write final : public GWInternalMessa
 };
 
 
+/*!
+ *  \brief  encoding of samples within a batch
+ */
+enum gw_ts_batch_encoding_t : uint8_t {
+    // dictionary of strings and delta-of-delta varints of integers (see GWUtilCompactJson)
+    GW_TS_BATCH_ENCODING_COMPACT = 0,
+
+    // GW_TS_BATCH_ENCODING_COMPACT, further compressed as a LZ4 block
+    GW_TS_BATCH_ENCODING_COMPACT_LZ4
+};
+
+
+// magic of a binary batch frame ("GWTB")
+#define GW_TS_BATCH_FRAME_MAGIC     0x42545747
+
+
+/*!
+ *  \brief  batch of samples appended to the same time series, which goes on the wire as a
+ *          single binary websocket frame instead of a json message:
+ *          magic (u32) | encoding (u8) | uri (uleb128 length + bytes) | nb_samples (uleb128)
+ *          | raw_size (uleb128) | samples, which is a compact json stream of samples
+ *  \note   samples are written into the stream as they are appended (e.g., by GWEvent::to_compact_json),
+ *          so that the sender never builds json values; the receiver decodes them straight into
+ *          list_samples, and moves them within the process by move_from() instead of copying
+ *          them through json
+ */
+class GWInternalMessagePayload_Common_DB_TS_BatchWrite final : public GWInternalMessagePayload {
+ public:
+    GWInternalMessagePayload_Common_DB_TS_BatchWrite() : GWInternalMessagePayload() {}
+    ~GWInternalMessagePayload_Common_DB_TS_BatchWrite() = default;
+
+
+    /*!
+     *  \brief  serialize the payload to json object
+     *  \note   batches are sent by serialize_frame, and moved within the process by move_from
+     *  \return json object
+     */
+    nlohmann::json serialize() override {
+        nlohmann::json object;
+        object["uri"] = this->uri;
+        object["samples"] = nlohmann::json::array();
+        for(const GWUtilTimeSeriesSample& sample : this->list_samples)
+            object["samples"].push_back(sample.serialize());
+        return object;
+    }
+
+
+    /*!
+     *  \brief  deserialize the payload from json object
+     *  \param  json object
+     *  \return GW_SUCCESS for successfully deserialized
+     */
+    void deserialize(const nlohmann::json& json) override {
+        uint64_t i = 0;
+
+        if(json.contains("uri"))
+            this->uri = json["uri"];
+        if(json.contains("samples") and json["samples"].is_array()){
+            this->list_samples.resize(json["samples"].size());
+            for(i=0; i<json["samples"].size(); i++){
+                if(unlikely(this->list_samples[i].deserialize(json["samples"][i]) != GW_SUCCESS)){
+                    this->list_samples.clear();
+                    break;
+                }
+            }
+        }
+    }
+
+
+    /*!
+     *  \brief  take over uri and received samples of another batch, which is left empty
+     *  \param  other   the other batch
+     */
+    inline void move_from(GWInternalMessagePayload_Common_DB_TS_BatchWrite& other){
+        this->uri = std::move(other.uri);
+        this->list_samples = std::move(other.list_samples);
+        this->encoding = other.encoding;
+        other.list_samples.clear();
+    }
+
+
+    /*!
+     *  \brief  append a sample to the batch
+     *  \param  index       index of the time series sample
+     *  \param  timestamp   timestamp of the time series sample
+     *  \param  payload     payload of the time series sample
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT if the payload contains binary
+     */
+    inline gw_retval_t append(uint64_t index, uint64_t timestamp, const nlohmann::json& payload){
+        gw_retval_t retval = GW_SUCCESS;
+        GWUtilCompactJson::Writer& writer = this->begin_sample(index, timestamp);
+        retval = writer.write_json(payload);
+        this->end_sample();
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  append a sample to the batch, whose payload is written by the caller into the
+     *          returned stream (exactly one value), followed by end_sample()
+     *  \param  index       index of the time series sample
+     *  \param  timestamp   timestamp of the time series sample
+     *  \return the stream to write the payload
+     */
+    inline GWUtilCompactJson::Writer& begin_sample(uint64_t index, uint64_t timestamp){
+        // in the form of GWUtilTimeSeriesSample
+        this->_samples_writer.begin_object(3);
+        this->_samples_writer.key("index");
+        this->_samples_writer.write_uint(index);
+        this->_samples_writer.key("timestamp");
+        this->_samples_writer.write_uint(timestamp);
+        this->_samples_writer.key("payload");
+        return this->_samples_writer;
+    }
+    inline void end_sample(){ this->_samples_writer.end(); }
+
+
+    /*!
+     *  \brief  obtain the number of samples appended to the batch
+     *  \return number of samples
+     */
+    inline uint64_t get_nb_samples() const { return this->_samples_writer.get_nb_values(); }
+
+
+    /*!
+     *  \brief  pack appended samples into a binary frame
+     *  \param  frame   the binary frame, overwritten
+     */
+    inline void serialize_frame(std::string& frame) const {
+        const std::vector<uint8_t>& samples_bytes = this->_samples_writer.get_bytes();
+        std::vector<uint8_t> header, compressed_bytes;
+        uint32_t magic = GW_TS_BATCH_FRAME_MAGIC;
+
+        header.insert(header.end(), reinterpret_cast<uint8_t*>(&magic), reinterpret_cast<uint8_t*>(&magic) + sizeof(uint32_t));
+        header.push_back(this->encoding);
+        GWUtilBytes::write_uleb128(header, this->uri.size());
+        header.insert(header.end(), this->uri.begin(), this->uri.end());
+        GWUtilBytes::write_uleb128(header, this->get_nb_samples());
+        GWUtilBytes::write_uleb128(header, samples_bytes.size());
+
+        frame.assign(reinterpret_cast<const char*>(header.data()), header.size());
+        if(this->encoding == GW_TS_BATCH_ENCODING_COMPACT_LZ4){
+            GWUtilCompress::lz4_compress(samples_bytes.data(), samples_bytes.size(), compressed_bytes);
+            frame.append(reinterpret_cast<const char*>(compressed_bytes.data()), compressed_bytes.size());
+        } else {
+            frame.append(reinterpret_cast<const char*>(samples_bytes.data()), samples_bytes.size());
+        }
+    }
+
+
+    /*!
+     *  \brief  unpack a binary frame into uri and list_samples
+     *  \param  frame       the binary frame
+     *  \param  frame_size  size of the binary frame
+     *  \return GW_SUCCESS for successfully unpacked, GW_FAILED_INVALID_INPUT for malformed frame
+     */
+    inline gw_retval_t deserialize_frame(const uint8_t* frame, uint64_t frame_size){
+        gw_retval_t retval = GW_SUCCESS;
+        const uint8_t *cursor = frame, *end = frame + frame_size;
+        std::vector<uint8_t> raw_bytes;
+        uint64_t uri_len = 0, nb_samples = 0, raw_size = 0;
+        uint32_t magic = 0;
+
+        this->list_samples.clear();
+
+        if(unlikely(frame_size < sizeof(uint32_t) + 1)){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        std::memcpy(&magic, cursor, sizeof(uint32_t));
+        cursor += sizeof(uint32_t);
+        if(unlikely(magic != GW_TS_BATCH_FRAME_MAGIC)){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        this->encoding = static_cast<gw_ts_batch_encoding_t>(*cursor);
+        cursor += 1;
+
+        if(unlikely(GWUtilBytes::read_uleb128(&cursor, end, uri_len) != GW_SUCCESS or uri_len > (uint64_t)(end - cursor))){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+        this->uri.assign(reinterpret_cast<const char*>(cursor), uri_len);
+        cursor += uri_len;
+
+        if(unlikely(
+            GWUtilBytes::read_uleb128(&cursor, end, nb_samples) != GW_SUCCESS
+            or GWUtilBytes::read_uleb128(&cursor, end, raw_size) != GW_SUCCESS
+        )){
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+
+        // reject forged sizes before allocating for decompression, each sample takes at least a byte
+        if(unlikely(
+            raw_size > GWUtilCompress::lz4_max_decompressed_size(end - cursor)
+            or nb_samples > raw_size
+        )){
+            GW_WARN_C(
+                "malformed batch of timeseries samples: uri(%s), nb_samples(%lu), raw_size(%lu), body_size(%lu)",
+                this->uri.c_str(), nb_samples, raw_size, (uint64_t)(end - cursor)
+            );
+            retval = GW_FAILED_INVALID_INPUT;
+            goto exit;
+        }
+
+        if(this->encoding == GW_TS_BATCH_ENCODING_COMPACT_LZ4){
+            retval = GWUtilCompress::lz4_decompress(cursor, end - cursor, raw_bytes, raw_size);
+            if(unlikely(retval != GW_SUCCESS)){
+                GW_WARN_C("failed to decompress batch of timeseries samples: uri(%s)", this->uri.c_str());
+                goto exit;
+            }
+            retval = __decode_samples(raw_bytes.data(), raw_bytes.size(), nb_samples);
+        } else if(this->encoding == GW_TS_BATCH_ENCODING_COMPACT){
+            retval = __decode_samples(cursor, end - cursor, nb_samples);
+        } else {
+            retval = GW_FAILED_INVALID_INPUT;
+        }
+        if(unlikely(retval != GW_SUCCESS or this->list_samples.size() != nb_samples)){
+            GW_WARN_C("failed to unpack batch of timeseries samples: uri(%s)", this->uri.c_str());
+            this->list_samples.clear();
+            retval = GW_FAILED_INVALID_INPUT;
+        }
+
+    exit:
+        return retval;
+    }
+
+
+    /*!
+     *  \brief  obtain whether a received frame is a binary batch frame
+     *  \param  frame       the frame
+     *  \param  frame_size  size of the frame
+     *  \return whether the frame is a binary batch frame
+     */
+    static inline bool is_frame(const uint8_t* frame, uint64_t frame_size){
+        uint32_t magic = 0;
+        if(frame_size < sizeof(uint32_t))
+            return false;
+        std::memcpy(&magic, frame, sizeof(uint32_t));
+        return magic == GW_TS_BATCH_FRAME_MAGIC;
+    }
+
+
+    // index of the message type
+    static constexpr gw_message_typeid_t msg_typeid = GW_MESSAGE_TYPEID_COMMON_TS_BATCH_WRITE_DB;
+
+    // uri of the resource
+    std::string uri = "";
+
+    // received samples
+    std::vector<GWUtilTimeSeriesSample> list_samples;
+
+    // encoding of samples on the wire
+    gw_ts_batch_encoding_t encoding = GW_TS_BATCH_ENCODING_COMPACT_LZ4;
+
+ private:
+    /*!
+     *  \brief  decode a compact json stream of samples straight into list_samples, so that
+     *          payloads are decoded in place rather than copied out of decoded samples
+     *  \param  input       the stream
+     *  \param  input_size  size of the stream
+     *  \param  nb_samples  number of samples declared by the frame
+     *  \return GW_SUCCESS if success, GW_FAILED_INVALID_INPUT for malformed stream
+     */
+    inline gw_retval_t __decode_samples(const uint8_t* input, uint64_t input_size, uint64_t nb_samples){
+        gw_retval_t retval = GW_SUCCESS;
+        GWUtilCompactJson::Reader reader(input, input_size);
+        const std::string *key = nullptr;
+        nlohmann::json unknown_value;
+        uint64_t nb_fields = 0, i = 0;
+        bool has_index = false, has_timestamp = false;
+
+        retval = reader.open();
+        if(unlikely(retval != GW_SUCCESS))
+            goto exit;
+
+        this->list_samples.reserve(nb_samples);
+        while(!reader.is_end()){
+            if(unlikely(this->list_samples.size() == nb_samples)){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+            GWUtilTimeSeriesSample& sample = this->list_samples.emplace_back();
+
+            retval = reader.begin_object(nb_fields);
+            if(unlikely(retval != GW_SUCCESS))
+                goto exit;
+            has_index = has_timestamp = false;
+            for(i=0; i<nb_fields; i++){
+                retval = reader.key(key);
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+                if(*key == "index"){
+                    retval = reader.read_uint(sample.index);
+                    has_index = true;
+                } else if(*key == "timestamp"){
+                    retval = reader.read_uint(sample.timestamp);
+                    has_timestamp = true;
+                } else if(*key == "payload"){
+                    retval = reader.read_json(sample.payload);
+                } else {
+                    retval = reader.read_json(unknown_value);
+                }
+                if(unlikely(retval != GW_SUCCESS))
+                    goto exit;
+            }
+            reader.end();
+
+            // same as GWUtilTimeSeriesSample::deserialize
+            if(unlikely(!has_index or !has_timestamp)){
+                retval = GW_FAILED_INVALID_INPUT;
+                goto exit;
+            }
+        }
+
+    exit:
+        return retval;
+    }
+
+    // appended samples to be sent
+    GWUtilCompactJson::Writer _samples_writer;
+};
+
+
 class GWInternalMessagePayload_Common_DB_TS_Read : public GWInternalMessagePayload {
  public:
     GWInternalMessagePayload_Common_DB_TS_Read() : GWInternalMessagePayload() {}